@@ -4,6 +4,8 @@
 
 #include "ElfUtils/ElfFile.h"
 
+#include <algorithm>
+#include <optional>
 #include <string_view>
 #include <vector>
 
@@ -31,7 +33,8 @@ class ElfFileImpl : public ElfFile {
   ElfFileImpl(std::filesystem::path file_path,
               llvm::object::OwningBinary<llvm::object::ObjectFile>&& owning_binary);
 
-  [[nodiscard]] ErrorMessageOr<ModuleSymbols> LoadSymbols() override;
+  [[nodiscard]] ErrorMessageOr<ModuleSymbols> LoadSymbols(ThreadPool* thread_pool,
+                                                          size_t symbols_per_range) override;
   [[nodiscard]] ErrorMessageOr<uint64_t> GetLoadBias() const override;
   [[nodiscard]] bool HasSymtab() const override;
   [[nodiscard]] bool HasDebugInfo() const override;
@@ -42,6 +45,9 @@ class ElfFileImpl : public ElfFile {
 
  private:
   void InitSections();
+  // Returns nullopt for the symbols that are not functions.
+  [[nodiscard]] std::optional<SymbolInfo> LoadSymbol(
+      const llvm::object::ELFSymbolRef& symbol_ref) const;
 
   const std::filesystem::path file_path_;
   llvm::object::OwningBinary<llvm::object::ObjectFile> owning_binary_;
@@ -107,13 +113,42 @@ void ElfFileImpl<ElfT>::InitSections() {
 }
 
 template <typename ElfT>
-ErrorMessageOr<ModuleSymbols> ElfFileImpl<ElfT>::LoadSymbols() {
+std::optional<SymbolInfo> ElfFileImpl<ElfT>::LoadSymbol(
+    const llvm::object::ELFSymbolRef& symbol_ref) const {
+  if ((symbol_ref.getFlags() & llvm::object::BasicSymbolRef::SF_Undefined) != 0) {
+    return std::nullopt;
+  }
+  std::string name = symbol_ref.getName() ? symbol_ref.getName().get() : "";
+
+  // Unknown type - skip and generate a warning
+  if (!symbol_ref.getType()) {
+    LOG("WARNING: Type is not set for symbol \"%s\" in \"%s\", skipping.", name,
+        file_path_.string());
+    return std::nullopt;
+  }
+
+  // Limit list of symbols to functions. Ignore sections and variables.
+  if (symbol_ref.getType().get() != llvm::object::SymbolRef::ST_Function) {
+    return std::nullopt;
+  }
+
+  SymbolInfo symbol_info;
+  symbol_info.set_demangled_name(llvm::demangle(name));
+  symbol_info.set_name(std::move(name));
+  symbol_info.set_address(symbol_ref.getValue());
+  symbol_info.set_size(symbol_ref.getSize());
+  return symbol_info;
+}
+
+template <typename ElfT>
+ErrorMessageOr<ModuleSymbols> ElfFileImpl<ElfT>::LoadSymbols(ThreadPool* thread_pool,
+                                                             size_t symbols_per_range) {
+  CHECK(symbols_per_range > 0);
   // TODO: if we want to use other sections than .symtab in the future for
   //       example .dynsym, than we have to change this.
   if (!has_symtab_section_) {
     return ErrorMessage("ELF file does not have a .symtab section.");
   }
-  bool symbols_added = false;
 
   OUTCOME_TRY(load_bias, GetLoadBias());
 
@@ -121,39 +156,40 @@ ErrorMessageOr<ModuleSymbols> ElfFileImpl<ElfT>::LoadSymbols() {
   module_symbols.set_load_bias(load_bias);
   module_symbols.set_symbols_file_path(file_path_.string());
 
+  // Walking the symbol table is cheap, reading the names and demangling them is what takes time for
+  // large binaries, so that is split in ranges of the table.
+  std::vector<llvm::object::ELFSymbolRef> symbol_refs;
   for (const llvm::object::ELFSymbolRef& symbol_ref : object_file_->symbols()) {
-    if ((symbol_ref.getFlags() & llvm::object::BasicSymbolRef::SF_Undefined) != 0) {
-      continue;
-    }
-    std::string name = symbol_ref.getName() ? symbol_ref.getName().get() : "";
-    std::string demangled_name = llvm::demangle(name);
-
-    // Unknown type - skip and generate a warning
-    if (!symbol_ref.getType()) {
-      LOG("WARNING: Type is not set for symbol \"%s\" in \"%s\", skipping.", name,
-          file_path_.string());
-      continue;
-    }
-
-    // Limit list of symbols to functions. Ignore sections and variables.
-    if (symbol_ref.getType().get() != llvm::object::SymbolRef::ST_Function) {
-      continue;
+    symbol_refs.push_back(symbol_ref);
+  }
+  const size_t range_count = (symbol_refs.size() + symbols_per_range - 1) / symbols_per_range;
+  std::vector<std::vector<SymbolInfo>> range_symbol_infos(range_count);
+  RunTasksInParallel(thread_pool, range_count, [&](size_t range_index) {
+    const size_t begin = range_index * symbols_per_range;
+    const size_t end = std::min(begin + symbols_per_range, symbol_refs.size());
+    for (size_t i = begin; i < end; ++i) {
+      std::optional<SymbolInfo> symbol_info = LoadSymbol(symbol_refs[i]);
+      if (symbol_info.has_value()) {
+        range_symbol_infos[range_index].push_back(std::move(symbol_info.value()));
+      }
     }
+  });
 
-    uint64_t symbol_address = symbol_ref.getValue();
-    SymbolInfo* symbol_info = module_symbols.add_symbol_infos();
-    symbol_info->set_name(name);
-    symbol_info->set_demangled_name(demangled_name);
-    symbol_info->set_address(symbol_address);
-    symbol_info->set_size(symbol_ref.getSize());
-
-    symbols_added = true;
+  size_t symbol_count = 0;
+  for (const std::vector<SymbolInfo>& symbol_infos : range_symbol_infos) {
+    symbol_count += symbol_infos.size();
   }
-  if (!symbols_added) {
+  if (symbol_count == 0) {
     return ErrorMessage(
         "Unable to load symbols from ELF file, not even a single symbol of "
         "type function found.");
   }
+  module_symbols.mutable_symbol_infos()->Reserve(static_cast<int>(symbol_count));
+  for (std::vector<SymbolInfo>& symbol_infos : range_symbol_infos) {
+    for (SymbolInfo& symbol_info : symbol_infos) {
+      *module_symbols.add_symbol_infos() = std::move(symbol_info);
+    }
+  }
   return module_symbols;
 }
 
@@ -7,14 +7,17 @@
 
 #include <fstream>
 #include <utility>
+#include <vector>
 
 #include "ElfUtils/ElfFile.h"
 #include "OrbitBase/ExecutablePath.h"
+#include "OrbitBase/ThreadPool.h"
 #include "absl/strings/ascii.h"
 #include "absl/strings/str_format.h"
 #include "symbol.pb.h"
 
 using orbit_elf_utils::ElfFile;
+using orbit_grpc_protos::ModuleSymbols;
 using orbit_grpc_protos::SymbolInfo;
 
 TEST(ElfFile, LoadSymbols) {
@@ -47,6 +50,33 @@ TEST(ElfFile, LoadSymbols) {
   EXPECT_EQ(symbol_info.size(), 45);
 }
 
+TEST(ElfFile, LoadSymbolsWithThreadPool) {
+  std::filesystem::path file_path =
+      orbit_base::GetExecutableDir() / "testdata" / "hello_world_elf_with_debug_info";
+
+  auto elf_file_result = ElfFile::Create(file_path);
+  ASSERT_TRUE(elf_file_result) << elf_file_result.error().message();
+  std::unique_ptr<ElfFile> elf_file = std::move(elf_file_result.value());
+
+  const auto expected_symbols_result = elf_file->LoadSymbols();
+  ASSERT_TRUE(expected_symbols_result);
+
+  // Small ranges, so that the symbol table of the small test binary is split in many of them, the
+  // last one partial.
+  std::unique_ptr<ThreadPool> thread_pool = ThreadPool::Create(1, 4, absl::Seconds(1));
+  std::vector<ErrorMessageOr<ModuleSymbols>> symbols_results;
+  for (size_t symbols_per_range : {1, 3, 7}) {
+    symbols_results.push_back(elf_file->LoadSymbols(thread_pool.get(), symbols_per_range));
+  }
+  thread_pool->ShutdownAndWait();
+
+  for (const ErrorMessageOr<ModuleSymbols>& symbols_result : symbols_results) {
+    ASSERT_TRUE(symbols_result) << symbols_result.error().message();
+    EXPECT_EQ(symbols_result.value().SerializeAsString(),
+              expected_symbols_result.value().SerializeAsString());
+  }
+}
+
 TEST(ElfFile, CalculateLoadBias) {
   std::filesystem::path executable_dir = orbit_base::GetExecutableDir();
 
@@ -11,6 +11,7 @@
 #include <vector>
 
 #include "OrbitBase/Result.h"
+#include "OrbitBase/ThreadPool.h"
 #include "llvm/Object/Binary.h"
 #include "llvm/Object/ObjectFile.h"
 #include "symbol.pb.h"
@@ -22,7 +23,20 @@ class ElfFile {
   ElfFile() = default;
   virtual ~ElfFile() = default;
 
-  [[nodiscard]] virtual ErrorMessageOr<orbit_grpc_protos::ModuleSymbols> LoadSymbols() = 0;
+  static constexpr size_t kSymbolsPerRange = 16 * 1024;
+
+  // Loads the function symbols of the .symtab section. With a thread pool, the symbols are read
+  // and demangled in parallel, range by range of symbols_per_range symbols of the symbol table, and
+  // returned in table order.
+  [[nodiscard]] virtual ErrorMessageOr<orbit_grpc_protos::ModuleSymbols> LoadSymbols(
+      ThreadPool* thread_pool, size_t symbols_per_range) = 0;
+  [[nodiscard]] ErrorMessageOr<orbit_grpc_protos::ModuleSymbols> LoadSymbols(
+      ThreadPool* thread_pool) {
+    return LoadSymbols(thread_pool, kSymbolsPerRange);
+  }
+  [[nodiscard]] ErrorMessageOr<orbit_grpc_protos::ModuleSymbols> LoadSymbols() {
+    return LoadSymbols(nullptr);
+  }
   // Background and some terminology
   // When an elf file is loaded to memory it has its load segments
   // (segments of PT_LOAD type from program headers) mapped to some
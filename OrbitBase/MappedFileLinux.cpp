@@ -0,0 +1,55 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/strings/str_format.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/MappedFile.h"
+#include "OrbitBase/SafeStrerror.h"
+#include "OrbitBase/UniqueResource.h"
+
+namespace orbit_base {
+
+ErrorMessageOr<std::unique_ptr<MappedFile>> MappedFile::Open(
+    const std::filesystem::path& file_name) {
+  unique_resource fd{open(file_name.c_str(), O_RDONLY | O_CLOEXEC), [](int fd) {
+                       if (fd != -1) close(fd);
+                     }};
+  if (fd.get() == -1) {
+    return ErrorMessage(
+        absl::StrFormat("Unable to open file %s: %s", file_name.string(), SafeStrerror(errno)));
+  }
+
+  struct stat file_stat {};
+  if (fstat(fd.get(), &file_stat) == -1) {
+    return ErrorMessage(
+        absl::StrFormat("Unable to get size of file %s: %s", file_name.string(),
+                        SafeStrerror(errno)));
+  }
+  const auto size = static_cast<uint64_t>(file_stat.st_size);
+  if (size == 0) {
+    return std::unique_ptr<MappedFile>(new MappedFile(nullptr, 0));
+  }
+
+  // The mapping stays valid after the file descriptor is closed.
+  void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd.get(), 0);
+  if (data == MAP_FAILED) {
+    return ErrorMessage(
+        absl::StrFormat("Unable to map file %s: %s", file_name.string(), SafeStrerror(errno)));
+  }
+  return std::unique_ptr<MappedFile>(new MappedFile(static_cast<const char*>(data), size));
+}
+
+MappedFile::~MappedFile() {
+  if (data_ == nullptr) return;
+  if (munmap(const_cast<char*>(data_), size_) == -1) {
+    ERROR("Unable to unmap file: %s", SafeStrerror(errno));
+  }
+}
+
+}  // namespace orbit_base
@@ -0,0 +1,23 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include <string_view>
+
+#include "OrbitBase/ExecutablePath.h"
+#include "OrbitBase/MappedFile.h"
+
+TEST(MappedFile, InvalidFile) {
+  const auto result = orbit_base::MappedFile::Open("non/existing/filename");
+  ASSERT_FALSE(result);
+}
+
+TEST(MappedFile, Smoke) {
+  const auto result = orbit_base::MappedFile::Open(orbit_base::GetExecutableDir() / "testdata" /
+                                                   "OrbitBase" / "textfile.txt");
+  ASSERT_TRUE(result) << result.error().message();
+  const orbit_base::MappedFile& mapped_file = *result.value();
+  EXPECT_EQ(std::string_view(mapped_file.data(), mapped_file.size()), "content\nnew line");
+}
@@ -0,0 +1,59 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/strings/str_format.h>
+#include <windows.h>
+
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/MappedFile.h"
+#include "OrbitBase/UniqueResource.h"
+
+namespace orbit_base {
+
+ErrorMessageOr<std::unique_ptr<MappedFile>> MappedFile::Open(
+    const std::filesystem::path& file_name) {
+  auto close_handle = [](HANDLE handle) {
+    if (handle != nullptr && handle != INVALID_HANDLE_VALUE) CloseHandle(handle);
+  };
+  unique_resource file{CreateFileW(file_name.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                   OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr),
+                       close_handle};
+  if (file.get() == INVALID_HANDLE_VALUE) {
+    return ErrorMessage(absl::StrFormat("Unable to open file %s: error %d", file_name.string(),
+                                        GetLastError()));
+  }
+
+  LARGE_INTEGER file_size;
+  if (!GetFileSizeEx(file.get(), &file_size)) {
+    return ErrorMessage(absl::StrFormat("Unable to get size of file %s: error %d",
+                                        file_name.string(), GetLastError()));
+  }
+  const auto size = static_cast<uint64_t>(file_size.QuadPart);
+  if (size == 0) {
+    return std::unique_ptr<MappedFile>(new MappedFile(nullptr, 0));
+  }
+
+  // The view stays valid after the file and mapping handles are closed.
+  unique_resource mapping{CreateFileMappingW(file.get(), nullptr, PAGE_READONLY, 0, 0, nullptr),
+                          close_handle};
+  if (mapping.get() == nullptr) {
+    return ErrorMessage(absl::StrFormat("Unable to map file %s: error %d", file_name.string(),
+                                        GetLastError()));
+  }
+  const void* data = MapViewOfFile(mapping.get(), FILE_MAP_READ, 0, 0, 0);
+  if (data == nullptr) {
+    return ErrorMessage(absl::StrFormat("Unable to map file %s: error %d", file_name.string(),
+                                        GetLastError()));
+  }
+  return std::unique_ptr<MappedFile>(new MappedFile(static_cast<const char*>(data), size));
+}
+
+MappedFile::~MappedFile() {
+  if (data_ == nullptr) return;
+  if (!UnmapViewOfFile(data_)) {
+    ERROR("Unable to unmap file: error %d", GetLastError());
+  }
+}
+
+}  // namespace orbit_base
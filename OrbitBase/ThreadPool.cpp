@@ -4,12 +4,15 @@
 
 #include "OrbitBase/ThreadPool.h"
 
+#include <algorithm>
+#include <atomic>
 #include <list>
 #include <thread>
 
 #include "OrbitBase/Logging.h"
 #include "OrbitBase/Tracing.h"
 #include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/blocking_counter.h"
 #include "absl/synchronization/mutex.h"
 
 namespace {
@@ -188,3 +191,34 @@ std::unique_ptr<ThreadPool> ThreadPool::Create(size_t thread_pool_min_size,
                                                absl::Duration thread_ttl) {
   return std::make_unique<ThreadPoolImpl>(thread_pool_min_size, thread_pool_max_size, thread_ttl);
 }
+
+void RunTasksInParallel(ThreadPool* thread_pool, size_t task_count,
+                        const std::function<void(size_t)>& task) {
+  if (thread_pool == nullptr || task_count <= 1) {
+    for (size_t i = 0; i < task_count; ++i) {
+      task(i);
+    }
+    return;
+  }
+
+  // Workers pick the next task when they are done with the previous one, so that a few long tasks
+  // don't leave the other workers idle.
+  constexpr size_t kMaxWorkerCount = 16;
+  const size_t worker_count = std::min(task_count, kMaxWorkerCount);
+  std::atomic<size_t> next_task = 0;
+  auto run_tasks = [&task, &next_task, task_count] {
+    for (size_t i = next_task++; i < task_count; i = next_task++) {
+      task(i);
+    }
+  };
+
+  absl::BlockingCounter workers_left(worker_count - 1);
+  for (size_t worker = 0; worker + 1 < worker_count; ++worker) {
+    thread_pool->Schedule([&run_tasks, &workers_left] {
+      run_tasks();
+      workers_left.DecrementCount();
+    });
+  }
+  run_tasks();
+  workers_left.Wait();
+}
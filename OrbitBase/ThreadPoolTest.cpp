@@ -4,7 +4,9 @@
 
 #include <gtest/gtest.h>
 
+#include <atomic>
 #include <memory>
+#include <vector>
 
 #include "OrbitBase/ThreadPool.h"
 #include "absl/synchronization/mutex.h"
@@ -376,3 +378,19 @@ TEST(ThreadPool, WaitWithoutShutdown) {
       },
       "");
 }
+
+TEST(ThreadPool, RunTasksInParallel) {
+  constexpr size_t kTaskCount = 1000;
+  std::vector<std::atomic<int>> run_counts(kTaskCount);
+  auto task = [&run_counts](size_t index) { ++run_counts[index]; };
+
+  RunTasksInParallel(nullptr, kTaskCount, task);
+  std::unique_ptr<ThreadPool> thread_pool = ThreadPool::Create(1, 4, absl::Milliseconds(5));
+  RunTasksInParallel(thread_pool.get(), kTaskCount, task);
+  RunTasksInParallel(thread_pool.get(), 0, task);
+  thread_pool->ShutdownAndWait();
+
+  for (const std::atomic<int>& run_count : run_counts) {
+    EXPECT_EQ(run_count, 2);
+  }
+}
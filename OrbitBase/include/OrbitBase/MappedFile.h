@@ -0,0 +1,40 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_BASE_MAPPED_FILE_H_
+#define ORBIT_BASE_MAPPED_FILE_H_
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+
+#include "OrbitBase/Result.h"
+
+namespace orbit_base {
+
+// A whole file mapped read-only in memory. The pages of the file are only read when they are
+// accessed, and the system can drop them again under memory pressure, so mapping even a very large
+// file is cheap and only the parts that are used are resident.
+class MappedFile {
+ public:
+  static ErrorMessageOr<std::unique_ptr<MappedFile>> Open(const std::filesystem::path& file_name);
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  ~MappedFile();
+
+  // data() is null for an empty file.
+  [[nodiscard]] const char* data() const { return data_; }
+  [[nodiscard]] uint64_t size() const { return size_; }
+
+ private:
+  MappedFile(const char* data, uint64_t size) : data_{data}, size_{size} {}
+
+  const char* data_;
+  uint64_t size_;
+};
+
+}  // namespace orbit_base
+
+#endif  // ORBIT_BASE_MAPPED_FILE_H_
@@ -5,6 +5,7 @@
 #ifndef ORBIT_BASE_THREAD_POOL_H_
 #define ORBIT_BASE_THREAD_POOL_H_
 
+#include <functional>
 #include <memory>
 
 #include "OrbitBase/Action.h"
@@ -74,4 +75,9 @@ class ThreadPool {
                                             size_t thread_pool_max_size, absl::Duration thread_ttl);
 };
 
+// Runs task(0), ..., task(task_count - 1) on thread_pool and on the calling thread, and returns
+// when all of them are done. Without a thread pool, runs them in order on the calling thread.
+void RunTasksInParallel(ThreadPool* thread_pool, size_t task_count,
+                        const std::function<void(size_t)>& task);
+
 #endif  // ORBIT_BASE_THREAD_POOL_H_
@@ -16,6 +16,7 @@
 ABSL_DECLARE_FLAG(uint16_t, sampling_rate);
 ABSL_DECLARE_FLAG(bool, frame_pointer_unwinding);
 ABSL_DECLARE_FLAG(bool, thread_state);
+ABSL_DECLARE_FLAG(std::string, capture_response_compression);
 
 using orbit_client_protos::FunctionInfo;
 
@@ -36,6 +37,20 @@ static CaptureOptions::InstrumentedFunction::FunctionType IntrumentedFunctionTyp
   }
 }
 
+static CaptureOptions::CaptureResponseCompression CaptureResponseCompressionFromFlag(
+    const std::string& flag_value) {
+  if (flag_value == "deflate") {
+    return CaptureOptions::kDeflate;
+  }
+  if (flag_value == "gzip") {
+    return CaptureOptions::kGzip;
+  }
+  if (flag_value != "none") {
+    ERROR("Unknown capture response compression \"%s\", not using compression", flag_value);
+  }
+  return CaptureOptions::kNoCompression;
+}
+
 ErrorMessageOr<void> CaptureClient::StartCapture(
     ThreadPool* thread_pool, const ProcessData& process,
     const orbit_client_data::ModuleManager& module_manager,
@@ -121,6 +136,10 @@ void CaptureClient::Capture(ProcessData&& process,
   }
 
   capture_options->set_enable_introspection(enable_introspection);
+  // CaptureEventProcessor can decode PackedCaptureEvents.
+  capture_options->set_enable_packed_capture_events(true);
+  capture_options->set_capture_response_compression(
+      CaptureResponseCompressionFromFlag(absl::GetFlag(FLAGS_capture_response_compression)));
 
   if (!reader_writer_->Write(request)) {
     ERROR("Sending CaptureRequest on Capture's gRPC stream");
@@ -22,10 +22,25 @@ using orbit_grpc_protos::GpuJob;
 using orbit_grpc_protos::InternedCallstack;
 using orbit_grpc_protos::InternedString;
 using orbit_grpc_protos::IntrospectionScope;
+using orbit_grpc_protos::PackedCallstackSamples;
+using orbit_grpc_protos::PackedCaptureEvents;
+using orbit_grpc_protos::PackedFunctionCalls;
+using orbit_grpc_protos::PackedSchedulingSlices;
+using orbit_grpc_protos::PackedThread;
 using orbit_grpc_protos::SchedulingSlice;
 using orbit_grpc_protos::ThreadName;
 using orbit_grpc_protos::ThreadStateSlice;
 
+namespace {
+
+// Packed timestamps are deltas modulo 2^64 from the previous timestamp of the same column.
+uint64_t ApplyTimestampDelta(int64_t delta, uint64_t* last_timestamp_ns) {
+  *last_timestamp_ns += static_cast<uint64_t>(delta);
+  return *last_timestamp_ns;
+}
+
+}  // namespace
+
 void CaptureEventProcessor::ProcessEvent(const CaptureEvent& event) {
   switch (event.event_case()) {
     case CaptureEvent::kSchedulingSlice:
@@ -66,6 +81,9 @@ void CaptureEventProcessor::ProcessEvent(const CaptureEvent& event) {
       break;
     case CaptureEvent::kGpuQueueSubmission:
       UNREACHABLE();
+    case CaptureEvent::kPackedCaptureEvents:
+      ProcessPackedCaptureEvents(event.packed_capture_events());
+      break;
     case CaptureEvent::kModulesUpdateEvent:
       // TODO (http://b/168797897): Process module update events
       break;
@@ -76,12 +94,20 @@ void CaptureEventProcessor::ProcessEvent(const CaptureEvent& event) {
 }
 
 void CaptureEventProcessor::ProcessSchedulingSlice(const SchedulingSlice& scheduling_slice) {
+  SendSchedulingSliceToListener(scheduling_slice.pid(), scheduling_slice.tid(),
+                                scheduling_slice.core(), scheduling_slice.in_timestamp_ns(),
+                                scheduling_slice.out_timestamp_ns());
+}
+
+void CaptureEventProcessor::SendSchedulingSliceToListener(int32_t pid, int32_t tid, int32_t core,
+                                                          uint64_t in_timestamp_ns,
+                                                          uint64_t out_timestamp_ns) {
   TimerInfo timer_info;
-  timer_info.set_start(scheduling_slice.in_timestamp_ns());
-  timer_info.set_end(scheduling_slice.out_timestamp_ns());
-  timer_info.set_process_id(scheduling_slice.pid());
-  timer_info.set_thread_id(scheduling_slice.tid());
-  timer_info.set_processor(static_cast<int8_t>(scheduling_slice.core()));
+  timer_info.set_start(in_timestamp_ns);
+  timer_info.set_end(out_timestamp_ns);
+  timer_info.set_process_id(pid);
+  timer_info.set_thread_id(tid);
+  timer_info.set_processor(static_cast<int8_t>(core));
   timer_info.set_depth(timer_info.processor());
   timer_info.set_type(TimerInfo::kCoreActivity);
 
@@ -97,40 +123,150 @@ void CaptureEventProcessor::ProcessInternedCallstack(InternedCallstack interned_
 }
 
 void CaptureEventProcessor::ProcessCallstackSample(const CallstackSample& callstack_sample) {
-  Callstack callstack;
   if (callstack_sample.callstack_or_key_case() == CallstackSample::kCallstackKey) {
-    callstack = callstack_intern_pool[callstack_sample.callstack_key()];
+    SendCallstackSampleToListener(callstack_sample.tid(), callstack_sample.timestamp_ns(),
+                                  callstack_intern_pool[callstack_sample.callstack_key()]);
   } else {
-    callstack = callstack_sample.callstack();
+    SendCallstackSampleToListener(callstack_sample.tid(), callstack_sample.timestamp_ns(),
+                                  callstack_sample.callstack());
   }
+}
 
+void CaptureEventProcessor::SendCallstackSampleToListener(int32_t tid, uint64_t timestamp_ns,
+                                                          const Callstack& callstack) {
   uint64_t hash = GetCallstackHashAndSendToListenerIfNecessary(callstack);
   CallstackEvent callstack_event;
-  callstack_event.set_time(callstack_sample.timestamp_ns());
+  callstack_event.set_time(timestamp_ns);
   callstack_event.set_callstack_hash(hash);
-  callstack_event.set_thread_id(callstack_sample.tid());
+  callstack_event.set_thread_id(tid);
   capture_listener_->OnCallstackEvent(std::move(callstack_event));
 }
 
 void CaptureEventProcessor::ProcessFunctionCall(const FunctionCall& function_call) {
+  SendFunctionCallToListener(
+      function_call.pid(), function_call.tid(), function_call.absolute_address(),
+      function_call.begin_timestamp_ns(), function_call.end_timestamp_ns(), function_call.depth(),
+      function_call.return_value(),
+      absl::MakeConstSpan(function_call.registers().data(), function_call.registers_size()));
+}
+
+void CaptureEventProcessor::SendFunctionCallToListener(
+    int32_t pid, int32_t tid, uint64_t absolute_address, uint64_t begin_timestamp_ns,
+    uint64_t end_timestamp_ns, int32_t depth, uint64_t return_value,
+    absl::Span<const uint64_t> registers) {
   TimerInfo timer_info;
-  timer_info.set_process_id(function_call.pid());
-  timer_info.set_thread_id(function_call.tid());
-  timer_info.set_start(function_call.begin_timestamp_ns());
-  timer_info.set_end(function_call.end_timestamp_ns());
-  timer_info.set_depth(static_cast<uint8_t>(function_call.depth()));
-  timer_info.set_function_address(function_call.absolute_address());
-  timer_info.set_user_data_key(function_call.return_value());
+  timer_info.set_process_id(pid);
+  timer_info.set_thread_id(tid);
+  timer_info.set_start(begin_timestamp_ns);
+  timer_info.set_end(end_timestamp_ns);
+  timer_info.set_depth(static_cast<uint8_t>(depth));
+  timer_info.set_function_address(absolute_address);
+  timer_info.set_user_data_key(return_value);
   timer_info.set_processor(-1);
   timer_info.set_type(TimerInfo::kNone);
 
-  for (int i = 0; i < function_call.registers_size(); ++i) {
-    timer_info.add_registers(function_call.registers(i));
+  timer_info.mutable_registers()->Reserve(static_cast<int>(registers.size()));
+  for (uint64_t register_value : registers) {
+    timer_info.add_registers(register_value);
   }
 
   capture_listener_->OnTimer(timer_info);
 }
 
+// The packed events come from the network, so malformed columns are reported and the corresponding
+// events dropped, instead of crashing.
+void CaptureEventProcessor::ProcessPackedCaptureEvents(const PackedCaptureEvents& packed_events) {
+  ProcessPackedSchedulingSlices(packed_events);
+  ProcessPackedCallstackSamples(packed_events);
+  ProcessPackedFunctionCalls(packed_events);
+}
+
+void CaptureEventProcessor::ProcessPackedSchedulingSlices(
+    const PackedCaptureEvents& packed_events) {
+  const PackedSchedulingSlices& columns = packed_events.scheduling_slices();
+  const int count = columns.thread_index_size();
+  if (columns.core_size() != count || columns.in_timestamp_ns_delta_size() != count ||
+      columns.duration_ns_size() != count) {
+    ERROR("Inconsistent column sizes in PackedSchedulingSlices");
+    return;
+  }
+
+  uint64_t in_timestamp_ns = 0;
+  for (int i = 0; i < count; ++i) {
+    ApplyTimestampDelta(columns.in_timestamp_ns_delta(i), &in_timestamp_ns);
+    uint32_t thread_index = columns.thread_index(i);
+    if (thread_index >= static_cast<uint32_t>(packed_events.threads_size())) {
+      ERROR("Invalid thread index %u in PackedSchedulingSlices", thread_index);
+      continue;
+    }
+    const PackedThread& thread = packed_events.threads(static_cast<int>(thread_index));
+    SendSchedulingSliceToListener(thread.pid(), thread.tid(), columns.core(i), in_timestamp_ns,
+                                  in_timestamp_ns + columns.duration_ns(i));
+  }
+}
+
+void CaptureEventProcessor::ProcessPackedCallstackSamples(
+    const PackedCaptureEvents& packed_events) {
+  const PackedCallstackSamples& columns = packed_events.callstack_samples();
+  const int count = columns.thread_index_size();
+  if (columns.callstack_key_size() != count || columns.timestamp_ns_delta_size() != count) {
+    ERROR("Inconsistent column sizes in PackedCallstackSamples");
+    return;
+  }
+
+  uint64_t timestamp_ns = 0;
+  for (int i = 0; i < count; ++i) {
+    ApplyTimestampDelta(columns.timestamp_ns_delta(i), &timestamp_ns);
+    uint32_t thread_index = columns.thread_index(i);
+    if (thread_index >= static_cast<uint32_t>(packed_events.threads_size())) {
+      ERROR("Invalid thread index %u in PackedCallstackSamples", thread_index);
+      continue;
+    }
+    const PackedThread& thread = packed_events.threads(static_cast<int>(thread_index));
+    SendCallstackSampleToListener(thread.tid(), timestamp_ns,
+                                  callstack_intern_pool[columns.callstack_key(i)]);
+  }
+}
+
+void CaptureEventProcessor::ProcessPackedFunctionCalls(const PackedCaptureEvents& packed_events) {
+  const PackedFunctionCalls& columns = packed_events.function_calls();
+  const int count = columns.thread_index_size();
+  if (columns.absolute_address_size() != count ||
+      columns.begin_timestamp_ns_delta_size() != count || columns.duration_ns_size() != count ||
+      columns.depth_size() != count || columns.return_value_size() != count ||
+      columns.register_count_size() != count) {
+    ERROR("Inconsistent column sizes in PackedFunctionCalls");
+    return;
+  }
+  uint64_t total_register_count = 0;
+  for (uint32_t register_count : columns.register_count()) {
+    total_register_count += register_count;
+  }
+  if (total_register_count != static_cast<uint64_t>(columns.registers_size())) {
+    ERROR("Inconsistent register count in PackedFunctionCalls");
+    return;
+  }
+
+  absl::Span<const uint64_t> remaining_registers =
+      absl::MakeConstSpan(columns.registers().data(), columns.registers_size());
+  uint64_t begin_timestamp_ns = 0;
+  for (int i = 0; i < count; ++i) {
+    ApplyTimestampDelta(columns.begin_timestamp_ns_delta(i), &begin_timestamp_ns);
+    absl::Span<const uint64_t> registers =
+        remaining_registers.subspan(0, columns.register_count(i));
+    remaining_registers.remove_prefix(registers.size());
+    uint32_t thread_index = columns.thread_index(i);
+    if (thread_index >= static_cast<uint32_t>(packed_events.threads_size())) {
+      ERROR("Invalid thread index %u in PackedFunctionCalls", thread_index);
+      continue;
+    }
+    const PackedThread& thread = packed_events.threads(static_cast<int>(thread_index));
+    SendFunctionCallToListener(thread.pid(), thread.tid(), columns.absolute_address(i),
+                               begin_timestamp_ns, begin_timestamp_ns + columns.duration_ns(i),
+                               columns.depth(i), columns.return_value(i), registers);
+  }
+}
+
 void CaptureEventProcessor::ProcessIntrospectionScope(
     const IntrospectionScope& introspection_scope) {
   TimerInfo timer_info;
@@ -24,6 +24,11 @@ using orbit_grpc_protos::InternedCallstack;
 using orbit_grpc_protos::InternedString;
 using orbit_grpc_protos::InternedTracepointInfo;
 using orbit_grpc_protos::IntrospectionScope;
+using orbit_grpc_protos::PackedCallstackSamples;
+using orbit_grpc_protos::PackedCaptureEvents;
+using orbit_grpc_protos::PackedFunctionCalls;
+using orbit_grpc_protos::PackedSchedulingSlices;
+using orbit_grpc_protos::PackedThread;
 using orbit_grpc_protos::SchedulingSlice;
 using orbit_grpc_protos::ThreadName;
 using orbit_grpc_protos::ThreadStateSlice;
@@ -564,6 +569,120 @@ TEST(CaptureEventProcessor, CanHandleThreadStateSlices) {
   EXPECT_EQ(actual_dead_thread_state_slice_info.thread_state(), ThreadStateSliceInfo::kDead);
 }
 
+TEST(CaptureEventProcessor, CanHandlePackedCaptureEvents) {
+  MockCaptureListener listener;
+  CaptureEventProcessor event_processor(&listener);
+
+  CaptureEvent interned_callstack_event;
+  InternedCallstack* interned_callstack = interned_callstack_event.mutable_interned_callstack();
+  interned_callstack->set_key(2);
+  interned_callstack->mutable_intern()->add_pcs(15);
+
+  CaptureEvent packed_event;
+  PackedCaptureEvents* packed_events = packed_event.mutable_packed_capture_events();
+  PackedThread* thread = packed_events->add_threads();
+  thread->set_pid(42);
+  thread->set_tid(24);
+
+  PackedSchedulingSlices* scheduling_slices = packed_events->mutable_scheduling_slices();
+  scheduling_slices->add_thread_index(0);
+  scheduling_slices->add_core(2);
+  scheduling_slices->add_in_timestamp_ns_delta(1000);
+  scheduling_slices->add_duration_ns(100);
+  scheduling_slices->add_thread_index(0);
+  scheduling_slices->add_core(3);
+  scheduling_slices->add_in_timestamp_ns_delta(-500);
+  scheduling_slices->add_duration_ns(50);
+
+  PackedCallstackSamples* callstack_samples = packed_events->mutable_callstack_samples();
+  callstack_samples->add_thread_index(0);
+  callstack_samples->add_callstack_key(interned_callstack->key());
+  callstack_samples->add_timestamp_ns_delta(700);
+
+  PackedFunctionCalls* function_calls = packed_events->mutable_function_calls();
+  function_calls->add_thread_index(0);
+  function_calls->add_absolute_address(0xABCD);
+  function_calls->add_begin_timestamp_ns_delta(800);
+  function_calls->add_duration_ns(20);
+  function_calls->add_depth(3);
+  function_calls->add_return_value(7);
+  function_calls->add_register_count(2);
+  function_calls->add_registers(5);
+  function_calls->add_registers(6);
+
+  std::vector<TimerInfo> actual_timers;
+  EXPECT_CALL(listener, OnTimer).Times(3).WillRepeatedly([&actual_timers](const TimerInfo& timer) {
+    actual_timers.push_back(timer);
+  });
+  EXPECT_CALL(listener, OnUniqueCallStack).Times(1);
+  CallstackEvent actual_callstack_event;
+  EXPECT_CALL(listener, OnCallstackEvent).Times(1).WillOnce(SaveArg<0>(&actual_callstack_event));
+
+  event_processor.ProcessEvent(interned_callstack_event);
+  event_processor.ProcessEvent(packed_event);
+
+  ASSERT_EQ(actual_timers.size(), 3);
+  EXPECT_EQ(actual_timers[0].type(), TimerInfo::kCoreActivity);
+  EXPECT_EQ(actual_timers[0].start(), 1000);
+  EXPECT_EQ(actual_timers[0].end(), 1100);
+  EXPECT_EQ(actual_timers[0].process_id(), 42);
+  EXPECT_EQ(actual_timers[0].thread_id(), 24);
+  EXPECT_EQ(actual_timers[0].processor(), 2);
+  EXPECT_EQ(actual_timers[1].start(), 500);
+  EXPECT_EQ(actual_timers[1].end(), 550);
+  EXPECT_EQ(actual_timers[1].processor(), 3);
+
+  EXPECT_EQ(actual_callstack_event.time(), 700);
+  EXPECT_EQ(actual_callstack_event.thread_id(), 24);
+
+  EXPECT_EQ(actual_timers[2].type(), TimerInfo::kNone);
+  EXPECT_EQ(actual_timers[2].start(), 800);
+  EXPECT_EQ(actual_timers[2].end(), 820);
+  EXPECT_EQ(actual_timers[2].function_address(), 0xABCD);
+  EXPECT_EQ(actual_timers[2].depth(), 3);
+  EXPECT_EQ(actual_timers[2].user_data_key(), 7);
+  ASSERT_EQ(actual_timers[2].registers_size(), 2);
+  EXPECT_EQ(actual_timers[2].registers(0), 5);
+  EXPECT_EQ(actual_timers[2].registers(1), 6);
+}
+
+TEST(CaptureEventProcessor, IgnoresMalformedPackedCaptureEvents) {
+  MockCaptureListener listener;
+  CaptureEventProcessor event_processor(&listener);
+
+  CaptureEvent packed_event;
+  PackedCaptureEvents* packed_events = packed_event.mutable_packed_capture_events();
+  packed_events->add_threads();
+
+  // Missing duration.
+  PackedSchedulingSlices* scheduling_slices = packed_events->mutable_scheduling_slices();
+  scheduling_slices->add_thread_index(0);
+  scheduling_slices->add_core(2);
+  scheduling_slices->add_in_timestamp_ns_delta(1000);
+
+  // Invalid thread index.
+  PackedCallstackSamples* callstack_samples = packed_events->mutable_callstack_samples();
+  callstack_samples->add_thread_index(1);
+  callstack_samples->add_callstack_key(2);
+  callstack_samples->add_timestamp_ns_delta(700);
+
+  // Too few registers.
+  PackedFunctionCalls* function_calls = packed_events->mutable_function_calls();
+  function_calls->add_thread_index(0);
+  function_calls->add_absolute_address(0xABCD);
+  function_calls->add_begin_timestamp_ns_delta(800);
+  function_calls->add_duration_ns(20);
+  function_calls->add_depth(3);
+  function_calls->add_return_value(7);
+  function_calls->add_register_count(2);
+  function_calls->add_registers(5);
+
+  EXPECT_CALL(listener, OnTimer).Times(0);
+  EXPECT_CALL(listener, OnCallstackEvent).Times(0);
+
+  event_processor.ProcessEvent(packed_event);
+}
+
 TEST(CaptureEventProcessor, CanHandleMultipleEvents) {
   MockCaptureListener listener;
   CaptureEventProcessor event_processor(&listener);
@@ -8,6 +8,7 @@
 #include "OrbitCaptureClient/CaptureListener.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
+#include "absl/types/span.h"
 #include "services.pb.h"
 
 class CaptureEventProcessor {
@@ -38,6 +39,21 @@ class CaptureEventProcessor {
   void ProcessInternedTracepointInfo(
       orbit_grpc_protos::InternedTracepointInfo interned_tracepoint_info);
   void ProcessTracepointEvent(const orbit_grpc_protos::TracepointEvent& tracepoint_event);
+  void ProcessPackedCaptureEvents(const orbit_grpc_protos::PackedCaptureEvents& packed_events);
+  void ProcessPackedSchedulingSlices(const orbit_grpc_protos::PackedCaptureEvents& packed_events);
+  void ProcessPackedCallstackSamples(const orbit_grpc_protos::PackedCaptureEvents& packed_events);
+  void ProcessPackedFunctionCalls(const orbit_grpc_protos::PackedCaptureEvents& packed_events);
+
+  // These are shared by the individual and the packed events, so that the latter are converted
+  // directly from their columns, without creating the corresponding individual events.
+  void SendSchedulingSliceToListener(int32_t pid, int32_t tid, int32_t core,
+                                     uint64_t in_timestamp_ns, uint64_t out_timestamp_ns);
+  void SendCallstackSampleToListener(int32_t tid, uint64_t timestamp_ns,
+                                     const orbit_grpc_protos::Callstack& callstack);
+  void SendFunctionCallToListener(int32_t pid, int32_t tid, uint64_t absolute_address,
+                                  uint64_t begin_timestamp_ns, uint64_t end_timestamp_ns,
+                                  int32_t depth, uint64_t return_value,
+                                  absl::Span<const uint64_t> registers);
 
   absl::flat_hash_map<uint64_t, orbit_grpc_protos::Callstack> callstack_intern_pool;
   absl::flat_hash_map<uint64_t, std::string> string_intern_pool;
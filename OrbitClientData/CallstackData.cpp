@@ -15,8 +15,7 @@ void CallstackData::AddCallstackEvent(CallstackEvent callstack_event) {
   CallstackID hash = callstack_event.callstack_hash();
   CHECK(unique_callstacks_.contains(hash));
   RegisterTime(callstack_event.time());
-  callstack_events_by_tid_[callstack_event.thread_id()][callstack_event.time()] =
-      std::move(callstack_event);
+  callstack_events_by_tid_[callstack_event.thread_id()].Add(callstack_event.time(), hash);
 }
 
 void CallstackData::RegisterTime(uint64_t time) {
@@ -39,21 +38,30 @@ uint32_t CallstackData::GetCallstackEventsCount() const {
   return count;
 }
 
+namespace {
+
+void AppendCallstackEvents(int32_t thread_id, absl::Span<const uint64_t> times,
+                           absl::Span<const CallstackID> callstack_ids,
+                           std::vector<CallstackEvent>* callstack_events) {
+  for (size_t i = 0; i < times.size(); ++i) {
+    CallstackEvent& event = callstack_events->emplace_back();
+    event.set_time(times[i]);
+    event.set_callstack_hash(callstack_ids[i]);
+    event.set_thread_id(thread_id);
+  }
+}
+
+}  // namespace
+
 std::vector<orbit_client_protos::CallstackEvent> CallstackData::GetCallstackEventsInTimeRange(
     uint64_t time_begin, uint64_t time_end) const {
-  std::lock_guard lock(mutex_);
   std::vector<CallstackEvent> callstack_events;
-  for (const auto& tid_and_events : callstack_events_by_tid_) {
-    const std::map<uint64_t, CallstackEvent>& events = tid_and_events.second;
-    for (auto event_it = events.lower_bound(time_begin); event_it != events.end(); ++event_it) {
-      uint64_t time = event_it->first;
-      if (time < time_end) {
-        callstack_events.push_back(event_it->second);
-      } else {
-        break;
-      }
-    }
-  }
+  ForEachCallstackEventSpanInTimeRange(
+      time_begin, time_end,
+      [&callstack_events](int32_t thread_id, absl::Span<const uint64_t> times,
+                          absl::Span<const CallstackID> callstack_ids) {
+        AppendCallstackEvents(thread_id, times, callstack_ids, &callstack_events);
+      });
   return callstack_events;
 }
 
@@ -77,33 +85,47 @@ uint32_t CallstackData::GetCallstackEventsOfTidCount(int32_t thread_id) const {
 
 std::vector<CallstackEvent> CallstackData::GetCallstackEventsOfTidInTimeRange(
     int32_t tid, uint64_t time_begin, uint64_t time_end) const {
-  std::lock_guard lock(mutex_);
   std::vector<CallstackEvent> callstack_events;
+  ForEachCallstackEventSpanOfTidInTimeRange(
+      tid, time_begin, time_end,
+      [tid, &callstack_events](absl::Span<const uint64_t> times,
+                               absl::Span<const CallstackID> callstack_ids) {
+        AppendCallstackEvents(tid, times, callstack_ids, &callstack_events);
+      });
+  return callstack_events;
+}
 
-  auto tid_and_events_it = callstack_events_by_tid_.find(tid);
-  if (tid_and_events_it == callstack_events_by_tid_.end()) {
-    return callstack_events;
+void CallstackData::ForEachCallstackEventSpanInTimeRange(
+    uint64_t time_begin, uint64_t time_end,
+    const std::function<void(int32_t, absl::Span<const uint64_t>, absl::Span<const CallstackID>)>&
+        action) const {
+  std::lock_guard lock(mutex_);
+  for (const auto& [tid, events] : callstack_events_by_tid_) {
+    events.ForEachSpanInTimeRange(
+        time_begin, time_end,
+        [tid = tid, &action](absl::Span<const uint64_t> times,
+                             absl::Span<const CallstackID> callstack_ids) {
+          action(tid, times, callstack_ids);
+        });
   }
+}
 
-  const std::map<uint64_t, CallstackEvent>& events = tid_and_events_it->second;
-  for (auto event_it = events.lower_bound(time_begin); event_it != events.end(); ++event_it) {
-    uint64_t time = event_it->first;
-    if (time < time_end) {
-      callstack_events.push_back(event_it->second);
-    } else {
-      break;
-    }
+void CallstackData::ForEachCallstackEventSpanOfTidInTimeRange(
+    int32_t tid, uint64_t time_begin, uint64_t time_end,
+    const ThreadCallstackEvents::SpanAction& action) const {
+  std::lock_guard lock(mutex_);
+  auto tid_and_events_it = callstack_events_by_tid_.find(tid);
+  if (tid_and_events_it == callstack_events_by_tid_.end()) {
+    return;
   }
-  return callstack_events;
+  tid_and_events_it->second.ForEachSpanInTimeRange(time_begin, time_end, action);
 }
 
 void CallstackData::ForEachCallstackEvent(
     const std::function<void(const orbit_client_protos::CallstackEvent&)>& action) const {
   std::lock_guard lock(mutex_);
   for (const auto& tid_and_events : callstack_events_by_tid_) {
-    for (const auto& time_and_event : tid_and_events.second) {
-      action(time_and_event.second);
-    }
+    ForEachCallstackEventOfTid(tid_and_events.first, action);
   }
 }
 
@@ -115,9 +137,26 @@ void CallstackData::ForEachCallstackEventOfTid(
   if (tid_and_events_it == callstack_events_by_tid_.end()) {
     return;
   }
-  for (const auto& time_and_event : tid_and_events_it->second) {
-    action(time_and_event.second);
-  }
+  const ThreadCallstackEvents& events = tid_and_events_it->second;
+  CallstackEvent event;
+  event.set_thread_id(tid);
+  events.ForEachSpan(0, events.size(),
+                     [&event, &action](absl::Span<const uint64_t> times,
+                                       absl::Span<const CallstackID> callstack_ids) {
+                       for (size_t i = 0; i < times.size(); ++i) {
+                         event.set_time(times[i]);
+                         event.set_callstack_hash(callstack_ids[i]);
+                         action(event);
+                       }
+                     });
+}
+
+void CallstackData::VisitCallstackEventsAndUniqueCallstacks(
+    const std::function<void(const absl::flat_hash_map<int32_t, ThreadCallstackEvents>&,
+                             const absl::flat_hash_map<CallstackID, std::shared_ptr<CallStack>>&)>&
+        action) const {
+  std::lock_guard lock(mutex_);
+  action(callstack_events_by_tid_, unique_callstacks_);
 }
 
 void CallstackData::AddCallStackFromKnownCallstackData(const CallstackEvent& event,
@@ -131,7 +170,7 @@ void CallstackData::AddCallStackFromKnownCallstackData(const CallstackEvent& eve
 
   // The insertion only happens if the hash isn't already present.
   unique_callstacks_.emplace(hash, std::move(unique_callstack));
-  callstack_events_by_tid_[event.thread_id()][event.time()] = CallstackEvent(event);
+  callstack_events_by_tid_[event.thread_id()].Add(event.time(), hash);
 }
 
 const CallStack* CallstackData::GetCallStack(CallstackID callstack_id) const {
@@ -143,6 +182,20 @@ const CallStack* CallstackData::GetCallStack(CallstackID callstack_id) const {
   return nullptr;
 }
 
+const CallStack* CallstackData::GetCallStackOfEvent(int32_t thread_id, uint64_t time) const {
+  std::lock_guard lock(mutex_);
+  auto events_it = callstack_events_by_tid_.find(thread_id);
+  if (events_it == callstack_events_by_tid_.end()) {
+    return nullptr;
+  }
+  const ThreadCallstackEvents& events = events_it->second;
+  size_t index = events.LowerBound(time);
+  if (index == events.size() || events.GetTime(index) != time) {
+    return nullptr;
+  }
+  return GetCallstackPtr(events.GetCallstackId(index)).get();
+}
+
 bool CallstackData::HasCallStack(CallstackID callstack_id) const {
   std::lock_guard lock(mutex_);
   return unique_callstacks_.contains(callstack_id);
@@ -183,21 +236,24 @@ void CallstackData::FilterCallstackEventsBasedOnMajorityStart() {
   uint32_t count_before_filtering = GetCallstackEventsCount();
 
   for (auto& tid_and_events : callstack_events_by_tid_) {
-    std::map<uint64_t, CallstackEvent>& callstack_events = tid_and_events.second;
+    ThreadCallstackEvents& callstack_events = tid_and_events.second;
     const uint64_t count_for_this_thread = callstack_events.size();
 
     // Count the number of occurrences of each outer frame for this thread.
     absl::flat_hash_map<uint64_t, uint64_t> count_by_outer_frame;
-    for (const auto& time_and_event : callstack_events) {
-      const CallstackEvent& event = time_and_event.second;
-      const std::vector<uint64_t>& frames =
-          unique_callstacks_.at(event.callstack_hash())->GetFrames();
-      if (frames.empty()) {
-        continue;
-      }
-      uint64_t outer_frame = *frames.rbegin();
-      ++count_by_outer_frame[outer_frame];
-    }
+    callstack_events.ForEachSpan(
+        0, callstack_events.size(),
+        [this, &count_by_outer_frame](absl::Span<const uint64_t> /*times*/,
+                                      absl::Span<const CallstackID> callstack_ids) {
+          for (CallstackID callstack_id : callstack_ids) {
+            const std::vector<uint64_t>& frames = unique_callstacks_.at(callstack_id)->GetFrames();
+            if (frames.empty()) {
+              continue;
+            }
+            uint64_t outer_frame = *frames.rbegin();
+            ++count_by_outer_frame[outer_frame];
+          }
+        });
 
     // Find the outer frame with the most occurrences.
     if (count_by_outer_frame.empty()) {
@@ -223,17 +279,10 @@ void CallstackData::FilterCallstackEventsBasedOnMajorityStart() {
     }
 
     // Discard the CallstackEvents whose outer frame doesn't match the (super)majority outer frame.
-    for (auto time_and_event_it = callstack_events.begin();
-         time_and_event_it != callstack_events.end();) {
-      const CallstackEvent& event = time_and_event_it->second;
-      const std::vector<uint64_t>& frames =
-          unique_callstacks_.at(event.callstack_hash())->GetFrames();
-      if (frames.empty() || *frames.rbegin() != majority_outer_frame) {
-        time_and_event_it = callstack_events.erase(time_and_event_it);
-      } else {
-        ++time_and_event_it;
-      }
-    }
+    callstack_events.RemoveIf([this, majority_outer_frame](CallstackID callstack_id) {
+      const std::vector<uint64_t>& frames = unique_callstacks_.at(callstack_id)->GetFrames();
+      return frames.empty() || *frames.rbegin() != majority_outer_frame;
+    });
   }
 
   uint32_t count_after_filtering = GetCallstackEventsCount();
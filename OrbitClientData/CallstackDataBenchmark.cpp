@@ -0,0 +1,143 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "OrbitClientData/Callstack.h"
+#include "OrbitClientData/CallstackData.h"
+#include "OrbitClientData/CallstackTypes.h"
+#include "OrbitClientData/ThreadCallstackEvents.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/types/span.h"
+#include "capture_data.pb.h"
+
+namespace {
+
+using orbit_client_protos::CallstackEvent;
+
+constexpr uint64_t kSamplingPeriodNs = 1'000'000;
+constexpr int kCallstackCount = 100;
+
+// Samples of one thread at about 1 kHz, with a few late ones that are inserted out of order.
+std::vector<std::pair<uint64_t, CallstackID>> CreateSamples(int sample_count) {
+  std::mt19937_64 random_engine{0};
+  std::uniform_int_distribution<uint64_t> jitter_distribution{0, kSamplingPeriodNs / 10};
+  std::uniform_int_distribution<CallstackID> callstack_distribution{1, kCallstackCount};
+  std::vector<std::pair<uint64_t, CallstackID>> samples(sample_count);
+  for (int i = 0; i < sample_count; ++i) {
+    samples[i] = {i * kSamplingPeriodNs + jitter_distribution(random_engine),
+                  callstack_distribution(random_engine)};
+  }
+  for (int i = 100; i < sample_count; i += 100) {
+    std::swap(samples[i - 1], samples[i]);
+  }
+  return samples;
+}
+
+// Reports the memory used per sample by a ThreadCallstackEvents and by the layout it replaced. The
+// time per iteration is the time spent adding the samples.
+void BM_ThreadCallstackEventsBytesPerSample(benchmark::State& state) {
+  const auto sample_count = static_cast<int>(state.range(0));
+  std::vector<std::pair<uint64_t, CallstackID>> samples = CreateSamples(sample_count);
+
+  size_t allocated_bytes = 0;
+  for (auto _ : state) {
+    ThreadCallstackEvents events;
+    for (const auto& [time, callstack_id] : samples) {
+      events.Add(time, callstack_id);
+    }
+    allocated_bytes = events.GetAllocatedBytes();
+    benchmark::DoNotOptimize(events.size());
+  }
+
+  // Before, each sample was a node of a std::map<uint64_t, CallstackEvent>: the color and the
+  // parent, left and right pointers of the red-black tree, then the key and the proto.
+  CallstackEvent event;
+  event.set_time(samples[0].first);
+  event.set_callstack_hash(samples[0].second);
+  event.set_thread_id(42);
+  const double legacy_bytes_per_sample =
+      4 * sizeof(void*) + sizeof(uint64_t) + static_cast<double>(event.SpaceUsedLong());
+
+  state.SetItemsProcessed(state.iterations() * sample_count);
+  state.counters["bytes/sample"] = static_cast<double>(allocated_bytes) / sample_count;
+  state.counters["legacy_bytes/sample"] = legacy_bytes_per_sample;
+}
+
+BENCHMARK(BM_ThreadCallstackEventsBytesPerSample)
+    ->Arg(1 << 16)
+    ->Arg(1 << 22)
+    ->Unit(benchmark::kMillisecond);
+
+// The work to find the samples of all threads in a time range of 1% of the capture, e.g., to draw
+// them when zoomed in, or to select them. The second argument selects whether to visit the samples
+// in place or to copy them out as CallstackEvents.
+void BM_CallstackDataTimeRangeQuery(benchmark::State& state) {
+  constexpr int kThreadCount = 20;
+  const auto samples_per_thread = static_cast<int>(state.range(0));
+  const bool copy_events = state.range(1) != 0;
+
+  CallstackData callstack_data;
+  absl::flat_hash_map<CallstackID, CallstackID> index_to_callstack_id;
+  for (CallstackID i = 1; i <= kCallstackCount; ++i) {
+    CallStack callstack{{0x1000 + i, 0x100}};
+    index_to_callstack_id[i] = callstack.GetHash();
+    callstack_data.AddUniqueCallStack(std::move(callstack));
+  }
+  std::vector<std::pair<uint64_t, CallstackID>> samples = CreateSamples(samples_per_thread);
+  for (int32_t thread_id = 1; thread_id <= kThreadCount; ++thread_id) {
+    for (const auto& [time, callstack_index] : samples) {
+      CallstackEvent event;
+      event.set_time(time);
+      event.set_thread_id(thread_id);
+      event.set_callstack_hash(index_to_callstack_id.at(callstack_index));
+      callstack_data.AddCallstackEvent(std::move(event));
+    }
+  }
+  const uint64_t capture_duration = samples_per_thread * kSamplingPeriodNs;
+  const uint64_t time_begin = capture_duration / 2;
+  const uint64_t time_end = time_begin + capture_duration / 100;
+
+  size_t visited_count = 0;
+  for (auto _ : state) {
+    visited_count = 0;
+    if (copy_events) {
+      std::vector<CallstackEvent> events =
+          callstack_data.GetCallstackEventsInTimeRange(time_begin, time_end);
+      for (const CallstackEvent& event : events) {
+        benchmark::DoNotOptimize(event.callstack_hash());
+      }
+      visited_count = events.size();
+    } else {
+      callstack_data.ForEachCallstackEventSpanInTimeRange(
+          time_begin, time_end,
+          [&visited_count](int32_t /*thread_id*/, absl::Span<const uint64_t> /*times*/,
+                           absl::Span<const CallstackID> callstack_ids) {
+            for (CallstackID callstack_id : callstack_ids) {
+              benchmark::DoNotOptimize(callstack_id);
+            }
+            visited_count += callstack_ids.size();
+          });
+    }
+  }
+
+  state.counters["visited_samples"] = static_cast<double>(visited_count);
+}
+
+BENCHMARK(BM_CallstackDataTimeRangeQuery)
+    ->Apply([](benchmark::internal::Benchmark* benchmark) {
+      for (int copy_events : {0, 1}) {
+        for (int samples_per_thread : {1 << 16, 1 << 20}) {
+          benchmark->Args({samples_per_thread, copy_events});
+        }
+      }
+    })
+    ->Unit(benchmark::kMicrosecond);
+
+}  // namespace
@@ -107,3 +107,37 @@ TEST(CallstackData, FilterCallstackEventsBasedOnMajorityStart) {
               testing::Pointwise(CallstackEventEq(),
                                  std::vector<orbit_client_protos::CallstackEvent>{event6, event7}));
 }
+
+TEST(CallstackData, GetCallStackOfEvent) {
+  CallstackData callstack_data;
+
+  const int32_t tid = 42;
+  const CallStack cs1{{0x11, 0x10}};
+  callstack_data.AddUniqueCallStack(cs1);
+  const CallStack cs2{{0x21, 0x10}};
+  callstack_data.AddUniqueCallStack(cs2);
+
+  orbit_client_protos::CallstackEvent event1;
+  event1.set_time(200);
+  event1.set_thread_id(tid);
+  event1.set_callstack_hash(cs1.GetHash());
+  callstack_data.AddCallstackEvent(event1);
+
+  // Inserting an older event moves the one above.
+  orbit_client_protos::CallstackEvent event2;
+  event2.set_time(100);
+  event2.set_thread_id(tid);
+  event2.set_callstack_hash(cs2.GetHash());
+  callstack_data.AddCallstackEvent(event2);
+
+  const CallStack* callstack1 = callstack_data.GetCallStackOfEvent(tid, 200);
+  ASSERT_NE(callstack1, nullptr);
+  EXPECT_EQ(callstack1->GetHash(), cs1.GetHash());
+  const CallStack* callstack2 = callstack_data.GetCallStackOfEvent(tid, 100);
+  ASSERT_NE(callstack2, nullptr);
+  EXPECT_EQ(callstack2->GetHash(), cs2.GetHash());
+
+  EXPECT_EQ(callstack_data.GetCallStackOfEvent(tid, 150), nullptr);
+  EXPECT_EQ(callstack_data.GetCallStackOfEvent(tid, 300), nullptr);
+  EXPECT_EQ(callstack_data.GetCallStackOfEvent(tid + 1, 100), nullptr);
+}
@@ -0,0 +1,59 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "OrbitClientData/FunctionAddressIndex.h"
+
+#include <utility>
+
+#include "OrbitBase/Logging.h"
+
+using orbit_client_protos::FunctionInfo;
+
+FunctionAddressIndex::FunctionAddressIndex(std::vector<const FunctionInfo*> functions)
+    : functions_(std::move(functions)) {
+  addresses_.reserve(functions_.size());
+  end_addresses_.reserve(functions_.size());
+  for (const FunctionInfo* function : functions_) {
+    CHECK(addresses_.empty() || addresses_.back() < function->address());
+    addresses_.push_back(function->address());
+    end_addresses_.push_back(function->address() + function->size());
+  }
+
+  eytzinger_addresses_.resize(functions_.size() + 1);
+  eytzinger_sorted_indices_.resize(functions_.size() + 1);
+  FillEytzingerOrder(0, 1);
+}
+
+size_t FunctionAddressIndex::FillEytzingerOrder(size_t sorted_index, size_t eytzinger_index) {
+  // An in-order walk of the tree visits the nodes in sorted order.
+  if (eytzinger_index >= eytzinger_addresses_.size()) return sorted_index;
+  sorted_index = FillEytzingerOrder(sorted_index, 2 * eytzinger_index);
+  eytzinger_addresses_[eytzinger_index] = addresses_[sorted_index];
+  eytzinger_sorted_indices_[eytzinger_index] = sorted_index;
+  return FillEytzingerOrder(sorted_index + 1, 2 * eytzinger_index + 1);
+}
+
+size_t FunctionAddressIndex::CountStartingAtOrBefore(uint64_t address) const {
+  const size_t node_count = addresses_.size();
+  size_t k = 1;
+  while (k <= node_count) {
+    k = 2 * k + (eytzinger_addresses_[k] <= address ? 1 : 0);
+  }
+  // The bits of k are the path from the root, 1 for going right. The first address after address
+  // is the last node where the search went left: drop the right turns after it, then it.
+  while ((k & 1) != 0) k >>= 1;
+  k >>= 1;
+  return k == 0 ? node_count : eytzinger_sorted_indices_[k];
+}
+
+const FunctionInfo* FunctionAddressIndex::Find(uint64_t elf_address, bool is_exact) const {
+  const size_t count = CountStartingAtOrBefore(elf_address);
+  if (count == 0) return nullptr;
+  const size_t index = count - 1;
+  if (is_exact) {
+    return addresses_[index] == elf_address ? functions_[index] : nullptr;
+  }
+  if (end_addresses_[index] < elf_address) return nullptr;
+  return functions_[index];
+}
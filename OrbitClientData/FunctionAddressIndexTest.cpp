@@ -0,0 +1,90 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "OrbitClientData/FunctionAddressIndex.h"
+#include "capture_data.pb.h"
+
+using orbit_client_protos::FunctionInfo;
+
+namespace {
+
+// The lookup FunctionAddressIndex replaces, over functions sorted by address.
+const FunctionInfo* FindLinearly(const std::vector<FunctionInfo>& functions, uint64_t address,
+                                 bool is_exact) {
+  const FunctionInfo* result = nullptr;
+  for (const FunctionInfo& function : functions) {
+    if (function.address() > address) break;
+    result = &function;
+  }
+  if (result == nullptr) return nullptr;
+  if (is_exact) return result->address() == address ? result : nullptr;
+  return result->address() + result->size() < address ? nullptr : result;
+}
+
+std::vector<const FunctionInfo*> GetPointers(const std::vector<FunctionInfo>& functions) {
+  std::vector<const FunctionInfo*> pointers;
+  for (const FunctionInfo& function : functions) {
+    pointers.push_back(&function);
+  }
+  return pointers;
+}
+
+}  // namespace
+
+TEST(FunctionAddressIndex, Empty) {
+  FunctionAddressIndex index{{}};
+  EXPECT_TRUE(index.empty());
+  EXPECT_EQ(index.Find(0, false), nullptr);
+  EXPECT_EQ(index.Find(std::numeric_limits<uint64_t>::max(), true), nullptr);
+}
+
+TEST(FunctionAddressIndex, FindsTheSameFunctionsAsALinearSearch) {
+  // Every size up to a few complete levels of the tree, so that the last level is filled to every
+  // extent. Functions are 10 bytes apart, of size 0 to 9.
+  for (size_t function_count = 1; function_count <= 70; ++function_count) {
+    std::vector<FunctionInfo> functions(function_count);
+    for (size_t i = 0; i < function_count; ++i) {
+      functions[i].set_address(100 + 10 * i);
+      functions[i].set_size(i % 10);
+    }
+    FunctionAddressIndex index{GetPointers(functions)};
+    ASSERT_EQ(index.size(), function_count);
+
+    for (uint64_t address = 0; address < 100 + 10 * function_count + 20; ++address) {
+      for (bool is_exact : {false, true}) {
+        EXPECT_EQ(index.Find(address, is_exact), FindLinearly(functions, address, is_exact))
+            << "function_count=" << function_count << " address=" << address
+            << " is_exact=" << is_exact;
+      }
+    }
+  }
+}
+
+TEST(FunctionAddressIndex, FindAddressesAroundFunctions) {
+  std::vector<FunctionInfo> functions(3);
+  functions[0].set_address(0x1000);
+  functions[0].set_size(0x10);
+  functions[1].set_address(0x1100);
+  functions[1].set_size(0x10);
+  functions[2].set_address(std::numeric_limits<uint64_t>::max() - 1);
+  FunctionAddressIndex index{GetPointers(functions)};
+
+  const std::vector<uint64_t> addresses{0x1108, 0x0fff, 0x1000, 0x1011,
+                                        std::numeric_limits<uint64_t>::max() - 1};
+  std::vector<const FunctionInfo*> found;
+  for (uint64_t address : addresses) found.push_back(index.Find(address, false));
+  EXPECT_EQ(found, (std::vector<const FunctionInfo*>{&functions[1], nullptr, &functions[0],
+                                                     nullptr, &functions[2]}));
+
+  found.clear();
+  for (uint64_t address : addresses) found.push_back(index.Find(address, true));
+  EXPECT_EQ(found, (std::vector<const FunctionInfo*>{nullptr, nullptr, &functions[0], nullptr,
+                                                     &functions[2]}));
+}
@@ -4,6 +4,9 @@
 
 #include "OrbitClientData/ModuleData.h"
 
+#include <memory>
+#include <vector>
+
 #include "OrbitBase/Logging.h"
 #include "OrbitClientData/FunctionUtils.h"
 #include "absl/synchronization/mutex.h"
@@ -41,6 +44,7 @@ void ModuleData::UpdateIfChanged(ModuleInfo info) {
 
   LOG("Module %s contained symbols. Because the module changed, those are now removed.",
       file_path());
+  std::atomic_store(&function_address_index_, std::shared_ptr<const FunctionAddressIndex>{});
   functions_.clear();
   hash_to_function_map_.clear();
   is_loaded_ = false;
@@ -54,24 +58,14 @@ const orbit_client_protos::FunctionInfo* ModuleData::FindFunctionByRelativeAddre
 
 const FunctionInfo* ModuleData::FindFunctionByElfAddress(uint64_t elf_address,
                                                          bool is_exact) const {
-  absl::MutexLock lock(&mutex_);
-  if (functions_.empty()) return nullptr;
-
-  if (is_exact) {
-    auto it = functions_.find(elf_address);
-    return (it != functions_.end()) ? it->second.get() : nullptr;
-  }
-
-  auto it = functions_.upper_bound(elf_address);
-  if (it == functions_.begin()) return nullptr;
-
-  --it;
-  FunctionInfo* function = it->second.get();
-  CHECK(function->address() <= elf_address);
-
-  if (function->address() + function->size() < elf_address) return nullptr;
+  const std::shared_ptr<const FunctionAddressIndex> function_address_index =
+      GetFunctionAddressIndex();
+  if (function_address_index == nullptr) return nullptr;
+  return function_address_index->Find(elf_address, is_exact);
+}
 
-  return function;
+std::shared_ptr<const FunctionAddressIndex> ModuleData::GetFunctionAddressIndex() const {
+  return std::atomic_load(&function_address_index_);
 }
 
 void ModuleData::AddSymbols(const orbit_grpc_protos::ModuleSymbols& module_symbols) {
@@ -111,6 +105,15 @@ void ModuleData::AddSymbols(const orbit_grpc_protos::ModuleSymbols& module_symbo
         name_reuse_counter);
   }
 
+  std::vector<const FunctionInfo*> functions;
+  functions.reserve(functions_.size());
+  for (const auto& [_, function] : functions_) {
+    functions.push_back(function.get());
+  }
+  std::shared_ptr<const FunctionAddressIndex> function_address_index =
+      std::make_shared<const FunctionAddressIndex>(std::move(functions));
+  std::atomic_store(&function_address_index_, std::move(function_address_index));
+
   is_loaded_ = true;
 }
 
@@ -44,19 +44,21 @@ ErrorMessageOr<std::pair<std::string, uint64_t>> ProcessData::FindModuleByAddres
                                         absolute_address, name()));
   }
 
-  ErrorMessage not_found_error =
-      ErrorMessage(absl::StrFormat("Unable to find module for address %016" PRIx64
-                                   ": No module loaded at this address by process %s",
-                                   absolute_address, name()));
+  // Only formatted when the module is not found, this is called for every frame of callstacks.
+  auto not_found_error = [this, absolute_address] {
+    return ErrorMessage(absl::StrFormat("Unable to find module for address %016" PRIx64
+                                        ": No module loaded at this address by process %s",
+                                        absolute_address, name()));
+  };
 
   auto it = start_addresses_.upper_bound(absolute_address);
-  if (it == start_addresses_.begin()) return not_found_error;
+  if (it == start_addresses_.begin()) return not_found_error();
 
   --it;
   const std::string& module_path = it->second;
   const MemorySpace& memory_space = module_memory_map_.at(module_path);
   CHECK(absolute_address >= memory_space.start);
-  if (absolute_address > memory_space.end) return not_found_error;
+  if (absolute_address > memory_space.end) return not_found_error();
 
   return std::make_pair(module_path, memory_space.start);
 }
\ No newline at end of file
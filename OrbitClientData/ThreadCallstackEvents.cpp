@@ -0,0 +1,109 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "OrbitClientData/ThreadCallstackEvents.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "OrbitBase/Logging.h"
+
+void ThreadCallstackEvents::Add(uint64_t time, CallstackID callstack_id) {
+  if (size_ == 0 || time > GetTime(size_ - 1)) {
+    PushBack(time, callstack_id);
+    return;
+  }
+
+  ++rewrite_count_;
+  const size_t index = LowerBound(time);
+  if (GetTime(index) == time) {
+    Set(index, time, callstack_id);
+    return;
+  }
+
+  // Make room at index by moving the newer samples by one. Late samples are rare and close to the
+  // end, so this only moves a few samples.
+  PushBack(GetTime(size_ - 1), GetCallstackId(size_ - 1));
+  for (size_t i = size_ - 2; i > index; --i) {
+    Set(i, GetTime(i - 1), GetCallstackId(i - 1));
+  }
+  Set(index, time, callstack_id);
+}
+
+size_t ThreadCallstackEvents::LowerBound(uint64_t time) const {
+  if (size_ == 0 || GetTime(size_ - 1) < time) return size_;
+
+  // The chunks are sorted too, so first find the first chunk whose last sample is not before time,
+  // then the sample in the chunk. All chunks but the last are full.
+  size_t chunk_begin = 0;
+  size_t chunk_end = chunks_.size() - 1;
+  while (chunk_begin < chunk_end) {
+    const size_t chunk_mid = chunk_begin + (chunk_end - chunk_begin) / 2;
+    if (chunks_[chunk_mid]->times[kChunkSize - 1] < time) {
+      chunk_begin = chunk_mid + 1;
+    } else {
+      chunk_end = chunk_mid;
+    }
+  }
+  const size_t chunk_size = std::min(kChunkSize, size_ - chunk_begin * kChunkSize);
+  const uint64_t* chunk_times = chunks_[chunk_begin]->times.data();
+  return chunk_begin * kChunkSize +
+         (std::lower_bound(chunk_times, chunk_times + chunk_size, time) - chunk_times);
+}
+
+size_t ThreadCallstackEvents::UpperBound(uint64_t time) const {
+  if (time == std::numeric_limits<uint64_t>::max()) return size_;
+  return LowerBound(time + 1);
+}
+
+void ThreadCallstackEvents::ForEachSpan(size_t begin, size_t end, const SpanAction& action) const {
+  CHECK(end <= size_);
+  while (begin < end) {
+    const Chunk& chunk = *chunks_[begin / kChunkSize];
+    const size_t index_in_chunk = begin % kChunkSize;
+    const size_t count = std::min(kChunkSize - index_in_chunk, end - begin);
+    action(absl::MakeConstSpan(chunk.times.data() + index_in_chunk, count),
+           absl::MakeConstSpan(chunk.callstack_ids.data() + index_in_chunk, count));
+    begin += count;
+  }
+}
+
+void ThreadCallstackEvents::ForEachSpanInTimeRange(uint64_t time_begin, uint64_t time_end,
+                                                   const SpanAction& action) const {
+  if (time_begin >= time_end) return;
+  ForEachSpan(LowerBound(time_begin), LowerBound(time_end), action);
+}
+
+void ThreadCallstackEvents::RemoveIf(const std::function<bool(CallstackID)>& predicate) {
+  size_t kept_count = 0;
+  for (size_t i = 0; i < size_; ++i) {
+    const CallstackID callstack_id = GetCallstackId(i);
+    if (predicate(callstack_id)) continue;
+    if (kept_count != i) {
+      Set(kept_count, GetTime(i), callstack_id);
+    }
+    ++kept_count;
+  }
+  if (kept_count != size_) ++rewrite_count_;
+  size_ = kept_count;
+  chunks_.resize((size_ + kChunkSize - 1) / kChunkSize);
+}
+
+size_t ThreadCallstackEvents::GetAllocatedBytes() const {
+  return chunks_.capacity() * sizeof(std::unique_ptr<Chunk>) + chunks_.size() * sizeof(Chunk);
+}
+
+void ThreadCallstackEvents::PushBack(uint64_t time, CallstackID callstack_id) {
+  if (size_ == chunks_.size() * kChunkSize) {
+    chunks_.push_back(std::make_unique<Chunk>());
+  }
+  ++size_;
+  Set(size_ - 1, time, callstack_id);
+}
+
+void ThreadCallstackEvents::Set(size_t index, uint64_t time, CallstackID callstack_id) {
+  Chunk& chunk = *chunks_[index / kChunkSize];
+  chunk.times[index % kChunkSize] = time;
+  chunk.callstack_ids[index % kChunkSize] = callstack_id;
+}
@@ -0,0 +1,131 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "OrbitClientData/ThreadCallstackEvents.h"
+
+namespace {
+
+using TimeAndCallstackId = std::pair<uint64_t, CallstackID>;
+
+std::vector<TimeAndCallstackId> GetEventsInTimeRange(const ThreadCallstackEvents& events,
+                                                     uint64_t time_begin, uint64_t time_end) {
+  std::vector<TimeAndCallstackId> result;
+  events.ForEachSpanInTimeRange(
+      time_begin, time_end,
+      [&result](absl::Span<const uint64_t> times, absl::Span<const CallstackID> callstack_ids) {
+        EXPECT_EQ(times.size(), callstack_ids.size());
+        EXPECT_LE(times.size(), ThreadCallstackEvents::kChunkSize);
+        for (size_t i = 0; i < times.size(); ++i) {
+          result.emplace_back(times[i], callstack_ids[i]);
+        }
+      });
+  return result;
+}
+
+}  // namespace
+
+TEST(ThreadCallstackEvents, AddsEventsSortedByTime) {
+  ThreadCallstackEvents events;
+  EXPECT_TRUE(events.empty());
+
+  events.Add(100, 1);
+  events.Add(300, 3);
+  events.Add(200, 2);
+  events.Add(50, 4);
+
+  ASSERT_EQ(events.size(), 4);
+  EXPECT_THAT(GetEventsInTimeRange(events, 0, std::numeric_limits<uint64_t>::max()),
+              testing::ElementsAre(TimeAndCallstackId{50, 4}, TimeAndCallstackId{100, 1},
+                                   TimeAndCallstackId{200, 2}, TimeAndCallstackId{300, 3}));
+}
+
+TEST(ThreadCallstackEvents, EventWithSameTimeReplacesCallstackId) {
+  ThreadCallstackEvents events;
+  events.Add(100, 1);
+  events.Add(200, 2);
+  events.Add(100, 3);
+  events.Add(200, 4);
+
+  ASSERT_EQ(events.size(), 2);
+  EXPECT_EQ(events.GetCallstackId(0), 3);
+  EXPECT_EQ(events.GetCallstackId(1), 4);
+}
+
+TEST(ThreadCallstackEvents, TimeRangeQueriesAcrossChunks) {
+  constexpr size_t kEventCount = 3 * ThreadCallstackEvents::kChunkSize + 10;
+  ThreadCallstackEvents events;
+  // Add every other event late, so that some are inserted in full chunks.
+  for (uint64_t i = 0; i < kEventCount; i += 2) {
+    events.Add(10 * i, i);
+  }
+  for (uint64_t i = 1; i < kEventCount; i += 2) {
+    events.Add(10 * i, i);
+  }
+  ASSERT_EQ(events.size(), kEventCount);
+  for (size_t i = 0; i < kEventCount; ++i) {
+    ASSERT_EQ(events.GetTime(i), 10 * i);
+    ASSERT_EQ(events.GetCallstackId(i), i);
+  }
+
+  EXPECT_EQ(events.LowerBound(0), 0);
+  EXPECT_EQ(events.LowerBound(15), 2);
+  EXPECT_EQ(events.UpperBound(20), 3);
+  EXPECT_EQ(events.LowerBound(10 * kEventCount), kEventCount);
+
+  const uint64_t time_begin = 10 * (ThreadCallstackEvents::kChunkSize - 2);
+  const uint64_t time_end = 10 * (2 * ThreadCallstackEvents::kChunkSize + 3) + 5;
+  std::vector<TimeAndCallstackId> range = GetEventsInTimeRange(events, time_begin, time_end);
+  ASSERT_EQ(range.size(), ThreadCallstackEvents::kChunkSize + 6);
+  EXPECT_EQ(range.front().first, time_begin);
+  EXPECT_EQ(range.back().first, 10 * (2 * ThreadCallstackEvents::kChunkSize + 3));
+
+  EXPECT_TRUE(GetEventsInTimeRange(events, time_end, time_begin).empty());
+}
+
+TEST(ThreadCallstackEvents, RemoveIfKeepsOrder) {
+  constexpr size_t kEventCount = 2 * ThreadCallstackEvents::kChunkSize + 1;
+  ThreadCallstackEvents events;
+  for (uint64_t i = 0; i < kEventCount; ++i) {
+    events.Add(i, i % 3);
+  }
+
+  events.RemoveIf([](CallstackID callstack_id) { return callstack_id != 0; });
+
+  ASSERT_EQ(events.size(), (kEventCount + 2) / 3);
+  for (size_t i = 0; i < events.size(); ++i) {
+    EXPECT_EQ(events.GetTime(i), 3 * i);
+  }
+  events.Add(1, 7);
+  EXPECT_EQ(events.GetCallstackId(1), 7);
+
+  events.RemoveIf([](CallstackID /*callstack_id*/) { return true; });
+  EXPECT_TRUE(events.empty());
+  EXPECT_EQ(events.LowerBound(0), 0);
+}
+
+TEST(ThreadCallstackEvents, RewriteCountOnlyChangesWhenExistingEventsChange) {
+  ThreadCallstackEvents events;
+  events.Add(100, 1);
+  events.Add(200, 2);
+  EXPECT_EQ(events.GetRewriteCount(), 0);
+
+  events.Add(200, 3);
+  EXPECT_EQ(events.GetRewriteCount(), 1);
+  events.Add(150, 4);
+  EXPECT_EQ(events.GetRewriteCount(), 2);
+  events.RemoveIf([](CallstackID /*callstack_id*/) { return false; });
+  EXPECT_EQ(events.GetRewriteCount(), 2);
+  events.RemoveIf([](CallstackID callstack_id) { return callstack_id == 4; });
+  EXPECT_EQ(events.GetRewriteCount(), 3);
+  events.Add(300, 5);
+  EXPECT_EQ(events.GetRewriteCount(), 3);
+}
@@ -10,7 +10,9 @@
 
 #include "Callstack.h"
 #include "CallstackTypes.h"
+#include "ThreadCallstackEvents.h"
 #include "absl/container/flat_hash_map.h"
+#include "absl/types/span.h"
 #include "capture_data.pb.h"
 
 class CallstackData {
@@ -31,12 +33,6 @@ class CallstackData {
   void AddCallStackFromKnownCallstackData(const orbit_client_protos::CallstackEvent& event,
                                           const CallstackData* known_callstack_data);
 
-  [[nodiscard]] const absl::flat_hash_map<int32_t,
-                                          std::map<uint64_t, orbit_client_protos::CallstackEvent>>&
-  callstack_events_by_tid() const {
-    return callstack_events_by_tid_;
-  }
-
   [[nodiscard]] uint32_t GetCallstackEventsCount() const;
 
   [[nodiscard]] std::vector<orbit_client_protos::CallstackEvent> GetCallstackEventsInTimeRange(
@@ -49,6 +45,20 @@ class CallstackData {
   [[nodiscard]] std::vector<orbit_client_protos::CallstackEvent> GetCallstackEventsOfTidInTimeRange(
       int32_t tid, uint64_t time_begin, uint64_t time_end) const;
 
+  // Calls action with the events with time in [time_begin, time_end), without copying them: each
+  // call receives consecutive events of one thread, sorted by time.
+  void ForEachCallstackEventSpanInTimeRange(
+      uint64_t time_begin, uint64_t time_end,
+      const std::function<void(int32_t thread_id, absl::Span<const uint64_t> times,
+                               absl::Span<const CallstackID> callstack_ids)>& action) const;
+
+  void ForEachCallstackEventSpanOfTidInTimeRange(int32_t tid, uint64_t time_begin,
+                                                 uint64_t time_end,
+                                                 const ThreadCallstackEvents::SpanAction& action)
+      const;
+
+  // The ForEachCallstackEvent... methods pass a temporary CallstackEvent to action, as the events
+  // are not stored as protos. Prefer the span-based methods above on hot paths.
   void ForEachCallstackEvent(
       const std::function<void(const orbit_client_protos::CallstackEvent&)>& action) const;
 
@@ -56,6 +66,15 @@ class CallstackData {
       int32_t tid,
       const std::function<void(const orbit_client_protos::CallstackEvent&)>& action) const;
 
+  // Calls action with the events of all threads, sorted by time for each thread, and with the
+  // unique callstacks. Nothing can be added or removed until action returns, so action can also
+  // have them read by other threads, without locking, as long as it waits for those threads.
+  void VisitCallstackEventsAndUniqueCallstacks(
+      const std::function<
+          void(const absl::flat_hash_map<int32_t, ThreadCallstackEvents>& callstack_events_by_tid,
+               const absl::flat_hash_map<CallstackID, std::shared_ptr<CallStack>>&
+                   unique_callstacks)>& action) const;
+
   [[nodiscard]] uint64_t max_time() const {
     std::lock_guard lock(mutex_);
     return max_time_;
@@ -68,6 +87,9 @@ class CallstackData {
 
   [[nodiscard]] const CallStack* GetCallStack(CallstackID callstack_id) const;
 
+  // The callstack of the event of thread_id at time, or nullptr if there is no such event.
+  [[nodiscard]] const CallStack* GetCallStackOfEvent(int32_t thread_id, uint64_t time) const;
+
   [[nodiscard]] bool HasCallStack(CallstackID callstack_id) const;
 
   void ForEachUniqueCallstack(const std::function<void(const CallStack&)>& action) const;
@@ -92,8 +114,7 @@ class CallstackData {
   // E.g., one might want to nest ForEachCallstackEvent and ForEachFrameInCallstack.
   mutable std::recursive_mutex mutex_;
   absl::flat_hash_map<CallstackID, std::shared_ptr<CallStack>> unique_callstacks_;
-  absl::flat_hash_map<int32_t, std::map<uint64_t, orbit_client_protos::CallstackEvent>>
-      callstack_events_by_tid_;
+  absl::flat_hash_map<int32_t, ThreadCallstackEvents> callstack_events_by_tid_;
 
   uint64_t max_time_ = 0;
   uint64_t min_time_ = std::numeric_limits<uint64_t>::max();
@@ -0,0 +1,46 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_CLIENT_DATA_FUNCTION_ADDRESS_INDEX_H_
+#define ORBIT_CLIENT_DATA_FUNCTION_ADDRESS_INDEX_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "capture_data.pb.h"
+
+// An immutable index of the functions of a module by ELF address, built once when the symbols are
+// loaded and then queried without locking. The start addresses are stored in flat arrays in
+// Eytzinger (breadth-first) order: the first levels of the binary search share a few cache lines
+// that stay hot across queries, where a std::map walks a pointer per level.
+class FunctionAddressIndex {
+ public:
+  // functions must be sorted by address, without duplicate addresses, and outlive the index.
+  explicit FunctionAddressIndex(std::vector<const orbit_client_protos::FunctionInfo*> functions);
+
+  // With is_exact, returns the function that starts at elf_address. Otherwise returns the last
+  // function starting at or before elf_address, if elf_address is not after its end.
+  [[nodiscard]] const orbit_client_protos::FunctionInfo* Find(uint64_t elf_address,
+                                                              bool is_exact) const;
+
+  [[nodiscard]] size_t size() const { return functions_.size(); }
+  [[nodiscard]] bool empty() const { return functions_.empty(); }
+
+ private:
+  // Returns the number of functions starting at or before address.
+  [[nodiscard]] size_t CountStartingAtOrBefore(uint64_t address) const;
+  size_t FillEytzingerOrder(size_t sorted_index, size_t eytzinger_index);
+
+  std::vector<const orbit_client_protos::FunctionInfo*> functions_;
+  // Start and end (address + size) of functions_, in the same order.
+  std::vector<uint64_t> addresses_;
+  std::vector<uint64_t> end_addresses_;
+  // The same addresses as a complete binary tree: node k has children 2k and 2k+1, node 0 is
+  // unused. eytzinger_sorted_indices_ has the index in addresses_ of each node.
+  std::vector<uint64_t> eytzinger_addresses_;
+  std::vector<size_t> eytzinger_sorted_indices_;
+};
+
+#endif  // ORBIT_CLIENT_DATA_FUNCTION_ADDRESS_INDEX_H_
@@ -11,6 +11,7 @@
 #include <utility>
 #include <vector>
 
+#include "OrbitClientData/FunctionAddressIndex.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/strings/str_format.h"
 #include "absl/synchronization/mutex.h"
@@ -37,6 +38,9 @@ class ModuleData final {
       uint64_t relative_address, bool is_exact) const;
   [[nodiscard]] const orbit_client_protos::FunctionInfo* FindFunctionByElfAddress(
       uint64_t elf_address, bool is_exact) const;
+  // The index of the functions by ELF address, null until symbols are loaded. Lookups through it
+  // don't lock the module, keep it to resolve many addresses.
+  [[nodiscard]] std::shared_ptr<const FunctionAddressIndex> GetFunctionAddressIndex() const;
   void AddSymbols(const orbit_grpc_protos::ModuleSymbols& module_symbols);
   [[nodiscard]] const orbit_client_protos::FunctionInfo* FindFunctionFromHash(uint64_t hash) const;
   [[nodiscard]] const std::vector<const orbit_client_protos::FunctionInfo*> GetFunctions() const;
@@ -51,6 +55,8 @@ class ModuleData final {
   // are based on a hash of the functions pretty name. This should be changed to not use hashes
   // anymore.
   absl::flat_hash_map<uint64_t, orbit_client_protos::FunctionInfo*> hash_to_function_map_;
+  // Set with std::atomic_store under mutex_ when functions_ changes, read with std::atomic_load.
+  std::shared_ptr<const FunctionAddressIndex> function_address_index_;
 };
 
 #endif  // ORBIT_GL_MODULE_DATA_H_
@@ -35,8 +35,8 @@ struct ThreadSampleData {
   absl::flat_hash_map<uint64_t, uint32_t> address_count;
   absl::flat_hash_map<uint64_t, uint32_t> raw_address_count;
   absl::flat_hash_map<uint64_t, uint32_t> exclusive_count;
-  std::multimap<uint32_t, uint64_t> address_count_sorted;
   uint32_t samples_count = 0;
+  // The functions with the most samples come first, the others are in no particular order.
   std::vector<SampledFunction> sampled_function;
   ThreadID thread_id = 0;
 };
@@ -54,6 +54,10 @@ struct SortedCallstackReport {
   std::vector<CallstackCount> callstacks_count;
 };
 
+namespace orbit_client_model {
+class IncrementalSamplingDataPostProcessor;
+}  // namespace orbit_client_model
+
 class PostProcessedSamplingData {
  public:
   PostProcessedSamplingData() = default;
@@ -101,6 +105,9 @@ class PostProcessedSamplingData {
   [[nodiscard]] uint32_t GetCountOfFunction(uint64_t function_address) const;
 
  private:
+  // Updates the data of a live capture in place, instead of creating it again.
+  friend class orbit_client_model::IncrementalSamplingDataPostProcessor;
+
   absl::flat_hash_map<ThreadID, ThreadSampleData> thread_id_to_sample_data_;
   absl::flat_hash_map<CallstackID, std::shared_ptr<CallStack>> unique_resolved_callstacks_;
   absl::flat_hash_map<CallstackID, CallstackID> original_to_resolved_callstack_;
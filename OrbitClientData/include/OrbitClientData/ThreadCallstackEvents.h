@@ -0,0 +1,81 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_CLIENT_DATA_THREAD_CALLSTACK_EVENTS_H_
+#define ORBIT_CLIENT_DATA_THREAD_CALLSTACK_EVENTS_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "OrbitClientData/CallstackTypes.h"
+#include "absl/types/span.h"
+
+// The callstack events (samples) of one thread, sorted by time. Instead of one CallstackEvent
+// proto per sample, timestamps and callstack ids are stored in two columns, split in chunks of
+// fixed capacity, so that appending samples never copies the existing ones. Inserting an older
+// sample shifts the newer ones, and removing samples compacts the chunks and frees the ones left
+// empty: pointers into the samples are only valid as long as the owner's lock is held. Ranges of
+// samples are visited as spans of consecutive samples rather than copied out.
+class ThreadCallstackEvents {
+ public:
+  static constexpr size_t kChunkSize = 1024;
+
+  using SpanAction = std::function<void(absl::Span<const uint64_t> times,
+                                        absl::Span<const CallstackID> callstack_ids)>;
+
+  // Samples usually arrive in time order. An older sample is inserted at its place, moving the
+  // newer ones. A thread can't be sampled twice at the same time, so a sample with the same time as
+  // an existing one replaces its callstack id.
+  void Add(uint64_t time, CallstackID callstack_id);
+
+  [[nodiscard]] size_t size() const { return size_; }
+  [[nodiscard]] bool empty() const { return size_ == 0; }
+
+  [[nodiscard]] uint64_t GetTime(size_t index) const {
+    return chunks_[index / kChunkSize]->times[index % kChunkSize];
+  }
+  [[nodiscard]] CallstackID GetCallstackId(size_t index) const {
+    return chunks_[index / kChunkSize]->callstack_ids[index % kChunkSize];
+  }
+
+  // Index of the first sample with a time not less than (LowerBound), or greater than
+  // (UpperBound), time. size() if there is none.
+  [[nodiscard]] size_t LowerBound(uint64_t time) const;
+  [[nodiscard]] size_t UpperBound(uint64_t time) const;
+
+  // Calls action with the samples of indices [begin, end), one chunk at a time.
+  void ForEachSpan(size_t begin, size_t end, const SpanAction& action) const;
+  // Calls action with the samples with time in [time_begin, time_end), one chunk at a time.
+  void ForEachSpanInTimeRange(uint64_t time_begin, uint64_t time_end,
+                              const SpanAction& action) const;
+
+  // Removes the samples whose callstack id satisfies predicate, keeping the others in order.
+  void RemoveIf(const std::function<bool(CallstackID)>& predicate);
+
+  // Memory used by the chunks, including the unused capacity of the last one.
+  [[nodiscard]] size_t GetAllocatedBytes() const;
+
+  // Number of times samples that were already added were replaced, moved or removed. Appending
+  // samples doesn't change it, so samples can be processed incrementally as long as it is the same.
+  [[nodiscard]] uint64_t GetRewriteCount() const { return rewrite_count_; }
+
+ private:
+  struct Chunk {
+    std::array<uint64_t, kChunkSize> times;
+    std::array<CallstackID, kChunkSize> callstack_ids;
+  };
+
+  void PushBack(uint64_t time, CallstackID callstack_id);
+  void Set(size_t index, uint64_t time, CallstackID callstack_id);
+
+  std::vector<std::unique_ptr<Chunk>> chunks_;
+  size_t size_ = 0;
+  uint64_t rewrite_count_ = 0;
+};
+
+#endif  // ORBIT_CLIENT_DATA_THREAD_CALLSTACK_EVENTS_H_
@@ -109,8 +109,9 @@ bool ClientGgp::SaveCapture() {
   // Add the location where the capture is saved
   file_name.insert(0, options_.capture_file_directory);
 
-  ErrorMessageOr<void> result = capture_serializer::Save(
-      file_name, GetCaptureData(), key_to_string_map, timer_infos_.begin(), timer_infos_.end());
+  ErrorMessageOr<void> result =
+      capture_serializer::Save(file_name, GetCaptureData(), key_to_string_map,
+                               capture_serializer::CreateTimersSections(timer_infos_));
   if (result.has_error()) {
     ERROR("Could not save the capture: %s", result.error().message());
     return false;
@@ -26,6 +26,8 @@ ABSL_FLAG(std::string, log_directory, "",
 ABSL_FLAG(uint16_t, sampling_rate, 1000, "Frequency of callstack sampling in samples per second");
 ABSL_FLAG(bool, frame_pointer_unwinding, false, "Use frame pointers for unwinding");
 ABSL_FLAG(bool, thread_state, false, "Collect thread states");
+ABSL_FLAG(std::string, capture_response_compression, "none",
+          "Compression of the capture data sent by OrbitService: none, deflate or gzip");
 
 namespace {
 
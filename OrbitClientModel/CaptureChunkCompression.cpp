@@ -0,0 +1,56 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "OrbitClientModel/CaptureChunkCompression.h"
+
+#include <zlib.h>
+
+#include <limits>
+
+#include "OrbitBase/Logging.h"
+
+namespace capture_compression {
+
+namespace {
+
+// Saving is bound by compression, and the fastest level already shrinks timers and callstack
+// events to a fraction of their size.
+constexpr int kCompressionLevel = Z_BEST_SPEED;
+
+}  // namespace
+
+std::optional<std::string> Compress(std::string_view payload) {
+  CHECK(payload.size() <= std::numeric_limits<uLong>::max());
+  uLongf compressed_size = compressBound(static_cast<uLong>(payload.size()));
+  std::string compressed(compressed_size, '\0');
+  const int result = compress2(reinterpret_cast<Bytef*>(compressed.data()), &compressed_size,
+                               reinterpret_cast<const Bytef*>(payload.data()),
+                               static_cast<uLong>(payload.size()), kCompressionLevel);
+  if (result != Z_OK || compressed_size >= payload.size()) {
+    return std::nullopt;
+  }
+  compressed.resize(compressed_size);
+  return compressed;
+}
+
+bool Decompress(absl::Span<const char> compressed, absl::Span<char> output) {
+  if (compressed.size() > std::numeric_limits<uInt>::max() ||
+      output.size() > std::numeric_limits<uInt>::max()) {
+    return false;
+  }
+  z_stream stream{};
+  if (inflateInit(&stream) != Z_OK) {
+    return false;
+  }
+  // zlib doesn't modify the input, it just doesn't declare it const.
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(compressed.data()));
+  stream.avail_in = static_cast<uInt>(compressed.size());
+  stream.next_out = reinterpret_cast<Bytef*>(output.data());
+  stream.avail_out = static_cast<uInt>(output.size());
+  const int result = inflate(&stream, Z_FINISH);
+  inflateEnd(&stream);
+  return result == Z_STREAM_END && stream.avail_out == 0;
+}
+
+}  // namespace capture_compression
@@ -0,0 +1,232 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "OrbitClientModel/CaptureColumns.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "OrbitBase/Logging.h"
+#include "absl/base/config.h"
+
+#ifndef ABSL_IS_LITTLE_ENDIAN
+#error "The columns of capture files are little-endian, and are written and read in place."
+#endif
+
+using orbit_client_protos::CallstackEvent;
+using orbit_client_protos::TimerInfo;
+
+namespace capture_columns {
+
+namespace {
+
+template <typename T>
+void AppendValue(T value, std::string* payload) {
+  payload->append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+void AppendColumn(const std::vector<T>& column, std::string* payload) {
+  payload->append(reinterpret_cast<const char*>(column.data()), column.size() * sizeof(T));
+}
+
+// Hands out the consecutive columns of a payload, checking that they fit in it.
+class ColumnLayout {
+ public:
+  explicit ColumnLayout(absl::Span<const char> payload)
+      : next_{payload.data()}, remaining_size_{payload.size()} {}
+
+  template <typename T>
+  Column<T> Next(size_t count) {
+    // count comes from a uint32_t, so this can't overflow.
+    const size_t column_size = count * sizeof(T);
+    if (column_size > remaining_size_) {
+      valid_ = false;
+      return Column<T>{};
+    }
+    Column<T> column{next_};
+    next_ += column_size;
+    remaining_size_ -= column_size;
+    return column;
+  }
+
+  [[nodiscard]] bool valid() const { return valid_; }
+
+ private:
+  const char* next_;
+  size_t remaining_size_;
+  bool valid_ = true;
+};
+
+}  // namespace
+
+ErrorMessageOr<TimerColumns> TimerColumns::Create(absl::Span<const char> payload) {
+  ColumnLayout layout{payload};
+  Column<uint32_t> counts = layout.Next<uint32_t>(2);
+  if (!layout.valid()) {
+    return ErrorMessage("The timers chunk is truncated");
+  }
+
+  TimerColumns columns;
+  columns.size_ = counts[0];
+  columns.register_count_ = counts[1];
+  columns.start_ = layout.Next<uint64_t>(columns.size_);
+  columns.end_ = layout.Next<uint64_t>(columns.size_);
+  columns.process_id_ = layout.Next<int32_t>(columns.size_);
+  columns.thread_id_ = layout.Next<int32_t>(columns.size_);
+  columns.depth_ = layout.Next<uint32_t>(columns.size_);
+  columns.type_ = layout.Next<int32_t>(columns.size_);
+  columns.processor_ = layout.Next<int32_t>(columns.size_);
+  columns.callstack_id_ = layout.Next<uint64_t>(columns.size_);
+  columns.function_address_ = layout.Next<uint64_t>(columns.size_);
+  columns.user_data_key_ = layout.Next<uint64_t>(columns.size_);
+  columns.timeline_hash_ = layout.Next<uint64_t>(columns.size_);
+  columns.registers_end_ = layout.Next<uint32_t>(columns.size_);
+  columns.registers_ = layout.Next<uint64_t>(columns.register_count_);
+  if (!layout.valid()) {
+    return ErrorMessage("The timers chunk is truncated");
+  }
+  return columns;
+}
+
+void TimerColumns::Decode(size_t index, TimerInfo* timer) const {
+  timer->set_start(start_[index]);
+  timer->set_end(end_[index]);
+  timer->set_process_id(process_id_[index]);
+  timer->set_thread_id(thread_id_[index]);
+  timer->set_depth(depth_[index]);
+  timer->set_type(static_cast<TimerInfo::Type>(type_[index]));
+  timer->set_processor(processor_[index]);
+  timer->set_callstack_id(callstack_id_[index]);
+  timer->set_function_address(function_address_[index]);
+  timer->set_user_data_key(user_data_key_[index]);
+  timer->set_timeline_hash(timeline_hash_[index]);
+
+  timer->clear_registers();
+  const uint32_t registers_begin = index == 0 ? 0 : registers_end_[index - 1];
+  const uint32_t registers_end = registers_end_[index];
+  // Only the size of the columns was checked on creation, not their content.
+  if (registers_begin > registers_end || registers_end > register_count_) {
+    return;
+  }
+  for (uint32_t i = registers_begin; i < registers_end; ++i) {
+    timer->add_registers(registers_[i]);
+  }
+}
+
+ErrorMessageOr<CallstackEventColumns> CallstackEventColumns::Create(
+    absl::Span<const char> payload) {
+  ColumnLayout layout{payload};
+  Column<uint32_t> count = layout.Next<uint32_t>(1);
+  if (!layout.valid()) {
+    return ErrorMessage("The callstack events chunk is truncated");
+  }
+
+  CallstackEventColumns columns;
+  columns.size_ = count[0];
+  columns.time_ = layout.Next<uint64_t>(columns.size_);
+  columns.callstack_hash_ = layout.Next<uint64_t>(columns.size_);
+  columns.thread_id_ = layout.Next<int32_t>(columns.size_);
+  if (!layout.valid()) {
+    return ErrorMessage("The callstack events chunk is truncated");
+  }
+  return columns;
+}
+
+void CallstackEventColumns::Decode(size_t index, CallstackEvent* event) const {
+  event->set_time(time_[index]);
+  event->set_callstack_hash(callstack_hash_[index]);
+  event->set_thread_id(thread_id_[index]);
+}
+
+void TimerColumnsBuilder::Add(const TimerFields& timer) {
+  start_.push_back(timer.start);
+  end_.push_back(timer.end);
+  process_id_.push_back(timer.process_id);
+  thread_id_.push_back(timer.thread_id);
+  depth_.push_back(timer.depth);
+  type_.push_back(timer.type);
+  processor_.push_back(timer.processor);
+  callstack_id_.push_back(timer.callstack_id);
+  function_address_.push_back(timer.function_address);
+  user_data_key_.push_back(timer.user_data_key);
+  timeline_hash_.push_back(timer.timeline_hash);
+  registers_.insert(registers_.end(), timer.registers.begin(), timer.registers.end());
+  CHECK(registers_.size() <= std::numeric_limits<uint32_t>::max());
+  registers_end_.push_back(static_cast<uint32_t>(registers_.size()));
+  min_timestamp_ns_ = std::min(min_timestamp_ns_, timer.start);
+  max_timestamp_ns_ = std::max(max_timestamp_ns_, timer.end);
+}
+
+void TimerColumnsBuilder::Add(const TimerInfo& timer) {
+  TimerFields fields;
+  fields.start = timer.start();
+  fields.end = timer.end();
+  fields.process_id = timer.process_id();
+  fields.thread_id = timer.thread_id();
+  fields.depth = timer.depth();
+  fields.type = timer.type();
+  fields.processor = timer.processor();
+  fields.callstack_id = timer.callstack_id();
+  fields.function_address = timer.function_address();
+  fields.user_data_key = timer.user_data_key();
+  fields.timeline_hash = timer.timeline_hash();
+  fields.registers = absl::MakeConstSpan(timer.registers().data(), timer.registers_size());
+  Add(fields);
+}
+
+std::string TimerColumnsBuilder::Build() const {
+  CHECK(size() <= std::numeric_limits<uint32_t>::max());
+  std::string payload;
+  // Six 64-bit and six 32-bit columns, then the registers.
+  constexpr size_t kBytesPerTimer = 6 * sizeof(uint64_t) + 6 * sizeof(uint32_t);
+  payload.reserve(2 * sizeof(uint32_t) + size() * kBytesPerTimer +
+                  registers_.size() * sizeof(uint64_t));
+  AppendValue(static_cast<uint32_t>(size()), &payload);
+  AppendValue(static_cast<uint32_t>(registers_.size()), &payload);
+  AppendColumn(start_, &payload);
+  AppendColumn(end_, &payload);
+  AppendColumn(process_id_, &payload);
+  AppendColumn(thread_id_, &payload);
+  AppendColumn(depth_, &payload);
+  AppendColumn(type_, &payload);
+  AppendColumn(processor_, &payload);
+  AppendColumn(callstack_id_, &payload);
+  AppendColumn(function_address_, &payload);
+  AppendColumn(user_data_key_, &payload);
+  AppendColumn(timeline_hash_, &payload);
+  AppendColumn(registers_end_, &payload);
+  AppendColumn(registers_, &payload);
+  return payload;
+}
+
+void CallstackEventColumnsBuilder::Add(uint64_t time, uint64_t callstack_hash,
+                                       int32_t thread_id) {
+  time_.push_back(time);
+  callstack_hash_.push_back(callstack_hash);
+  thread_id_.push_back(thread_id);
+  min_timestamp_ns_ = std::min(min_timestamp_ns_, time);
+  max_timestamp_ns_ = std::max(max_timestamp_ns_, time);
+}
+
+std::string CallstackEventColumnsBuilder::Build() const {
+  CHECK(size() <= std::numeric_limits<uint32_t>::max());
+  std::string payload;
+  payload.reserve(sizeof(uint32_t) + size() * (2 * sizeof(uint64_t) + sizeof(int32_t)));
+  AppendValue(static_cast<uint32_t>(size()), &payload);
+  AppendColumn(time_, &payload);
+  AppendColumn(callstack_hash_, &payload);
+  AppendColumn(thread_id_, &payload);
+  return payload;
+}
+
+std::string EncodeTimers(absl::Span<const TimerInfo* const> timers) {
+  TimerColumnsBuilder builder;
+  for (const TimerInfo* timer : timers) {
+    builder.Add(*timer);
+  }
+  return builder.Build();
+}
+
+}  // namespace capture_columns
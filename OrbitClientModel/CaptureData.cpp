@@ -5,8 +5,11 @@
 #include "OrbitClientModel/CaptureData.h"
 
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "OrbitBase/Profiling.h"
+#include "OrbitClientData/FunctionAddressIndex.h"
 #include "OrbitClientData/FunctionUtils.h"
 #include "OrbitClientData/ModuleData.h"
 #include "process.pb.h"
@@ -143,6 +146,34 @@ const FunctionInfo* CaptureData::FindFunctionByAddress(uint64_t absolute_address
   return module->FindFunctionByRelativeAddress(relative_address, is_exact);
 }
 
+std::vector<const FunctionInfo*> CaptureData::FindFunctionsByAddresses(
+    absl::Span<const uint64_t> absolute_addresses, bool is_exact) const {
+  std::vector<const FunctionInfo*> functions(absolute_addresses.size(), nullptr);
+  // The memory of the module of the previous address, initially empty, and its functions.
+  uint64_t module_start = 1;
+  uint64_t module_end = 0;
+  uint64_t module_load_bias = 0;
+  std::shared_ptr<const FunctionAddressIndex> function_address_index;
+  for (size_t i = 0; i < absolute_addresses.size(); ++i) {
+    const uint64_t absolute_address = absolute_addresses[i];
+    if (absolute_address < module_start || absolute_address > module_end) {
+      const auto result = process_.FindModuleByAddress(absolute_address);
+      if (!result) continue;
+      const std::string& module_path = result.value().first;
+      const MemorySpace& memory_space = process_.GetMemoryMap().at(module_path);
+      module_start = memory_space.start;
+      module_end = memory_space.end;
+      const ModuleData* module = module_manager_->GetModuleByPath(module_path);
+      function_address_index = module != nullptr ? module->GetFunctionAddressIndex() : nullptr;
+      module_load_bias = module != nullptr ? module->load_bias() : 0;
+    }
+    if (function_address_index == nullptr) continue;
+    functions[i] = function_address_index->Find(absolute_address - module_start + module_load_bias,
+                                                is_exact);
+  }
+  return functions;
+}
+
 [[nodiscard]] ModuleData* CaptureData::FindModuleByAddress(uint64_t absolute_address) const {
   const auto result = process_.FindModuleByAddress(absolute_address);
   if (!result) return nullptr;
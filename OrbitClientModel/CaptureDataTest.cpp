@@ -0,0 +1,97 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "OrbitClientData/ModuleData.h"
+#include "OrbitClientData/ModuleManager.h"
+#include "OrbitClientData/ProcessData.h"
+#include "OrbitClientData/UserDefinedCaptureData.h"
+#include "OrbitClientModel/CaptureData.h"
+#include "capture_data.pb.h"
+#include "module.pb.h"
+#include "process.pb.h"
+#include "symbol.pb.h"
+
+using orbit_client_data::ModuleManager;
+using orbit_client_protos::FunctionInfo;
+using orbit_grpc_protos::ModuleInfo;
+using orbit_grpc_protos::ModuleSymbols;
+using orbit_grpc_protos::SymbolInfo;
+
+namespace {
+
+ModuleInfo CreateModuleInfo(const std::string& file_path, uint64_t address_start,
+                            uint64_t address_end, uint64_t load_bias) {
+  ModuleInfo module_info;
+  module_info.set_name(file_path);
+  module_info.set_file_path(file_path);
+  module_info.set_address_start(address_start);
+  module_info.set_address_end(address_end);
+  module_info.set_load_bias(load_bias);
+  return module_info;
+}
+
+void AddSymbol(ModuleSymbols* module_symbols, const std::string& name, uint64_t address,
+               uint64_t size) {
+  SymbolInfo* symbol_info = module_symbols->add_symbol_infos();
+  symbol_info->set_name(name);
+  symbol_info->set_demangled_name(name);
+  symbol_info->set_address(address);
+  symbol_info->set_size(size);
+}
+
+}  // namespace
+
+TEST(CaptureData, FindFunctionsByAddressesMatchesFindFunctionByAddress) {
+  // Two modules with symbols, one of them with a load bias, and one module without symbols.
+  const std::vector<ModuleInfo> module_infos{
+      CreateModuleInfo("/path/to/biased", 0x10000, 0x20000, 0x400000),
+      CreateModuleInfo("/path/to/unbiased", 0x30000, 0x38000, 0),
+      CreateModuleInfo("/path/to/no_symbols", 0x40000, 0x41000, 0)};
+  ModuleManager module_manager;
+  module_manager.AddOrUpdateModules(module_infos);
+
+  ModuleSymbols biased_symbols;
+  AddSymbol(&biased_symbols, "biased_1", 0x401000, 0x100);
+  AddSymbol(&biased_symbols, "biased_2", 0x402000, 0x10);
+  module_manager.GetMutableModuleByPath("/path/to/biased")->AddSymbols(biased_symbols);
+  ModuleSymbols unbiased_symbols;
+  AddSymbol(&unbiased_symbols, "unbiased_1", 0x100, 0x20);
+  AddSymbol(&unbiased_symbols, "unbiased_2", 0x2000, 0x8);
+  module_manager.GetMutableModuleByPath("/path/to/unbiased")->AddSymbols(unbiased_symbols);
+
+  orbit_grpc_protos::ProcessInfo process_info;
+  process_info.set_pid(42);
+  ProcessData process{process_info};
+  process.UpdateModuleInfos(module_infos);
+  CaptureData capture_data{std::move(process), &module_manager, {}, {}, UserDefinedCaptureData{}};
+
+  // Unsorted, alternating between modules, at the start, inside and after functions, and outside of
+  // any module.
+  const std::vector<uint64_t> addresses{
+      0x11000, 0x30100, 0x11080, 0x32004, 0x12000, 0x12010, 0x12011, 0x30120, 0x30121,
+      0x40010, 0x11000, 0x30000, 0x10000, 0x0fff,  0x20001, 0x38000, 0x50000, 0x32008};
+  for (bool is_exact : {false, true}) {
+    const std::vector<const FunctionInfo*> functions =
+        capture_data.FindFunctionsByAddresses(addresses, is_exact);
+    ASSERT_EQ(functions.size(), addresses.size());
+    for (size_t i = 0; i < addresses.size(); ++i) {
+      EXPECT_EQ(functions[i], capture_data.FindFunctionByAddress(addresses[i], is_exact))
+          << "address=" << std::hex << addresses[i] << " is_exact=" << is_exact;
+    }
+  }
+
+  const std::vector<const FunctionInfo*> functions =
+      capture_data.FindFunctionsByAddresses({0x11080, 0x32004, 0x40010}, false);
+  ASSERT_NE(functions[0], nullptr);
+  EXPECT_EQ(functions[0]->name(), "biased_1");
+  ASSERT_NE(functions[1], nullptr);
+  EXPECT_EQ(functions[1]->name(), "unbiased_2");
+  EXPECT_EQ(functions[2], nullptr);
+}
@@ -4,14 +4,22 @@
 
 #include "OrbitClientModel/CaptureDeserializer.h"
 
+#include <array>
+#include <deque>
 #include <fstream>
+#include <limits>
 #include <memory>
 
 #include "OrbitBase/MakeUniqueForOverwrite.h"
+#include "OrbitBase/Tracing.h"
 #include "OrbitClientData/Callstack.h"
 #include "OrbitClientData/FunctionUtils.h"
 #include "OrbitClientData/ModuleManager.h"
+#include "OrbitClientModel/CaptureChunkCompression.h"
+#include "OrbitClientModel/CaptureColumns.h"
+#include "OrbitClientModel/MappedCaptureFile.h"
 #include "absl/strings/str_format.h"
+#include "absl/synchronization/notification.h"
 #include "capture_data.pb.h"
 #include "google/protobuf/io/coded_stream.h"
 #include "google/protobuf/io/zero_copy_stream_impl.h"
@@ -21,6 +29,8 @@
 using orbit_client_data::ModuleManager;
 using orbit_client_protos::CallstackEvent;
 using orbit_client_protos::CallstackInfo;
+using orbit_client_protos::CaptureChunkIndex;
+using orbit_client_protos::CaptureChunkType;
 using orbit_client_protos::CaptureHeader;
 using orbit_client_protos::CaptureInfo;
 using orbit_client_protos::FunctionInfo;
@@ -29,11 +39,286 @@ using orbit_grpc_protos::ProcessInfo;
 
 namespace capture_deserializer {
 
+namespace {
+
+// Bounds the memory used by chunks read ahead of the one being loaded.
+constexpr size_t kMaxChunksInFlight = 16;
+
+bool ReadLittleEndian32(std::istream* input, uint32_t* value) {
+  std::array<char, sizeof(uint32_t)> bytes;
+  if (!input->read(bytes.data(), bytes.size())) {
+    return false;
+  }
+  google::protobuf::io::CodedInputStream::ReadLittleEndian32FromArray(
+      reinterpret_cast<const uint8_t*>(bytes.data()), value);
+  return true;
+}
+
+bool IsCaptureInfoChunk(CaptureChunkType type) {
+  switch (type) {
+    case orbit_client_protos::kCaptureInfoChunk:
+    case orbit_client_protos::kKeysAndStringsChunk:
+    case orbit_client_protos::kAddressInfosChunk:
+    case orbit_client_protos::kThreadStateSlicesChunk:
+    case orbit_client_protos::kCallstacksChunk:
+    case orbit_client_protos::kTracepointEventsChunk:
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool IsColumnsChunk(CaptureChunkType type) {
+  return type == orbit_client_protos::kTimersChunk ||
+         type == orbit_client_protos::kCallstackEventsChunk;
+}
+
+// A chunk read from the file, parsed on the thread pool while the previous ones are loaded. The
+// columns of timers and callstack events chunks point into the payload.
+struct PendingChunk {
+  internal::CaptureChunk chunk;
+  bool parsed_successfully = false;
+  CaptureInfo capture_info;
+  capture_columns::TimerColumns timers;
+  capture_columns::CallstackEventColumns callstack_events;
+  absl::Notification parsed;
+};
+
+void ParseChunk(PendingChunk* pending_chunk) {
+  ORBIT_SCOPE("Parse capture chunk");
+  if (!internal::DecompressChunk(&pending_chunk->chunk)) {
+    pending_chunk->parsed_successfully = false;
+    pending_chunk->parsed.Notify();
+    return;
+  }
+  const absl::Span<const char> payload = pending_chunk->chunk.payload;
+  switch (pending_chunk->chunk.type) {
+    case orbit_client_protos::kTimersChunk: {
+      ErrorMessageOr<capture_columns::TimerColumns> timers =
+          capture_columns::TimerColumns::Create(payload);
+      pending_chunk->parsed_successfully = timers.has_value();
+      if (timers.has_value()) pending_chunk->timers = timers.value();
+      break;
+    }
+    case orbit_client_protos::kCallstackEventsChunk: {
+      ErrorMessageOr<capture_columns::CallstackEventColumns> callstack_events =
+          capture_columns::CallstackEventColumns::Create(payload);
+      pending_chunk->parsed_successfully = callstack_events.has_value();
+      if (callstack_events.has_value()) {
+        pending_chunk->callstack_events = callstack_events.value();
+      }
+      break;
+    }
+    default:
+      pending_chunk->parsed_successfully =
+          pending_chunk->capture_info.ParseFromArray(payload.data(),
+                                                     static_cast<int>(payload.size()));
+      pending_chunk->chunk.payload_buffer.reset();
+      break;
+  }
+  pending_chunk->parsed.Notify();
+}
+
+// Returns false if the loading was cancelled.
+bool LoadCaptureInfoData(const CaptureInfo& capture_info, CaptureListener* capture_listener,
+                         std::atomic<bool>* cancellation_requested) {
+  for (const auto& address_info : capture_info.address_infos()) {
+    if (*cancellation_requested) {
+      return false;
+    }
+    capture_listener->OnAddressInfo(address_info);
+  }
+
+  for (const auto& thread_id_and_name : capture_info.thread_names()) {
+    if (*cancellation_requested) {
+      return false;
+    }
+    capture_listener->OnThreadName(thread_id_and_name.first, thread_id_and_name.second);
+  }
+
+  for (const orbit_client_protos::ThreadStateSliceInfo& thread_state_slice :
+       capture_info.thread_state_slices()) {
+    if (*cancellation_requested) {
+      return false;
+    }
+    capture_listener->OnThreadStateSlice(thread_state_slice);
+  }
+
+  for (const CallstackInfo& callstack : capture_info.callstacks()) {
+    CallStack unique_callstack({callstack.data().begin(), callstack.data().end()});
+    if (*cancellation_requested) {
+      return false;
+    }
+    capture_listener->OnUniqueCallStack(std::move(unique_callstack));
+  }
+  // Only captures passed to LoadCaptureInfo directly have callstack events in capture_info, files
+  // have them in kCallstackEventsChunk chunks.
+  for (CallstackEvent callstack_event : capture_info.callstack_events()) {
+    if (*cancellation_requested) {
+      return false;
+    }
+    capture_listener->OnCallstackEvent(std::move(callstack_event));
+  }
+
+  for (const orbit_client_protos::TracepointInfo& tracepoint_info :
+       capture_info.tracepoint_infos()) {
+    if (*cancellation_requested) {
+      return false;
+    }
+    orbit_grpc_protos::TracepointInfo tracepoint_info_translated;
+    tracepoint_info_translated.set_category(tracepoint_info.category());
+    tracepoint_info_translated.set_name(tracepoint_info.name());
+    capture_listener->OnUniqueTracepointInfo(tracepoint_info.tracepoint_info_key(),
+                                             std::move(tracepoint_info_translated));
+  }
+
+  for (orbit_client_protos::TracepointEventInfo tracepoint_event_info :
+       capture_info.tracepoint_event_infos()) {
+    if (*cancellation_requested) {
+      return false;
+    }
+    capture_listener->OnTracepointEvent(std::move(tracepoint_event_info));
+  }
+
+  for (const auto& key_to_string : capture_info.key_to_string()) {
+    if (*cancellation_requested) {
+      return false;
+    }
+    capture_listener->OnKeyAndString(key_to_string.first, key_to_string.second);
+  }
+  return true;
+}
+
+// Returns false if the loading was cancelled.
+bool LoadTimers(const capture_columns::TimerColumns& timers, CaptureListener* capture_listener,
+                std::atomic<bool>* cancellation_requested) {
+  TimerInfo timer_info;
+  for (size_t i = 0; i < timers.size(); ++i) {
+    if (*cancellation_requested) {
+      return false;
+    }
+    timers.Decode(i, &timer_info);
+    capture_listener->OnTimer(timer_info);
+  }
+  return true;
+}
+
+// Returns false if the loading was cancelled.
+bool LoadCallstackEvents(const capture_columns::CallstackEventColumns& callstack_events,
+                         CaptureListener* capture_listener,
+                         std::atomic<bool>* cancellation_requested) {
+  for (size_t i = 0; i < callstack_events.size(); ++i) {
+    if (*cancellation_requested) {
+      return false;
+    }
+    CallstackEvent callstack_event;
+    callstack_events.Decode(i, &callstack_event);
+    capture_listener->OnCallstackEvent(std::move(callstack_event));
+  }
+  return true;
+}
+
+// Loads the chunks up to the index or the end of input, and finishes the capture. Chunks are read
+// ahead and parsed on thread_pool, if not null, while the previous ones are passed to the listener
+// in the order of the file.
+void LoadChunks(const internal::ChunkReader& read_next_chunk, CaptureListener* capture_listener,
+                ThreadPool* thread_pool, std::atomic<bool>* cancellation_requested) {
+  const size_t max_chunks_in_flight = thread_pool != nullptr ? kMaxChunksInFlight : 1;
+  std::deque<std::unique_ptr<PendingChunk>> pending_chunks;
+  bool end_of_chunks = false;
+  bool parsing_failed = false;
+  bool cancelled = false;
+  while (true) {
+    while (!end_of_chunks && pending_chunks.size() < max_chunks_in_flight) {
+      auto pending_chunk = std::make_unique<PendingChunk>();
+      if (!read_next_chunk(&pending_chunk->chunk) ||
+          pending_chunk->chunk.type == orbit_client_protos::kIndexChunk) {
+        end_of_chunks = true;
+        break;
+      }
+      const CaptureChunkType type = pending_chunk->chunk.type;
+      if (!IsCaptureInfoChunk(type) && !IsColumnsChunk(type)) {
+        continue;
+      }
+      PendingChunk* pending_chunk_ptr = pending_chunk.get();
+      pending_chunks.push_back(std::move(pending_chunk));
+      if (thread_pool != nullptr) {
+        thread_pool->Schedule([pending_chunk_ptr] { ParseChunk(pending_chunk_ptr); });
+      } else {
+        ParseChunk(pending_chunk_ptr);
+      }
+    }
+    if (pending_chunks.empty()) {
+      break;
+    }
+
+    std::unique_ptr<PendingChunk> pending_chunk = std::move(pending_chunks.front());
+    pending_chunks.pop_front();
+    pending_chunk->parsed.WaitForNotification();
+    if (!pending_chunk->parsed_successfully) {
+      parsing_failed = true;
+      break;
+    }
+    if (pending_chunk->chunk.type == orbit_client_protos::kTimersChunk) {
+      cancelled = !LoadTimers(pending_chunk->timers, capture_listener, cancellation_requested);
+    } else if (pending_chunk->chunk.type == orbit_client_protos::kCallstackEventsChunk) {
+      cancelled = !LoadCallstackEvents(pending_chunk->callstack_events, capture_listener,
+                                       cancellation_requested);
+    } else {
+      cancelled = !LoadCaptureInfoData(pending_chunk->capture_info, capture_listener,
+                                       cancellation_requested);
+    }
+    if (cancelled) {
+      break;
+    }
+  }
+
+  // The chunks still being parsed must outlive the tasks parsing them.
+  for (const std::unique_ptr<PendingChunk>& pending_chunk : pending_chunks) {
+    pending_chunk->parsed.WaitForNotification();
+  }
+
+  if (parsing_failed) {
+    constexpr const char* kErrorMessage = "Error parsing the capture: the file is corrupted.";
+    ERROR("%s", kErrorMessage);
+    capture_listener->OnCaptureFailed(ErrorMessage(kErrorMessage));
+  } else if (cancelled) {
+    capture_listener->OnCaptureCancelled();
+  } else {
+    capture_listener->OnCaptureComplete();
+  }
+}
+
+}  // namespace
+
 void Load(const std::string& file_name, CaptureListener* capture_listener,
-          ModuleManager* module_manager, std::atomic<bool>* cancellation_requested) {
+          ModuleManager* module_manager, std::atomic<bool>* cancellation_requested,
+          ThreadPool* thread_pool) {
   SCOPED_TIMED_LOG("Loading capture from \"%s\"", file_name);
 
-  // Binary
+  ErrorMessageOr<std::unique_ptr<MappedCaptureFile>> capture_file_or_error =
+      MappedCaptureFile::Open(file_name);
+  if (capture_file_or_error.has_value()) {
+    const MappedCaptureFile& capture_file = *capture_file_or_error.value();
+    // The first chunk is the metadata in capture_file.capture_info().
+    int next_chunk = 1;
+    internal::LoadCaptureInfo(
+        capture_file.capture_info(), capture_listener, module_manager,
+        [&capture_file, &next_chunk](internal::CaptureChunk* chunk) {
+          if (next_chunk == capture_file.index().chunks_size()) return false;
+          const CaptureChunkIndex::Entry& entry = capture_file.index().chunks(next_chunk++);
+          chunk->type = entry.type();
+          chunk->payload = capture_file.GetChunkPayload(entry);
+          chunk->uncompressed_size = entry.uncompressed_size();
+          return true;
+        },
+        cancellation_requested, thread_pool);
+    return;
+  }
+
+  // Captures that were not completely written have no index, and captures of other versions can't
+  // be mapped. Read them as a stream: that loads what was written, or reports the version.
+  LOG("%s", capture_file_or_error.error().message());
   std::ifstream file(file_name, std::ios::binary);
   if (file.fail()) {
     ERROR("Loading capture from \"%s\": %s", file_name, "file.fail()");
@@ -42,14 +327,13 @@ void Load(const std::string& file_name, CaptureListener* capture_listener,
     return;
   }
 
-  return Load(file, file_name, capture_listener, module_manager, cancellation_requested);
+  return Load(file, file_name, capture_listener, module_manager, cancellation_requested,
+              thread_pool);
 }
 
 void Load(std::istream& stream, const std::string& file_name, CaptureListener* capture_listener,
-          ModuleManager* module_manager, std::atomic<bool>* cancellation_requested) {
-  google::protobuf::io::IstreamInputStream input_stream(&stream);
-  google::protobuf::io::CodedInputStream coded_input(&input_stream);
-
+          ModuleManager* module_manager, std::atomic<bool>* cancellation_requested,
+          ThreadPool* thread_pool) {
   std::string error_message = absl::StrFormat(
       "Error parsing the capture from \"%s\".\nNote: If the capture "
       "was taken with a previous Orbit version, it could be incompatible. "
@@ -57,7 +341,7 @@ void Load(std::istream& stream, const std::string& file_name, CaptureListener* c
       file_name);
 
   CaptureHeader header;
-  if (!internal::ReadMessage(&header, &coded_input) || header.version().empty()) {
+  if (!internal::ReadMessage(&header, &stream) || header.version().empty()) {
     ERROR("%s", error_message);
     capture_listener->OnCaptureFailed(ErrorMessage(std::move(error_message)));
     return;
@@ -72,39 +356,112 @@ void Load(std::istream& stream, const std::string& file_name, CaptureListener* c
     return;
   }
 
+  // The first chunk has the metadata needed to start the capture.
+  internal::CaptureChunk first_chunk;
   CaptureInfo capture_info;
-  if (!internal::ReadMessage(&capture_info, &coded_input)) {
+  if (!internal::ReadChunk(&stream, &first_chunk) ||
+      first_chunk.type != orbit_client_protos::kCaptureInfoChunk ||
+      !internal::DecompressChunk(&first_chunk) ||
+      !capture_info.ParseFromArray(first_chunk.payload.data(),
+                                   static_cast<int>(first_chunk.payload.size()))) {
     ERROR("%s", error_message);
     capture_listener->OnCaptureFailed(ErrorMessage(std::move(error_message)));
     return;
   }
+  first_chunk.payload_buffer.reset();
 
-  internal::LoadCaptureInfo(capture_info, capture_listener, module_manager, &coded_input,
-                            cancellation_requested);
+  internal::LoadCaptureInfo(capture_info, capture_listener, module_manager, &stream,
+                            cancellation_requested, thread_pool);
+}
+
+ErrorMessageOr<CaptureChunkIndex> ReadChunkIndex(std::istream& stream) {
+  stream.seekg(-static_cast<std::streamoff>(sizeof(uint64_t)), std::ios::end);
+  std::array<char, sizeof(uint64_t)> index_offset_bytes;
+  if (!stream.read(index_offset_bytes.data(), index_offset_bytes.size())) {
+    return ErrorMessage("Unable to read the offset of the index of the capture");
+  }
+  uint64_t index_offset;
+  google::protobuf::io::CodedInputStream::ReadLittleEndian64FromArray(
+      reinterpret_cast<const uint8_t*>(index_offset_bytes.data()), &index_offset);
+
+  stream.seekg(static_cast<std::streamoff>(index_offset));
+  internal::CaptureChunk chunk;
+  if (!internal::ReadChunk(&stream, &chunk) ||
+      chunk.type != orbit_client_protos::kIndexChunk) {
+    return ErrorMessage("Unable to read the index of the capture");
+  }
+  CaptureChunkIndex index;
+  if (!index.ParseFromArray(chunk.payload.data(), static_cast<int>(chunk.payload.size()))) {
+    return ErrorMessage("Unable to parse the index of the capture");
+  }
+  return index;
 }
 
 namespace internal {
 
-bool ReadMessage(google::protobuf::Message* message,
-                 google::protobuf::io::CodedInputStream* input) {
+bool ReadMessage(google::protobuf::Message* message, std::istream* input) {
   uint32_t message_size;
-  if (!input->ReadLittleEndian32(&message_size)) {
+  if (!ReadLittleEndian32(input, &message_size)) {
     return false;
   }
 
   std::unique_ptr<char[]> buffer = make_unique_for_overwrite<char[]>(message_size);
-  if (!input->ReadRaw(buffer.get(), message_size)) {
+  if (!input->read(buffer.get(), message_size)) {
+    return false;
+  }
+  message->ParseFromArray(buffer.get(), static_cast<int>(message_size));
+
+  return true;
+}
+
+bool ReadChunk(std::istream* input, CaptureChunk* chunk) {
+  uint32_t type;
+  uint32_t payload_size;
+  uint32_t uncompressed_size;
+  if (!ReadLittleEndian32(input, &type) || !ReadLittleEndian32(input, &payload_size) ||
+      !ReadLittleEndian32(input, &uncompressed_size)) {
     return false;
   }
-  message->ParseFromArray(buffer.get(), message_size);
+  chunk->uncompressed_size = uncompressed_size;
+  chunk->type = orbit_client_protos::CaptureChunkType_IsValid(static_cast<int>(type))
+                    ? static_cast<CaptureChunkType>(type)
+                    : orbit_client_protos::kUnknownCaptureChunk;
+
+  chunk->payload_buffer = make_unique_for_overwrite<char[]>(payload_size);
+  chunk->payload = absl::MakeConstSpan(chunk->payload_buffer.get(), payload_size);
+  return static_cast<bool>(input->read(chunk->payload_buffer.get(), payload_size));
+}
 
+bool DecompressChunk(CaptureChunk* chunk) {
+  if (chunk->uncompressed_size == 0) {
+    return true;
+  }
+  if (chunk->uncompressed_size > static_cast<uint64_t>(std::numeric_limits<int>::max())) {
+    return false;
+  }
+  std::unique_ptr<char[]> buffer = make_unique_for_overwrite<char[]>(chunk->uncompressed_size);
+  absl::Span<char> decompressed_payload = absl::MakeSpan(buffer.get(), chunk->uncompressed_size);
+  if (!capture_compression::Decompress(chunk->payload, decompressed_payload)) {
+    return false;
+  }
+  chunk->payload = decompressed_payload;
+  chunk->payload_buffer = std::move(buffer);
+  chunk->uncompressed_size = 0;
   return true;
 }
 
 void LoadCaptureInfo(const CaptureInfo& capture_info, CaptureListener* capture_listener,
-                     ModuleManager* module_manager,
-                     google::protobuf::io::CodedInputStream* coded_input,
-                     std::atomic<bool>* cancellation_requested) {
+                     ModuleManager* module_manager, std::istream* chunks_input,
+                     std::atomic<bool>* cancellation_requested, ThreadPool* thread_pool) {
+  LoadCaptureInfo(
+      capture_info, capture_listener, module_manager,
+      [chunks_input](CaptureChunk* chunk) { return ReadChunk(chunks_input, chunk); },
+      cancellation_requested, thread_pool);
+}
+
+void LoadCaptureInfo(const CaptureInfo& capture_info, CaptureListener* capture_listener,
+                     ModuleManager* module_manager, const ChunkReader& read_next_chunk,
+                     std::atomic<bool>* cancellation_requested, ThreadPool* thread_pool) {
   CHECK(capture_listener != nullptr);
 
   ProcessInfo process_info;
@@ -176,88 +533,12 @@ void LoadCaptureInfo(const CaptureInfo& capture_info, CaptureListener* capture_l
                                      std::move(selected_tracepoints),
                                      std::move(user_defined_capture_data));
 
-  for (const auto& address_info : capture_info.address_infos()) {
-    if (*cancellation_requested) {
-      capture_listener->OnCaptureCancelled();
-      return;
-    }
-    capture_listener->OnAddressInfo(address_info);
-  }
-
-  for (const auto& thread_id_and_name : capture_info.thread_names()) {
-    if (*cancellation_requested) {
-      capture_listener->OnCaptureCancelled();
-      return;
-    }
-    capture_listener->OnThreadName(thread_id_and_name.first, thread_id_and_name.second);
-  }
-
-  for (const orbit_client_protos::ThreadStateSliceInfo& thread_state_slice :
-       capture_info.thread_state_slices()) {
-    if (*cancellation_requested) {
-      capture_listener->OnCaptureCancelled();
-      return;
-    }
-    capture_listener->OnThreadStateSlice(thread_state_slice);
-  }
-
-  for (const CallstackInfo& callstack : capture_info.callstacks()) {
-    CallStack unique_callstack({callstack.data().begin(), callstack.data().end()});
-    if (*cancellation_requested) {
-      capture_listener->OnCaptureCancelled();
-      return;
-    }
-    capture_listener->OnUniqueCallStack(std::move(unique_callstack));
-  }
-  for (CallstackEvent callstack_event : capture_info.callstack_events()) {
-    if (*cancellation_requested) {
-      capture_listener->OnCaptureCancelled();
-      return;
-    }
-    capture_listener->OnCallstackEvent(std::move(callstack_event));
-  }
-
-  for (const orbit_client_protos::TracepointInfo& tracepoint_info :
-       capture_info.tracepoint_infos()) {
-    if (*cancellation_requested) {
-      capture_listener->OnCaptureCancelled();
-      return;
-    }
-    orbit_grpc_protos::TracepointInfo tracepoint_info_translated;
-    tracepoint_info_translated.set_category(tracepoint_info.category());
-    tracepoint_info_translated.set_name(tracepoint_info.name());
-    capture_listener->OnUniqueTracepointInfo(tracepoint_info.tracepoint_info_key(),
-                                             std::move(tracepoint_info_translated));
-  }
-
-  for (orbit_client_protos::TracepointEventInfo tracepoint_event_info :
-       capture_info.tracepoint_event_infos()) {
-    if (*cancellation_requested) {
-      capture_listener->OnCaptureCancelled();
-      return;
-    }
-    capture_listener->OnTracepointEvent(std::move(tracepoint_event_info));
-  }
-
-  for (const auto& key_to_string : capture_info.key_to_string()) {
-    if (*cancellation_requested) {
-      capture_listener->OnCaptureCancelled();
-      return;
-    }
-    capture_listener->OnKeyAndString(key_to_string.first, key_to_string.second);
-  }
-
-  // Timers
-  TimerInfo timer_info;
-  while (internal::ReadMessage(&timer_info, coded_input)) {
-    if (*cancellation_requested) {
-      capture_listener->OnCaptureCancelled();
-      return;
-    }
-    capture_listener->OnTimer(timer_info);
+  if (!LoadCaptureInfoData(capture_info, capture_listener, cancellation_requested)) {
+    capture_listener->OnCaptureCancelled();
+    return;
   }
 
-  capture_listener->OnCaptureComplete();
+  LoadChunks(read_next_chunk, capture_listener, thread_pool, cancellation_requested);
 }
 
 }  // namespace internal
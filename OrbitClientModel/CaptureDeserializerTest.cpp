@@ -2,24 +2,35 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <algorithm>
+#include <atomic>
 #include <memory>
+#include <sstream>
+#include <string>
 #include <vector>
 
 #include "CaptureSerializationTestMatchers.h"
+#include "OrbitBase/ThreadPool.h"
 #include "OrbitClientData/ModuleData.h"
 #include "OrbitClientData/ModuleManager.h"
 #include "OrbitClientData/ProcessData.h"
 #include "OrbitClientData/UserDefinedCaptureData.h"
+#include "OrbitClientModel/CaptureColumns.h"
+#include "OrbitClientModel/CaptureData.h"
 #include "OrbitClientModel/CaptureDeserializer.h"
+#include "OrbitClientModel/CaptureSerializer.h"
 #include "absl/base/casts.h"
 #include "capture_data.pb.h"
 #include "gmock/gmock-actions.h"
 #include "gmock/gmock.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/io/zero_copy_stream_impl.h"
 #include "gtest/gtest.h"
 
 using orbit_client_data::ModuleManager;
 using orbit_client_protos::CallstackEvent;
 using orbit_client_protos::CallstackInfo;
+using orbit_client_protos::CaptureChunkIndex;
 using orbit_client_protos::CaptureHeader;
 using orbit_client_protos::CaptureInfo;
 using orbit_client_protos::FunctionInfo;
@@ -182,8 +193,7 @@ TEST(CaptureDeserializer, LoadCaptureInfoOnCaptureStarted) {
   selected_function->set_size(12);
 
   std::atomic<bool> cancellation_requested = false;
-  uint8_t empty_data = 0;
-  google::protobuf::io::CodedInputStream empty_stream(&empty_data, 0);
+  std::istringstream empty_stream;
 
   // There will be no call to OnCaptureStarted other then the one specified next.
   EXPECT_CALL(listener, OnCaptureStarted(_, _, _, _)).Times(0);
@@ -237,8 +247,7 @@ TEST(CaptureDeserializer, LoadCaptureInfoModuleManager) {
   module_info->set_load_bias(0x400);
 
   std::atomic<bool> cancellation_requested = false;
-  uint8_t empty_data = 0;
-  google::protobuf::io::CodedInputStream empty_stream(&empty_data, 0);
+  std::istringstream empty_stream;
 
   // There will be no call to OnCaptureStarted other then the one specified next.
   EXPECT_CALL(listener, OnCaptureStarted).Times(1);
@@ -281,8 +290,7 @@ TEST(CaptureDeserializer, LoadCaptureInfoAddressInfos) {
   capture_info.add_address_infos()->CopyFrom(address_info_2);
 
   std::atomic<bool> cancellation_requested = false;
-  uint8_t empty_data = 0;
-  google::protobuf::io::CodedInputStream empty_stream(&empty_data, 0);
+  std::istringstream empty_stream;
 
   LinuxAddressInfo actual_address_info_1;
   LinuxAddressInfo actual_address_info_2;
@@ -317,8 +325,7 @@ TEST(CaptureDeserializer, LoadCaptureInfoThreadNames) {
   capture_info.mutable_thread_names()->insert(expected_thread_names.begin(),
                                               expected_thread_names.end());
   std::atomic<bool> cancellation_requested = false;
-  uint8_t empty_data = 0;
-  google::protobuf::io::CodedInputStream empty_stream(&empty_data, 0);
+  std::istringstream empty_stream;
 
   EXPECT_CALL(listener, OnThreadName(_, _)).Times(0);
   EXPECT_CALL(listener, OnThreadName(1, "thread_a")).Times(1);
@@ -352,8 +359,7 @@ TEST(CaptureDeserializer, LoadCaptureInfoThreadStateSlices) {
   capture_info.add_thread_state_slices()->CopyFrom(thread_state_slice1);
 
   std::atomic<bool> cancellation_requested = false;
-  uint8_t empty_data = 0;
-  google::protobuf::io::CodedInputStream empty_stream(&empty_data, 0);
+  std::istringstream empty_stream;
 
   {
     InSequence sequence;
@@ -379,8 +385,7 @@ TEST(CaptureDeserializer, LoadCaptureInfoKeysAndStrings) {
 
   capture_info.mutable_key_to_string()->insert(keys_and_strings.begin(), keys_and_strings.end());
   std::atomic<bool> cancellation_requested = false;
-  uint8_t empty_data = 0;
-  google::protobuf::io::CodedInputStream empty_stream(&empty_data, 0);
+  std::istringstream empty_stream;
 
   EXPECT_CALL(listener, OnKeyAndString(_, _)).Times(0);
   EXPECT_CALL(listener, OnKeyAndString(1, "string_a")).Times(1);
@@ -430,8 +435,7 @@ TEST(CaptureDeserializer, LoadCaptureInfoCallstacks) {
   callstack_event_2->set_callstack_hash(callstack_2.GetHash());
 
   std::atomic<bool> cancellation_requested = false;
-  uint8_t empty_data = 0;
-  google::protobuf::io::CodedInputStream empty_stream(&empty_data, 0);
+  std::istringstream empty_stream;
 
   bool hash_added_1 = false;
   bool hash_present_1_1 = false;
@@ -521,8 +525,7 @@ TEST(CaptureDeserializer, LoadCaptureInfoTracepoints) {
   tracepoint_event_2->set_cpu(12);
 
   std::atomic<bool> cancellation_requested = false;
-  uint8_t empty_data = 0;
-  google::protobuf::io::CodedInputStream empty_stream(&empty_data, 0);
+  std::istringstream empty_stream;
 
   bool hash_added_1 = false;
   bool hash_present_1_1 = false;
@@ -599,23 +602,22 @@ TEST(CaptureDeserializer, LoadCaptureInfoTimers) {
   timer_1.set_start(0);
   timer_1.set_end(1);
   timer_1.set_process_id(42);
-
-  std::string serialized_timer_1;
-  timer_1.SerializeToString(&serialized_timer_1);
-  int32_t size_of_timer_1 = serialized_timer_1.size();
-  stream << std::string(absl::bit_cast<char*>(&size_of_timer_1), sizeof(size_of_timer_1))
-         << serialized_timer_1;
+  timer_1.add_registers(7);
 
   TimerInfo timer_2;
   timer_2.set_start(3);
   timer_2.set_end(5);
   timer_2.set_process_id(2);
+  timer_2.set_type(TimerInfo::kGpuActivity);
 
-  std::string serialized_timer_2;
-  timer_2.SerializeToString(&serialized_timer_2);
-  int32_t size_of_timer_2 = serialized_timer_2.size();
-  stream << std::string(absl::bit_cast<char*>(&size_of_timer_2), sizeof(size_of_timer_2))
-         << serialized_timer_2;
+  std::string serialized_timers = capture_columns::EncodeTimers({&timer_1, &timer_2});
+  int32_t chunk_type = orbit_client_protos::kTimersChunk;
+  int32_t size_of_timers = serialized_timers.size();
+  int32_t uncompressed_size = 0;
+  stream << std::string(absl::bit_cast<char*>(&chunk_type), sizeof(chunk_type))
+         << std::string(absl::bit_cast<char*>(&size_of_timers), sizeof(size_of_timers))
+         << std::string(absl::bit_cast<char*>(&uncompressed_size), sizeof(uncompressed_size))
+         << serialized_timers;
 
   TimerInfo actual_timer_1;
   TimerInfo actual_timer_2;
@@ -624,12 +626,9 @@ TEST(CaptureDeserializer, LoadCaptureInfoTimers) {
       .WillOnce(SaveArg<0>(&actual_timer_1))
       .WillOnce(SaveArg<0>(&actual_timer_2));
 
-  google::protobuf::io::IstreamInputStream input_stream(&stream);
-  google::protobuf::io::CodedInputStream coded_input(&input_stream);
-
   ModuleManager module_manager;
   capture_deserializer::internal::LoadCaptureInfo(empty_capture_info, &listener, &module_manager,
-                                                  &coded_input, &cancellation_requested);
+                                                  &stream, &cancellation_requested);
 
   EXPECT_EQ(timer_1.start(), actual_timer_1.start());
   EXPECT_EQ(timer_2.start(), actual_timer_2.start());
@@ -637,6 +636,9 @@ TEST(CaptureDeserializer, LoadCaptureInfoTimers) {
   EXPECT_EQ(timer_2.end(), actual_timer_2.end());
   EXPECT_EQ(timer_1.process_id(), actual_timer_1.process_id());
   EXPECT_EQ(timer_2.process_id(), actual_timer_2.process_id());
+  EXPECT_THAT(actual_timer_1.registers(), ::testing::ElementsAre(7));
+  EXPECT_THAT(actual_timer_2.registers(), IsEmpty());
+  EXPECT_EQ(timer_2.type(), actual_timer_2.type());
 }
 
 TEST(CaptureDeserializer, LoadCaptureInfoUserDefinedCaptureData) {
@@ -653,8 +655,7 @@ TEST(CaptureDeserializer, LoadCaptureInfoUserDefinedCaptureData) {
       ->CopyFrom(frame_track_function);
 
   std::atomic<bool> cancellation_requested = false;
-  uint8_t empty_data = 0;
-  google::protobuf::io::CodedInputStream empty_stream(&empty_data, 0);
+  std::istringstream empty_stream;
 
   // There will be no call to OnCaptureStarted other then the one specified next.
   UserDefinedCaptureData actual_capture_data;
@@ -674,4 +675,158 @@ TEST(CaptureDeserializer, LoadCaptureInfoUserDefinedCaptureData) {
   EXPECT_EQ(frame_track_function.loaded_module_path(), actual_function_info.loaded_module_path());
 }
 
-}  // namespace
\ No newline at end of file
+// A capture with enough callstack events and timers to take several chunks each.
+constexpr int kChunkedCaptureCallstackEventCount = 300'000;
+constexpr int kChunkedCaptureTimerCount = 2 * capture_serializer::internal::kTimersPerChunk + 1;
+
+std::string CreateChunkedCapture(bool compress_chunks = false) {
+  orbit_grpc_protos::ProcessInfo process_info;
+  process_info.set_pid(42);
+  ModuleManager module_manager;
+  CaptureData capture_data{ProcessData{process_info}, &module_manager, {}, {},
+                           UserDefinedCaptureData{}};
+  CallStack callstack(std::vector<uint64_t>{0x100});
+  capture_data.AddUniqueCallStack(callstack);
+  for (int i = 0; i < kChunkedCaptureCallstackEventCount; ++i) {
+    CallstackEvent callstack_event;
+    callstack_event.set_time(i);
+    callstack_event.set_thread_id(43);
+    callstack_event.set_callstack_hash(callstack.GetHash());
+    capture_data.AddCallstackEvent(callstack_event);
+  }
+
+  std::vector<TimerInfo> timers(kChunkedCaptureTimerCount);
+  for (int i = 0; i < kChunkedCaptureTimerCount; ++i) {
+    timers[i].set_start(2 * i);
+    timers[i].set_end(2 * i + 1);
+  }
+
+  std::ostringstream stream;
+  capture_serializer::internal::Save(stream, capture_data, {},
+                                     capture_serializer::CreateTimersSections(timers),
+                                     /*thread_pool=*/nullptr, compress_chunks);
+  return stream.str();
+}
+
+}  // namespace
+
+TEST(CaptureDeserializer, LoadChunkedCaptureInOrderWithThreadPool) {
+  MockCaptureListener listener;
+  std::atomic<bool> cancellation_requested = false;
+  EXPECT_CALL(listener, OnCaptureStarted).Times(1);
+  EXPECT_CALL(listener, OnUniqueCallStack).Times(1);
+  uint64_t next_callstack_event_time = 0;
+  EXPECT_CALL(listener, OnCallstackEvent)
+      .Times(kChunkedCaptureCallstackEventCount)
+      .WillRepeatedly([&next_callstack_event_time](CallstackEvent callstack_event) {
+        EXPECT_EQ(callstack_event.time(), next_callstack_event_time++);
+      });
+  uint64_t next_timer_start = 0;
+  EXPECT_CALL(listener, OnTimer)
+      .Times(kChunkedCaptureTimerCount)
+      .WillRepeatedly([&next_timer_start](const TimerInfo& timer) {
+        EXPECT_EQ(timer.start(), next_timer_start);
+        next_timer_start += 2;
+      });
+  EXPECT_CALL(listener, OnCaptureComplete).Times(1);
+  EXPECT_CALL(listener, OnCaptureFailed).Times(0);
+  EXPECT_CALL(listener, OnCaptureCancelled).Times(0);
+
+  std::istringstream stream(CreateChunkedCapture());
+  std::unique_ptr<ThreadPool> thread_pool = ThreadPool::Create(4, 4, absl::Seconds(1));
+  ModuleManager module_manager;
+  capture_deserializer::Load(stream, "file_name", &listener, &module_manager,
+                             &cancellation_requested, thread_pool.get());
+  thread_pool->ShutdownAndWait();
+}
+
+TEST(CaptureDeserializer, LoadCompressedCapture) {
+  const std::string capture = CreateChunkedCapture();
+  const std::string compressed_capture = CreateChunkedCapture(/*compress_chunks=*/true);
+  EXPECT_LT(compressed_capture.size(), capture.size());
+
+  MockCaptureListener listener;
+  std::atomic<bool> cancellation_requested = false;
+  EXPECT_CALL(listener, OnCaptureStarted).Times(1);
+  EXPECT_CALL(listener, OnUniqueCallStack).Times(1);
+  EXPECT_CALL(listener, OnCallstackEvent).Times(kChunkedCaptureCallstackEventCount);
+  uint64_t next_timer_start = 0;
+  EXPECT_CALL(listener, OnTimer)
+      .Times(kChunkedCaptureTimerCount)
+      .WillRepeatedly([&next_timer_start](const TimerInfo& timer) {
+        EXPECT_EQ(timer.start(), next_timer_start);
+        next_timer_start += 2;
+      });
+  EXPECT_CALL(listener, OnCaptureComplete).Times(1);
+  EXPECT_CALL(listener, OnCaptureFailed).Times(0);
+
+  std::istringstream stream(compressed_capture);
+  std::unique_ptr<ThreadPool> thread_pool = ThreadPool::Create(4, 4, absl::Seconds(1));
+  ModuleManager module_manager;
+  capture_deserializer::Load(stream, "file_name", &listener, &module_manager,
+                             &cancellation_requested, thread_pool.get());
+  thread_pool->ShutdownAndWait();
+}
+
+TEST(CaptureDeserializer, LoadCorruptedChunkFails) {
+  std::string capture = CreateChunkedCapture();
+  ErrorMessageOr<CaptureChunkIndex> index = [&capture] {
+    std::istringstream stream(capture);
+    return capture_deserializer::ReadChunkIndex(stream);
+  }();
+  ASSERT_TRUE(index.has_value());
+  // Overwrite the payload of the last timers chunk with invalid data.
+  const CaptureChunkIndex::Entry& timers_chunk =
+      index.value().chunks(index.value().chunks_size() - 1);
+  ASSERT_EQ(timers_chunk.type(), orbit_client_protos::kTimersChunk);
+  std::fill_n(capture.begin() + timers_chunk.offset() + 3 * sizeof(uint32_t), timers_chunk.size(),
+              '\xff');
+
+  MockCaptureListener listener;
+  std::atomic<bool> cancellation_requested = false;
+  EXPECT_CALL(listener, OnCaptureStarted).Times(1);
+  EXPECT_CALL(listener, OnUniqueCallStack).Times(1);
+  EXPECT_CALL(listener, OnCallstackEvent).Times(kChunkedCaptureCallstackEventCount);
+  // The chunks before the corrupted one are still delivered.
+  EXPECT_CALL(listener, OnTimer).Times(kChunkedCaptureTimerCount - 1);
+  EXPECT_CALL(listener, OnCaptureFailed).Times(1);
+  EXPECT_CALL(listener, OnCaptureComplete).Times(0);
+
+  std::istringstream stream(capture);
+  ModuleManager module_manager;
+  capture_deserializer::Load(stream, "file_name", &listener, &module_manager,
+                             &cancellation_requested);
+}
+
+TEST(CaptureDeserializer, ReadChunkIndex) {
+  std::istringstream stream(CreateChunkedCapture());
+  ErrorMessageOr<CaptureChunkIndex> index_or_error = capture_deserializer::ReadChunkIndex(stream);
+  ASSERT_TRUE(index_or_error.has_value()) << index_or_error.error().message();
+  const CaptureChunkIndex& index = index_or_error.value();
+
+  std::vector<orbit_client_protos::CaptureChunkType> types;
+  for (const CaptureChunkIndex::Entry& entry : index.chunks()) {
+    types.push_back(entry.type());
+
+    stream.clear();
+    stream.seekg(entry.offset());
+    capture_deserializer::internal::CaptureChunk chunk;
+    ASSERT_TRUE(capture_deserializer::internal::ReadChunk(&stream, &chunk));
+    EXPECT_EQ(chunk.type, entry.type());
+    EXPECT_EQ(chunk.payload.size(), entry.size());
+  }
+  EXPECT_THAT(types,
+              ::testing::ElementsAre(
+                  orbit_client_protos::kCaptureInfoChunk, orbit_client_protos::kCallstacksChunk,
+                  orbit_client_protos::kCallstackEventsChunk,
+                  orbit_client_protos::kCallstackEventsChunk,
+                  orbit_client_protos::kCallstackEventsChunk, orbit_client_protos::kTimersChunk,
+                  orbit_client_protos::kTimersChunk, orbit_client_protos::kTimersChunk));
+
+  const CaptureChunkIndex::Entry& first_callstack_events_chunk = index.chunks(2);
+  EXPECT_EQ(first_callstack_events_chunk.min_timestamp_ns(), 0);
+  EXPECT_EQ(first_callstack_events_chunk.max_timestamp_ns(), 128 * 1024 - 1);
+  const CaptureChunkIndex::Entry& last_timers_chunk = index.chunks(index.chunks_size() - 1);
+  EXPECT_EQ(last_timers_chunk.min_timestamp_ns(), 2 * (kChunkedCaptureTimerCount - 1));
+  EXPECT_EQ(last_timers_chunk.max_timestamp_ns(), 2 * (kChunkedCaptureTimerCount - 1) + 1);
+}
@@ -6,28 +6,399 @@
 
 #include <OrbitClientData/FunctionUtils.h>
 
+#include <algorithm>
+#include <deque>
+#include <fstream>
+#include <limits>
 #include <memory>
+#include <optional>
+#include <utility>
 
 #include "CoreUtils.h"
 #include "OrbitBase/ExecutablePath.h"
+#include "OrbitBase/Tracing.h"
 #include "OrbitClientData/Callstack.h"
+#include "OrbitClientModel/CaptureChunkCompression.h"
+#include "OrbitClientModel/CaptureColumns.h"
+#include "absl/synchronization/notification.h"
 #include "capture_data.pb.h"
 #include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
 #include "google/protobuf/message.h"
+#include "google/protobuf/wire_format_lite.h"
 
-using orbit_client_protos::CallstackInfo;
+using capture_serializer::internal::EncodedChunk;
+using orbit_client_protos::CaptureChunkIndex;
+using orbit_client_protos::CaptureChunkType;
 using orbit_client_protos::CaptureInfo;
 using orbit_client_protos::FunctionInfo;
 using orbit_client_protos::FunctionStats;
+using orbit_client_protos::LinuxAddressInfo;
 using orbit_client_protos::ModuleInfo;
 using orbit_client_protos::ProcessInfo;
+using orbit_client_protos::ThreadStateSliceInfo;
+using orbit_client_protos::TimerInfo;
+using orbit_client_protos::TracepointEventInfo;
 
 namespace {
+
 inline constexpr std::string_view kFileOrbitExtension = ".orbit";
+
+// Keep chunks in the order of a few MB, far from the 2 GB limit of protobuf messages.
+constexpr size_t kKeysAndStringsPerChunk = 16 * 1024;
+constexpr size_t kAddressInfosPerChunk = 16 * 1024;
+constexpr size_t kThreadStateSlicesPerChunk = 64 * 1024;
+constexpr size_t kCallstacksPerChunk = 4 * 1024;
+constexpr size_t kCallstackEventsPerChunk = 128 * 1024;
+constexpr size_t kTracepointEventsPerChunk = 64 * 1024;
+
+// Bounds the memory used by the chunks encoded ahead of the one being written.
+constexpr size_t kMaxEncodersInFlight = 32;
+
+// Encodes one or more consecutive chunks of the capture. Runs on the thread pool while saving.
+using ChunksEncoder = std::function<std::vector<EncodedChunk>()>;
+
+// Serializes items as the repeated field field_number of a CaptureInfo, without copying them to
+// one.
+template <typename T>
+std::string SerializeAsRepeatedField(int field_number, absl::Span<const T* const> items) {
+  using google::protobuf::internal::WireFormatLite;
+  std::string payload;
+  {
+    google::protobuf::io::StringOutputStream string_stream(&payload);
+    google::protobuf::io::CodedOutputStream output(&string_stream);
+    for (const T* item : items) {
+      WireFormatLite::WriteTag(field_number, WireFormatLite::WIRETYPE_LENGTH_DELIMITED, &output);
+      output.WriteVarint32(static_cast<uint32_t>(item->ByteSizeLong()));
+      item->SerializeWithCachedSizes(&output);
+    }
+  }
+  return payload;
+}
+
+EncodedChunk CreateCaptureInfoChunk(CaptureChunkType type, const CaptureInfo& capture_info) {
+  EncodedChunk chunk;
+  chunk.type = type;
+  {
+    google::protobuf::io::StringOutputStream string_stream(&chunk.payload);
+    google::protobuf::io::CodedOutputStream output(&string_stream);
+    // Write maps in the order of their keys rather than in the order of their hash table.
+    output.SetSerializationDeterministic(true);
+    capture_info.SerializeToCodedStream(&output);
+  }
+  return chunk;
+}
+
+// Adds an encoder for each range of up to items_per_chunk items, which encode_range turns into a
+// chunk. The items are shared by the encoders.
+template <typename T, typename EncodeRange>
+void AddRangeEncoders(std::vector<const T*> items, size_t items_per_chunk,
+                      EncodeRange encode_range, std::vector<ChunksEncoder>* encoders) {
+  auto shared_items = std::make_shared<const std::vector<const T*>>(std::move(items));
+  for (size_t begin = 0; begin < shared_items->size(); begin += items_per_chunk) {
+    const size_t size = std::min(items_per_chunk, shared_items->size() - begin);
+    encoders->push_back([shared_items, begin, size, encode_range] {
+      std::vector<EncodedChunk> chunks;
+      chunks.push_back(encode_range(absl::MakeConstSpan(shared_items->data() + begin, size)));
+      return chunks;
+    });
+  }
 }
 
+// Fixes names/offset/module in address infos (some might only be in process).
+void SetAddressInfo(const CaptureData& capture_data, const LinuxAddressInfo& address_info,
+                    LinuxAddressInfo* added_address_info) {
+  const uint64_t absolute_address = address_info.absolute_address();
+  added_address_info->set_absolute_address(absolute_address);
+  const FunctionInfo* function = capture_data.FindFunctionByAddress(absolute_address, false);
+  if (function == nullptr) {
+    added_address_info->set_module_path(address_info.module_path());
+    added_address_info->set_function_name(address_info.function_name());
+    added_address_info->set_offset_in_function(address_info.offset_in_function());
+    return;
+  }
+  added_address_info->set_function_name(function_utils::GetDisplayName(*function));
+  const uint64_t absolute_function_address = capture_data.GetAbsoluteAddress(*function);
+  added_address_info->set_offset_in_function(absolute_address - absolute_function_address);
+  added_address_info->set_module_path(function->loaded_module_path());
+}
+
+template <typename Key, typename Value>
+std::vector<Key> SortedKeys(const absl::flat_hash_map<Key, Value>& map) {
+  std::vector<Key> keys;
+  keys.reserve(map.size());
+  for (const auto& [key, value] : map) {
+    keys.push_back(key);
+  }
+  std::sort(keys.begin(), keys.end());
+  return keys;
+}
+
+// Returns the encoders of all the chunks of the capture but the index, in the order of the file.
+// The encoders read capture_data and key_to_string_map, which must outlive them.
+std::vector<ChunksEncoder> CreateEncoders(
+    const CaptureData& capture_data,
+    const absl::flat_hash_map<uint64_t, std::string>& key_to_string_map,
+    std::vector<capture_serializer::TimersSection> timers_sections) {
+  ORBIT_SCOPE_FUNCTION;
+  std::vector<ChunksEncoder> encoders;
+
+  encoders.push_back([&capture_data] {
+    std::vector<EncodedChunk> chunks;
+    chunks.push_back(CreateCaptureInfoChunk(
+        orbit_client_protos::kCaptureInfoChunk,
+        capture_serializer::internal::GenerateCaptureInfoMetadata(capture_data)));
+    return chunks;
+  });
+
+  std::vector<const std::pair<const uint64_t, std::string>*> keys_and_strings;
+  keys_and_strings.reserve(key_to_string_map.size());
+  for (const auto& key_and_string : key_to_string_map) {
+    keys_and_strings.push_back(&key_and_string);
+  }
+  // Hash map order depends on the instance, sort to save the same capture the same way.
+  std::sort(keys_and_strings.begin(), keys_and_strings.end(),
+            [](const auto* lhs, const auto* rhs) { return lhs->first < rhs->first; });
+  AddRangeEncoders(
+      std::move(keys_and_strings), kKeysAndStringsPerChunk,
+      [](absl::Span<const std::pair<const uint64_t, std::string>* const> range) {
+        CaptureInfo chunk;
+        for (const auto* key_and_string : range) {
+          chunk.mutable_key_to_string()->insert({key_and_string->first, key_and_string->second});
+        }
+        return CreateCaptureInfoChunk(orbit_client_protos::kKeysAndStringsChunk, chunk);
+      },
+      &encoders);
+
+  std::vector<const LinuxAddressInfo*> address_infos;
+  address_infos.reserve(capture_data.address_infos().size());
+  for (const auto& [absolute_address, address_info] : capture_data.address_infos()) {
+    address_infos.push_back(&address_info);
+  }
+  std::sort(address_infos.begin(), address_infos.end(),
+            [](const LinuxAddressInfo* lhs, const LinuxAddressInfo* rhs) {
+              return lhs->absolute_address() < rhs->absolute_address();
+            });
+  AddRangeEncoders(
+      std::move(address_infos), kAddressInfosPerChunk,
+      [&capture_data](absl::Span<const LinuxAddressInfo* const> range) {
+        CaptureInfo chunk;
+        chunk.mutable_address_infos()->Reserve(static_cast<int>(range.size()));
+        for (const LinuxAddressInfo* address_info : range) {
+          SetAddressInfo(capture_data, *address_info, chunk.add_address_infos());
+        }
+        return CreateCaptureInfoChunk(orbit_client_protos::kAddressInfosChunk, chunk);
+      },
+      &encoders);
+
+  // Thread state slices are saved in their original order only among the same thread, but all
+  // slices of the same thread are saved sequentially.
+  std::vector<const ThreadStateSliceInfo*> thread_state_slices;
+  for (int32_t tid : SortedKeys(capture_data.thread_state_slices())) {
+    for (const ThreadStateSliceInfo& slice : capture_data.thread_state_slices().at(tid)) {
+      thread_state_slices.push_back(&slice);
+    }
+  }
+  AddRangeEncoders(
+      std::move(thread_state_slices), kThreadStateSlicesPerChunk,
+      [](absl::Span<const ThreadStateSliceInfo* const> range) {
+        EncodedChunk chunk;
+        chunk.type = orbit_client_protos::kThreadStateSlicesChunk;
+        chunk.payload =
+            SerializeAsRepeatedField(CaptureInfo::kThreadStateSlicesFieldNumber, range);
+        chunk.min_timestamp_ns = std::numeric_limits<uint64_t>::max();
+        for (const ThreadStateSliceInfo* slice : range) {
+          chunk.min_timestamp_ns = std::min(chunk.min_timestamp_ns, slice->begin_timestamp_ns());
+          chunk.max_timestamp_ns = std::max(chunk.max_timestamp_ns, slice->end_timestamp_ns());
+        }
+        return chunk;
+      },
+      &encoders);
+
+  // TODO: this is not really synchronized, since GetCallstackData processing below is not under the
+  // same mutex lock we could end up having list of callstacks inconsistent with unique_callstacks.
+  // Revisit sampling profiler data thread-safety.
+  const CallstackData* callstack_data = capture_data.GetCallstackData();
+  std::vector<const CallStack*> callstacks;
+  callstack_data->ForEachUniqueCallstack(
+      [&callstacks](const CallStack& callstack) { callstacks.push_back(&callstack); });
+  // Hash map order depends on the instance, sort to save the same capture the same way.
+  std::sort(callstacks.begin(), callstacks.end(), [](const CallStack* lhs, const CallStack* rhs) {
+    return lhs->GetHash() < rhs->GetHash();
+  });
+  AddRangeEncoders(
+      std::move(callstacks), kCallstacksPerChunk,
+      [](absl::Span<const CallStack* const> range) {
+        CaptureInfo chunk;
+        for (const CallStack* callstack : range) {
+          *chunk.add_callstacks()->mutable_data() = {callstack->GetFrames().begin(),
+                                                     callstack->GetFrames().end()};
+        }
+        return CreateCaptureInfoChunk(orbit_client_protos::kCallstacksChunk, chunk);
+      },
+      &encoders);
+
+  // The callstack events of each thread are already in time-sorted columns, one encoder per thread
+  // copies them to chunks.
+  std::vector<int32_t> callstack_event_tids;
+  for (const auto& [tid, count] : callstack_data->GetCallstackEventsCountsPerTid()) {
+    callstack_event_tids.push_back(tid);
+  }
+  std::sort(callstack_event_tids.begin(), callstack_event_tids.end());
+  for (int32_t tid : callstack_event_tids) {
+    encoders.push_back([callstack_data, tid] {
+      std::vector<EncodedChunk> chunks;
+      capture_columns::CallstackEventColumnsBuilder builder;
+      auto add_chunk = [&chunks, &builder] {
+        EncodedChunk chunk;
+        chunk.type = orbit_client_protos::kCallstackEventsChunk;
+        chunk.payload = builder.Build();
+        chunk.min_timestamp_ns = builder.min_timestamp_ns();
+        chunk.max_timestamp_ns = builder.max_timestamp_ns();
+        chunks.push_back(std::move(chunk));
+        builder = capture_columns::CallstackEventColumnsBuilder{};
+      };
+      callstack_data->ForEachCallstackEventSpanOfTidInTimeRange(
+          tid, 0, std::numeric_limits<uint64_t>::max(),
+          [tid, &builder, &add_chunk](absl::Span<const uint64_t> times,
+                                      absl::Span<const CallstackID> callstack_ids) {
+            for (size_t i = 0; i < times.size(); ++i) {
+              builder.Add(times[i], callstack_ids[i], tid);
+              if (builder.size() == kCallstackEventsPerChunk) add_chunk();
+            }
+          });
+      if (builder.size() > 0) add_chunk();
+      return chunks;
+    });
+  }
+
+  std::vector<const TracepointEventInfo*> tracepoint_events;
+  capture_data.GetTracepointData()->ForEachTracepointEvent(
+      [&tracepoint_events](const TracepointEventInfo& tracepoint_event) {
+        tracepoint_events.push_back(&tracepoint_event);
+      });
+  // The events are grouped by thread in hash map order.
+  std::stable_sort(tracepoint_events.begin(), tracepoint_events.end(),
+                   [](const TracepointEventInfo* lhs, const TracepointEventInfo* rhs) {
+                     if (lhs->tid() != rhs->tid()) return lhs->tid() < rhs->tid();
+                     return lhs->time() < rhs->time();
+                   });
+  AddRangeEncoders(
+      std::move(tracepoint_events), kTracepointEventsPerChunk,
+      [](absl::Span<const TracepointEventInfo* const> range) {
+        EncodedChunk chunk;
+        chunk.type = orbit_client_protos::kTracepointEventsChunk;
+        chunk.payload =
+            SerializeAsRepeatedField(CaptureInfo::kTracepointEventInfosFieldNumber, range);
+        chunk.min_timestamp_ns = std::numeric_limits<uint64_t>::max();
+        for (const TracepointEventInfo* event : range) {
+          const auto time = static_cast<uint64_t>(event->time());
+          chunk.min_timestamp_ns = std::min(chunk.min_timestamp_ns, time);
+          chunk.max_timestamp_ns = std::max(chunk.max_timestamp_ns, time);
+        }
+        return chunk;
+      },
+      &encoders);
+
+  for (capture_serializer::TimersSection& timers_section : timers_sections) {
+    encoders.push_back([timers_section = std::move(timers_section)] {
+      capture_columns::TimerColumnsBuilder builder;
+      timers_section(&builder);
+      std::vector<EncodedChunk> chunks;
+      if (builder.size() == 0) return chunks;
+      EncodedChunk chunk;
+      chunk.type = orbit_client_protos::kTimersChunk;
+      chunk.payload = builder.Build();
+      chunk.min_timestamp_ns = builder.min_timestamp_ns();
+      chunk.max_timestamp_ns = builder.max_timestamp_ns();
+      chunks.push_back(std::move(chunk));
+      return chunks;
+    });
+  }
+
+  return encoders;
+}
+
+// Runs the encoders on thread_pool, if not null, a bounded number of them ahead of the chunks being
+// written, and writes their chunks in the order of the encoders.
+void WriteChunksInOrder(std::vector<ChunksEncoder> encoders, bool compress_chunks,
+                        ThreadPool* thread_pool,
+                        capture_serializer::internal::CaptureChunkWriter* writer) {
+  struct PendingChunks {
+    std::vector<EncodedChunk> chunks;
+    absl::Notification encoded;
+  };
+
+  const size_t max_encoders_in_flight = thread_pool != nullptr ? kMaxEncodersInFlight : 1;
+  std::deque<std::unique_ptr<PendingChunks>> pending;
+  size_t next_encoder = 0;
+  while (next_encoder < encoders.size() || !pending.empty()) {
+    while (next_encoder < encoders.size() && pending.size() < max_encoders_in_flight) {
+      auto pending_chunks = std::make_unique<PendingChunks>();
+      auto encode = [pending_chunks = pending_chunks.get(),
+                     encoder = std::move(encoders[next_encoder]), compress_chunks] {
+        ORBIT_SCOPE("Encode capture chunks");
+        pending_chunks->chunks = encoder();
+        if (compress_chunks) {
+          for (EncodedChunk& chunk : pending_chunks->chunks) {
+            capture_serializer::internal::CompressChunk(&chunk);
+          }
+        }
+        pending_chunks->encoded.Notify();
+      };
+      ++next_encoder;
+      pending.push_back(std::move(pending_chunks));
+      if (thread_pool != nullptr) {
+        thread_pool->Schedule(std::move(encode));
+      } else {
+        encode();
+      }
+    }
+
+    std::unique_ptr<PendingChunks> pending_chunks = std::move(pending.front());
+    pending.pop_front();
+    pending_chunks->encoded.WaitForNotification();
+    for (const EncodedChunk& chunk : pending_chunks->chunks) {
+      writer->WriteChunk(chunk);
+    }
+  }
+}
+
+}  // namespace
+
 namespace capture_serializer {
 
+ErrorMessageOr<void> Save(const std::string& filename, const CaptureData& capture_data,
+                          const absl::flat_hash_map<uint64_t, std::string>& key_to_string_map,
+                          std::vector<TimersSection> timers_sections, ThreadPool* thread_pool) {
+  std::ofstream file(filename, std::ios::binary);
+  if (file.fail()) {
+    ERROR("Saving capture in \"%s\": %s", filename, "file.fail()");
+    return ErrorMessage("Error opening the file for writing");
+  }
+
+  {
+    SCOPED_TIMED_LOG("Saving capture in \"%s\"", filename);
+    internal::Save(file, capture_data, key_to_string_map, std::move(timers_sections),
+                   thread_pool);
+  }
+
+  return outcome::success();
+}
+
+std::vector<TimersSection> CreateTimersSections(absl::Span<const TimerInfo> timers) {
+  std::vector<TimersSection> sections;
+  for (size_t begin = 0; begin < timers.size(); begin += internal::kTimersPerChunk) {
+    absl::Span<const TimerInfo> section_timers = timers.subspan(begin, internal::kTimersPerChunk);
+    sections.emplace_back([section_timers](capture_columns::TimerColumnsBuilder* builder) {
+      for (const TimerInfo& timer : section_timers) {
+        builder->Add(timer);
+      }
+    });
+  }
+  return sections;
+}
+
 void WriteMessage(const google::protobuf::Message* message,
                   google::protobuf::io::CodedOutputStream* output) {
   uint32_t message_size = message->ByteSizeLong();
@@ -53,12 +424,19 @@ void IncludeOrbitExtensionInFile(std::string& file_name) {
 
 namespace internal {
 
-CaptureInfo GenerateCaptureInfo(
-    const CaptureData& capture_data,
-    const absl::flat_hash_map<uint64_t, std::string>& key_to_string_map) {
+CaptureInfo GenerateCaptureInfoMetadata(const CaptureData& capture_data) {
+  // The repeated fields that come from hash containers are sorted, so that the same capture is
+  // always saved the same way.
   CaptureInfo capture_info;
-  for (const auto& pair : capture_data.selected_functions()) {
-    capture_info.add_selected_functions()->CopyFrom(pair.second);
+  std::vector<const std::pair<const uint64_t, FunctionInfo>*> selected_functions;
+  selected_functions.reserve(capture_data.selected_functions().size());
+  for (const auto& address_and_function : capture_data.selected_functions()) {
+    selected_functions.push_back(&address_and_function);
+  }
+  std::sort(selected_functions.begin(), selected_functions.end(),
+            [](const auto* lhs, const auto* rhs) { return lhs->first < rhs->first; });
+  for (const auto* address_and_function : selected_functions) {
+    capture_info.add_selected_functions()->CopyFrom(address_and_function->second);
   }
 
   ProcessInfo* process = capture_info.mutable_process();
@@ -81,61 +459,20 @@ CaptureInfo GenerateCaptureInfo(
     module_info->set_build_id(module->build_id());
     module_info->set_load_bias(module->load_bias());
   }
+  std::sort(capture_info.mutable_modules()->begin(), capture_info.mutable_modules()->end(),
+            [](const ModuleInfo& lhs, const ModuleInfo& rhs) {
+              return lhs.address_start() < rhs.address_start();
+            });
 
   capture_info.mutable_thread_names()->insert(capture_data.thread_names().begin(),
                                               capture_data.thread_names().end());
 
-  for (const auto& tid_and_thread_state_slices : capture_data.thread_state_slices()) {
-    // Note that thread state slices are saved in their original order only among the same thread,
-    // but all slices related to the same thread are saved sequentially. This might not be desired
-    // if the capture is opened in a streaming fashion.
-    for (const auto& thread_state_slice : tid_and_thread_state_slices.second) {
-      orbit_client_protos::ThreadStateSliceInfo* added_thread_state_slice =
-          capture_info.add_thread_state_slices();
-      added_thread_state_slice->CopyFrom(thread_state_slice);
-    }
-  }
-
-  capture_info.mutable_address_infos()->Reserve(capture_data.address_infos().size());
-  for (const auto& address_info : capture_data.address_infos()) {
-    orbit_client_protos::LinuxAddressInfo* added_address_info = capture_info.add_address_infos();
-    added_address_info->CopyFrom(address_info.second);
-    const uint64_t absolute_address = added_address_info->absolute_address();
-    const orbit_client_protos::FunctionInfo* function =
-        capture_data.FindFunctionByAddress(absolute_address, false);
-    if (function == nullptr) {
-      continue;
-    }
-    // Fix names/offset/module in address infos (some might only be in process):
-    added_address_info->set_function_name(function_utils::GetDisplayName(*function));
-    uint64_t absolute_function_address = capture_data.GetAbsoluteAddress(*function);
-    const uint64_t offset = absolute_address - absolute_function_address;
-    added_address_info->set_offset_in_function(offset);
-    added_address_info->set_module_path(function->loaded_module_path());
-  }
-
   const FunctionInfoMap<FunctionStats>& functions_stats = capture_data.functions_stats();
   for (const auto& [function, stats] : functions_stats) {
     uint64_t absolute_address = capture_data.GetAbsoluteAddress(function);
     capture_info.mutable_function_stats()->operator[](absolute_address) = stats;
   }
 
-  // TODO: this is not really synchronized, since GetCallstackData processing below is not under the
-  // same mutex lock we could end up having list of callstacks inconsistent with unique_callstacks.
-  // Revisit sampling profiler data thread-safety.
-  capture_data.GetCallstackData()->ForEachUniqueCallstack(
-      [&capture_info](const CallStack& call_stack) {
-        CallstackInfo* callstack = capture_info.add_callstacks();
-        *callstack->mutable_data() = {call_stack.GetFrames().begin(), call_stack.GetFrames().end()};
-      });
-
-  capture_info.mutable_callstack_events()->Reserve(
-      capture_data.GetCallstackData()->GetCallstackEventsCount());
-  capture_data.GetCallstackData()->ForEachCallstackEvent(
-      [&capture_info](const orbit_client_protos::CallstackEvent& event) {
-        capture_info.add_callstack_events()->CopyFrom(event);
-      });
-
   capture_data.GetTracepointData()->ForEachUniqueTracepointInfo(
       [&capture_info](const orbit_client_protos::TracepointInfo& tracepoint_info) {
         orbit_client_protos::TracepointInfo* new_tracepoint_info =
@@ -144,13 +481,12 @@ CaptureInfo GenerateCaptureInfo(
         *new_tracepoint_info->mutable_name() = tracepoint_info.name();
         new_tracepoint_info->set_tracepoint_info_key(tracepoint_info.tracepoint_info_key());
       });
-
-  capture_data.GetTracepointData()->ForEachTracepointEvent(
-      [&capture_info](const orbit_client_protos::TracepointEventInfo& tracepoint_event_info) {
-        capture_info.add_tracepoint_event_infos()->CopyFrom(tracepoint_event_info);
-      });
-
-  capture_info.mutable_key_to_string()->insert(key_to_string_map.begin(), key_to_string_map.end());
+  std::sort(capture_info.mutable_tracepoint_infos()->begin(),
+            capture_info.mutable_tracepoint_infos()->end(),
+            [](const orbit_client_protos::TracepointInfo& lhs,
+               const orbit_client_protos::TracepointInfo& rhs) {
+              return lhs.tracepoint_info_key() < rhs.tracepoint_info_key();
+            });
 
   for (const auto& function : capture_data.user_defined_capture_data().frame_track_functions()) {
     capture_info.mutable_user_defined_capture_info()
@@ -158,10 +494,94 @@ CaptureInfo GenerateCaptureInfo(
         ->add_frame_track_functions()
         ->CopyFrom(function);
   }
+  auto* frame_track_functions = capture_info.mutable_user_defined_capture_info()
+                                    ->mutable_frame_tracks_info()
+                                    ->mutable_frame_track_functions();
+  std::sort(frame_track_functions->begin(), frame_track_functions->end(),
+            [](const FunctionInfo& lhs, const FunctionInfo& rhs) {
+              if (lhs.loaded_module_path() != rhs.loaded_module_path()) {
+                return lhs.loaded_module_path() < rhs.loaded_module_path();
+              }
+              return lhs.address() < rhs.address();
+            });
 
   return capture_info;
 }
 
+void CompressChunk(EncodedChunk* chunk) {
+  std::optional<std::string> compressed = capture_compression::Compress(chunk->payload);
+  if (!compressed.has_value()) {
+    return;
+  }
+  chunk->uncompressed_size = chunk->payload.size();
+  chunk->payload = std::move(compressed.value());
+}
+
+void CaptureChunkWriter::WriteChunk(CaptureChunkType type,
+                                    const google::protobuf::Message& payload,
+                                    uint64_t min_timestamp_ns, uint64_t max_timestamp_ns) {
+  const size_t payload_size = payload.ByteSizeLong();
+  CHECK(payload_size <= static_cast<size_t>(std::numeric_limits<int>::max()));
+  WriteChunkHeader(type, payload_size, 0, min_timestamp_ns, max_timestamp_ns);
+  payload.SerializeWithCachedSizes(output_);
+}
+
+void CaptureChunkWriter::WriteChunk(CaptureChunkType type, std::string_view payload,
+                                    uint64_t min_timestamp_ns, uint64_t max_timestamp_ns) {
+  CHECK(payload.size() <= static_cast<size_t>(std::numeric_limits<int>::max()));
+  WriteChunkHeader(type, payload.size(), 0, min_timestamp_ns, max_timestamp_ns);
+  output_->WriteRaw(payload.data(), static_cast<int>(payload.size()));
+}
+
+void CaptureChunkWriter::WriteChunk(const EncodedChunk& chunk) {
+  CHECK(chunk.payload.size() <= static_cast<size_t>(std::numeric_limits<int>::max()));
+  CHECK(chunk.uncompressed_size <= static_cast<uint64_t>(std::numeric_limits<int>::max()));
+  WriteChunkHeader(chunk.type, chunk.payload.size(), chunk.uncompressed_size,
+                   chunk.min_timestamp_ns, chunk.max_timestamp_ns);
+  output_->WriteRaw(chunk.payload.data(), static_cast<int>(chunk.payload.size()));
+}
+
+void CaptureChunkWriter::WriteChunkHeader(CaptureChunkType type, size_t payload_size,
+                                          uint64_t uncompressed_size, uint64_t min_timestamp_ns,
+                                          uint64_t max_timestamp_ns) {
+  CaptureChunkIndex::Entry* entry = index_.add_chunks();
+  entry->set_type(type);
+  entry->set_offset(offset_);
+  entry->set_size(payload_size);
+  entry->set_min_timestamp_ns(min_timestamp_ns);
+  entry->set_max_timestamp_ns(max_timestamp_ns);
+  entry->set_uncompressed_size(uncompressed_size);
+
+  output_->WriteLittleEndian32(type);
+  output_->WriteLittleEndian32(static_cast<uint32_t>(payload_size));
+  output_->WriteLittleEndian32(static_cast<uint32_t>(uncompressed_size));
+  offset_ += 3 * sizeof(uint32_t) + payload_size;
+}
+
+void CaptureChunkWriter::Finish() {
+  const uint64_t index_offset = offset_;
+  CaptureChunkIndex index = std::move(index_);
+  WriteChunk(orbit_client_protos::kIndexChunk, index);
+  output_->WriteLittleEndian64(index_offset);
+}
+
+void Save(std::ostream& stream, const CaptureData& capture_data,
+          const absl::flat_hash_map<uint64_t, std::string>& key_to_string_map,
+          std::vector<TimersSection> timers_sections, ThreadPool* thread_pool,
+          bool compress_chunks) {
+  google::protobuf::io::OstreamOutputStream out_stream(&stream);
+  google::protobuf::io::CodedOutputStream coded_output(&out_stream);
+
+  orbit_client_protos::CaptureHeader header;
+  header.set_version(kRequiredCaptureVersion);
+  WriteMessage(&header, &coded_output);
+
+  CaptureChunkWriter chunk_writer(&coded_output);
+  WriteChunksInOrder(CreateEncoders(capture_data, key_to_string_map, std::move(timers_sections)),
+                     compress_chunks, thread_pool, &chunk_writer);
+  chunk_writer.Finish();
+}
+
 }  // namespace internal
 
 }  // namespace capture_serializer
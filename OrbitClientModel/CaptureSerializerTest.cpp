@@ -3,15 +3,20 @@
 // found in the LICENSE file.
 
 #include <memory>
+#include <sstream>
 #include <string>
+#include <vector>
 
 #include "CaptureSerializationTestMatchers.h"
 #include "CoreUtils.h"
+#include "OrbitBase/ThreadPool.h"
 #include "OrbitClientData/FunctionUtils.h"
 #include "OrbitClientData/ModuleManager.h"
 #include "OrbitClientData/ProcessData.h"
 #include "OrbitClientData/TracepointCustom.h"
+#include "OrbitClientModel/CaptureColumns.h"
 #include "OrbitClientModel/CaptureData.h"
+#include "OrbitClientModel/CaptureDeserializer.h"
 #include "OrbitClientModel/CaptureSerializer.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/strings/str_cat.h"
@@ -27,10 +32,49 @@ using orbit_client_protos::CaptureInfo;
 using orbit_client_protos::FunctionInfo;
 using orbit_client_protos::FunctionStats;
 using orbit_client_protos::LinuxAddressInfo;
+using orbit_client_protos::TimerInfo;
 using orbit_client_protos::TracepointEventInfo;
 using orbit_grpc_protos::TracepointInfo;
 using ::testing::ElementsAreArray;
 
+namespace {
+
+// Merges all the chunks of a saved capture in one CaptureInfo, and appends its timers to timers.
+CaptureInfo ReadSavedCapture(const std::string& capture, std::vector<TimerInfo>* timers) {
+  std::istringstream stream(capture);
+  orbit_client_protos::CaptureHeader header;
+  EXPECT_TRUE(capture_deserializer::internal::ReadMessage(&header, &stream));
+  EXPECT_EQ(header.version(), capture_serializer::internal::kRequiredCaptureVersion);
+
+  CaptureInfo capture_info;
+  capture_deserializer::internal::CaptureChunk chunk;
+  while (capture_deserializer::internal::ReadChunk(&stream, &chunk) &&
+         chunk.type != orbit_client_protos::kIndexChunk) {
+    EXPECT_TRUE(capture_deserializer::internal::DecompressChunk(&chunk));
+    if (chunk.type == orbit_client_protos::kTimersChunk) {
+      auto columns = capture_columns::TimerColumns::Create(chunk.payload);
+      EXPECT_TRUE(columns.has_value());
+      for (size_t i = 0; i < columns.value().size(); ++i) {
+        columns.value().Decode(i, &timers->emplace_back());
+      }
+    } else if (chunk.type == orbit_client_protos::kCallstackEventsChunk) {
+      auto columns = capture_columns::CallstackEventColumns::Create(chunk.payload);
+      EXPECT_TRUE(columns.has_value());
+      for (size_t i = 0; i < columns.value().size(); ++i) {
+        columns.value().Decode(i, capture_info.add_callstack_events());
+      }
+    } else {
+      CaptureInfo chunk_capture_info;
+      EXPECT_TRUE(chunk_capture_info.ParseFromArray(chunk.payload.data(),
+                                                    static_cast<int>(chunk.payload.size())));
+      capture_info.MergeFrom(chunk_capture_info);
+    }
+  }
+  return capture_info;
+}
+
+}  // namespace
+
 TEST(CaptureSerializer, GetCaptureFileName) {
   int32_t process_id = 42;
   std::string process_name = "p";
@@ -69,7 +113,7 @@ TEST(CaptureSerializer, IncludeOrbitExtensionInFile) {
   EXPECT_EQ(expected_file_name, file_name_without_extension);
 }
 
-TEST(CaptureSerializer, GenerateCaptureInfo) {
+TEST(CaptureSerializer, SaveWritesAllFields) {
   int32_t process_id = 42;
   std::string process_name = "p";
   orbit_grpc_protos::ProcessInfo process_info;
@@ -170,8 +214,11 @@ TEST(CaptureSerializer, GenerateCaptureInfo) {
   key_to_string_map[1] = "b";
   key_to_string_map[2] = "c";
 
-  CaptureInfo capture_info =
-      capture_serializer::internal::GenerateCaptureInfo(capture_data, key_to_string_map);
+  std::ostringstream stream;
+  capture_serializer::internal::Save(stream, capture_data, key_to_string_map, {}, nullptr);
+  std::vector<TimerInfo> timers;
+  CaptureInfo capture_info = ReadSavedCapture(stream.str(), &timers);
+  EXPECT_TRUE(timers.empty());
 
   ASSERT_EQ(1, capture_info.selected_functions_size());
   const FunctionInfo& actual_selected_function = capture_info.selected_functions(0);
@@ -256,4 +303,107 @@ TEST(CaptureSerializer, GenerateCaptureInfo) {
     EXPECT_EQ(expected_key_to_string.second,
               capture_info.key_to_string().at(expected_key_to_string.first));
   }
-}
\ No newline at end of file
+}
+
+TEST(CaptureSerializer, SaveWithThreadPoolWritesTheSameChunks) {
+  orbit_grpc_protos::ProcessInfo process_info;
+  process_info.set_name("p");
+  process_info.set_pid(42);
+  ModuleManager module_manager;
+  CaptureData capture_data{ProcessData{process_info}, &module_manager, {}, {},
+                           UserDefinedCaptureData{}};
+
+  CallStack callstack(std::vector<uint64_t>{1, 2, 3});
+  capture_data.AddUniqueCallStack(callstack);
+  // More events per thread than fit in a chunk.
+  constexpr uint64_t kCallstackEventsPerThread = 200'000;
+  for (int32_t thread_id = 1; thread_id <= 3; ++thread_id) {
+    for (uint64_t i = 0; i < kCallstackEventsPerThread; ++i) {
+      CallstackEvent callstack_event;
+      callstack_event.set_time(10 * i + thread_id);
+      callstack_event.set_thread_id(thread_id);
+      callstack_event.set_callstack_hash(callstack.GetHash());
+      capture_data.AddCallstackEvent(callstack_event);
+    }
+  }
+
+  std::vector<TimerInfo> timers(2 * capture_serializer::internal::kTimersPerChunk + 1);
+  for (size_t i = 0; i < timers.size(); ++i) {
+    timers[i].set_start(10 * i);
+    timers[i].set_end(10 * i + 5);
+    timers[i].set_thread_id(1);
+    timers[i].set_function_address(0x1000 + i % 20);
+  }
+
+  auto save = [&](ThreadPool* thread_pool, bool compress_chunks) {
+    std::ostringstream stream;
+    capture_serializer::internal::Save(stream, capture_data, {},
+                                       capture_serializer::CreateTimersSections(timers),
+                                       thread_pool, compress_chunks);
+    return stream.str();
+  };
+  const std::string capture = save(nullptr, true);
+  std::unique_ptr<ThreadPool> thread_pool = ThreadPool::Create(4, 4, absl::Seconds(1));
+  EXPECT_EQ(save(thread_pool.get(), true), capture);
+  EXPECT_LT(capture.size(), save(nullptr, false).size());
+  thread_pool->ShutdownAndWait();
+
+  std::vector<TimerInfo> saved_timers;
+  CaptureInfo capture_info = ReadSavedCapture(capture, &saved_timers);
+  ASSERT_EQ(saved_timers.size(), timers.size());
+  EXPECT_EQ(saved_timers.back().start(), timers.back().start());
+  EXPECT_EQ(saved_timers.back().function_address(), timers.back().function_address());
+  ASSERT_EQ(capture_info.callstack_events_size(), 3 * kCallstackEventsPerThread);
+  // Events are saved by thread, in time order.
+  EXPECT_EQ(capture_info.callstack_events(0).thread_id(), 1);
+  EXPECT_EQ(capture_info.callstack_events(0).time(), 1);
+  EXPECT_EQ(capture_info.callstack_events(kCallstackEventsPerThread).thread_id(), 2);
+  EXPECT_EQ(capture_info.callstack_events(3 * kCallstackEventsPerThread - 1).time(),
+            10 * (kCallstackEventsPerThread - 1) + 3);
+}
+
+TEST(CaptureSerializer, SaveDoesNotDependOnHashMapOrder) {
+  constexpr uint64_t kCount = 1000;
+  // The same keys, address infos, selected functions, tracepoint infos and tracepoint events,
+  // inserted in opposite orders and, where possible, in maps of different capacities.
+  auto save = [](bool reversed) {
+    orbit_grpc_protos::ProcessInfo process_info;
+    process_info.set_pid(42);
+    ModuleManager module_manager;
+    absl::flat_hash_map<uint64_t, FunctionInfo> selected_functions;
+    if (reversed) selected_functions.reserve(16 * kCount);
+    for (uint64_t i = 0; i < kCount; ++i) {
+      const uint64_t value = reversed ? kCount - 1 - i : i;
+      FunctionInfo function;
+      function.set_name(absl::StrCat("function ", value));
+      function.set_address(0x2000 + value);
+      selected_functions.emplace(0x2000 + value, function);
+    }
+    CaptureData capture_data{ProcessData{process_info}, &module_manager,
+                             std::move(selected_functions), {}, UserDefinedCaptureData{}};
+    absl::flat_hash_map<uint64_t, std::string> key_to_string_map;
+    if (reversed) key_to_string_map.reserve(16 * kCount);
+    for (uint64_t i = 0; i < kCount; ++i) {
+      const uint64_t value = reversed ? kCount - 1 - i : i;
+      key_to_string_map.emplace(value, absl::StrCat("string ", value));
+      LinuxAddressInfo address_info;
+      address_info.set_absolute_address(0x1000 + value);
+      address_info.set_function_name(absl::StrCat("function ", value));
+      capture_data.InsertAddressInfo(address_info);
+      TracepointInfo tracepoint_info;
+      tracepoint_info.set_category("category");
+      tracepoint_info.set_name(absl::StrCat("tracepoint ", value));
+      capture_data.AddUniqueTracepointEventInfo(value, tracepoint_info);
+      // One event per thread, the threads of the target process and of other processes mixed.
+      capture_data.AddTracepointEventAndMapToThreads(
+          /*time=*/value, /*tracepoint_hash=*/value, /*process_id=*/value % 2 == 0 ? 42 : 43,
+          /*thread_id=*/value, /*cpu=*/0, /*is_same_pid_as_target=*/value % 2 == 0);
+    }
+
+    std::ostringstream stream;
+    capture_serializer::internal::Save(stream, capture_data, key_to_string_map, {},
+                                       /*thread_pool=*/nullptr);
+    return stream.str();
+  };
+  EXPECT_EQ(save(false), save(true));
+}
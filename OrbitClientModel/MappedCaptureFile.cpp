@@ -0,0 +1,156 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "OrbitClientModel/MappedCaptureFile.h"
+
+#include <limits>
+
+#include "OrbitBase/MakeUniqueForOverwrite.h"
+#include "OrbitBase/Tracing.h"
+#include "OrbitClientModel/CaptureChunkCompression.h"
+#include "OrbitClientModel/CaptureDeserializer.h"
+#include "absl/strings/str_format.h"
+#include "google/protobuf/io/coded_stream.h"
+
+using orbit_client_protos::CaptureChunkIndex;
+using orbit_client_protos::CaptureChunkType;
+using orbit_client_protos::CaptureHeader;
+
+namespace {
+
+constexpr uint64_t kChunkHeaderSize = 3 * sizeof(uint32_t);
+
+uint32_t ReadLittleEndian32(const char* data) {
+  uint32_t value;
+  google::protobuf::io::CodedInputStream::ReadLittleEndian32FromArray(
+      reinterpret_cast<const uint8_t*>(data), &value);
+  return value;
+}
+
+uint64_t ReadLittleEndian64(const char* data) {
+  uint64_t value;
+  google::protobuf::io::CodedInputStream::ReadLittleEndian64FromArray(
+      reinterpret_cast<const uint8_t*>(data), &value);
+  return value;
+}
+
+}  // namespace
+
+ErrorMessageOr<std::unique_ptr<MappedCaptureFile>> MappedCaptureFile::Open(
+    const std::filesystem::path& file_name) {
+  SCOPED_TIMED_LOG("Mapping capture \"%s\"", file_name.string());
+  OUTCOME_TRY(file, orbit_base::MappedFile::Open(file_name));
+  std::unique_ptr<MappedCaptureFile> capture_file{new MappedCaptureFile(std::move(file))};
+  auto result = capture_file->ReadHeaderAndIndex();
+  if (result.has_error()) {
+    return ErrorMessage(absl::StrFormat("Unable to open capture \"%s\": %s", file_name.string(),
+                                        result.error().message()));
+  }
+  return capture_file;
+}
+
+ErrorMessageOr<void> MappedCaptureFile::ReadHeaderAndIndex() {
+  const char* data = file_->data();
+  const uint64_t size = file_->size();
+
+  if (size < sizeof(uint32_t)) {
+    return ErrorMessage("The file is not a capture.");
+  }
+  const uint64_t header_size = ReadLittleEndian32(data);
+  const uint64_t chunks_begin = sizeof(uint32_t) + header_size;
+  CaptureHeader header;
+  if (chunks_begin > size ||
+      header_size > static_cast<uint64_t>(std::numeric_limits<int>::max()) ||
+      !header.ParseFromArray(data + sizeof(uint32_t), static_cast<int>(header_size))) {
+    return ErrorMessage("The file is not a capture.");
+  }
+  if (header.version() != capture_deserializer::internal::kRequiredCaptureVersion) {
+    return ErrorMessage(
+        absl::StrFormat("The capture has version %s instead of %s.", header.version(),
+                        capture_deserializer::internal::kRequiredCaptureVersion));
+  }
+
+  if (size - chunks_begin < sizeof(uint64_t)) {
+    return ErrorMessage("The capture has no index.");
+  }
+  const uint64_t chunks_end = size - sizeof(uint64_t);
+  const uint64_t index_offset = ReadLittleEndian64(data + chunks_end);
+  if (index_offset < chunks_begin) {
+    return ErrorMessage("The capture has no index.");
+  }
+  OUTCOME_TRY(index_payload,
+              GetChunkPayloadAt(index_offset, orbit_client_protos::kIndexChunk, chunks_end));
+  if (GetUncompressedSizeAt(index_offset) != 0 ||
+      !index_.ParseFromArray(index_payload.data(), static_cast<int>(index_payload.size()))) {
+    return ErrorMessage("The index of the capture is corrupted.");
+  }
+
+  if (index_.chunks_size() == 0 ||
+      index_.chunks(0).type() != orbit_client_protos::kCaptureInfoChunk) {
+    return ErrorMessage("The capture has no metadata.");
+  }
+  for (int i = 0; i < index_.chunks_size(); ++i) {
+    const CaptureChunkIndex::Entry& entry = index_.chunks(i);
+    if (entry.offset() < chunks_begin) {
+      return ErrorMessage("The index of the capture is corrupted.");
+    }
+    OUTCOME_TRY(payload, GetChunkPayloadAt(entry.offset(), entry.type(), index_offset));
+    if (payload.size() != entry.size() ||
+        GetUncompressedSizeAt(entry.offset()) != entry.uncompressed_size()) {
+      return ErrorMessage("The index of the capture is corrupted.");
+    }
+
+    if (i == 0) {
+      OUTCOME_TRY(ParseMetadata(entry, payload));
+    }
+  }
+  return outcome::success();
+}
+
+ErrorMessageOr<void> MappedCaptureFile::ParseMetadata(const CaptureChunkIndex::Entry& entry,
+                                                      absl::Span<const char> payload) {
+  std::unique_ptr<char[]> buffer;
+  if (entry.uncompressed_size() != 0) {
+    if (entry.uncompressed_size() > static_cast<uint64_t>(std::numeric_limits<int>::max())) {
+      return ErrorMessage("The metadata of the capture is corrupted.");
+    }
+    buffer = make_unique_for_overwrite<char[]>(entry.uncompressed_size());
+    absl::Span<char> decompressed_payload = absl::MakeSpan(buffer.get(), entry.uncompressed_size());
+    if (!capture_compression::Decompress(payload, decompressed_payload)) {
+      return ErrorMessage("The metadata of the capture is corrupted.");
+    }
+    payload = decompressed_payload;
+  }
+  if (!capture_info_.ParseFromArray(payload.data(), static_cast<int>(payload.size()))) {
+    return ErrorMessage("The metadata of the capture is corrupted.");
+  }
+  return outcome::success();
+}
+
+ErrorMessageOr<absl::Span<const char>> MappedCaptureFile::GetChunkPayloadAt(
+    uint64_t offset, CaptureChunkType expected_type, uint64_t chunks_end) const {
+  if (offset > chunks_end || chunks_end - offset < kChunkHeaderSize) {
+    return ErrorMessage("A chunk of the capture is truncated.");
+  }
+  const char* chunk = file_->data() + offset;
+  const uint32_t type = ReadLittleEndian32(chunk);
+  const uint64_t payload_size = ReadLittleEndian32(chunk + sizeof(uint32_t));
+  if (type != static_cast<uint32_t>(expected_type)) {
+    return ErrorMessage("A chunk of the capture doesn't match the index.");
+  }
+  if (chunks_end - offset - kChunkHeaderSize < payload_size ||
+      payload_size > static_cast<uint64_t>(std::numeric_limits<int>::max())) {
+    return ErrorMessage("A chunk of the capture is truncated.");
+  }
+  return absl::MakeConstSpan(chunk + kChunkHeaderSize, payload_size);
+}
+
+uint64_t MappedCaptureFile::GetUncompressedSizeAt(uint64_t offset) const {
+  return ReadLittleEndian32(file_->data() + offset + 2 * sizeof(uint32_t));
+}
+
+absl::Span<const char> MappedCaptureFile::GetChunkPayload(
+    const CaptureChunkIndex::Entry& entry) const {
+  return absl::MakeConstSpan(file_->data() + entry.offset() + kChunkHeaderSize, entry.size());
+}
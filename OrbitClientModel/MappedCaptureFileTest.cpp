@@ -0,0 +1,171 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "OrbitClientData/Callstack.h"
+#include "OrbitClientData/ModuleManager.h"
+#include "OrbitClientData/ProcessData.h"
+#include "OrbitClientData/UserDefinedCaptureData.h"
+#include "OrbitClientModel/CaptureChunkCompression.h"
+#include "OrbitClientModel/CaptureColumns.h"
+#include "OrbitClientModel/CaptureData.h"
+#include "OrbitClientModel/CaptureDeserializer.h"
+#include "OrbitClientModel/CaptureSerializer.h"
+#include "OrbitClientModel/MappedCaptureFile.h"
+#include "capture_data.pb.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
+#include "process.pb.h"
+
+using orbit_client_data::ModuleManager;
+using orbit_client_protos::CallstackEvent;
+using orbit_client_protos::CaptureChunkIndex;
+using orbit_client_protos::CaptureHeader;
+using orbit_client_protos::TimerInfo;
+
+namespace {
+
+constexpr uint64_t kTimerCount = 2 * capture_serializer::internal::kTimersPerChunk + 10;
+constexpr uint64_t kCallstackEventCount = 1000;
+
+// Timer i is [10 * i, 10 * i + 5], callstack event i is at 3 * i.
+std::string CreateCapture(bool compress_chunks = false) {
+  orbit_grpc_protos::ProcessInfo process_info;
+  process_info.set_pid(42);
+  ModuleManager module_manager;
+  CaptureData capture_data{ProcessData{process_info}, &module_manager, {}, {},
+                           UserDefinedCaptureData{}};
+  CallStack callstack(std::vector<uint64_t>{0x100});
+  capture_data.AddUniqueCallStack(callstack);
+  for (uint64_t i = 0; i < kCallstackEventCount; ++i) {
+    CallstackEvent callstack_event;
+    callstack_event.set_time(3 * i);
+    callstack_event.set_thread_id(43);
+    callstack_event.set_callstack_hash(callstack.GetHash());
+    capture_data.AddCallstackEvent(callstack_event);
+  }
+
+  std::vector<TimerInfo> timers(kTimerCount);
+  for (uint64_t i = 0; i < kTimerCount; ++i) {
+    timers[i].set_start(10 * i);
+    timers[i].set_end(10 * i + 5);
+    timers[i].set_function_address(i);
+  }
+
+  std::ostringstream stream;
+  capture_serializer::internal::Save(stream, capture_data, {},
+                                     capture_serializer::CreateTimersSections(timers),
+                                     /*thread_pool=*/nullptr, compress_chunks);
+  return stream.str();
+}
+
+// Replaces the version in the header of capture. The chunks move, so the index doesn't match them
+// anymore.
+std::string SetVersion(const std::string& capture, const std::string& version) {
+  uint32_t header_size;
+  google::protobuf::io::CodedInputStream::ReadLittleEndian32FromArray(
+      reinterpret_cast<const uint8_t*>(capture.data()), &header_size);
+  CaptureHeader header;
+  header.set_version(version);
+  std::string new_capture;
+  {
+    google::protobuf::io::StringOutputStream output_stream(&new_capture);
+    google::protobuf::io::CodedOutputStream coded_output(&output_stream);
+    capture_serializer::WriteMessage(&header, &coded_output);
+  }
+  return new_capture + capture.substr(sizeof(uint32_t) + header_size);
+}
+
+class MappedCaptureFileTest : public testing::Test {
+ protected:
+  void WriteFile(const std::string& content) {
+    std::ofstream file(file_name_, std::ios::binary);
+    file << content;
+  }
+
+  void TearDown() override { std::filesystem::remove(file_name_); }
+
+  const std::filesystem::path file_name_ =
+      std::filesystem::temp_directory_path() / "MappedCaptureFileTest.orbit";
+};
+
+}  // namespace
+
+TEST_F(MappedCaptureFileTest, ReadsMetadataAndIndex) {
+  WriteFile(CreateCapture());
+  auto capture_file_or_error = MappedCaptureFile::Open(file_name_);
+  ASSERT_TRUE(capture_file_or_error.has_value()) << capture_file_or_error.error().message();
+  const MappedCaptureFile& capture_file = *capture_file_or_error.value();
+
+  EXPECT_EQ(capture_file.capture_info().process().pid(), 42);
+
+  std::vector<const CaptureChunkIndex::Entry*> timer_entries;
+  uint64_t callstack_event_count = 0;
+  for (const CaptureChunkIndex::Entry& entry : capture_file.index().chunks()) {
+    if (entry.type() == orbit_client_protos::kTimersChunk) {
+      timer_entries.push_back(&entry);
+    } else if (entry.type() == orbit_client_protos::kCallstackEventsChunk) {
+      auto columns = capture_columns::CallstackEventColumns::Create(
+          capture_file.GetChunkPayload(entry));
+      ASSERT_TRUE(columns.has_value()) << columns.error().message();
+      callstack_event_count += columns.value().size();
+    }
+  }
+  EXPECT_EQ(callstack_event_count, kCallstackEventCount);
+
+  // The timers are in three chunks, the last one is the remainder.
+  ASSERT_EQ(timer_entries.size(), 3);
+  EXPECT_EQ(timer_entries.back()->min_timestamp_ns(), 10 * (kTimerCount - 10));
+  EXPECT_EQ(timer_entries.back()->max_timestamp_ns(), 10 * (kTimerCount - 1) + 5);
+  EXPECT_EQ(timer_entries.back()->uncompressed_size(), 0);
+  auto columns =
+      capture_columns::TimerColumns::Create(capture_file.GetChunkPayload(*timer_entries.back()));
+  ASSERT_TRUE(columns.has_value()) << columns.error().message();
+  ASSERT_EQ(columns.value().size(), 10);
+  EXPECT_EQ(columns.value().start(0), 10 * (kTimerCount - 10));
+}
+
+TEST_F(MappedCaptureFileTest, GetsPayloadsOfCompressedChunks) {
+  WriteFile(CreateCapture(/*compress_chunks=*/true));
+  auto capture_file_or_error = MappedCaptureFile::Open(file_name_);
+  ASSERT_TRUE(capture_file_or_error.has_value()) << capture_file_or_error.error().message();
+  const MappedCaptureFile& capture_file = *capture_file_or_error.value();
+
+  uint64_t timer_count = 0;
+  for (const CaptureChunkIndex::Entry& entry : capture_file.index().chunks()) {
+    if (entry.type() != orbit_client_protos::kTimersChunk) continue;
+    ASSERT_NE(entry.uncompressed_size(), 0);
+    std::string payload(entry.uncompressed_size(), '\0');
+    ASSERT_TRUE(capture_compression::Decompress(capture_file.GetChunkPayload(entry),
+                                                absl::MakeSpan(payload)));
+    auto columns = capture_columns::TimerColumns::Create(payload);
+    ASSERT_TRUE(columns.has_value()) << columns.error().message();
+    EXPECT_EQ(columns.value().start(0), entry.min_timestamp_ns());
+    timer_count += columns.value().size();
+  }
+  EXPECT_EQ(timer_count, kTimerCount);
+}
+
+TEST_F(MappedCaptureFileTest, OpenFailsOnTruncatedCapture) {
+  std::string capture = CreateCapture();
+  capture.resize(capture.size() / 2);
+  WriteFile(capture);
+  EXPECT_FALSE(MappedCaptureFile::Open(file_name_).has_value());
+}
+
+TEST_F(MappedCaptureFileTest, OpenFailsOnOtherVersion) {
+  WriteFile(SetVersion(CreateCapture(), "1.0"));
+  auto capture_file_or_error = MappedCaptureFile::Open(file_name_);
+  ASSERT_FALSE(capture_file_or_error.has_value());
+  EXPECT_THAT(capture_file_or_error.error().message(), testing::HasSubstr("version 1.0"));
+}
@@ -4,20 +4,26 @@
 
 #include "OrbitClientModel/SamplingDataPostProcessor.h"
 
+#include <algorithm>
 #include <cstdint>
+#include <functional>
 #include <memory>
 #include <set>
+#include <utility>
 #include <vector>
 
 #include "OrbitBase/Logging.h"
 #include "OrbitBase/ThreadConstants.h"
+#include "OrbitBase/Tracing.h"
 #include "OrbitClientData/Callstack.h"
 #include "OrbitClientData/CallstackTypes.h"
+#include "OrbitClientData/FunctionUtils.h"
+#include "OrbitClientData/ThreadCallstackEvents.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
+#include "absl/types/span.h"
 #include "capture_data.pb.h"
 
-using orbit_client_protos::CallstackEvent;
 using orbit_client_protos::FunctionInfo;
 using orbit_client_protos::LinuxAddressInfo;
 
@@ -25,225 +31,433 @@ namespace orbit_client_model {
 
 namespace {
 
-class SamplingDataPostProcessor {
- public:
-  explicit SamplingDataPostProcessor() = default;
-  SamplingDataPostProcessor& operator=(const SamplingDataPostProcessor& other) = default;
-  SamplingDataPostProcessor(const SamplingDataPostProcessor& other) = default;
-
-  SamplingDataPostProcessor(SamplingDataPostProcessor&& other) = default;
-  SamplingDataPostProcessor& operator=(SamplingDataPostProcessor&& other) = default;
-
-  PostProcessedSamplingData ProcessSamples(const CallstackData& callstack_data,
-                                           const CaptureData& capture_data, bool generate_summary);
-
- private:
-  void SortByThreadUsage();
+// function is the function of absolute_address found by CaptureData::FindFunctionsByAddresses.
+uint64_t MapAddressToFunctionAddress(uint64_t absolute_address, const FunctionInfo* function,
+                                     const CaptureData& capture_data) {
+  const LinuxAddressInfo* address_info = capture_data.GetAddressInfo(absolute_address);
 
-  void ResolveCallstacks(const CallstackData& callstack_data, const CaptureData& capture_data);
+  // Find the start address of the function this address falls inside.
+  // Use the Function returned by Process::GetFunctionFromAddress, and
+  // when this fails (e.g., the module containing the function has not
+  // been loaded) use (for now) the LinuxAddressInfo that is collected
+  // for every address in a callstack. SamplingProfiler relies heavily
+  // on the association between address and function address held by
+  // exact_address_to_function_address_, otherwise each address is
+  // considered a different function.
+  if (function != nullptr) {
+    return capture_data.GetAbsoluteAddress(*function);
+  }
+  if (address_info != nullptr) {
+    return absolute_address - address_info->offset_in_function();
+  }
+  return absolute_address;
+}
 
-  void MapAddressToFunctionAddress(uint64_t absolute_address, const CaptureData& capture_data);
+SampledFunction CreateSampledFunction(uint64_t absolute_address, const FunctionInfo* function_info,
+                                      const CaptureData& capture_data) {
+  SampledFunction function;
+  function.name = function_info != nullptr
+                      ? function_utils::GetDisplayName(*function_info)
+                      : capture_data.GetFunctionNameByAddress(absolute_address);
+  function.absolute_address = absolute_address;
+  function.module_path = capture_data.GetModulePathByAddress(absolute_address);
+
+  if (function_info != nullptr) {
+    function.line = function_info->line();
+    function.file = function_info->file();
+  }
+  return function;
+}
 
-  void FillThreadSampleDataSampleReports(const CaptureData& capture_data);
+}  // namespace
 
-  // Filled by ProcessSamples.
-  absl::flat_hash_map<ThreadID, ThreadSampleData> thread_id_to_sample_data_;
-  absl::flat_hash_map<CallstackID, std::shared_ptr<CallStack>> unique_resolved_callstacks_;
-  absl::flat_hash_map<CallstackID, CallstackID> original_to_resolved_callstack_;
-  absl::flat_hash_map<uint64_t, std::set<CallstackID>> function_address_to_callstack_;
-  absl::flat_hash_map<uint64_t, uint64_t> exact_address_to_function_address_;
-  absl::flat_hash_map<uint64_t, absl::flat_hash_set<uint64_t>> function_address_to_exact_addresses_;
-  std::vector<ThreadSampleData> sorted_thread_sample_data_;
+// The new events of one thread, copied out of the CallstackData. Each shard is counted by a single
+// task, into its own map.
+struct IncrementalSamplingDataPostProcessor::ThreadShard {
+  ThreadID thread_id = 0;
+  std::vector<CallstackID> new_callstack_ids;
+  ThreadSampleData* thread_sample_data = nullptr;
+  absl::flat_hash_map<CallstackID, uint32_t> new_callstack_counts;
 };
 
-}  // namespace
-
 PostProcessedSamplingData CreatePostProcessedSamplingData(const CallstackData& callstack_data,
                                                           const CaptureData& capture_data,
-                                                          bool generate_summary) {
-  SamplingDataPostProcessor profiler;
-  return profiler.ProcessSamples(callstack_data, capture_data, generate_summary);
+                                                          bool generate_summary,
+                                                          ThreadPool* thread_pool) {
+  return IncrementalSamplingDataPostProcessor{generate_summary, thread_pool}.Update(callstack_data,
+                                                                                   capture_data);
 }
 
-namespace {
-PostProcessedSamplingData SamplingDataPostProcessor::ProcessSamples(
-    const CallstackData& callstack_data, const CaptureData& capture_data, bool generate_summary) {
-  // Unique call stacks and per thread data
-  callstack_data.ForEachCallstackEvent(
-      [this, &callstack_data, generate_summary](const CallstackEvent& event) {
-        CHECK(callstack_data.HasCallStack(event.callstack_hash()));
-
-        ThreadSampleData* thread_sample_data = &thread_id_to_sample_data_[event.thread_id()];
-        thread_sample_data->samples_count++;
-        thread_sample_data->callstack_count[event.callstack_hash()]++;
-        callstack_data.ForEachFrameInCallstack(event.callstack_hash(),
-                                               [&thread_sample_data](uint64_t address) {
-                                                 thread_sample_data->raw_address_count[address]++;
-                                               });
-
-        if (generate_summary) {
-          ThreadSampleData* all_thread_sample_data =
-              &thread_id_to_sample_data_[orbit_base::kAllProcessThreadsTid];
-          all_thread_sample_data->samples_count++;
-          all_thread_sample_data->callstack_count[event.callstack_hash()]++;
-          callstack_data.ForEachFrameInCallstack(
-              event.callstack_hash(), [&all_thread_sample_data](uint64_t address) {
-                all_thread_sample_data->raw_address_count[address]++;
-              });
-        }
-      });
-
-  ResolveCallstacks(callstack_data, capture_data);
-
-  for (auto& sample_data_it : thread_id_to_sample_data_) {
-    ThreadSampleData* thread_sample_data = &sample_data_it.second;
+std::shared_ptr<const PostProcessedSamplingData> IncrementalSamplingDataPostProcessor::Update(
+    const CallstackData& callstack_data, const CaptureData& capture_data) & {
+  ProcessNewEvents(callstack_data, capture_data);
+  return data_;
+}
 
-    // Address count per sample per thread
-    for (const auto& callstack_count_it : thread_sample_data->callstack_count) {
-      const CallstackID callstack_id = callstack_count_it.first;
-      const uint32_t callstack_count = callstack_count_it.second;
+PostProcessedSamplingData IncrementalSamplingDataPostProcessor::Update(
+    const CallstackData& callstack_data, const CaptureData& capture_data) && {
+  ProcessNewEvents(callstack_data, capture_data);
+  return std::move(*data_);
+}
 
-      CallstackID resolved_callstack_id = original_to_resolved_callstack_[callstack_id];
-      std::shared_ptr<CallStack>& resolved_callstack =
-          unique_resolved_callstacks_[resolved_callstack_id];
+void IncrementalSamplingDataPostProcessor::Reset() {
+  thread_id_to_progress_.clear();
+  original_to_resolved_callstack_info_.clear();
+  function_address_to_sampled_function_.clear();
+  exact_address_to_function_address_.clear();
+  // The previous data might still be in use.
+  data_ = std::make_shared<PostProcessedSamplingData>();
+  unique_callstacks_ =
+      std::make_shared<absl::flat_hash_map<CallstackID, std::shared_ptr<CallStack>>>();
+}
 
-      // exclusive stat
-      thread_sample_data->exclusive_count[resolved_callstack->GetFrame(0)] += callstack_count;
+void IncrementalSamplingDataPostProcessor::ProcessNewEvents(const CallstackData& callstack_data,
+                                                            const CaptureData& capture_data) {
+  ORBIT_SCOPE_FUNCTION;
+  // Only the copy of the new events holds the lock of the CallstackData, so that the capture can
+  // keep adding events while they are processed.
+  std::vector<ThreadShard> shards;
+  callstack_data.VisitCallstackEventsAndUniqueCallstacks(
+      [this, &shards](const auto& callstack_events_by_tid, const auto& /*unique_callstacks*/) {
+        if (!TrySnapshotNewEvents(callstack_events_by_tid, &shards)) {
+          Reset();
+          CHECK(TrySnapshotNewEvents(callstack_events_by_tid, &shards));
+        }
+      });
+  if (shards.empty()) {
+    return;
+  }
 
-      std::set<uint64_t> unique_addresses;
-      for (uint64_t address : resolved_callstack->GetFrames()) {
-        unique_addresses.insert(address);
-      }
+  // Create all the ThreadSampleData before the tasks get pointers to them.
+  for (ThreadShard& shard : shards) {
+    data_->thread_id_to_sample_data_[shard.thread_id].thread_id = shard.thread_id;
+  }
+  if (generate_summary_) {
+    data_->thread_id_to_sample_data_[orbit_base::kAllProcessThreadsTid].thread_id =
+        orbit_base::kAllProcessThreadsTid;
+  }
+  for (ThreadShard& shard : shards) {
+    shard.thread_sample_data = &data_->thread_id_to_sample_data_.at(shard.thread_id);
+  }
+  // Start with the largest shards, so that they don't end up running alone at the end. Only the
+  // shards the workers pick up first need to be in order.
+  const size_t first_shards_count =
+      std::min(shards.size(), thread_pool_ != nullptr ? thread_pool_->GetPoolSize() : 0);
+  std::partial_sort(shards.begin(), shards.begin() + first_shards_count, shards.end(),
+                    [](const ThreadShard& a, const ThreadShard& b) {
+                      return a.new_callstack_ids.size() > b.new_callstack_ids.size();
+                    });
+
+  RunTasksInParallel(thread_pool_, shards.size(), [&shards](size_t shard_index) {
+    ORBIT_SCOPE("Count callstacks of thread");
+    ThreadShard& shard = shards[shard_index];
+    for (CallstackID callstack_id : shard.new_callstack_ids) {
+      shard.new_callstack_counts[callstack_id]++;
+    }
+  });
 
-      for (uint64_t address : unique_addresses) {
-        thread_sample_data->address_count[address] += callstack_count;
+  std::vector<CallstackID> new_callstack_ids;
+  absl::flat_hash_set<CallstackID> visited_new_callstack_ids;
+  for (const ThreadShard& shard : shards) {
+    for (const auto& [callstack_id, unused_count] : shard.new_callstack_counts) {
+      if (!original_to_resolved_callstack_info_.contains(callstack_id) &&
+          visited_new_callstack_ids.insert(callstack_id).second) {
+        new_callstack_ids.push_back(callstack_id);
       }
     }
-
-    // sort thread addresses by count
-    for (const auto& address_count_it : thread_sample_data->address_count) {
-      const uint64_t address = address_count_it.first;
-      const uint32_t count = address_count_it.second;
-      thread_sample_data->address_count_sorted.insert(std::make_pair(count, address));
+  }
+  // Unique callstacks are never removed from the CallstackData, so the ones of the events copied
+  // above are still there.
+  callstack_data.VisitCallstackEventsAndUniqueCallstacks(
+      [this, &new_callstack_ids](const auto& /*callstack_events_by_tid*/,
+                                 const auto& unique_callstacks) {
+        for (CallstackID callstack_id : new_callstack_ids) {
+          unique_callstacks_->emplace(callstack_id, unique_callstacks.at(callstack_id));
+        }
+      });
+  ResolveCallstacks(new_callstack_ids, capture_data);
+
+  absl::flat_hash_map<CallstackID, uint32_t> summary_new_callstack_counts;
+  uint32_t summary_new_samples_count = 0;
+  if (generate_summary_) {
+    for (const ThreadShard& shard : shards) {
+      summary_new_samples_count += shard.new_callstack_ids.size();
+      for (const auto& [callstack_id, count] : shard.new_callstack_counts) {
+        summary_new_callstack_counts[callstack_id] += count;
+      }
     }
   }
 
-  FillThreadSampleDataSampleReports(capture_data);
-
-  SortByThreadUsage();
+  // Each task updates the counts and the report of one thread. The summary, the largest, goes
+  // first.
+  const size_t summary_task_count = generate_summary_ ? 1 : 0;
+  RunTasksInParallel(thread_pool_, summary_task_count + shards.size(), [&](size_t task_index) {
+    ORBIT_SCOPE("Update thread sample data");
+    if (task_index < summary_task_count) {
+      ThreadSampleData* summary =
+          &data_->thread_id_to_sample_data_.at(orbit_base::kAllProcessThreadsTid);
+      AddCallstackCounts(summary_new_callstack_counts, summary_new_samples_count, summary);
+      FillThreadSampleDataSampleReport(summary);
+      return;
+    }
+    ThreadShard& shard = shards[task_index - summary_task_count];
+    AddCallstackCounts(shard.new_callstack_counts, shard.new_callstack_ids.size(),
+                       shard.thread_sample_data);
+    FillThreadSampleDataSampleReport(shard.thread_sample_data);
+  });
 
-  return PostProcessedSamplingData(
-      std::move(thread_id_to_sample_data_), std::move(unique_resolved_callstacks_),
-      std::move(original_to_resolved_callstack_), std::move(function_address_to_callstack_),
-      std::move(function_address_to_exact_addresses_), std::move(sorted_thread_sample_data_));
+  std::vector<ThreadID> updated_thread_ids;
+  for (const ThreadShard& shard : shards) {
+    updated_thread_ids.push_back(shard.thread_id);
+  }
+  if (generate_summary_) {
+    updated_thread_ids.push_back(orbit_base::kAllProcessThreadsTid);
+  }
+  UpdateSortedThreadSampleData(updated_thread_ids);
 }
 
-void SamplingDataPostProcessor::SortByThreadUsage() {
-  sorted_thread_sample_data_.reserve(thread_id_to_sample_data_.size());
-
-  for (auto& pair : thread_id_to_sample_data_) {
-    ThreadSampleData& data = pair.second;
-    data.thread_id = pair.first;
-    sorted_thread_sample_data_.push_back(data);
+bool IncrementalSamplingDataPostProcessor::TrySnapshotNewEvents(
+    const absl::flat_hash_map<int32_t, ThreadCallstackEvents>& callstack_events_by_tid,
+    std::vector<ThreadShard>* shards) {
+  // Events are sorted by time, so the events added since the last update are the ones after the
+  // last processed event, unless some were inserted before it, replaced or removed. Check all the
+  // threads before changing anything.
+  absl::flat_hash_map<ThreadID, size_t> thread_id_to_new_events_begin;
+  size_t visited_threads_with_progress_count = 0;
+  for (const auto& [thread_id, events] : callstack_events_by_tid) {
+    size_t new_events_begin = 0;
+    auto progress_it = thread_id_to_progress_.find(thread_id);
+    if (progress_it != thread_id_to_progress_.end()) {
+      ++visited_threads_with_progress_count;
+      const ThreadProgress& progress = progress_it->second;
+      if (events.GetRewriteCount() != progress.rewrite_count) {
+        return false;
+      }
+      new_events_begin = events.UpperBound(progress.last_event_time);
+    }
+    if (new_events_begin < events.size()) {
+      thread_id_to_new_events_begin.emplace(thread_id, new_events_begin);
+    }
+  }
+  // A thread that was processed before but has no events anymore also means that events were
+  // removed.
+  if (visited_threads_with_progress_count != thread_id_to_progress_.size()) {
+    return false;
   }
 
-  sort(sorted_thread_sample_data_.begin(), sorted_thread_sample_data_.end(),
-       [](const ThreadSampleData& a, const ThreadSampleData& b) {
-         return a.samples_count > b.samples_count;
-       });
+  shards->reserve(thread_id_to_new_events_begin.size());
+  for (const auto& [thread_id, new_events_begin] : thread_id_to_new_events_begin) {
+    const ThreadCallstackEvents& events = callstack_events_by_tid.at(thread_id);
+    ThreadShard& shard = shards->emplace_back();
+    shard.thread_id = thread_id;
+    shard.new_callstack_ids.reserve(events.size() - new_events_begin);
+    events.ForEachSpan(new_events_begin, events.size(),
+                       [&shard](absl::Span<const uint64_t> /*times*/,
+                                absl::Span<const CallstackID> callstack_ids) {
+                         shard.new_callstack_ids.insert(shard.new_callstack_ids.end(),
+                                                        callstack_ids.begin(), callstack_ids.end());
+                       });
+
+    ThreadProgress& progress = thread_id_to_progress_[thread_id];
+    progress.last_event_time = events.GetTime(events.size() - 1);
+    progress.rewrite_count = events.GetRewriteCount();
+  }
+  return true;
 }
 
-void SamplingDataPostProcessor::ResolveCallstacks(const CallstackData& callstack_data,
-                                                  const CaptureData& capture_data) {
-  callstack_data.ForEachUniqueCallstack([this, &capture_data](const CallStack& call_stack) {
-    // A "resolved callstack" is a callstack where every address is replaced
-    // by the start address of the function (if known).
-    std::vector<uint64_t> resolved_callstack_data;
-
-    for (uint64_t address : call_stack.GetFrames()) {
-      if (exact_address_to_function_address_.find(address) ==
-          exact_address_to_function_address_.end()) {
-        MapAddressToFunctionAddress(address, capture_data);
+void IncrementalSamplingDataPostProcessor::ResolveCallstacks(
+    const std::vector<CallstackID>& callstack_ids, const CaptureData& capture_data) {
+  ORBIT_SCOPE_FUNCTION;
+  // A "resolved callstack" is a callstack where every address is replaced
+  // by the start address of the function (if known).
+  // Chunks of callstacks are resolved in parallel. Each chunk keeps the addresses it maps to
+  // functions for itself, and only reads the ones mapped by the previous updates.
+  struct ResolvedChunk {
+    std::vector<std::vector<uint64_t>> resolved_frames;
+    absl::flat_hash_map<uint64_t, uint64_t> exact_address_to_function_address;
+  };
+  constexpr size_t kCallstacksPerChunk = 1024;
+  const size_t chunk_count = (callstack_ids.size() + kCallstacksPerChunk - 1) / kCallstacksPerChunk;
+  std::vector<ResolvedChunk> chunks(chunk_count);
+
+  RunTasksInParallel(thread_pool_, chunk_count, [&](size_t chunk_index) {
+    ResolvedChunk& chunk = chunks[chunk_index];
+    const size_t begin = chunk_index * kCallstacksPerChunk;
+    const size_t end = std::min(begin + kCallstacksPerChunk, callstack_ids.size());
+    std::vector<const CallStack*> callstacks;
+    callstacks.reserve(end - begin);
+    for (size_t i = begin; i < end; ++i) {
+      auto callstack_it = unique_callstacks_->find(callstack_ids[i]);
+      CHECK(callstack_it != unique_callstacks_->end());
+      callstacks.push_back(callstack_it->second.get());
+    }
+
+    // The addresses no update mapped yet are resolved in one batch, sorted so that the addresses of
+    // the same module are consecutive.
+    std::vector<uint64_t> new_addresses;
+    for (const CallStack* callstack : callstacks) {
+      for (uint64_t address : callstack->GetFrames()) {
+        if (!exact_address_to_function_address_.contains(address) &&
+            chunk.exact_address_to_function_address.try_emplace(address).second) {
+          new_addresses.push_back(address);
+        }
+      }
+    }
+    std::sort(new_addresses.begin(), new_addresses.end());
+    const std::vector<const FunctionInfo*> functions =
+        capture_data.FindFunctionsByAddresses(new_addresses, false);
+    for (size_t i = 0; i < new_addresses.size(); ++i) {
+      chunk.exact_address_to_function_address[new_addresses[i]] =
+          MapAddressToFunctionAddress(new_addresses[i], functions[i], capture_data);
+    }
+
+    chunk.resolved_frames.reserve(callstacks.size());
+    for (const CallStack* callstack : callstacks) {
+      std::vector<uint64_t>& resolved_frames = chunk.resolved_frames.emplace_back();
+      for (uint64_t address : callstack->GetFrames()) {
+        auto known_it = exact_address_to_function_address_.find(address);
+        resolved_frames.push_back(known_it != exact_address_to_function_address_.end()
+                                      ? known_it->second
+                                      : chunk.exact_address_to_function_address.at(address));
       }
-      uint64_t function_address = exact_address_to_function_address_.at(address);
+    }
+  });
 
-      resolved_callstack_data.push_back(function_address);
-      function_address_to_callstack_[function_address].insert(call_stack.GetHash());
+  std::vector<uint64_t> new_function_addresses;
+  for (size_t chunk_index = 0; chunk_index < chunk_count; ++chunk_index) {
+    ResolvedChunk& chunk = chunks[chunk_index];
+    for (const auto& [exact_address, function_address] : chunk.exact_address_to_function_address) {
+      if (exact_address_to_function_address_.try_emplace(exact_address, function_address).second) {
+        data_->function_address_to_exact_addresses_[function_address].insert(exact_address);
+      }
     }
 
-    CallStack resolved_callstack(std::move(resolved_callstack_data));
+    for (size_t i = 0; i < chunk.resolved_frames.size(); ++i) {
+      const CallstackID callstack_id = callstack_ids[chunk_index * kCallstacksPerChunk + i];
+      std::vector<uint64_t>& resolved_frames = chunk.resolved_frames[i];
+
+      ResolvedCallstack resolved_callstack;
+      for (uint64_t function_address : resolved_frames) {
+        data_->function_address_to_callstack_[function_address].insert(callstack_id);
+      }
+      std::set<uint64_t> unique_addresses(resolved_frames.begin(), resolved_frames.end());
+      resolved_callstack.unique_function_addresses.assign(unique_addresses.begin(),
+                                                          unique_addresses.end());
+      for (uint64_t function_address : resolved_callstack.unique_function_addresses) {
+        if (function_address_to_sampled_function_.try_emplace(function_address).second) {
+          new_function_addresses.push_back(function_address);
+        }
+      }
+
+      CallStack resolved_call_stack(std::move(resolved_frames));
+      resolved_callstack.innermost_function_address = resolved_call_stack.GetFrame(0);
+      resolved_callstack.resolved_callstack_id = resolved_call_stack.GetHash();
+      if (data_->unique_resolved_callstacks_.find(resolved_callstack.resolved_callstack_id) ==
+          data_->unique_resolved_callstacks_.end()) {
+        data_->unique_resolved_callstacks_[resolved_callstack.resolved_callstack_id] =
+            std::make_shared<CallStack>(std::move(resolved_call_stack));
+      }
 
-    CallstackID resolved_callstack_id = resolved_callstack.GetHash();
-    if (unique_resolved_callstacks_.find(resolved_callstack_id) ==
-        unique_resolved_callstacks_.end()) {
-      unique_resolved_callstacks_[resolved_callstack_id] =
-          std::make_shared<CallStack>(resolved_callstack);
+      data_->original_to_resolved_callstack_[callstack_id] =
+          resolved_callstack.resolved_callstack_id;
+      original_to_resolved_callstack_info_.emplace(callstack_id, std::move(resolved_callstack));
     }
+  }
 
-    original_to_resolved_callstack_[call_stack.GetHash()] = resolved_callstack_id;
+  // The names, modules and lines of the functions for the reports are only looked up once. The
+  // entries were inserted above, so the tasks only write to their values. Sorted like the addresses
+  // of the chunks above, so that the functions of the same module are consecutive.
+  std::sort(new_function_addresses.begin(), new_function_addresses.end());
+  std::vector<SampledFunction*> new_sampled_functions;
+  new_sampled_functions.reserve(new_function_addresses.size());
+  for (uint64_t function_address : new_function_addresses) {
+    new_sampled_functions.push_back(&function_address_to_sampled_function_.at(function_address));
+  }
+  const size_t function_chunk_count =
+      (new_function_addresses.size() + kCallstacksPerChunk - 1) / kCallstacksPerChunk;
+  RunTasksInParallel(thread_pool_, function_chunk_count, [&](size_t chunk_index) {
+    const size_t begin = chunk_index * kCallstacksPerChunk;
+    const size_t end = std::min(begin + kCallstacksPerChunk, new_function_addresses.size());
+    const std::vector<const FunctionInfo*> functions = capture_data.FindFunctionsByAddresses(
+        absl::MakeConstSpan(new_function_addresses).subspan(begin, end - begin), false);
+    for (size_t i = begin; i < end; ++i) {
+      *new_sampled_functions[i] =
+          CreateSampledFunction(new_function_addresses[i], functions[i - begin], capture_data);
+    }
   });
 }
 
-void SamplingDataPostProcessor::MapAddressToFunctionAddress(uint64_t absolute_address,
-                                                            const CaptureData& capture_data) {
-  const LinuxAddressInfo* address_info = capture_data.GetAddressInfo(absolute_address);
-  const FunctionInfo* function = capture_data.FindFunctionByAddress(absolute_address, false);
+void IncrementalSamplingDataPostProcessor::AddCallstackCounts(
+    const absl::flat_hash_map<CallstackID, uint32_t>& callstack_counts, uint32_t samples_count,
+    ThreadSampleData* thread_sample_data) const {
+  thread_sample_data->samples_count += samples_count;
+  for (const auto& [callstack_id, count] : callstack_counts) {
+    thread_sample_data->callstack_count[callstack_id] += count;
+    for (uint64_t address : unique_callstacks_->at(callstack_id)->GetFrames()) {
+      thread_sample_data->raw_address_count[address] += count;
+    }
 
-  // Find the start address of the function this address falls inside.
-  // Use the Function returned by Process::GetFunctionFromAddress, and
-  // when this fails (e.g., the module containing the function has not
-  // been loaded) use (for now) the LinuxAddressInfo that is collected
-  // for every address in a callstack. SamplingProfiler relies heavily
-  // on the association between address and function address held by
-  // exact_address_to_function_address_, otherwise each address is
-  // considered a different function.
-  uint64_t absolute_function_address;
-  if (function != nullptr) {
-    absolute_function_address = capture_data.GetAbsoluteAddress(*function);
-  } else if (address_info != nullptr) {
-    absolute_function_address = absolute_address - address_info->offset_in_function();
-  } else {
-    absolute_function_address = absolute_address;
+    const ResolvedCallstack& resolved_callstack =
+        original_to_resolved_callstack_info_.at(callstack_id);
+    // exclusive stat
+    thread_sample_data->exclusive_count[resolved_callstack.innermost_function_address] += count;
+    for (uint64_t address : resolved_callstack.unique_function_addresses) {
+      thread_sample_data->address_count[address] += count;
+    }
+  }
+}
+
+void IncrementalSamplingDataPostProcessor::FillThreadSampleDataSampleReport(
+    ThreadSampleData* thread_sample_data) const {
+  std::vector<SampledFunction>* sampled_functions = &thread_sample_data->sampled_function;
+  sampled_functions->clear();
+  sampled_functions->reserve(thread_sample_data->address_count.size());
+
+  for (const auto& [absolute_address, num_occurences] : thread_sample_data->address_count) {
+    SampledFunction& function =
+        sampled_functions->emplace_back(function_address_to_sampled_function_.at(absolute_address));
+    function.inclusive = 100.f * num_occurences / thread_sample_data->samples_count;
+    function.exclusive = 0.f;
+    auto it = thread_sample_data->exclusive_count.find(absolute_address);
+    if (it != thread_sample_data->exclusive_count.end()) {
+      function.exclusive = 100.f * it->second / thread_sample_data->samples_count;
+    }
   }
 
-  exact_address_to_function_address_[absolute_address] = absolute_function_address;
-  function_address_to_exact_addresses_[absolute_function_address].insert(absolute_address);
+  // The report views sort the functions themselves, so only the top ones are sorted here, by
+  // decreasing inclusive count. Addresses break ties, so that reports are stable.
+  const size_t sorted_functions_count =
+      std::min(sampled_functions->size(), kSortedSampledFunctionsCount);
+  std::partial_sort(sampled_functions->begin(), sampled_functions->begin() + sorted_functions_count,
+                    sampled_functions->end(),
+                    [](const SampledFunction& a, const SampledFunction& b) {
+                      if (a.inclusive != b.inclusive) return a.inclusive > b.inclusive;
+                      return a.absolute_address < b.absolute_address;
+                    });
 }
 
-void SamplingDataPostProcessor::FillThreadSampleDataSampleReports(const CaptureData& capture_data) {
-  for (auto& data : thread_id_to_sample_data_) {
-    ThreadSampleData* thread_sample_data = &data.second;
-    std::vector<SampledFunction>* sampled_functions = &thread_sample_data->sampled_function;
-
-    for (auto sorted_it = thread_sample_data->address_count_sorted.rbegin();
-         sorted_it != thread_sample_data->address_count_sorted.rend(); ++sorted_it) {
-      uint32_t num_occurences = sorted_it->first;
-      uint64_t absolute_address = sorted_it->second;
-      float inclusive_percent = 100.f * num_occurences / thread_sample_data->samples_count;
-
-      SampledFunction function;
-      function.name = capture_data.GetFunctionNameByAddress(absolute_address);
-      function.inclusive = inclusive_percent;
-      function.exclusive = 0.f;
-      auto it = thread_sample_data->exclusive_count.find(absolute_address);
-      if (it != thread_sample_data->exclusive_count.end()) {
-        function.exclusive = 100.f * it->second / thread_sample_data->samples_count;
-      }
-      function.absolute_address = absolute_address;
-      function.module_path = capture_data.GetModulePathByAddress(absolute_address);
-
-      const FunctionInfo* function_info =
-          capture_data.FindFunctionByAddress(absolute_address, false);
-      if (function_info != nullptr) {
-        function.line = function_info->line();
-        function.file = function_info->file();
-      }
+void IncrementalSamplingDataPostProcessor::UpdateSortedThreadSampleData(
+    const std::vector<ThreadID>& updated_thread_ids) {
+  std::vector<ThreadSampleData>& sorted_thread_sample_data = data_->sorted_thread_sample_data_;
+  absl::flat_hash_map<ThreadID, size_t> thread_id_to_sorted_index;
+  for (size_t i = 0; i < sorted_thread_sample_data.size(); ++i) {
+    thread_id_to_sorted_index.emplace(sorted_thread_sample_data[i].thread_id, i);
+  }
 
-      sampled_functions->push_back(function);
+  for (ThreadID thread_id : updated_thread_ids) {
+    const ThreadSampleData& thread_sample_data = data_->thread_id_to_sample_data_.at(thread_id);
+    auto sorted_it = thread_id_to_sorted_index.find(thread_id);
+    if (sorted_it == thread_id_to_sorted_index.end()) {
+      sorted_thread_sample_data.push_back(thread_sample_data);
+    } else {
+      sorted_thread_sample_data[sorted_it->second] = thread_sample_data;
     }
   }
-}
 
-}  // namespace
+  std::stable_sort(sorted_thread_sample_data.begin(), sorted_thread_sample_data.end(),
+                   [](const ThreadSampleData& a, const ThreadSampleData& b) {
+                     return a.samples_count > b.samples_count;
+                   });
+}
 
 }  // namespace orbit_client_model
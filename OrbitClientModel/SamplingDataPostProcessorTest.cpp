@@ -0,0 +1,272 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "OrbitBase/ThreadConstants.h"
+#include "OrbitBase/ThreadPool.h"
+#include "OrbitClientData/CallstackData.h"
+#include "OrbitClientData/ModuleManager.h"
+#include "OrbitClientData/PostProcessedSamplingData.h"
+#include "OrbitClientData/ProcessData.h"
+#include "OrbitClientData/UserDefinedCaptureData.h"
+#include "OrbitClientModel/CaptureData.h"
+#include "OrbitClientModel/SamplingDataPostProcessor.h"
+#include "absl/time/time.h"
+#include "capture_data.pb.h"
+#include "process.pb.h"
+
+using orbit_client_data::ModuleManager;
+using orbit_client_model::CreatePostProcessedSamplingData;
+using orbit_client_model::IncrementalSamplingDataPostProcessor;
+using orbit_client_protos::CallstackEvent;
+using orbit_client_protos::LinuxAddressInfo;
+
+namespace {
+
+constexpr int32_t kThreadId = 42;
+constexpr int32_t kOtherThreadId = 43;
+
+// Two functions, at 0x100 and 0x200, both called from the function at 0x300.
+const CallStack kCallstack1{{0x101, 0x300}};
+const CallStack kCallstack2{{0x202, 0x300}};
+const CallStack kCallstack3{{0x103, 0x201, 0x300}};
+const CallStack kBrokenCallstack{{0x104, 0x400}};
+
+class SamplingDataPostProcessorTest : public ::testing::Test {
+ protected:
+  SamplingDataPostProcessorTest()
+      : capture_data_{ProcessData{orbit_grpc_protos::ProcessInfo{}}, &module_manager_, {}, {},
+                      UserDefinedCaptureData{}} {
+    for (uint64_t function_address : {0x100, 0x200, 0x300, 0x400}) {
+      for (uint64_t offset = 0; offset < 5; ++offset) {
+        LinuxAddressInfo address_info;
+        address_info.set_absolute_address(function_address + offset);
+        address_info.set_offset_in_function(offset);
+        capture_data_.InsertAddressInfo(address_info);
+      }
+    }
+    for (const CallStack& callstack :
+         {kCallstack1, kCallstack2, kCallstack3, kBrokenCallstack}) {
+      callstack_data_.AddUniqueCallStack(callstack);
+    }
+  }
+
+  void AddEvent(int32_t thread_id, uint64_t time, const CallStack& callstack) {
+    CallstackEvent event;
+    event.set_thread_id(thread_id);
+    event.set_time(time);
+    event.set_callstack_hash(callstack.GetHash());
+    callstack_data_.AddCallstackEvent(event);
+  }
+
+  ModuleManager module_manager_;
+  CaptureData capture_data_;
+  CallstackData callstack_data_;
+};
+
+MATCHER(SampledFunctionEq, "") {
+  const SampledFunction& a = std::get<0>(arg);
+  const SampledFunction& b = std::get<1>(arg);
+  return a.absolute_address == b.absolute_address && a.inclusive == b.inclusive &&
+         a.exclusive == b.exclusive;
+}
+
+void ExpectSameThreadSampleData(const ThreadSampleData& actual, const ThreadSampleData& expected) {
+  EXPECT_EQ(actual.thread_id, expected.thread_id);
+  EXPECT_EQ(actual.samples_count, expected.samples_count);
+  EXPECT_EQ(actual.callstack_count, expected.callstack_count);
+  EXPECT_EQ(actual.address_count, expected.address_count);
+  EXPECT_EQ(actual.raw_address_count, expected.raw_address_count);
+  EXPECT_EQ(actual.exclusive_count, expected.exclusive_count);
+  EXPECT_THAT(actual.sampled_function,
+              ::testing::Pointwise(SampledFunctionEq(), expected.sampled_function));
+}
+
+void ExpectSamePostProcessedSamplingData(const PostProcessedSamplingData& actual,
+                                         const PostProcessedSamplingData& expected) {
+  ASSERT_EQ(actual.GetThreadSampleData().size(), expected.GetThreadSampleData().size());
+  for (const ThreadSampleData& expected_thread_sample_data : expected.GetThreadSampleData()) {
+    const ThreadSampleData* actual_thread_sample_data =
+        actual.GetThreadSampleDataByThreadId(expected_thread_sample_data.thread_id);
+    ASSERT_NE(actual_thread_sample_data, nullptr);
+    ExpectSameThreadSampleData(*actual_thread_sample_data, expected_thread_sample_data);
+
+    for (uint64_t function_address : {0x100, 0x200, 0x300}) {
+      EXPECT_EQ(actual.GetCallstacksFromAddress(function_address,
+                                                expected_thread_sample_data.thread_id),
+                expected.GetCallstacksFromAddress(function_address,
+                                                  expected_thread_sample_data.thread_id));
+    }
+    for (const auto& [callstack_id, unused_count] : expected_thread_sample_data.callstack_count) {
+      EXPECT_EQ(actual.GetResolvedCallstack(callstack_id).GetFrames(),
+                expected.GetResolvedCallstack(callstack_id).GetFrames());
+    }
+  }
+}
+
+}  // namespace
+
+TEST_F(SamplingDataPostProcessorTest, ResolvesAddressesToFunctions) {
+  AddEvent(kThreadId, 100, kCallstack1);
+  AddEvent(kThreadId, 200, kCallstack3);
+  AddEvent(kThreadId, 300, kCallstack3);
+
+  PostProcessedSamplingData data = CreatePostProcessedSamplingData(callstack_data_, capture_data_);
+
+  const ThreadSampleData* thread_sample_data = data.GetThreadSampleDataByThreadId(kThreadId);
+  ASSERT_NE(thread_sample_data, nullptr);
+  EXPECT_EQ(thread_sample_data->samples_count, 3);
+  EXPECT_EQ(thread_sample_data->address_count.at(0x100), 3);
+  EXPECT_EQ(thread_sample_data->address_count.at(0x200), 2);
+  EXPECT_EQ(thread_sample_data->address_count.at(0x300), 3);
+  EXPECT_EQ(thread_sample_data->exclusive_count.at(0x100), 3);
+  EXPECT_EQ(thread_sample_data->exclusive_count.count(0x200), 0);
+  EXPECT_EQ(data.GetResolvedCallstack(kCallstack3.GetHash()).GetFrames(),
+            std::vector<uint64_t>({0x100, 0x200, 0x300}));
+
+  ASSERT_NE(data.GetSummary(), nullptr);
+  EXPECT_EQ(data.GetSummary()->samples_count, 3);
+  EXPECT_EQ(data.GetSummary()->thread_id, orbit_base::kAllProcessThreadsTid);
+
+  // Sorted by decreasing inclusive count.
+  ASSERT_EQ(thread_sample_data->sampled_function.size(), 3);
+  EXPECT_EQ(thread_sample_data->sampled_function[0].absolute_address, 0x100);
+  EXPECT_EQ(thread_sample_data->sampled_function[1].absolute_address, 0x300);
+  EXPECT_EQ(thread_sample_data->sampled_function[2].absolute_address, 0x200);
+  EXPECT_EQ(thread_sample_data->sampled_function[2].inclusive, 100.f * 2 / 3);
+}
+
+TEST_F(SamplingDataPostProcessorTest, ParallelPostProcessingMatchesSerial) {
+  const std::vector<CallStack> callstacks{kCallstack1, kCallstack2, kCallstack3};
+  for (int32_t thread_id = 1; thread_id <= 20; ++thread_id) {
+    for (uint64_t time = 0; time < 100 * static_cast<uint64_t>(thread_id); ++time) {
+      AddEvent(thread_id, time, callstacks[(time * thread_id) % callstacks.size()]);
+    }
+  }
+
+  std::unique_ptr<ThreadPool> thread_pool = ThreadPool::Create(4, 4, absl::Seconds(1));
+  ExpectSamePostProcessedSamplingData(
+      CreatePostProcessedSamplingData(callstack_data_, capture_data_, /*generate_summary=*/true,
+                                      thread_pool.get()),
+      CreatePostProcessedSamplingData(callstack_data_, capture_data_));
+
+  IncrementalSamplingDataPostProcessor post_processor(/*generate_summary=*/true,
+                                                      thread_pool.get());
+  (void)post_processor.Update(callstack_data_, capture_data_);
+  AddEvent(1, 1000, kCallstack2);
+  AddEvent(21, 1000, kCallstack3);
+  ExpectSamePostProcessedSamplingData(*post_processor.Update(callstack_data_, capture_data_),
+                                      CreatePostProcessedSamplingData(callstack_data_,
+                                                                      capture_data_));
+  thread_pool->ShutdownAndWait();
+}
+
+TEST_F(SamplingDataPostProcessorTest, IncrementalUpdatesMatchFullPostProcessing) {
+  IncrementalSamplingDataPostProcessor post_processor;
+
+  AddEvent(kThreadId, 100, kCallstack1);
+  AddEvent(kThreadId, 200, kCallstack3);
+  ExpectSamePostProcessedSamplingData(*post_processor.Update(callstack_data_, capture_data_),
+                                      CreatePostProcessedSamplingData(callstack_data_,
+                                                                      capture_data_));
+
+  AddEvent(kThreadId, 300, kCallstack2);
+  AddEvent(kOtherThreadId, 150, kCallstack3);
+  ExpectSamePostProcessedSamplingData(*post_processor.Update(callstack_data_, capture_data_),
+                                      CreatePostProcessedSamplingData(callstack_data_,
+                                                                      capture_data_));
+
+  // No new events.
+  ExpectSamePostProcessedSamplingData(*post_processor.Update(callstack_data_, capture_data_),
+                                      CreatePostProcessedSamplingData(callstack_data_,
+                                                                      capture_data_));
+
+  AddEvent(kThreadId, 400, kCallstack1);
+  AddEvent(kOtherThreadId, 250, kCallstack1);
+  AddEvent(kOtherThreadId, 350, kCallstack2);
+  ExpectSamePostProcessedSamplingData(*post_processor.Update(callstack_data_, capture_data_),
+                                      CreatePostProcessedSamplingData(callstack_data_,
+                                                                      capture_data_));
+}
+
+TEST_F(SamplingDataPostProcessorTest, IncrementalUpdateHandlesEventsOutOfOrder) {
+  IncrementalSamplingDataPostProcessor post_processor;
+
+  AddEvent(kThreadId, 200, kCallstack1);
+  AddEvent(kThreadId, 400, kCallstack3);
+  ExpectSamePostProcessedSamplingData(*post_processor.Update(callstack_data_, capture_data_),
+                                      CreatePostProcessedSamplingData(callstack_data_,
+                                                                      capture_data_));
+
+  AddEvent(kThreadId, 300, kCallstack2);
+  AddEvent(kThreadId, 500, kCallstack2);
+  ExpectSamePostProcessedSamplingData(*post_processor.Update(callstack_data_, capture_data_),
+                                      CreatePostProcessedSamplingData(callstack_data_,
+                                                                      capture_data_));
+}
+
+TEST_F(SamplingDataPostProcessorTest, IncrementalUpdateHandlesRemovedEvents) {
+  IncrementalSamplingDataPostProcessor post_processor(/*generate_summary=*/false);
+
+  AddEvent(kThreadId, 100, kCallstack1);
+  AddEvent(kThreadId, 200, kCallstack1);
+  AddEvent(kThreadId, 300, kCallstack2);
+  AddEvent(kThreadId, 400, kBrokenCallstack);
+  AddEvent(kThreadId, 500, kCallstack3);
+  AddEvent(kOtherThreadId, 100, kBrokenCallstack);
+  (void)post_processor.Update(callstack_data_, capture_data_);
+
+  callstack_data_.FilterCallstackEventsBasedOnMajorityStart();
+  std::shared_ptr<const PostProcessedSamplingData> data =
+      post_processor.Update(callstack_data_, capture_data_);
+  ExpectSamePostProcessedSamplingData(
+      *data, CreatePostProcessedSamplingData(callstack_data_, capture_data_,
+                                             /*generate_summary=*/false));
+  EXPECT_EQ(data->GetSummary(), nullptr);
+  ASSERT_NE(data->GetThreadSampleDataByThreadId(kThreadId), nullptr);
+  EXPECT_EQ(data->GetThreadSampleDataByThreadId(kThreadId)->samples_count, 4);
+}
+
+TEST_F(SamplingDataPostProcessorTest, IncrementalUpdateHandlesReplacedEvents) {
+  IncrementalSamplingDataPostProcessor post_processor;
+
+  AddEvent(kThreadId, 100, kCallstack1);
+  AddEvent(kThreadId, 200, kCallstack1);
+  (void)post_processor.Update(callstack_data_, capture_data_);
+
+  // Same number of events and same last time as before, but a different callstack.
+  AddEvent(kThreadId, 100, kCallstack2);
+  ExpectSamePostProcessedSamplingData(*post_processor.Update(callstack_data_, capture_data_),
+                                      CreatePostProcessedSamplingData(callstack_data_,
+                                                                      capture_data_));
+}
+
+TEST_F(SamplingDataPostProcessorTest, IncrementalUpdateSharesItsData) {
+  IncrementalSamplingDataPostProcessor post_processor;
+
+  AddEvent(kThreadId, 100, kCallstack1);
+  std::shared_ptr<const PostProcessedSamplingData> data =
+      post_processor.Update(callstack_data_, capture_data_);
+  EXPECT_EQ(post_processor.GetUniqueCallstacks()->size(), 1);
+
+  AddEvent(kThreadId, 200, kCallstack3);
+  EXPECT_EQ(post_processor.Update(callstack_data_, capture_data_), data);
+  ExpectSamePostProcessedSamplingData(*data,
+                                      CreatePostProcessedSamplingData(callstack_data_,
+                                                                      capture_data_));
+  EXPECT_EQ(post_processor.GetUniqueCallstacks()->size(), 2);
+  EXPECT_EQ(post_processor.GetUniqueCallstacks()->at(kCallstack3.GetHash())->GetFrames(),
+            kCallstack3.GetFrames());
+
+  // After a reset, the previous data is left as is.
+  post_processor.Reset();
+  EXPECT_NE(post_processor.Update(callstack_data_, capture_data_), data);
+  EXPECT_EQ(data->GetThreadSampleDataByThreadId(kThreadId)->samples_count, 2);
+}
@@ -0,0 +1,28 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_CLIENT_MODEL_CAPTURE_CHUNK_COMPRESSION_H_
+#define ORBIT_CLIENT_MODEL_CAPTURE_CHUNK_COMPRESSION_H_
+
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "absl/types/span.h"
+
+// Chunks of a capture file are compressed independently with zlib, so that they can be compressed
+// in parallel when saving and decompressed one at a time when loading.
+namespace capture_compression {
+
+// Returns payload compressed, or nullopt if compressing it doesn't make it smaller, in which case
+// the chunk is stored as is.
+[[nodiscard]] std::optional<std::string> Compress(std::string_view payload);
+
+// Decompresses compressed into output, which must have exactly the size of the uncompressed data.
+// Returns false if the compressed data is corrupted or has another size.
+[[nodiscard]] bool Decompress(absl::Span<const char> compressed, absl::Span<char> output);
+
+}  // namespace capture_compression
+
+#endif  // ORBIT_CLIENT_MODEL_CAPTURE_CHUNK_COMPRESSION_H_
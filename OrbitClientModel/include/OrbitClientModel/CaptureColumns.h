@@ -0,0 +1,172 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_CLIENT_MODEL_CAPTURE_COLUMNS_H_
+#define ORBIT_CLIENT_MODEL_CAPTURE_COLUMNS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "OrbitBase/Result.h"
+#include "absl/types/span.h"
+#include "capture_data.pb.h"
+
+// Timers and callstack events are the bulk of a capture. In kTimersChunk and kCallstackEventsChunk
+// chunks they are not stored as protos but as fixed-width little-endian columns: a uint32 with the
+// number of events, then the values of each field for all the events, one field after the other.
+// Each value is at a known offset in the payload, so the events of a chunk can be read in place,
+// e.g., from a mapped file, and reading one field only accesses the memory of that column.
+namespace capture_columns {
+
+template <typename T>
+class Column {
+ public:
+  Column() = default;
+  explicit Column(const char* data) : data_{data} {}
+
+  // The payload has no alignment, so values are copied out rather than accessed through a T*.
+  [[nodiscard]] T operator[](size_t index) const {
+    T value;
+    std::memcpy(&value, data_ + index * sizeof(T), sizeof(T));
+    return value;
+  }
+
+ private:
+  const char* data_ = nullptr;
+};
+
+// Layout of a kTimersChunk payload: the number of timers and the total number of registers, then
+// the columns start, end, process_id, thread_id, depth, type, processor, callstack_id,
+// function_address, user_data_key, timeline_hash and registers_end, then the registers of all
+// timers. The registers of timer i are [registers_end[i - 1], registers_end[i]).
+class TimerColumns {
+ public:
+  // Returns an error if payload is smaller than the columns it declares.
+  static ErrorMessageOr<TimerColumns> Create(absl::Span<const char> payload);
+
+  [[nodiscard]] size_t size() const { return size_; }
+  [[nodiscard]] uint64_t start(size_t index) const { return start_[index]; }
+  [[nodiscard]] uint64_t end(size_t index) const { return end_[index]; }
+
+  // Sets all the fields of timer, which can be reused across calls to avoid allocations.
+  void Decode(size_t index, orbit_client_protos::TimerInfo* timer) const;
+
+ private:
+  size_t size_ = 0;
+  uint32_t register_count_ = 0;
+  Column<uint64_t> start_;
+  Column<uint64_t> end_;
+  Column<int32_t> process_id_;
+  Column<int32_t> thread_id_;
+  Column<uint32_t> depth_;
+  Column<int32_t> type_;
+  Column<int32_t> processor_;
+  Column<uint64_t> callstack_id_;
+  Column<uint64_t> function_address_;
+  Column<uint64_t> user_data_key_;
+  Column<uint64_t> timeline_hash_;
+  Column<uint32_t> registers_end_;
+  Column<uint64_t> registers_;
+};
+
+// Layout of a kCallstackEventsChunk payload: the number of events, then the columns time,
+// callstack_hash and thread_id.
+class CallstackEventColumns {
+ public:
+  // Returns an error if payload is smaller than the columns it declares.
+  static ErrorMessageOr<CallstackEventColumns> Create(absl::Span<const char> payload);
+
+  [[nodiscard]] size_t size() const { return size_; }
+  [[nodiscard]] uint64_t time(size_t index) const { return time_[index]; }
+
+  void Decode(size_t index, orbit_client_protos::CallstackEvent* event) const;
+
+ private:
+  size_t size_ = 0;
+  Column<uint64_t> time_;
+  Column<uint64_t> callstack_hash_;
+  Column<int32_t> thread_id_;
+};
+
+// The fields of a timer, as added to a TimerColumnsBuilder. Unlike a TimerInfo, it doesn't own its
+// registers, so timers can be encoded from where they are stored without copying them to protos.
+struct TimerFields {
+  uint64_t start = 0;
+  uint64_t end = 0;
+  int32_t process_id = 0;
+  int32_t thread_id = 0;
+  uint32_t depth = 0;
+  int32_t type = 0;
+  int32_t processor = 0;
+  uint64_t callstack_id = 0;
+  uint64_t function_address = 0;
+  uint64_t user_data_key = 0;
+  uint64_t timeline_hash = 0;
+  absl::Span<const uint64_t> registers;
+};
+
+// Collects timers column by column, then encodes them as the payload of a kTimersChunk.
+class TimerColumnsBuilder {
+ public:
+  void Add(const TimerFields& timer);
+  void Add(const orbit_client_protos::TimerInfo& timer);
+
+  [[nodiscard]] size_t size() const { return start_.size(); }
+  // Time range of the timers added so far, for the index of the capture.
+  [[nodiscard]] uint64_t min_timestamp_ns() const { return min_timestamp_ns_; }
+  [[nodiscard]] uint64_t max_timestamp_ns() const { return max_timestamp_ns_; }
+
+  [[nodiscard]] std::string Build() const;
+
+ private:
+  std::vector<uint64_t> start_;
+  std::vector<uint64_t> end_;
+  std::vector<int32_t> process_id_;
+  std::vector<int32_t> thread_id_;
+  std::vector<uint32_t> depth_;
+  std::vector<int32_t> type_;
+  std::vector<int32_t> processor_;
+  std::vector<uint64_t> callstack_id_;
+  std::vector<uint64_t> function_address_;
+  std::vector<uint64_t> user_data_key_;
+  std::vector<uint64_t> timeline_hash_;
+  std::vector<uint32_t> registers_end_;
+  std::vector<uint64_t> registers_;
+  uint64_t min_timestamp_ns_ = std::numeric_limits<uint64_t>::max();
+  uint64_t max_timestamp_ns_ = 0;
+};
+
+// Collects callstack events column by column, then encodes them as the payload of a
+// kCallstackEventsChunk.
+class CallstackEventColumnsBuilder {
+ public:
+  void Add(uint64_t time, uint64_t callstack_hash, int32_t thread_id);
+  void Add(const orbit_client_protos::CallstackEvent& event) {
+    Add(event.time(), event.callstack_hash(), event.thread_id());
+  }
+
+  [[nodiscard]] size_t size() const { return time_.size(); }
+  [[nodiscard]] uint64_t min_timestamp_ns() const { return min_timestamp_ns_; }
+  [[nodiscard]] uint64_t max_timestamp_ns() const { return max_timestamp_ns_; }
+
+  [[nodiscard]] std::string Build() const;
+
+ private:
+  std::vector<uint64_t> time_;
+  std::vector<uint64_t> callstack_hash_;
+  std::vector<int32_t> thread_id_;
+  uint64_t min_timestamp_ns_ = std::numeric_limits<uint64_t>::max();
+  uint64_t max_timestamp_ns_ = 0;
+};
+
+[[nodiscard]] std::string EncodeTimers(
+    absl::Span<const orbit_client_protos::TimerInfo* const> timers);
+
+}  // namespace capture_columns
+
+#endif  // ORBIT_CLIENT_MODEL_CAPTURE_COLUMNS_H_
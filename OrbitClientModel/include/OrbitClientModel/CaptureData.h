@@ -18,6 +18,7 @@
 #include "OrbitClientData/TracepointData.h"
 #include "OrbitClientData/UserDefinedCaptureData.h"
 #include "absl/container/flat_hash_map.h"
+#include "absl/types/span.h"
 #include "capture_data.pb.h"
 #include "process.pb.h"
 
@@ -77,6 +78,10 @@ class CaptureData {
 
   [[nodiscard]] const orbit_client_protos::FunctionInfo* FindFunctionByAddress(
       uint64_t absolute_address, bool is_exact) const;
+  // FindFunctionByAddress for each address, in the same order. The module is only looked up again
+  // when an address is outside the module of the previous one, so sorted addresses resolve fastest.
+  [[nodiscard]] std::vector<const orbit_client_protos::FunctionInfo*> FindFunctionsByAddresses(
+      absl::Span<const uint64_t> absolute_addresses, bool is_exact) const;
   [[nodiscard]] ModuleData* FindModuleByAddress(uint64_t absolute_address) const;
   [[nodiscard]] uint64_t GetAbsoluteAddress(
       const orbit_client_protos::FunctionInfo& function) const;
@@ -5,14 +5,19 @@
 #ifndef ORBIT_GL_CAPTURE_DESERIALIZER_H_
 #define ORBIT_GL_CAPTURE_DESERIALIZER_H_
 
+#include <cstdint>
+#include <functional>
 #include <iosfwd>
+#include <memory>
 #include <outcome.hpp>
 #include <string>
 
 #include "CaptureData.h"
 #include "OrbitBase/Result.h"
+#include "OrbitBase/ThreadPool.h"
 #include "OrbitCaptureClient/CaptureListener.h"
 #include "OrbitClientData/ModuleManager.h"
+#include "absl/types/span.h"
 #include "capture_data.pb.h"
 #include "google/protobuf/io/coded_stream.h"
 #include "google/protobuf/io/zero_copy_stream_impl.h"
@@ -20,24 +25,58 @@
 
 namespace capture_deserializer {
 
+// The capture is passed to capture_listener as it is read. If thread_pool is not null, the chunks
+// of the file are parsed on it, while the ones already parsed are passed to capture_listener.
 void Load(std::istream& stream, const std::string& file_name, CaptureListener* capture_listener,
           orbit_client_data::ModuleManager* module_manager,
-          std::atomic<bool>* cancellation_requested);
+          std::atomic<bool>* cancellation_requested, ThreadPool* thread_pool = nullptr);
+// Reads the file through a MappedCaptureFile, without copying it, if it is a complete capture.
+// Every event is still decoded and passed to capture_listener, so this takes time and memory
+// proportional to the size of the capture. The mapping is released when Load returns.
 void Load(const std::string& file_name, CaptureListener* capture_listener,
           orbit_client_data::ModuleManager* module_manager,
-          std::atomic<bool>* cancellation_requested);
+          std::atomic<bool>* cancellation_requested, ThreadPool* thread_pool = nullptr);
+
+// Reads the index at the end of a capture file, which has the offset and time range of each chunk.
+ErrorMessageOr<orbit_client_protos::CaptureChunkIndex> ReadChunkIndex(std::istream& stream);
 
 namespace internal {
 
-bool ReadMessage(google::protobuf::Message* message, google::protobuf::io::CodedInputStream* input);
+struct CaptureChunk {
+  orbit_client_protos::CaptureChunkType type = orbit_client_protos::kUnknownCaptureChunk;
+  absl::Span<const char> payload;
+  // Size of payload once decompressed, 0 if it is not compressed.
+  uint64_t uncompressed_size = 0;
+  // Holds the payload of a chunk read from a stream, or decompressed. A chunk of a mapped file has
+  // none.
+  std::unique_ptr<char[]> payload_buffer;
+};
+
+// Sets chunk to the next chunk of the capture. Returns false when there are no more chunks.
+using ChunkReader = std::function<bool(CaptureChunk* chunk)>;
+
+bool ReadMessage(google::protobuf::Message* message, std::istream* input);
+
+// Returns false at the end of input, or if the chunk is truncated. The payload is not decompressed.
+bool ReadChunk(std::istream* input, CaptureChunk* chunk);
 
+// Replaces a compressed payload of chunk with the decompressed one. Returns false if it is
+// corrupted.
+bool DecompressChunk(CaptureChunk* chunk);
+
+// Starts the capture from the metadata in capture_info, loads the rest of capture_info, then the
+// chunks that follow, up to the index.
 void LoadCaptureInfo(const orbit_client_protos::CaptureInfo& capture_info,
                      CaptureListener* capture_listener,
                      orbit_client_data::ModuleManager* module_manager,
-                     google::protobuf::io::CodedInputStream* coded_input,
-                     std::atomic<bool>* cancellation_requested);
+                     const ChunkReader& read_next_chunk,
+                     std::atomic<bool>* cancellation_requested, ThreadPool* thread_pool = nullptr);
+void LoadCaptureInfo(const orbit_client_protos::CaptureInfo& capture_info,
+                     CaptureListener* capture_listener,
+                     orbit_client_data::ModuleManager* module_manager, std::istream* chunks_input,
+                     std::atomic<bool>* cancellation_requested, ThreadPool* thread_pool = nullptr);
 
-inline const std::string kRequiredCaptureVersion = "1.55";
+inline const std::string kRequiredCaptureVersion = "1.58";
 
 }  // namespace internal
 
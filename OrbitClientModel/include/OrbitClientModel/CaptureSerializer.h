@@ -5,12 +5,19 @@
 #ifndef ORBIT_CLIENT_MODEL_CAPTURE_SERIALIZER_H_
 #define ORBIT_CLIENT_MODEL_CAPTURE_SERIALIZER_H_
 
+#include <cstdint>
+#include <functional>
 #include <iosfwd>
 #include <outcome.hpp>
 #include <string>
+#include <string_view>
+#include <vector>
 
 #include "CaptureData.h"
 #include "OrbitBase/Result.h"
+#include "OrbitBase/ThreadPool.h"
+#include "OrbitClientModel/CaptureColumns.h"
+#include "absl/types/span.h"
 #include "capture_data.pb.h"
 #include "google/protobuf/io/coded_stream.h"
 #include "google/protobuf/io/zero_copy_stream_impl.h"
@@ -18,10 +25,20 @@
 
 namespace capture_serializer {
 
-template <class TimersIterator>
+// Adds a part of the timers of a capture to builder. Sections are encoded in parallel while saving,
+// so they read the timers from where they are stored, which must not change until Save returns.
+using TimersSection = std::function<void(capture_columns::TimerColumnsBuilder* builder)>;
+
+// Encodes the sections of the capture in parallel on thread_pool, if not null, and compresses them
+// independently. The chunks are written in the same order whatever the thread pool.
 ErrorMessageOr<void> Save(const std::string& filename, const CaptureData& capture_data,
                           const absl::flat_hash_map<uint64_t, std::string>& key_to_string_map,
-                          TimersIterator timers_iterator_begin, TimersIterator timers_iterator_end);
+                          std::vector<TimersSection> timers_sections,
+                          ThreadPool* thread_pool = nullptr);
+
+// Splits timers in sections of one chunk each. The timers must outlive saving.
+[[nodiscard]] std::vector<TimersSection> CreateTimersSections(
+    absl::Span<const orbit_client_protos::TimerInfo> timers);
 
 void WriteMessage(const google::protobuf::Message* message,
                   google::protobuf::io::CodedOutputStream* output);
@@ -32,55 +49,66 @@ void IncludeOrbitExtensionInFile(std::string& file_name);
 
 namespace internal {
 
-inline const std::string kRequiredCaptureVersion = "1.55";
-
-orbit_client_protos::CaptureInfo GenerateCaptureInfo(
-    const CaptureData& capture_data,
-    const absl::flat_hash_map<uint64_t, std::string>& key_to_string_map);
-
-template <class TimersIterator>
+inline const std::string kRequiredCaptureVersion = "1.58";
+
+inline constexpr size_t kTimersPerChunk = 64 * 1024;
+
+// The fields of CaptureInfo other than the events and the other potentially large fields, which
+// are saved in chunks of their own.
+orbit_client_protos::CaptureInfo GenerateCaptureInfoMetadata(const CaptureData& capture_data);
+
+// A chunk ready to be written, possibly compressed.
+struct EncodedChunk {
+  orbit_client_protos::CaptureChunkType type = orbit_client_protos::kUnknownCaptureChunk;
+  std::string payload;
+  // 0 if payload is not compressed.
+  uint64_t uncompressed_size = 0;
+  // Time range of the events in the chunk, if any.
+  uint64_t min_timestamp_ns = 0;
+  uint64_t max_timestamp_ns = 0;
+};
+
+// Compresses the payload of chunk, unless that doesn't make it smaller.
+void CompressChunk(EncodedChunk* chunk);
+
+// Writes the chunks of a capture file after the CaptureHeader, and records them in the index that
+// ends the file. See CaptureChunkType in capture_data.proto for the format.
+class CaptureChunkWriter {
+ public:
+  explicit CaptureChunkWriter(google::protobuf::io::CodedOutputStream* output)
+      : output_{output}, offset_{static_cast<uint64_t>(output->ByteCount())} {}
+
+  // min_timestamp_ns and max_timestamp_ns are the time range of the events in the chunk, if any.
+  // These write the payload uncompressed.
+  void WriteChunk(orbit_client_protos::CaptureChunkType type,
+                  const google::protobuf::Message& payload, uint64_t min_timestamp_ns = 0,
+                  uint64_t max_timestamp_ns = 0);
+  void WriteChunk(orbit_client_protos::CaptureChunkType type, std::string_view payload,
+                  uint64_t min_timestamp_ns = 0, uint64_t max_timestamp_ns = 0);
+  void WriteChunk(const EncodedChunk& chunk);
+
+  // Writes the index chunk and its offset. No chunk can be written after this.
+  void Finish();
+
+ private:
+  // Records the chunk in the index and writes its header. The payload must follow.
+  void WriteChunkHeader(orbit_client_protos::CaptureChunkType type, size_t payload_size,
+                        uint64_t uncompressed_size, uint64_t min_timestamp_ns,
+                        uint64_t max_timestamp_ns);
+
+  google::protobuf::io::CodedOutputStream* output_;
+  uint64_t offset_;
+  orbit_client_protos::CaptureChunkIndex index_;
+};
+
+// Writes the capture to stream, compressing the chunks if compress_chunks is true.
 void Save(std::ostream& stream, const CaptureData& capture_data,
           const absl::flat_hash_map<uint64_t, std::string>& key_to_string_map,
-          TimersIterator timers_iterator_begin, TimersIterator timers_iterator_end) {
-  google::protobuf::io::OstreamOutputStream out_stream(&stream);
-  google::protobuf::io::CodedOutputStream coded_output(&out_stream);
-
-  orbit_client_protos::CaptureHeader header;
-  header.set_version(kRequiredCaptureVersion);
-  WriteMessage(&header, &coded_output);
-
-  orbit_client_protos::CaptureInfo capture_info =
-      GenerateCaptureInfo(capture_data, key_to_string_map);
-  WriteMessage(&capture_info, &coded_output);
-
-  // Timers
-  for (auto it = timers_iterator_begin; it != timers_iterator_end; ++it) {
-    WriteMessage(&(*it), &coded_output);
-  }
-}
+          std::vector<TimersSection> timers_sections, ThreadPool* thread_pool,
+          bool compress_chunks = true);
 
 }  // namespace internal
 
-template <class TimersIterator>
-ErrorMessageOr<void> Save(const std::string& filename, const CaptureData& capture_data,
-                          const absl::flat_hash_map<uint64_t, std::string>& key_to_string_map,
-                          TimersIterator timers_iterator_begin,
-                          TimersIterator timers_iterator_end) {
-  std::ofstream file(filename, std::ios::binary);
-  if (file.fail()) {
-    ERROR("Saving capture in \"%s\": %s", filename, "file.fail()");
-    return ErrorMessage("Error opening the file for writing");
-  }
-
-  {
-    SCOPED_TIMED_LOG("Saving capture in \"%s\"", filename);
-    internal::Save(file, capture_data, key_to_string_map, std::move(timers_iterator_begin),
-                   std::move(timers_iterator_end));
-  }
-
-  return outcome::success();
-}
-
 }  // namespace capture_serializer
 
 #endif  // ORBIT_CLIENT_MODEL_CAPTURE_SERIALIZER_H_
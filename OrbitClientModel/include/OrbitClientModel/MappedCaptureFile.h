@@ -0,0 +1,57 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_CLIENT_MODEL_MAPPED_CAPTURE_FILE_H_
+#define ORBIT_CLIENT_MODEL_MAPPED_CAPTURE_FILE_H_
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+
+#include "OrbitBase/MappedFile.h"
+#include "OrbitBase/Result.h"
+#include "absl/types/span.h"
+#include "capture_data.pb.h"
+
+// A capture file mapped in memory. Opening it only reads the header, the metadata and the index at
+// the end of the file, which takes about as long for any size of capture. The payloads of the
+// other chunks are then read in place, without copying the file, by capture_deserializer::Load,
+// which decodes all of them. Nothing queries the chunks of a time range.
+class MappedCaptureFile {
+ public:
+  // Fails if the file is not a complete capture of the current version.
+  static ErrorMessageOr<std::unique_ptr<MappedCaptureFile>> Open(
+      const std::filesystem::path& file_name);
+
+  // The metadata of the capture, from the first chunk.
+  [[nodiscard]] const orbit_client_protos::CaptureInfo& capture_info() const {
+    return capture_info_;
+  }
+  [[nodiscard]] const orbit_client_protos::CaptureChunkIndex& index() const { return index_; }
+  // The chunks of index() were checked to be in the file on Open. The payload is compressed if
+  // the uncompressed_size of entry is not 0.
+  [[nodiscard]] absl::Span<const char> GetChunkPayload(
+      const orbit_client_protos::CaptureChunkIndex::Entry& entry) const;
+
+ private:
+  explicit MappedCaptureFile(std::unique_ptr<orbit_base::MappedFile> file)
+      : file_{std::move(file)} {}
+
+  ErrorMessageOr<void> ReadHeaderAndIndex();
+  ErrorMessageOr<void> ParseMetadata(const orbit_client_protos::CaptureChunkIndex::Entry& entry,
+                                     absl::Span<const char> payload);
+  // The payload of the chunk at offset, which must be of type expected_type and end before
+  // chunks_end.
+  ErrorMessageOr<absl::Span<const char>> GetChunkPayloadAt(
+      uint64_t offset, orbit_client_protos::CaptureChunkType expected_type,
+      uint64_t chunks_end) const;
+  // The uncompressed size in the header of the chunk at offset, which must be in the file.
+  [[nodiscard]] uint64_t GetUncompressedSizeAt(uint64_t offset) const;
+
+  std::unique_ptr<orbit_base::MappedFile> file_;
+  orbit_client_protos::CaptureInfo capture_info_;
+  orbit_client_protos::CaptureChunkIndex index_;
+};
+
+#endif  // ORBIT_CLIENT_MODEL_MAPPED_CAPTURE_FILE_H_
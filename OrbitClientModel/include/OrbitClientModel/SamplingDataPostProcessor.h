@@ -5,13 +5,110 @@
 #ifndef ORBIT_CLIENT_MODEL_SAMPLING_DATA_POST_PROCESSOR_H_
 #define ORBIT_CLIENT_MODEL_SAMPLING_DATA_POST_PROCESSOR_H_
 
+#include <cstdint>
+#include <memory>
+#include <set>
+#include <vector>
+
+#include "OrbitBase/ThreadPool.h"
 #include "OrbitClientData/CallstackData.h"
+#include "OrbitClientData/CallstackTypes.h"
+#include "OrbitClientData/PostProcessedSamplingData.h"
+#include "OrbitClientData/ThreadCallstackEvents.h"
 #include "OrbitClientModel/CaptureData.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "capture_data.pb.h"
 
 namespace orbit_client_model {
+
+// If thread_pool is not null, the samples of different threads are processed in parallel on it.
 PostProcessedSamplingData CreatePostProcessedSamplingData(const CallstackData& callstack_data,
                                                           const CaptureData& capture_data,
-                                                          bool generate_summary = true);
+                                                          bool generate_summary = true,
+                                                          ThreadPool* thread_pool = nullptr);
+
+// Post-processes the samples of a CallstackData that keeps growing, e.g., during a live capture.
+// Each call to Update only processes the callstack events added since the previous call, so the
+// cost of a refresh is proportional to the new samples. If events were added to a thread before
+// its last processed event, or were removed, everything is processed again. The CallstackData is
+// only locked while the new events are copied, so the capture can keep adding to it meanwhile.
+// The resolution of addresses to functions is cached: call Reset when new symbols are loaded.
+class IncrementalSamplingDataPostProcessor {
+ public:
+  explicit IncrementalSamplingDataPostProcessor(bool generate_summary = true,
+                                                ThreadPool* thread_pool = nullptr)
+      : generate_summary_{generate_summary}, thread_pool_{thread_pool} {}
+
+  // Processes the new events and returns the post-processed data of all the events so far. The
+  // data is not copied: the post-processor keeps updating it in place on each call to Update, so it
+  // must only be used on the thread calling Update. Reset leaves it as is and starts new data.
+  [[nodiscard]] std::shared_ptr<const PostProcessedSamplingData> Update(
+      const CallstackData& callstack_data, const CaptureData& capture_data) &;
+  // Same as above, but moves the result out of a post-processor that is not needed anymore.
+  [[nodiscard]] PostProcessedSamplingData Update(const CallstackData& callstack_data,
+                                                 const CaptureData& capture_data) &&;
+
+  // The unique callstacks of the events processed so far, shared like the result of Update.
+  [[nodiscard]] std::shared_ptr<const absl::flat_hash_map<CallstackID, std::shared_ptr<CallStack>>>
+  GetUniqueCallstacks() const {
+    return unique_callstacks_;
+  }
+
+  void Reset();
+
+ private:
+  struct ResolvedCallstack {
+    CallstackID resolved_callstack_id = 0;
+    uint64_t innermost_function_address = 0;
+    std::vector<uint64_t> unique_function_addresses;
+  };
+
+  struct ThreadProgress {
+    uint64_t last_event_time = 0;
+    uint64_t rewrite_count = 0;
+  };
+
+  struct ThreadShard;
+
+  void ProcessNewEvents(const CallstackData& callstack_data, const CaptureData& capture_data);
+
+  // Copies the events added since the last update into shards, and marks them as processed.
+  // Returns false, without side effects, if events were inserted before the last processed ones,
+  // replaced or removed.
+  [[nodiscard]] bool TrySnapshotNewEvents(
+      const absl::flat_hash_map<int32_t, ThreadCallstackEvents>& callstack_events_by_tid,
+      std::vector<ThreadShard>* shards);
+
+  // The callstacks must already be in unique_callstacks_.
+  void ResolveCallstacks(const std::vector<CallstackID>& callstack_ids,
+                         const CaptureData& capture_data);
+
+  void AddCallstackCounts(const absl::flat_hash_map<CallstackID, uint32_t>& callstack_counts,
+                          uint32_t samples_count, ThreadSampleData* thread_sample_data) const;
+
+  // Only the first kSortedSampledFunctionsCount sampled functions are sorted.
+  void FillThreadSampleDataSampleReport(ThreadSampleData* thread_sample_data) const;
+
+  // Copies the updated ThreadSampleData into the ones sorted by decreasing number of samples.
+  void UpdateSortedThreadSampleData(const std::vector<ThreadID>& updated_thread_ids);
+
+  static constexpr size_t kSortedSampledFunctionsCount = 1024;
+
+  bool generate_summary_;
+  ThreadPool* thread_pool_;
+
+  absl::flat_hash_map<ThreadID, ThreadProgress> thread_id_to_progress_;
+  absl::flat_hash_map<CallstackID, ResolvedCallstack> original_to_resolved_callstack_info_;
+  absl::flat_hash_map<uint64_t, SampledFunction> function_address_to_sampled_function_;
+  absl::flat_hash_map<uint64_t, uint64_t> exact_address_to_function_address_;
+
+  // The result, updated in place.
+  std::shared_ptr<PostProcessedSamplingData> data_ = std::make_shared<PostProcessedSamplingData>();
+  std::shared_ptr<absl::flat_hash_map<CallstackID, std::shared_ptr<CallStack>>> unique_callstacks_ =
+      std::make_shared<absl::flat_hash_map<CallstackID, std::shared_ptr<CallStack>>>();
+};
+
 }  // namespace orbit_client_model
 
 #endif  // ORBIT_CLIENT_MODEL_SAMPLING_DATA_POST_PROCESSOR_H_
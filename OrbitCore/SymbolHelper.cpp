@@ -8,16 +8,24 @@
 #include <absl/strings/str_format.h>
 #include <absl/strings/str_replace.h>
 
+#include <chrono>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
+#include <limits>
+#include <random>
+#include <string_view>
+#include <system_error>
 
 #include "ElfUtils/ElfFile.h"
 #include "OrbitBase/Logging.h"
+#include "OrbitBase/MappedFile.h"
 #include "OrbitBase/Result.h"
 #include "OrbitBase/Tracing.h"
 #include "Path.h"
 
 using orbit_grpc_protos::ModuleSymbols;
+using orbit_grpc_protos::SymbolInfo;
 
 namespace fs = std::filesystem;
 using ::orbit_elf_utils::ElfFile;
@@ -63,6 +71,179 @@ std::vector<fs::path> ReadSymbolsFile() {
   return directories;
 }
 
+// A symbols cache file is a SymbolsCacheHeader, the build id, symbol_count SymbolsCacheRecords,
+// then the strings the records refer to. Integers are in the byte order of the machine that wrote
+// the file, the version also rejects files of the other byte order.
+constexpr char kSymbolsCacheMagic[8] = {'O', 'R', 'B', 'S', 'Y', 'M', 'S', '\0'};
+constexpr uint32_t kSymbolsCacheVersion = 2;
+
+// Identifies the version of a symbols file the symbols were loaded from, with its path.
+struct SymbolsFileStamp {
+  uint64_t size;
+  int64_t modification_time_ns;
+};
+
+ErrorMessageOr<SymbolsFileStamp> GetSymbolsFileStamp(const fs::path& symbols_path) {
+  std::error_code error;
+  const uint64_t size = fs::file_size(symbols_path, error);
+  if (error) {
+    return ErrorMessage(absl::StrFormat("Unable to get size of \"%s\": %s", symbols_path.string(),
+                                        error.message()));
+  }
+  const fs::file_time_type modification_time = fs::last_write_time(symbols_path, error);
+  if (error) {
+    return ErrorMessage(absl::StrFormat("Unable to get modification time of \"%s\": %s",
+                                        symbols_path.string(), error.message()));
+  }
+  return SymbolsFileStamp{
+      size, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                modification_time.time_since_epoch())
+                .count()};
+}
+
+struct SymbolsCacheHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t build_id_size;
+  uint64_t load_bias;
+  uint64_t symbol_count;
+  uint64_t strings_size;
+  uint64_t symbols_file_path_offset;
+  uint64_t symbols_file_path_size;
+  uint64_t symbols_file_size;
+  int64_t symbols_file_modification_time_ns;
+};
+static_assert(sizeof(SymbolsCacheHeader) == 72);
+
+struct SymbolsCacheRecord {
+  uint64_t address;
+  uint64_t size;
+  // The demangled name follows the name in the strings, unless it is the same as the name.
+  uint64_t name_offset;
+  uint32_t name_size;
+  uint32_t demangled_name_size;
+};
+static_assert(sizeof(SymbolsCacheRecord) == 32);
+
+constexpr uint32_t kDemangledNameIsName = std::numeric_limits<uint32_t>::max();
+
+std::string EncodeSymbolsCacheFile(const std::string& build_id, const ModuleSymbols& module_symbols,
+                                   const SymbolsFileStamp& symbols_file_stamp) {
+  std::string strings = module_symbols.symbols_file_path();
+  std::vector<SymbolsCacheRecord> records;
+  records.reserve(module_symbols.symbol_infos_size());
+  for (const SymbolInfo& symbol_info : module_symbols.symbol_infos()) {
+    SymbolsCacheRecord record{};
+    record.address = symbol_info.address();
+    record.size = symbol_info.size();
+    record.name_offset = strings.size();
+    record.name_size = static_cast<uint32_t>(symbol_info.name().size());
+    strings.append(symbol_info.name());
+    if (symbol_info.demangled_name() == symbol_info.name()) {
+      record.demangled_name_size = kDemangledNameIsName;
+    } else {
+      record.demangled_name_size = static_cast<uint32_t>(symbol_info.demangled_name().size());
+      strings.append(symbol_info.demangled_name());
+    }
+    records.push_back(record);
+  }
+
+  SymbolsCacheHeader header{};
+  std::memcpy(header.magic, kSymbolsCacheMagic, sizeof(header.magic));
+  header.version = kSymbolsCacheVersion;
+  header.build_id_size = static_cast<uint32_t>(build_id.size());
+  header.load_bias = module_symbols.load_bias();
+  header.symbol_count = records.size();
+  header.strings_size = strings.size();
+  header.symbols_file_path_offset = 0;
+  header.symbols_file_path_size = module_symbols.symbols_file_path().size();
+  header.symbols_file_size = symbols_file_stamp.size;
+  header.symbols_file_modification_time_ns = symbols_file_stamp.modification_time_ns;
+
+  std::string file;
+  file.reserve(sizeof(header) + build_id.size() + records.size() * sizeof(SymbolsCacheRecord) +
+               strings.size());
+  file.append(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.append(build_id);
+  file.append(reinterpret_cast<const char*>(records.data()),
+              records.size() * sizeof(SymbolsCacheRecord));
+  file.append(strings);
+  return file;
+}
+
+ErrorMessageOr<ModuleSymbols> DecodeSymbolsCacheFile(const char* data, uint64_t size,
+                                                     const std::string& build_id,
+                                                     const fs::path& symbols_path,
+                                                     const SymbolsFileStamp& symbols_file_stamp) {
+  SymbolsCacheHeader header;
+  if (size < sizeof(header)) return ErrorMessage("The file is too small");
+  std::memcpy(&header, data, sizeof(header));
+  if (std::memcmp(header.magic, kSymbolsCacheMagic, sizeof(header.magic)) != 0 ||
+      header.version != kSymbolsCacheVersion) {
+    return ErrorMessage("The file is not a symbols cache file of this version");
+  }
+
+  // Checks each part fits in what is left of the file, without overflowing.
+  uint64_t offset = sizeof(header);
+  if (header.build_id_size > size - offset) return ErrorMessage("The file is truncated");
+  if (std::string_view(data + offset, header.build_id_size) != build_id) {
+    return ErrorMessage("The file has a different build id");
+  }
+  offset += header.build_id_size;
+  if (header.symbol_count > (size - offset) / sizeof(SymbolsCacheRecord)) {
+    return ErrorMessage("The file is truncated");
+  }
+  const char* records = data + offset;
+  offset += header.symbol_count * sizeof(SymbolsCacheRecord);
+  if (header.strings_size != size - offset) return ErrorMessage("The file is truncated");
+  const char* strings = data + offset;
+  auto in_strings = [&header](uint64_t string_offset, uint64_t string_size) {
+    return string_offset <= header.strings_size &&
+           string_size <= header.strings_size - string_offset;
+  };
+
+  if (!in_strings(header.symbols_file_path_offset, header.symbols_file_path_size)) {
+    return ErrorMessage("The file is corrupted");
+  }
+  if (std::string_view(strings + header.symbols_file_path_offset,
+                       header.symbols_file_path_size) != symbols_path.string()) {
+    return ErrorMessage("The file has the symbols of another symbols file");
+  }
+  if (header.symbols_file_size != symbols_file_stamp.size ||
+      header.symbols_file_modification_time_ns != symbols_file_stamp.modification_time_ns) {
+    return ErrorMessage("The symbols file changed since the file was written");
+  }
+
+  ModuleSymbols module_symbols;
+  module_symbols.set_load_bias(header.load_bias);
+  module_symbols.set_symbols_file_path(strings + header.symbols_file_path_offset,
+                                       header.symbols_file_path_size);
+  module_symbols.mutable_symbol_infos()->Reserve(static_cast<int>(header.symbol_count));
+  for (uint64_t i = 0; i < header.symbol_count; ++i) {
+    SymbolsCacheRecord record;
+    std::memcpy(&record, records + i * sizeof(record), sizeof(record));
+    const uint64_t demangled_name_offset = record.name_offset + record.name_size;
+    const bool demangled_name_is_name = record.demangled_name_size == kDemangledNameIsName;
+    if (!in_strings(record.name_offset, record.name_size)) {
+      return ErrorMessage("The file is corrupted");
+    }
+    if (!demangled_name_is_name && !in_strings(demangled_name_offset, record.demangled_name_size)) {
+      return ErrorMessage("The file is corrupted");
+    }
+
+    SymbolInfo* symbol_info = module_symbols.add_symbol_infos();
+    symbol_info->set_name(strings + record.name_offset, record.name_size);
+    if (demangled_name_is_name) {
+      symbol_info->set_demangled_name(symbol_info->name());
+    } else {
+      symbol_info->set_demangled_name(strings + demangled_name_offset, record.demangled_name_size);
+    }
+    symbol_info->set_address(record.address);
+    symbol_info->set_size(record.size);
+  }
+  return module_symbols;
+}
+
 }  // namespace
 
 ErrorMessageOr<void> SymbolHelper::VerifySymbolsFile(const fs::path& symbols_path,
@@ -141,7 +322,8 @@ ErrorMessageOr<fs::path> SymbolHelper::FindSymbolsWithSymbolsPathFile(
   return cache_file_path;
 }
 
-ErrorMessageOr<ModuleSymbols> SymbolHelper::LoadSymbolsFromFile(const fs::path& file_path) {
+ErrorMessageOr<ModuleSymbols> SymbolHelper::LoadSymbolsFromFile(const fs::path& file_path,
+                                                                ThreadPool* thread_pool) {
   ORBIT_SCOPE_FUNCTION;
   SCOPED_TIMED_LOG("LoadSymbolsFromFile: %s", file_path.string());
   ErrorMessageOr<std::unique_ptr<ElfFile>> elf_file_result = ElfFile::Create(file_path.string());
@@ -151,10 +333,92 @@ ErrorMessageOr<ModuleSymbols> SymbolHelper::LoadSymbolsFromFile(const fs::path&
                                         file_path.string(), elf_file_result.error().message()));
   }
 
-  return elf_file_result.value()->LoadSymbols();
+  return elf_file_result.value()->LoadSymbols(thread_pool);
+}
+
+ErrorMessageOr<ModuleSymbols> SymbolHelper::LoadSymbols(const fs::path& symbols_path,
+                                                        const std::string& build_id,
+                                                        ThreadPool* thread_pool) const {
+  if (!build_id.empty()) {
+    auto symbols_result = LoadSymbolsFromSymbolsCache(symbols_path, build_id);
+    if (symbols_result) return symbols_result;
+    LOG("Loading symbols of \"%s\" from the symbols file: %s", symbols_path.string(),
+        symbols_result.error().message());
+  }
+
+  OUTCOME_TRY(module_symbols, LoadSymbolsFromFile(symbols_path, thread_pool));
+  if (!build_id.empty()) {
+    const auto add_result = AddSymbolsToSymbolsCache(build_id, module_symbols);
+    if (!add_result) {
+      ERROR("Adding symbols of \"%s\" to the symbols cache: %s", symbols_path.string(),
+            add_result.error().message());
+    }
+  }
+  return module_symbols;
+}
+
+ErrorMessageOr<ModuleSymbols> SymbolHelper::LoadSymbolsFromSymbolsCache(
+    const fs::path& symbols_path, const std::string& build_id) const {
+  ORBIT_SCOPE_FUNCTION;
+  const fs::path file_path = GenerateSymbolsCacheFileName(build_id);
+  SCOPED_TIMED_LOG("LoadSymbolsFromSymbolsCache: %s", file_path.string());
+  if (!fs::exists(file_path)) {
+    return ErrorMessage(
+        absl::StrFormat("Unable to find symbols in symbols cache for build id \"%s\"", build_id));
+  }
+  OUTCOME_TRY(symbols_file_stamp, GetSymbolsFileStamp(symbols_path));
+  OUTCOME_TRY(mapped_file, orbit_base::MappedFile::Open(file_path));
+  auto symbols_result = DecodeSymbolsCacheFile(mapped_file->data(), mapped_file->size(), build_id,
+                                               symbols_path, symbols_file_stamp);
+  if (!symbols_result) {
+    return ErrorMessage(absl::StrFormat("Unable to load symbols cache file \"%s\": %s",
+                                        file_path.string(), symbols_result.error().message()));
+  }
+  return symbols_result;
+}
+
+ErrorMessageOr<void> SymbolHelper::AddSymbolsToSymbolsCache(
+    const std::string& build_id, const ModuleSymbols& module_symbols) const {
+  ORBIT_SCOPE_FUNCTION;
+  OUTCOME_TRY(symbols_file_stamp, GetSymbolsFileStamp(module_symbols.symbols_file_path()));
+  const fs::path file_path = GenerateSymbolsCacheFileName(build_id);
+  // Written next to the final file and renamed, so that the cache never has a partial file. The
+  // name is unique so that concurrent loads of the same module don't write the same file.
+  std::random_device random_device;
+  fs::path temporary_file_path = file_path;
+  temporary_file_path += absl::StrFormat(".%08x%08x.tmp", random_device(), random_device());
+  {
+    std::ofstream file(temporary_file_path, std::ios::binary);
+    if (file.fail()) {
+      return ErrorMessage(
+          absl::StrFormat("Unable to open \"%s\" for writing", temporary_file_path.string()));
+    }
+    file << EncodeSymbolsCacheFile(build_id, module_symbols, symbols_file_stamp);
+    file.close();
+    if (file.fail()) {
+      std::error_code remove_error;
+      fs::remove(temporary_file_path, remove_error);
+      return ErrorMessage(absl::StrFormat("Unable to write \"%s\"", temporary_file_path.string()));
+    }
+  }
+
+  std::error_code error;
+  fs::rename(temporary_file_path, file_path, error);
+  if (error) {
+    std::error_code remove_error;
+    fs::remove(temporary_file_path, remove_error);
+    return ErrorMessage(absl::StrFormat("Unable to rename \"%s\" to \"%s\": %s",
+                                        temporary_file_path.string(), file_path.string(),
+                                        error.message()));
+  }
+  return outcome::success();
 }
 
 fs::path SymbolHelper::GenerateCachedFileName(const fs::path& file_path) const {
   auto file_name = absl::StrReplaceAll(file_path.string(), {{"/", "_"}});
   return cache_directory_ / file_name;
 }
+
+fs::path SymbolHelper::GenerateSymbolsCacheFileName(const std::string& build_id) const {
+  return cache_directory_ / absl::StrFormat("%s.symbols", build_id);
+}
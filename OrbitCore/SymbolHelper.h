@@ -10,6 +10,7 @@
 #include <vector>
 
 #include "OrbitBase/Result.h"
+#include "OrbitBase/ThreadPool.h"
 #include "symbol.pb.h"
 
 namespace fs = std::filesystem;
@@ -26,11 +27,24 @@ class SymbolHelper {
   [[nodiscard]] ErrorMessageOr<fs::path> FindSymbolsInCache(const fs::path& module_path,
                                                             const std::string& build_id) const;
   [[nodiscard]] static ErrorMessageOr<orbit_grpc_protos::ModuleSymbols> LoadSymbolsFromFile(
-      const fs::path& file_path);
+      const fs::path& file_path, ThreadPool* thread_pool = nullptr);
+  // Loads the symbols of the module with build_id from the symbols cache if they are there, else
+  // from the symbols file, in parallel on thread_pool, and then adds them to the symbols cache.
+  [[nodiscard]] ErrorMessageOr<orbit_grpc_protos::ModuleSymbols> LoadSymbols(
+      const fs::path& symbols_path, const std::string& build_id, ThreadPool* thread_pool) const;
   [[nodiscard]] static ErrorMessageOr<void> VerifySymbolsFile(const fs::path& symbols_path,
                                                               const std::string& build_id);
 
+  // The symbols cache has the symbols already loaded from symbols files, in a binary format mapped
+  // in memory to load them again without parsing the ELF file. Entries are keyed by build id, and
+  // only match the symbols file they were loaded from while its size and modification time stay.
+  [[nodiscard]] ErrorMessageOr<orbit_grpc_protos::ModuleSymbols> LoadSymbolsFromSymbolsCache(
+      const fs::path& symbols_path, const std::string& build_id) const;
+  [[nodiscard]] ErrorMessageOr<void> AddSymbolsToSymbolsCache(
+      const std::string& build_id, const orbit_grpc_protos::ModuleSymbols& module_symbols) const;
+
   [[nodiscard]] fs::path GenerateCachedFileName(const fs::path& file_path) const;
+  [[nodiscard]] fs::path GenerateSymbolsCacheFileName(const std::string& build_id) const;
 
  private:
   const std::vector<fs::path> symbols_file_directories_;
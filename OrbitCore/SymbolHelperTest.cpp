@@ -5,7 +5,9 @@
 #include <gmock/gmock-matchers.h>
 #include <gtest/gtest.h>
 
+#include <chrono>
 #include <memory>
+#include <string>
 
 #include "OrbitBase/ExecutablePath.h"
 #include "Path.h"
@@ -14,6 +16,7 @@
 #include "symbol.pb.h"
 
 using orbit_grpc_protos::ModuleSymbols;
+using orbit_grpc_protos::SymbolInfo;
 namespace fs = std::filesystem;
 
 const std::filesystem::path executable_directory = orbit_base::GetExecutableDir() / "testdata";
@@ -168,4 +171,104 @@ TEST(SymbolHelper, VerifySymbolsFile) {
     EXPECT_THAT(absl::AsciiStrToLower(result.error().message()),
                 testing::HasSubstr("unable to load elf file"));
   }
-}
\ No newline at end of file
+}
+
+TEST(SymbolHelper, SymbolsCache) {
+  const fs::path cache_directory = fs::temp_directory_path() / "SymbolHelperTestSymbolsCache";
+  fs::remove_all(cache_directory);
+  ASSERT_TRUE(fs::create_directory(cache_directory));
+  SymbolHelper symbol_helper({}, cache_directory);
+  const std::string build_id = "b5413574bbacec6eacb3b89b1012d0e2cd92ec6b";
+  // A copy, as the test changes its modification time.
+  const fs::path symbols_path = cache_directory / "no_symbols_elf.debug";
+  fs::copy_file(executable_directory / "no_symbols_elf.debug", symbols_path);
+
+  {
+    const auto result = symbol_helper.LoadSymbolsFromSymbolsCache(symbols_path, build_id);
+    ASSERT_FALSE(result);
+    EXPECT_THAT(absl::AsciiStrToLower(result.error().message()),
+                testing::HasSubstr("unable to find symbols in symbols cache"));
+  }
+
+  ModuleSymbols module_symbols;
+  module_symbols.set_load_bias(0x400000);
+  module_symbols.set_symbols_file_path(symbols_path.string());
+  SymbolInfo* symbol_info = module_symbols.add_symbol_infos();
+  symbol_info->set_name("_ZN3foo3barEv");
+  symbol_info->set_demangled_name("foo::bar()");
+  symbol_info->set_address(0x1140);
+  symbol_info->set_size(45);
+  symbol_info = module_symbols.add_symbol_infos();
+  symbol_info->set_name("main");
+  symbol_info->set_demangled_name("main");
+  symbol_info->set_address(0x1200);
+  symbol_info->set_size(12);
+
+  ASSERT_TRUE(symbol_helper.AddSymbolsToSymbolsCache(build_id, module_symbols));
+  {
+    const auto result = symbol_helper.LoadSymbolsFromSymbolsCache(symbols_path, build_id);
+    ASSERT_TRUE(result) << result.error().message();
+    EXPECT_EQ(result.value().SerializeAsString(), module_symbols.SerializeAsString());
+  }
+
+  {
+    // Another symbols file with the same build id
+    const auto result = symbol_helper.LoadSymbolsFromSymbolsCache(
+        executable_directory / "no_symbols_elf.debug", build_id);
+    ASSERT_FALSE(result);
+    EXPECT_THAT(absl::AsciiStrToLower(result.error().message()),
+                testing::HasSubstr("another symbols file"));
+  }
+
+  {
+    // The file of another build id
+    fs::copy_file(symbol_helper.GenerateSymbolsCacheFileName(build_id),
+                  symbol_helper.GenerateSymbolsCacheFileName("other"));
+    const auto result = symbol_helper.LoadSymbolsFromSymbolsCache(symbols_path, "other");
+    ASSERT_FALSE(result);
+    EXPECT_THAT(absl::AsciiStrToLower(result.error().message()),
+                testing::HasSubstr("different build id"));
+  }
+
+  {
+    // The symbols file changed
+    fs::last_write_time(symbols_path, fs::last_write_time(symbols_path) + std::chrono::seconds(1));
+    const auto result = symbol_helper.LoadSymbolsFromSymbolsCache(symbols_path, build_id);
+    ASSERT_FALSE(result);
+    EXPECT_THAT(absl::AsciiStrToLower(result.error().message()),
+                testing::HasSubstr("symbols file changed"));
+    ASSERT_TRUE(symbol_helper.AddSymbolsToSymbolsCache(build_id, module_symbols));
+  }
+
+  {
+    // Truncated file
+    const fs::path file_path = symbol_helper.GenerateSymbolsCacheFileName(build_id);
+    fs::resize_file(file_path, fs::file_size(file_path) - 1);
+    const auto result = symbol_helper.LoadSymbolsFromSymbolsCache(symbols_path, build_id);
+    ASSERT_FALSE(result);
+    EXPECT_THAT(absl::AsciiStrToLower(result.error().message()), testing::HasSubstr("truncated"));
+  }
+
+  fs::remove_all(cache_directory);
+}
+
+TEST(SymbolHelper, LoadSymbolsAddsThemToSymbolsCache) {
+  const fs::path cache_directory = fs::temp_directory_path() / "SymbolHelperTestLoadSymbols";
+  fs::remove_all(cache_directory);
+  ASSERT_TRUE(fs::create_directory(cache_directory));
+  SymbolHelper symbol_helper({}, cache_directory);
+  const std::string build_id = "b5413574bbacec6eacb3b89b1012d0e2cd92ec6b";
+  const fs::path file_path = executable_directory / "no_symbols_elf.debug";
+
+  const auto result = symbol_helper.LoadSymbols(file_path, build_id, nullptr);
+  ASSERT_TRUE(result) << result.error().message();
+  EXPECT_EQ(result.value().symbols_file_path(), file_path);
+  EXPECT_FALSE(result.value().symbol_infos().empty());
+
+  // Loading again only reads the symbols cache.
+  const auto cached_result = symbol_helper.LoadSymbolsFromSymbolsCache(file_path, build_id);
+  ASSERT_TRUE(cached_result) << cached_result.error().message();
+  EXPECT_EQ(cached_result.value().SerializeAsString(), result.value().SerializeAsString());
+
+  fs::remove_all(cache_directory);
+}
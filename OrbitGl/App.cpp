@@ -47,7 +47,6 @@
 #include "StringManager.h"
 #include "SymbolHelper.h"
 #include "Timer.h"
-#include "TimerInfosIterator.h"
 #include "capture_data.pb.h"
 #include "preset.pb.h"
 #include "symbol.pb.h"
@@ -111,6 +110,8 @@ OrbitApp::OrbitApp(ApplicationOptions&& options,
                    std::unique_ptr<MainThreadExecutor> main_thread_executor)
     : options_(std::move(options)), main_thread_executor_(std::move(main_thread_executor)) {
   thread_pool_ = ThreadPool::Create(4 /*min_size*/, 256 /*max_size*/, absl::Seconds(1));
+  live_sampling_data_post_processor_ = orbit_client_model::IncrementalSamplingDataPostProcessor(
+      /*generate_summary=*/true, thread_pool_.get());
   main_thread_id_ = std::this_thread::get_id();
   data_manager_ = std::make_unique<DataManager>(main_thread_id_);
   module_manager_ = std::make_unique<orbit_client_data::ModuleManager>();
@@ -127,6 +128,8 @@ void OrbitApp::OnCaptureStarted(ProcessData&& process,
                                 absl::flat_hash_map<uint64_t, FunctionInfo> selected_functions,
                                 TracepointInfoSet selected_tracepoints,
                                 UserDefinedCaptureData user_defined_capture_data) {
+  last_live_sampling_report_refresh_time_ = absl::Now();
+
   // We need to block until initialization is complete to
   // avoid races when capture thread start processing data.
   absl::Mutex mutex;
@@ -141,6 +144,7 @@ void OrbitApp::OnCaptureStarted(ProcessData&& process,
         const bool has_selected_functions = !selected_functions.empty();
 
         ClearCapture();
+        live_sampling_data_post_processor_.Reset();
 
         // It is safe to do this write on the main thread, as the capture thread is suspended until
         // this task is completely executed.
@@ -174,7 +178,9 @@ void OrbitApp::OnCaptureComplete() {
   GetMutableCaptureData().FilterBrokenCallstacks();
   PostProcessedSamplingData post_processed_sampling_data =
       orbit_client_model::CreatePostProcessedSamplingData(*GetCaptureData().GetCallstackData(),
-                                                          GetCaptureData());
+                                                          GetCaptureData(),
+                                                          /*generate_summary=*/true,
+                                                          thread_pool_.get());
   RefreshFrameTracks();
 
   main_thread_executor_->Schedule(
@@ -248,6 +254,14 @@ void OrbitApp::OnUniqueCallStack(CallStack callstack) {
 
 void OrbitApp::OnCallstackEvent(CallstackEvent callstack_event) {
   GetMutableCaptureData().AddCallstackEvent(std::move(callstack_event));
+
+  static constexpr absl::Duration kLiveSamplingReportRefreshInterval = absl::Seconds(1);
+  absl::Time now = absl::Now();
+  if (now - last_live_sampling_report_refresh_time_ < kLiveSamplingReportRefreshInterval) {
+    return;
+  }
+  last_live_sampling_report_refresh_time_ = now;
+  main_thread_executor_->Schedule([this] { RefreshSamplingReportDuringCapture(); });
 }
 
 void OrbitApp::OnThreadName(int32_t thread_id, std::string thread_name) {
@@ -571,6 +585,16 @@ void OrbitApp::NeedsRedraw() {
 void OrbitApp::SetSamplingReport(
     PostProcessedSamplingData post_processed_sampling_data,
     absl::flat_hash_map<CallstackID, std::shared_ptr<CallStack>> unique_callstacks) {
+  SetSamplingReport(
+      std::make_shared<const PostProcessedSamplingData>(std::move(post_processed_sampling_data)),
+      std::make_shared<const absl::flat_hash_map<CallstackID, std::shared_ptr<CallStack>>>(
+          std::move(unique_callstacks)));
+}
+
+void OrbitApp::SetSamplingReport(
+    std::shared_ptr<const PostProcessedSamplingData> post_processed_sampling_data,
+    std::shared_ptr<const absl::flat_hash_map<CallstackID, std::shared_ptr<CallStack>>>
+        unique_callstacks) {
   ORBIT_SCOPE_FUNCTION;
   // clear old sampling report
   if (sampling_report_ != nullptr) {
@@ -596,8 +620,11 @@ void OrbitApp::SetSelectionReport(
     selection_report_->ClearReport();
   }
 
-  auto report = std::make_shared<SamplingReport>(std::move(post_processed_sampling_data),
-                                                 std::move(unique_callstacks), has_summary);
+  auto report = std::make_shared<SamplingReport>(
+      std::make_shared<const PostProcessedSamplingData>(std::move(post_processed_sampling_data)),
+      std::make_shared<const absl::flat_hash_map<CallstackID, std::shared_ptr<CallStack>>>(
+          std::move(unique_callstacks)),
+      has_summary);
   DataView* callstack_data_view = GetOrCreateSelectionCallstackDataView();
 
   selection_report_ = report;
@@ -758,15 +785,27 @@ PresetLoadState OrbitApp::GetPresetLoadState(
 ErrorMessageOr<void> OrbitApp::OnSaveCapture(const std::string& file_name) {
   const auto& key_to_string_map = GCurrentTimeGraph->GetStringManager()->GetKeyToStringMap();
 
+  // Timers are encoded straight from the chains of the tracks, one chunk per section, on the
+  // thread pool. The sections keep the chains alive.
   std::vector<std::shared_ptr<TimerChain>> chains =
       GCurrentTimeGraph->GetAllSerializableTimerChains();
-
-  TimerInfosIterator timers_it_begin(chains.begin(), chains.end());
-  TimerInfosIterator timers_it_end(chains.end(), chains.end());
+  std::vector<capture_serializer::TimersSection> timers_sections;
+  for (const std::shared_ptr<TimerChain>& chain : chains) {
+    const uint64_t chain_size = chain->size();
+    for (uint64_t begin = 0; begin < chain_size;
+         begin += capture_serializer::internal::kTimersPerChunk) {
+      const uint64_t end =
+          std::min<uint64_t>(begin + capture_serializer::internal::kTimersPerChunk, chain_size);
+      timers_sections.emplace_back(
+          [chain, begin, end](capture_columns::TimerColumnsBuilder* builder) {
+            chain->AddToColumns(begin, end, builder);
+          });
+    }
+  }
   const CaptureData& capture_data = GetCaptureData();
 
-  return capture_serializer::Save(file_name, capture_data, key_to_string_map, timers_it_begin,
-                                  timers_it_end);
+  return capture_serializer::Save(file_name, capture_data, key_to_string_map,
+                                  std::move(timers_sections), thread_pool_.get());
 }
 
 void OrbitApp::OnLoadCapture(const std::string& file_name) {
@@ -780,7 +819,7 @@ void OrbitApp::OnLoadCapture(const std::string& file_name) {
   thread_pool_->Schedule([this, file_name]() mutable {
     capture_loading_cancellation_requested_ = false;
     capture_deserializer::Load(file_name, this, module_manager_.get(),
-                               &capture_loading_cancellation_requested_);
+                               &capture_loading_cancellation_requested_, thread_pool_.get());
   });
 
   DoZoom = true;  // TODO: remove global, review logic
@@ -1114,7 +1153,8 @@ void OrbitApp::LoadSymbols(const std::filesystem::path& symbols_path, ModuleData
                           function_hashes_to_hook = std::move(function_hashes_to_hook),
                           frame_track_function_hashes =
                               std::move(frame_track_function_hashes)]() mutable {
-    auto symbols_result = SymbolHelper::LoadSymbolsFromFile(symbols_path);
+    auto symbols_result =
+        symbol_helper_.LoadSymbols(symbols_path, module_data->build_id(), thread_pool_.get());
     CHECK(symbols_result);
     module_data->AddSymbols(symbols_result.value());
 
@@ -1470,7 +1510,8 @@ void OrbitApp::SelectCallstackEvents(const std::vector<CallstackEvent>& selected
   bool generate_summary = thread_id == orbit_base::kAllProcessThreadsTid;
   PostProcessedSamplingData processed_sampling_data =
       orbit_client_model::CreatePostProcessedSamplingData(
-          *GetCaptureData().GetSelectionCallstackData(), GetCaptureData(), generate_summary);
+          *GetCaptureData().GetSelectionCallstackData(), GetCaptureData(), generate_summary,
+          thread_pool_.get());
 
   SetSelectionTopDownView(processed_sampling_data, GetCaptureData());
   SetSelectionBottomUpView(processed_sampling_data, GetCaptureData());
@@ -1485,13 +1526,19 @@ void OrbitApp::UpdateAfterSymbolLoading() {
     return;
   }
   const CaptureData& capture_data = GetCaptureData();
+  // The new symbols change how addresses are resolved to functions.
+  live_sampling_data_post_processor_.Reset();
 
   if (sampling_report_ != nullptr) {
     PostProcessedSamplingData post_processed_sampling_data =
         orbit_client_model::CreatePostProcessedSamplingData(*capture_data.GetCallstackData(),
-                                                            capture_data);
-    sampling_report_->UpdateReport(post_processed_sampling_data,
-                                   capture_data.GetCallstackData()->GetUniqueCallstacksCopy());
+                                                            capture_data,
+                                                            /*generate_summary=*/true,
+                                                            thread_pool_.get());
+    sampling_report_->UpdateReport(
+        std::make_shared<const PostProcessedSamplingData>(post_processed_sampling_data),
+        std::make_shared<const absl::flat_hash_map<CallstackID, std::shared_ptr<CallStack>>>(
+            capture_data.GetCallstackData()->GetUniqueCallstacksCopy()));
     GetMutableCaptureData().set_post_processed_sampling_data(post_processed_sampling_data);
     SetTopDownView(capture_data);
     SetBottomUpView(capture_data);
@@ -1504,13 +1551,42 @@ void OrbitApp::UpdateAfterSymbolLoading() {
   PostProcessedSamplingData selection_post_processed_sampling_data =
       orbit_client_model::CreatePostProcessedSamplingData(*capture_data.GetSelectionCallstackData(),
                                                           capture_data,
-                                                          selection_report_->has_summary());
+                                                          selection_report_->has_summary(),
+                                                          thread_pool_.get());
 
   SetSelectionTopDownView(selection_post_processed_sampling_data, capture_data);
   SetSelectionBottomUpView(selection_post_processed_sampling_data, capture_data);
   selection_report_->UpdateReport(
-      std::move(selection_post_processed_sampling_data),
-      capture_data.GetSelectionCallstackData()->GetUniqueCallstacksCopy());
+      std::make_shared<const PostProcessedSamplingData>(
+          std::move(selection_post_processed_sampling_data)),
+      std::make_shared<const absl::flat_hash_map<CallstackID, std::shared_ptr<CallStack>>>(
+          capture_data.GetSelectionCallstackData()->GetUniqueCallstacksCopy()));
+}
+
+void OrbitApp::RefreshSamplingReportDuringCapture() {
+  ORBIT_SCOPE_FUNCTION;
+  // Refreshes scheduled by the capture thread are executed before the task scheduled by
+  // OnCaptureComplete, which sets the final sampling report.
+  if (!IsCapturing() || !HasCaptureData()) {
+    return;
+  }
+  const CaptureData& capture_data = GetCaptureData();
+
+  // The report shares the data of the post-processor, which updates it in place, so refreshing
+  // doesn't copy the data of all the samples.
+  std::shared_ptr<const PostProcessedSamplingData> post_processed_sampling_data =
+      live_sampling_data_post_processor_.Update(*capture_data.GetCallstackData(), capture_data);
+  // SamplingReport::UpdateReport only updates the existing per-thread tabs, so the report is
+  // recreated when samples of new threads arrive.
+  const size_t thread_count = post_processed_sampling_data->GetThreadSampleData().size();
+  if (sampling_report_ != nullptr && sampling_report_->GetThreadReports().size() == thread_count) {
+    sampling_report_->UpdateReport(std::move(post_processed_sampling_data),
+                                   live_sampling_data_post_processor_.GetUniqueCallstacks());
+  } else {
+    SetSamplingReport(std::move(post_processed_sampling_data),
+                      live_sampling_data_post_processor_.GetUniqueCallstacks());
+  }
+  FireRefreshCallbacks();
 }
 
 void OrbitApp::UpdateAfterCaptureCleared() {
@@ -1712,9 +1788,8 @@ void OrbitApp::AddFrameTrackTimers(const FunctionInfo& function) {
     if (!chain) continue;
     for (const TimerBlock& block : *chain) {
       for (uint64_t i = 0; i < block.size(); ++i) {
-        const TextBox& box = block[i];
-        if (box.GetTimerInfo().function_address() == function_address) {
-          all_start_times.push_back(box.GetTimerInfo().start());
+        if (block.GetFunctionAddress(i) == function_address) {
+          all_start_times.push_back(block.GetStart(i));
         }
       }
     }
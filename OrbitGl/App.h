@@ -42,6 +42,7 @@
 #include "OrbitClientData/PostProcessedSamplingData.h"
 #include "OrbitClientData/ProcessData.h"
 #include "OrbitClientData/TracepointCustom.h"
+#include "OrbitClientModel/SamplingDataPostProcessor.h"
 #include "OrbitClientServices/CrashManager.h"
 #include "OrbitClientServices/ProcessManager.h"
 #include "OrbitClientServices/TracepointServiceClient.h"
@@ -58,6 +59,7 @@
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/flags/flag.h"
+#include "absl/time/time.h"
 #include "capture_data.pb.h"
 #include "grpcpp/grpcpp.h"
 #include "preset.pb.h"
@@ -146,6 +148,10 @@ class OrbitApp final : public DataViewFactory, public CaptureListener {
   void SetSamplingReport(
       PostProcessedSamplingData post_processed_sampling_data,
       absl::flat_hash_map<CallstackID, std::shared_ptr<CallStack>> unique_callstacks);
+  void SetSamplingReport(
+      std::shared_ptr<const PostProcessedSamplingData> post_processed_sampling_data,
+      std::shared_ptr<const absl::flat_hash_map<CallstackID, std::shared_ptr<CallStack>>>
+          unique_callstacks);
   void SetSelectionReport(
       PostProcessedSamplingData post_processed_sampling_data,
       absl::flat_hash_map<CallstackID, std::shared_ptr<CallStack>> unique_callstacks,
@@ -292,6 +298,7 @@ class OrbitApp final : public DataViewFactory, public CaptureListener {
   void UpdateProcessAndModuleList(int32_t pid);
 
   void UpdateAfterSymbolLoading();
+  void RefreshSamplingReportDuringCapture();
   void UpdateAfterCaptureCleared();
 
   void LoadPreset(const std::shared_ptr<orbit_client_protos::PresetFile>& preset);
@@ -477,6 +484,12 @@ class OrbitApp final : public DataViewFactory, public CaptureListener {
   std::optional<CaptureData> capture_data_;
 
   FrameTrackOnlineProcessor frame_track_online_processor_;
+
+  // The sampling report is refreshed periodically during a capture, post-processing only the
+  // callstack events received since the previous refresh. The post-processor is only accessed on
+  // the main thread, the time of the last refresh only on the capture thread.
+  orbit_client_model::IncrementalSamplingDataPostProcessor live_sampling_data_post_processor_;
+  absl::Time last_live_sampling_report_refresh_time_;
 };
 
 extern std::unique_ptr<OrbitApp> GOrbitApp;
@@ -20,7 +20,7 @@ AsyncTrack::AsyncTrack(TimeGraph* time_graph, const std::string& name) : TimerTr
 }
 
 [[nodiscard]] std::string AsyncTrack::GetBoxTooltip(PickingId id) const {
-  const TextBox* text_box = time_graph_->GetBatcher().GetTextBox(id);
+  const TextBox* text_box = time_graph_->GetBatcher().GetTemporaryTextBox(id);
   if (text_box == nullptr) return "";
   auto* manual_inst_manager = GOrbitApp->GetManualInstrumentationManager();
   TimerInfo timer_info = text_box->GetTimerInfo();
@@ -76,26 +76,13 @@ void AsyncTrack::OnTimer(const orbit_client_protos::TimerInfo& timer_info) {
 }
 
 void AsyncTrack::SetTimesliceText(const TimerInfo& timer_info, double elapsed_us, float min_x,
-                                  float z_offset, TextBox* text_box) {
-  TimeGraphLayout layout = time_graph_->GetLayout();
+                                  float z_offset, const Vec2& pos, const Vec2& size) {
   std::string time = GetPrettyTime(absl::Microseconds(elapsed_us));
-  text_box->SetElapsedTimeTextLength(time.length());
-
   orbit_api::Event event = ManualInstrumentationManager::ApiEventFromTimerInfo(timer_info);
   const uint64_t event_id = event.data;
   std::string name = GOrbitApp->GetManualInstrumentationManager()->GetString(event_id);
   std::string text = absl::StrFormat("%s %s", name, time.c_str());
-  text_box->SetText(text);
-
-  const Color kTextWhite(255, 255, 255, 255);
-  const Vec2& box_pos = text_box->GetPos();
-  const Vec2& box_size = text_box->GetSize();
-  float pos_x = std::max(box_pos[0], min_x);
-  float max_size = box_pos[0] + box_size[0] - pos_x;
-  text_renderer_->AddTextTrailingCharsPrioritized(
-      text_box->GetText().c_str(), pos_x, text_box->GetPos()[1] + layout.GetTextOffset(),
-      GlCanvas::kZValueBox + z_offset, kTextWhite, text_box->GetElapsedTimeTextLength(),
-      time_graph_->CalculateZoomedFontSize(), max_size);
+  DrawTimesliceText(text, time.length(), min_x, z_offset, pos, size);
 }
 
 Color AsyncTrack::GetTimerColor(const TimerInfo& timer_info, bool is_selected) const {
@@ -6,42 +6,42 @@
 
 #include <math.h>
 
+#include <array>
+
 #include "CoreUtils.h"
 #include "OpenGl.h"
 #include "OrbitBase/Tracing.h"
+#include "TimerChain.h"
+#include "absl/base/casts.h"
 
 void Batcher::AddLine(Vec2 from, Vec2 to, float z, const Color& color,
-                      std::unique_ptr<PickingUserData> user_data) {
+                      const PickingUserData& user_data) {
   Color picking_color = PickingId::ToColor(PickingType::kLine, user_data_.size(), batcher_id_);
 
-  AddLine(from, to, z, color, picking_color, std::move(user_data));
+  AddLine(from, to, z, color, picking_color, user_data);
 }
 
 void Batcher::AddLine(Vec2 from, Vec2 to, float z, const Color& color,
                       std::shared_ptr<Pickable> pickable) {
-  CHECK(picking_manager_ != nullptr);
-
-  Color picking_color = picking_manager_->GetPickableColor(pickable, batcher_id_);
+  Color picking_color = GetPickableColor(std::move(pickable));
 
-  AddLine(from, to, z, color, picking_color, nullptr);
+  AddLine(from, to, z, color, picking_color);
 }
 
 void Batcher::AddVerticalLine(Vec2 pos, float size, float z, const Color& color,
-                              std::unique_ptr<PickingUserData> user_data) {
-  AddLine(pos, pos + Vec2(0, size), z, color, std::move(user_data));
+                              const PickingUserData& user_data) {
+  AddLine(pos, pos + Vec2(0, size), z, color, user_data);
 }
 
 void Batcher::AddVerticalLine(Vec2 pos, float size, float z, const Color& color,
                               std::shared_ptr<Pickable> pickable) {
-  CHECK(picking_manager_ != nullptr);
-
-  Color picking_color = picking_manager_->GetPickableColor(pickable, batcher_id_);
+  Color picking_color = GetPickableColor(std::move(pickable));
 
-  AddLine(pos, pos + Vec2(0, size), z, color, picking_color, nullptr);
+  AddLine(pos, pos + Vec2(0, size), z, color, picking_color);
 }
 
 void Batcher::AddLine(Vec2 from, Vec2 to, float z, const Color& color, const Color& picking_color,
-                      std::unique_ptr<PickingUserData> user_data) {
+                      const PickingUserData& user_data) {
   Line line;
   line.start_point = Vec3(floorf(from[0]), floorf(from[1]), z);
   line.end_point = Vec3(floorf(to[0]), floorf(to[1]), z);
@@ -50,49 +50,48 @@ void Batcher::AddLine(Vec2 from, Vec2 to, float z, const Color& color, const Col
   buffer.line_buffer.lines_.push_back(line);
   buffer.line_buffer.colors_.push_back_n(color, 2);
   buffer.line_buffer.picking_colors_.push_back_n(picking_color, 2);
-  user_data_.push_back(std::move(user_data));
+  AddUserData(user_data);
+  ++version_;
 }
 
 void Batcher::AddBox(const Box& box, const std::array<Color, 4>& colors,
-                     std::unique_ptr<PickingUserData> user_data) {
+                     const PickingUserData& user_data) {
   Color picking_color = PickingId::ToColor(PickingType::kBox, user_data_.size(), batcher_id_);
-  AddBox(box, colors, picking_color, std::move(user_data));
+  AddBox(box, colors, picking_color, user_data);
 }
 
 void Batcher::AddBox(const Box& box, const Color& color,
-                     std::unique_ptr<PickingUserData> user_data) {
+                     const PickingUserData& user_data) {
   std::array<Color, 4> colors;
   Fill(colors, color);
-  AddBox(box, colors, std::move(user_data));
+  AddBox(box, colors, user_data);
 }
 
 void Batcher::AddBox(const Box& box, const Color& color, std::shared_ptr<Pickable> pickable) {
-  CHECK(picking_manager_ != nullptr);
-
-  Color picking_color = picking_manager_->GetPickableColor(pickable, batcher_id_);
+  Color picking_color = GetPickableColor(std::move(pickable));
   std::array<Color, 4> colors;
   Fill(colors, color);
 
-  AddBox(box, colors, picking_color, nullptr);
+  AddBox(box, colors, picking_color);
 }
 
 void Batcher::AddShadedBox(Vec2 pos, Vec2 size, float z, const Color& color) {
-  AddShadedBox(pos, size, z, color, std::unique_ptr<PickingUserData>(),
+  AddShadedBox(pos, size, z, color, PickingUserData{},
                ShadingDirection::kLeftToRight);
 }
 
 void Batcher::AddShadedBox(Vec2 pos, Vec2 size, float z, const Color& color,
                            ShadingDirection shading_direction) {
-  AddShadedBox(pos, size, z, color, std::unique_ptr<PickingUserData>(), shading_direction);
+  AddShadedBox(pos, size, z, color, PickingUserData{}, shading_direction);
 }
 
 void Batcher::AddShadedBox(Vec2 pos, Vec2 size, float z, const Color& color,
-                           std::unique_ptr<PickingUserData> user_data,
+                           const PickingUserData& user_data,
                            ShadingDirection shading_direction) {
   std::array<Color, 4> colors;
   GetBoxGradientColors(color, &colors, shading_direction);
   Box box(pos, size, z);
-  AddBox(box, colors, std::move(user_data));
+  AddBox(box, colors, user_data);
 }
 
 static std::vector<Triangle> GetUnitArcTriangles(float angle_0, float angle_1, uint32_t num_sides) {
@@ -178,44 +177,58 @@ void Batcher::AddShadedBox(Vec2 pos, Vec2 size, float z, const Color& color,
                            std::shared_ptr<Pickable> pickable, ShadingDirection shading_direction) {
   std::array<Color, 4> colors;
   GetBoxGradientColors(color, &colors, shading_direction);
-  Color picking_color = picking_manager_->GetPickableColor(pickable, batcher_id_);
+  Color picking_color = GetPickableColor(std::move(pickable));
   Box box(pos, size, z);
-  AddBox(box, colors, picking_color, nullptr);
+  AddBox(box, colors, picking_color);
 }
 
-void Batcher::AddBox(const Box& box, const std::array<Color, 4>& colors, const Color& picking_color,
-                     std::unique_ptr<PickingUserData> user_data) {
+static Box RoundBox(const Box& box) {
   Box rounded_box = box;
   for (size_t v = 0; v < 4; ++v) {
     rounded_box.vertices[v][0] = floorf(rounded_box.vertices[v][0]);
     rounded_box.vertices[v][1] = floorf(rounded_box.vertices[v][1]);
   }
+  return rounded_box;
+}
+
+void Batcher::AddPickingBox(const Box& box, const PickingUserData& user_data) {
+  Color picking_color = PickingId::ToColor(PickingType::kBox, user_data_.size(), batcher_id_);
+  Box rounded_box = RoundBox(box);
+  auto& buffer = primitive_buffers_by_layer_[rounded_box.vertices[0][2]];
+  buffer.picking_box_buffer.boxes_.push_back(rounded_box);
+  buffer.picking_box_buffer.picking_colors_.push_back_n(picking_color, 4);
+  AddUserData(user_data);
+  ++version_;
+}
+
+void Batcher::AddBox(const Box& box, const std::array<Color, 4>& colors, const Color& picking_color,
+                     const PickingUserData& user_data) {
+  Box rounded_box = RoundBox(box);
   float layer_z_value = rounded_box.vertices[0][2];
   auto& buffer = primitive_buffers_by_layer_[layer_z_value];
   buffer.box_buffer.boxes_.push_back(rounded_box);
   buffer.box_buffer.colors_.push_back(colors);
   buffer.box_buffer.picking_colors_.push_back_n(picking_color, 4);
-  user_data_.push_back(std::move(user_data));
+  AddUserData(user_data);
+  ++version_;
 }
 
 void Batcher::AddTriangle(const Triangle& triangle, const Color& color,
-                          std::unique_ptr<PickingUserData> user_data) {
+                          const PickingUserData& user_data) {
   Color picking_color = PickingId::ToColor(PickingType::kTriangle, user_data_.size(), batcher_id_);
 
-  AddTriangle(triangle, color, picking_color, std::move(user_data));
+  AddTriangle(triangle, color, picking_color, user_data);
 }
 
 void Batcher::AddTriangle(const Triangle& triangle, const Color& color,
                           std::shared_ptr<Pickable> pickable) {
-  CHECK(picking_manager_ != nullptr);
-
-  Color picking_color = picking_manager_->GetPickableColor(pickable, batcher_id_);
+  Color picking_color = GetPickableColor(std::move(pickable));
 
-  AddTriangle(triangle, color, picking_color, nullptr);
+  AddTriangle(triangle, color, picking_color);
 }
 
 void Batcher::AddTriangle(const Triangle& triangle, const Color& color, const Color& picking_color,
-                          std::unique_ptr<PickingUserData> user_data) {
+                          const PickingUserData& user_data) {
   Triangle rounded_tri = triangle;
   for (size_t v = 0; v < 3; ++v) {
     rounded_tri.vertices[v][0] = floorf(rounded_tri.vertices[v][0]);
@@ -226,7 +239,8 @@ void Batcher::AddTriangle(const Triangle& triangle, const Color& color, const Co
   buffer.triangle_buffer.triangles_.push_back(rounded_tri);
   buffer.triangle_buffer.colors_.push_back_n(color, 3);
   buffer.triangle_buffer.picking_colors_.push_back_n(picking_color, 3);
-  user_data_.push_back(std::move(user_data));
+  AddUserData(user_data);
+  ++version_;
 }
 
 void Batcher::AddCircle(Vec2 position, float radius, float z, Color color) {
@@ -259,7 +273,7 @@ const PickingUserData* Batcher::GetUserData(PickingId id) const {
     case PickingType::kTriangle:
     case PickingType::kLine:
       CHECK(id.element_id < user_data_.size());
-      return user_data_[id.element_id].get();
+      return &user_data_[id.element_id];
     case PickingType::kPickable:
       return nullptr;
   }
@@ -274,13 +288,92 @@ PickingUserData* Batcher::GetUserData(PickingId id) {
 const TextBox* Batcher::GetTextBox(PickingId id) {
   PickingUserData* data = GetUserData(id);
 
-  if (data && data->text_box_) {
-    return data->text_box_;
+  if (data && data->timer_chain_) {
+    return data->timer_chain_->GetTextBox(data->timer_index_);
+  }
+
+  return nullptr;
+}
+
+const TextBox* Batcher::GetTemporaryTextBox(PickingId id) {
+  PickingUserData* data = GetUserData(id);
+
+  if (data && data->timer_chain_) {
+    return data->timer_chain_->GetTemporaryTextBox(data->timer_index_);
   }
 
   return nullptr;
 }
 
+namespace {
+
+// Copies all elements of block_chain into the vertex buffer object *buffer_id, which is created
+// if it doesn't exist yet.
+template <class T, uint32_t BlockSize>
+void UploadToBuffer(const BlockChain<T, BlockSize>& block_chain, uint32_t* buffer_id) {
+  if (*buffer_id == 0) glGenBuffers(1, buffer_id);
+  glBindBuffer(GL_ARRAY_BUFFER, *buffer_id);
+  glBufferData(GL_ARRAY_BUFFER, block_chain.size() * sizeof(T), nullptr, GL_STATIC_DRAW);
+  size_t offset = 0;
+  for (const Block<T, BlockSize>* block = block_chain.root(); block != nullptr;
+       block = block->next()) {
+    if (block->size() == 0) break;
+    glBufferSubData(GL_ARRAY_BUFFER, offset, block->size() * sizeof(T), block->data());
+    offset += block->size() * sizeof(T);
+  }
+}
+
+}  // namespace
+
+void Batcher::DrawRetainedLayer(float layer, bool picking) const {
+  const PrimitiveBuffers& buffers = primitive_buffers_by_layer_.at(layer);
+  RetainedLayer& retained_layer = retained_layers_[layer];
+
+  if (retained_layer.version != version_) {
+    ORBIT_SCOPE("Upload retained layer");
+    UploadToBuffer(buffers.box_buffer.boxes_, &retained_layer.boxes.vertices);
+    UploadToBuffer(buffers.box_buffer.colors_, &retained_layer.boxes.colors);
+    retained_layer.boxes.vertex_count = buffers.box_buffer.boxes_.size() * 4;
+    UploadToBuffer(buffers.line_buffer.lines_, &retained_layer.lines.vertices);
+    UploadToBuffer(buffers.line_buffer.colors_, &retained_layer.lines.colors);
+    retained_layer.lines.vertex_count = buffers.line_buffer.lines_.size() * 2;
+    UploadToBuffer(buffers.triangle_buffer.triangles_, &retained_layer.triangles.vertices);
+    UploadToBuffer(buffers.triangle_buffer.colors_, &retained_layer.triangles.colors);
+    retained_layer.triangles.vertex_count = buffers.triangle_buffer.triangles_.size() * 3;
+    retained_layer.version = version_;
+  }
+
+  // Picking colors and boxes are only needed for picking, which is rare compared to drawing.
+  if (picking && retained_layer.picking_version != version_) {
+    ORBIT_SCOPE("Upload retained picking buffers");
+    UploadToBuffer(buffers.box_buffer.picking_colors_, &retained_layer.boxes.picking_colors);
+    UploadToBuffer(buffers.line_buffer.picking_colors_, &retained_layer.lines.picking_colors);
+    UploadToBuffer(buffers.triangle_buffer.picking_colors_,
+                   &retained_layer.triangles.picking_colors);
+    UploadToBuffer(buffers.picking_box_buffer.boxes_, &retained_layer.picking_boxes.vertices);
+    UploadToBuffer(buffers.picking_box_buffer.picking_colors_,
+                   &retained_layer.picking_boxes.picking_colors);
+    retained_layer.picking_boxes.vertex_count = buffers.picking_box_buffer.boxes_.size() * 4;
+    retained_layer.picking_version = version_;
+  }
+
+  DrawRetainedBuffer(retained_layer.boxes, GL_QUADS, picking);
+  DrawRetainedBuffer(retained_layer.lines, GL_LINES, picking);
+  DrawRetainedBuffer(retained_layer.triangles, GL_TRIANGLES, picking);
+  if (picking) DrawRetainedBuffer(retained_layer.picking_boxes, GL_QUADS, picking);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void Batcher::DrawRetainedBuffer(const RetainedBuffer& buffer, uint32_t mode, bool picking) const {
+  if (buffer.vertex_count == 0) return;
+  glBindBuffer(GL_ARRAY_BUFFER, buffer.vertices);
+  glVertexPointer(3, GL_FLOAT, sizeof(Vec3), nullptr);
+  glBindBuffer(GL_ARRAY_BUFFER, picking ? buffer.picking_colors : buffer.colors);
+  glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(Color), nullptr);
+  glDrawArrays(mode, 0, buffer.vertex_count);
+  ++draw_call_count_;
+}
+
 void Batcher::GetBoxGradientColors(const Color& color, std::array<Color, 4>* colors,
                                    ShadingDirection shading_direction) {
   const float kGradientCoeff = 0.94f;
@@ -316,15 +409,131 @@ void Batcher::GetBoxGradientColors(const Color& color, std::array<Color, 4>* col
   }
 }
 
+Color Batcher::GetPickableColor(std::shared_ptr<Pickable> pickable) {
+  if (is_segment_) {
+    auto index = static_cast<uint32_t>(segment_pickables_.size());
+    segment_pickables_.push_back(std::move(pickable));
+    return PickingId::ToColor(PickingType::kPickable, index, batcher_id_);
+  }
+
+  CHECK(picking_manager_ != nullptr);
+  return picking_manager_->GetPickableColor(pickable, batcher_id_);
+}
+
+Batcher::~Batcher() {
+  for (auto& [unused_layer, retained_layer] : retained_layers_) {
+    for (RetainedBuffer* buffer :
+         {&retained_layer.lines, &retained_layer.boxes, &retained_layer.triangles,
+          &retained_layer.picking_boxes}) {
+      for (uint32_t* id : {&buffer->vertices, &buffer->colors, &buffer->picking_colors}) {
+        if (*id != 0) glDeleteBuffers(1, id);
+      }
+    }
+  }
+}
+
+void Batcher::AddUserData(const PickingUserData& user_data) {
+  if (user_data_.size() == user_data_.capacity()) ++user_data_allocation_count_;
+  user_data_.push_back(user_data);
+}
+
+std::unique_ptr<Batcher> Batcher::CreateSegment(BatcherId batcher_id) {
+  auto segment = std::make_unique<Batcher>(batcher_id);
+  segment->is_segment_ = true;
+  return segment;
+}
+
+namespace {
+
+template <class T, uint32_t BlockSize>
+void Append(const BlockChain<T, BlockSize>& source, BlockChain<T, BlockSize>* target) {
+  for (const T& element : source) {
+    target->push_back(element);
+  }
+}
+
+template <uint32_t BlockSize, typename Remap>
+void AppendRemapped(const BlockChain<Color, BlockSize>& source,
+                    BlockChain<Color, BlockSize>* target, Remap&& remap) {
+  for (const Color& color : source) {
+    target->push_back(remap(color));
+  }
+}
+
+}  // namespace
+
+void Batcher::MergeFrom(Batcher* other) {
+  CHECK(other->batcher_id_ == batcher_id_);
+
+  // Assign ids to the pickables of a segment in the order they were added.
+  std::vector<Color> pickable_colors;
+  pickable_colors.reserve(other->segment_pickables_.size());
+  for (std::shared_ptr<Pickable>& pickable : other->segment_pickables_) {
+    pickable_colors.push_back(GetPickableColor(std::move(pickable)));
+  }
+
+  // The element ids of primitives with user data are their index in user_data_.
+  auto element_id_offset = static_cast<uint32_t>(user_data_.size());
+  auto remap = [&](const Color& color) -> Color {
+    std::array<uint8_t, 4> color_values{color[0], color[1], color[2], color[3]};
+    PickingId id = PickingId::FromPixelValue(absl::bit_cast<uint32_t>(color_values));
+    switch (id.type) {
+      case PickingType::kLine:
+      case PickingType::kBox:
+      case PickingType::kTriangle:
+        return PickingId::ToColor(id.type, id.element_id + element_id_offset, batcher_id_);
+      case PickingType::kPickable:
+        return other->is_segment_ ? pickable_colors[id.element_id] : color;
+      case PickingType::kInvalid:
+        return color;
+    }
+    UNREACHABLE();
+  };
+
+  for (auto& [layer, source] : other->primitive_buffers_by_layer_) {
+    if (source.line_buffer.lines_.size() == 0 && source.box_buffer.boxes_.size() == 0 &&
+        source.triangle_buffer.triangles_.size() == 0 &&
+        source.picking_box_buffer.boxes_.size() == 0) {
+      continue;
+    }
+    PrimitiveBuffers& target = primitive_buffers_by_layer_[layer];
+
+    Append(source.line_buffer.lines_, &target.line_buffer.lines_);
+    Append(source.line_buffer.colors_, &target.line_buffer.colors_);
+    AppendRemapped(source.line_buffer.picking_colors_, &target.line_buffer.picking_colors_, remap);
+
+    Append(source.box_buffer.boxes_, &target.box_buffer.boxes_);
+    Append(source.box_buffer.colors_, &target.box_buffer.colors_);
+    AppendRemapped(source.box_buffer.picking_colors_, &target.box_buffer.picking_colors_, remap);
+
+    Append(source.triangle_buffer.triangles_, &target.triangle_buffer.triangles_);
+    Append(source.triangle_buffer.colors_, &target.triangle_buffer.colors_);
+    AppendRemapped(source.triangle_buffer.picking_colors_,
+                   &target.triangle_buffer.picking_colors_, remap);
+
+    Append(source.picking_box_buffer.boxes_, &target.picking_box_buffer.boxes_);
+    AppendRemapped(source.picking_box_buffer.picking_colors_,
+                   &target.picking_box_buffer.picking_colors_, remap);
+  }
+
+  for (const PickingUserData& user_data : other->user_data_) {
+    AddUserData(user_data);
+  }
+  ++version_;
+  other->StartNewFrame();
+}
+
 void Batcher::ResetElements() {
   for (auto& [unused_layer, buffer] : primitive_buffers_by_layer_) {
     buffer.Reset();
   }
+  ++version_;
 }
 
 void Batcher::StartNewFrame() {
   ResetElements();
   user_data_.clear();
+  segment_pickables_.clear();
 }
 
 std::vector<float> Batcher::GetLayers() const {
@@ -350,9 +559,15 @@ void Batcher::DrawLayer(float layer, bool picking) const {
   glEnableClientState(GL_COLOR_ARRAY);
   glEnable(GL_TEXTURE_2D);
 
-  DrawBoxBuffer(layer, picking);
-  DrawLineBuffer(layer, picking);
-  DrawTriangleBuffer(layer, picking);
+  if (retained_) {
+    DrawRetainedLayer(layer, picking);
+  } else {
+    const PrimitiveBuffers& buffers = primitive_buffers_by_layer_.at(layer);
+    DrawBoxBuffer(buffers.box_buffer, picking);
+    DrawLineBuffer(layer, picking);
+    DrawTriangleBuffer(layer, picking);
+    if (picking) DrawBoxBuffer(buffers.picking_box_buffer, picking);
+  }
 
   glDisableClientState(GL_COLOR_ARRAY);
   glDisableClientState(GL_VERTEX_ARRAY);
@@ -365,8 +580,7 @@ void Batcher::Draw(bool picking) const {
   }
 }
 
-void Batcher::DrawBoxBuffer(float layer, bool picking) const {
-  auto& box_buffer = primitive_buffers_by_layer_.at(layer).box_buffer;
+void Batcher::DrawBoxBuffer(const BoxBuffer& box_buffer, bool picking) const {
   const Block<Box, BoxBuffer::NUM_BOXES_PER_BLOCK>* box_block = box_buffer.boxes_.root();
   const Block<Color, BoxBuffer::NUM_BOXES_PER_BLOCK * 4>* color_block;
 
@@ -377,6 +591,7 @@ void Batcher::DrawBoxBuffer(float layer, bool picking) const {
       glVertexPointer(3, GL_FLOAT, sizeof(Vec3), box_block->data());
       glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(Color), color_block->data());
       glDrawArrays(GL_QUADS, 0, num_elems * 4);
+      ++draw_call_count_;
     }
 
     box_block = box_block->next();
@@ -396,6 +611,7 @@ void Batcher::DrawLineBuffer(float layer, bool picking) const {
       glVertexPointer(3, GL_FLOAT, sizeof(Vec3), line_block->data());
       glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(Color), color_block->data());
       glDrawArrays(GL_LINES, 0, num_elems * 2);
+      ++draw_call_count_;
     }
 
     line_block = line_block->next();
@@ -416,6 +632,7 @@ void Batcher::DrawTriangleBuffer(float layer, bool picking) const {
       glVertexPointer(3, GL_FLOAT, sizeof(Vec3), triangle_block->data());
       glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(Color), color_block->data());
       glDrawArrays(GL_TRIANGLES, 0, num_elems * 3);
+      ++draw_call_count_;
     }
 
     triangle_block = triangle_block->next();
@@ -13,15 +13,18 @@
 #include "PickingManager.h"
 #include "TextBox.h"
 
-using TooltipCallback = std::function<std::string(PickingId)>;
+class TimerChain;
+class Track;
 
+// Picking data of a primitive, stored by value in a flat array indexed by the element id of the
+// primitive's PickingId. Tooltips are only generated for the hovered primitive, by the track that
+// added it.
 struct PickingUserData {
-  TextBox* text_box_;
-  TooltipCallback generate_tooltip_;
+  const Track* track_ = nullptr;
   const void* custom_data_ = nullptr;
-
-  explicit PickingUserData(TextBox* text_box = nullptr, TooltipCallback generate_tooltip = nullptr)
-      : text_box_(text_box), generate_tooltip_(std::move(generate_tooltip)) {}
+  // The timer of a TimerChain, whose TextBox is only created if picked.
+  const TimerChain* timer_chain_ = nullptr;
+  uint64_t timer_index_ = 0;
 };
 
 struct LineBuffer {
@@ -68,11 +71,32 @@ struct PrimitiveBuffers {
     line_buffer.Reset();
     box_buffer.Reset();
     triangle_buffer.Reset();
+    picking_box_buffer.Reset();
   }
 
   LineBuffer line_buffer;
   BoxBuffer box_buffer;
   TriangleBuffer triangle_buffer;
+  // Boxes only drawn when picking, which have no colors.
+  BoxBuffer picking_box_buffer;
+};
+
+// Vertex buffer objects holding a copy of the primitives of one type of one layer.
+struct RetainedBuffer {
+  uint32_t vertices = 0;
+  uint32_t colors = 0;
+  uint32_t picking_colors = 0;
+  uint32_t vertex_count = 0;
+};
+
+struct RetainedLayer {
+  RetainedBuffer lines;
+  RetainedBuffer boxes;
+  RetainedBuffer triangles;
+  RetainedBuffer picking_boxes;
+  // The Batcher::version_ the buffers, respectively the picking colors, were last uploaded at.
+  uint64_t version = 0;
+  uint64_t picking_version = 0;
 };
 
 enum class ShadingDirection { kLeftToRight, kRightToLeft, kTopToBottom, kBottomToTop };
@@ -105,30 +129,34 @@ class Batcher {
   Batcher() = delete;
   Batcher(const Batcher&) = delete;
   Batcher(Batcher&&) = delete;
+  virtual ~Batcher();
 
   void AddLine(Vec2 from, Vec2 to, float z, const Color& color,
-               std::unique_ptr<PickingUserData> user_data = nullptr);
+               const PickingUserData& user_data = {});
   void AddVerticalLine(Vec2 pos, float size, float z, const Color& color,
-                       std::unique_ptr<PickingUserData> user_data = nullptr);
+                       const PickingUserData& user_data = {});
   void AddLine(Vec2 from, Vec2 to, float z, const Color& color, std::shared_ptr<Pickable> pickable);
   void AddVerticalLine(Vec2 pos, float size, float z, const Color& color,
                        std::shared_ptr<Pickable> pickable);
 
   void AddBox(const Box& box, const std::array<Color, 4>& colors,
-              std::unique_ptr<PickingUserData> user_data = nullptr);
+              const PickingUserData& user_data = {});
   void AddBox(const Box& box, const Color& color,
-              std::unique_ptr<PickingUserData> user_data = nullptr);
+              const PickingUserData& user_data = {});
   void AddBox(const Box& box, const Color& color, std::shared_ptr<Pickable> pickable);
 
   void AddShadedBox(Vec2 pos, Vec2 size, float z, const Color& color);
   void AddShadedBox(Vec2 pos, Vec2 size, float z, const Color& color,
                     ShadingDirection shading_direction);
   void AddShadedBox(Vec2 pos, Vec2 size, float z, const Color& color,
-                    std::unique_ptr<PickingUserData> user_data,
+                    const PickingUserData& user_data,
                     ShadingDirection shading_direction = ShadingDirection::kLeftToRight);
   void AddShadedBox(Vec2 pos, Vec2 size, float z, const Color& color,
                     std::shared_ptr<Pickable> pickable,
                     ShadingDirection shading_direction = ShadingDirection::kLeftToRight);
+  // Adds a box that is only drawn when picking, e.g., to make a thin line easier to pick. As the
+  // same primitives are used for drawing and picking, picking doesn't require updating them.
+  void AddPickingBox(const Box& box, const PickingUserData& user_data);
   void AddRoundedBox(Vec2 pos, Vec2 size, float z, float radius, const Color& color,
                      float margin = 0);
 
@@ -138,7 +166,7 @@ class Batcher {
   void AddBottomRightRoundedCorner(Vec2 pos, float radius, float z, const Color& color);
 
   void AddTriangle(const Triangle& triangle, const Color& color,
-                   std::unique_ptr<PickingUserData> user_data = nullptr);
+                   const PickingUserData& user_data = {});
   void AddTriangle(const Triangle& triangle, const Color& color,
                    std::shared_ptr<Pickable> pickable);
 
@@ -150,36 +178,77 @@ class Batcher {
   void ResetElements();
   void StartNewFrame();
 
+  // In retained mode, primitives are drawn from vertex buffer objects, which are only uploaded
+  // again if primitives changed since they were last drawn. This avoids sending all vertices to
+  // the GPU every frame for a batcher whose primitives are kept across frames.
+  void SetRetained(bool retained) { retained_ = retained; }
+  [[nodiscard]] bool IsRetained() const { return retained_; }
+
+  [[nodiscard]] uint32_t GetDrawCallCount() const { return draw_call_count_; }
+  void ResetDrawCallCount() { draw_call_count_ = 0; }
+  // Number of times the storage of picking user data was reallocated since the last reset. Drawing
+  // timers doesn't create TextBoxes: TimerChain only creates one when the tooltip of a timer is
+  // shown or the timer is selected.
+  [[nodiscard]] uint32_t GetUserDataAllocationCount() const { return user_data_allocation_count_; }
+  void ResetUserDataAllocationCount() { user_data_allocation_count_ = 0; }
+
+  // Creates a batcher to be filled in parallel with others, and then merged into the batcher used
+  // for drawing with MergeFrom. Picking ids of pickables are only assigned when merging, in the
+  // order the pickables were added, so that merging segments in order gives the same result as
+  // adding all primitives to the target batcher directly.
+  [[nodiscard]] static std::unique_ptr<Batcher> CreateSegment(BatcherId batcher_id);
+  // Appends all primitives of other as if they had been added to this batcher, and resets other.
+  void MergeFrom(Batcher* other);
+
   [[nodiscard]] PickingManager* GetPickingManager() { return picking_manager_; }
   void SetPickingManager(PickingManager* picking_manager) { picking_manager_ = picking_manager; }
 
   [[nodiscard]] const PickingUserData* GetUserData(PickingId id) const;
   [[nodiscard]] PickingUserData* GetUserData(PickingId id);
 
+  // Returns the TextBox of the picked timer, which lives as long as its TimerChain.
   [[nodiscard]] const TextBox* GetTextBox(PickingId id);
+  // Same as GetTextBox, for immediate use only, e.g., to show a tooltip. See
+  // TimerChain::GetTemporaryTextBox.
+  [[nodiscard]] const TextBox* GetTemporaryTextBox(PickingId id);
 
   static constexpr uint32_t kNumArcSides = 16;
 
  protected:
   void DrawLineBuffer(float layer, bool picking) const;
-  void DrawBoxBuffer(float layer, bool picking) const;
+  void DrawBoxBuffer(const BoxBuffer& box_buffer, bool picking) const;
   void DrawTriangleBuffer(float layer, bool picking) const;
+  void DrawRetainedLayer(float layer, bool picking) const;
+  void DrawRetainedBuffer(const RetainedBuffer& buffer, uint32_t mode, bool picking) const;
 
   void GetBoxGradientColors(const Color& color, std::array<Color, 4>* colors,
                             ShadingDirection shading_direction = ShadingDirection::kLeftToRight);
 
   void AddLine(Vec2 from, Vec2 to, float z, const Color& color, const Color& picking_color,
-               std::unique_ptr<PickingUserData> user_data = nullptr);
+               const PickingUserData& user_data = {});
   void AddBox(const Box& box, const std::array<Color, 4>& colors, const Color& picking_color,
-              std::unique_ptr<PickingUserData> user_data = nullptr);
+              const PickingUserData& user_data = {});
   void AddTriangle(const Triangle& triangle, const Color& color, const Color& picking_color,
-                   std::unique_ptr<PickingUserData> user_data = nullptr);
+                   const PickingUserData& user_data = {});
+  [[nodiscard]] Color GetPickableColor(std::shared_ptr<Pickable> pickable);
+  void AddUserData(const PickingUserData& user_data);
 
   BatcherId batcher_id_;
   PickingManager* picking_manager_;
   std::unordered_map<float, PrimitiveBuffers> primitive_buffers_by_layer_;
 
-  std::vector<std::unique_ptr<PickingUserData>> user_data_;
+  std::vector<PickingUserData> user_data_;
+
+  bool is_segment_ = false;
+  // Pickables added to a segment, whose picking colors hold the index in this vector.
+  std::vector<std::shared_ptr<Pickable>> segment_pickables_;
+
+  bool retained_ = false;
+  // Incremented whenever primitives are added or removed.
+  uint64_t version_ = 1;
+  mutable std::unordered_map<float, RetainedLayer> retained_layers_;
+  mutable uint32_t draw_call_count_ = 0;
+  uint32_t user_data_allocation_count_ = 0;
 
   std::vector<Vec2> circle_points;
 };
@@ -4,6 +4,10 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <thread>
+#include <vector>
+
 #include "Batcher.h"
 #include "PickingManagerTest.h"
 
@@ -23,6 +27,9 @@ class MockBatcher : public Batcher {
   const std::vector<Color>& GetDrawnLineColors() const { return drawn_line_colors_; }
   const std::vector<Color>& GetDrawnTriangleColors() const { return drawn_triangle_colors_; }
   const std::vector<Color>& GetDrawnBoxColors() const { return drawn_box_colors_; }
+  const std::unordered_map<float, PrimitiveBuffers>& GetPrimitiveBuffers() const {
+    return primitive_buffers_by_layer_;
+  }
 
   // Simulate drawing by simple appending all colors to internal
   // buffers. Only a single color per element will be appended
@@ -51,6 +58,14 @@ class MockBatcher : public Batcher {
           ++it;
           ++it;
         }
+        for (auto it = buffer.picking_box_buffer.picking_colors_.begin();
+             it != buffer.picking_box_buffer.picking_colors_.end();) {
+          drawn_box_colors_.push_back(*it);
+          ++it;
+          ++it;
+          ++it;
+          ++it;
+        }
       } else {
         for (auto it = buffer.line_buffer.colors_.begin();
              it != buffer.line_buffer.colors_.end();) {
@@ -136,21 +151,21 @@ TEST(Batcher, PickingSimpleElements) {
   MockBatcher batcher(BatcherId::kUi);
 
   std::string line_custom_data = "line custom data";
-  auto line_user_data = std::make_unique<PickingUserData>();
-  line_user_data->custom_data_ = &line_custom_data;
+  PickingUserData line_user_data;
+  line_user_data.custom_data_ = &line_custom_data;
 
   std::string triangle_custom_data = "triangle custom data";
-  auto triangle_user_data = std::make_unique<PickingUserData>();
-  triangle_user_data->custom_data_ = &triangle_custom_data;
+  PickingUserData triangle_user_data;
+  triangle_user_data.custom_data_ = &triangle_custom_data;
 
   std::string box_custom_data = "box custom data";
-  auto box_user_data = std::make_unique<PickingUserData>();
-  box_user_data->custom_data_ = &box_custom_data;
+  PickingUserData box_user_data;
+  box_user_data.custom_data_ = &box_custom_data;
 
-  batcher.AddLine(Vec2(0, 0), Vec2(1, 0), 0, Color(255, 255, 255, 255), std::move(line_user_data));
+  batcher.AddLine(Vec2(0, 0), Vec2(1, 0), 0, Color(255, 255, 255, 255), line_user_data);
   batcher.AddTriangle(Triangle(Vec3(0, 0, 0), Vec3(0, 1, 0), Vec3(1, 0, 0)), Color(0, 255, 0, 255),
-                      std::move(triangle_user_data));
-  batcher.AddBox(Box(Vec2(0, 0), Vec2(1, 1), 0), Color(255, 0, 0, 255), std::move(box_user_data));
+                      triangle_user_data);
+  batcher.AddBox(Box(Vec2(0, 0), Vec2(1, 1), 0), Color(255, 0, 0, 255), box_user_data);
 
   batcher.Draw(true);
   ExpectCustomDataEq(batcher, batcher.GetDrawnLineColors()[0], line_custom_data);
@@ -189,21 +204,21 @@ TEST(Batcher, MultipleDrawCalls) {
   MockBatcher batcher(BatcherId::kUi);
 
   std::string line_custom_data = "line custom data";
-  auto line_user_data = std::make_unique<PickingUserData>();
-  line_user_data->custom_data_ = &line_custom_data;
+  PickingUserData line_user_data;
+  line_user_data.custom_data_ = &line_custom_data;
 
   std::string triangle_custom_data = "triangle custom data";
-  auto triangle_user_data = std::make_unique<PickingUserData>();
-  triangle_user_data->custom_data_ = &triangle_custom_data;
+  PickingUserData triangle_user_data;
+  triangle_user_data.custom_data_ = &triangle_custom_data;
 
   std::string box_custom_data = "box custom data";
-  auto box_user_data = std::make_unique<PickingUserData>();
-  box_user_data->custom_data_ = &box_custom_data;
+  PickingUserData box_user_data;
+  box_user_data.custom_data_ = &box_custom_data;
 
-  batcher.AddLine(Vec2(0, 0), Vec2(1, 0), 0, Color(255, 255, 255, 255), std::move(line_user_data));
+  batcher.AddLine(Vec2(0, 0), Vec2(1, 0), 0, Color(255, 255, 255, 255), line_user_data);
   batcher.AddTriangle(Triangle(Vec3(0, 0, 0), Vec3(0, 1, 0), Vec3(1, 0, 0)), Color(0, 255, 0, 255),
-                      std::move(triangle_user_data));
-  batcher.AddBox(Box(Vec2(0, 0), Vec2(1, 1), 0), Color(255, 0, 0, 255), std::move(box_user_data));
+                      triangle_user_data);
+  batcher.AddBox(Box(Vec2(0, 0), Vec2(1, 1), 0), Color(255, 0, 0, 255), box_user_data);
 
   batcher.Draw(true);
 
@@ -230,4 +245,186 @@ TEST(Batcher, MultipleDrawCalls) {
   UNUSED(rendered_data);
 }
 
-}  // namespace
\ No newline at end of file
+void AddPrimitives(Batcher* batcher, size_t first, size_t count,
+                   const std::vector<std::string>& custom_data,
+                   const std::vector<std::shared_ptr<PickableMock>>& pickables) {
+  for (size_t i = first; i < first + count; ++i) {
+    auto x = static_cast<float>(i);
+    auto z = static_cast<float>(i % 3);
+    PickingUserData user_data;
+    user_data.custom_data_ = &custom_data[i];
+    batcher->AddLine(Vec2(x, 0), Vec2(x + 1, 0), z, Color(255, 255, 255, 255));
+    batcher->AddBox(Box(Vec2(x, 0), Vec2(1, 1), z), Color(255, 0, 0, 255), user_data);
+    batcher->AddTriangle(Triangle(Vec3(x, 0, z), Vec3(x, 1, z), Vec3(x + 1, 0, z)),
+                         Color(0, 255, 0, 255), pickables[i]);
+    batcher->AddShadedBox(Vec2(x, 2), Vec2(1, 1), z + 0.5f, Color(0, 0, 255, 255), pickables[i]);
+    batcher->AddPickingBox(Box(Vec2(x, 4), Vec2(1, 1), z), user_data);
+  }
+}
+
+template <class T, uint32_t BlockSize>
+std::vector<T> ToVector(const BlockChain<T, BlockSize>& block_chain) {
+  std::vector<T> result;
+  for (const T& element : block_chain) {
+    result.push_back(element);
+  }
+  return result;
+}
+
+template <size_t N, uint32_t BlockSize, typename Primitive>
+void ExpectVerticesEq(const BlockChain<Primitive, BlockSize>& actual,
+                      const BlockChain<Primitive, BlockSize>& expected) {
+  std::vector<Primitive> actual_primitives = ToVector(actual);
+  std::vector<Primitive> expected_primitives = ToVector(expected);
+  ASSERT_EQ(actual_primitives.size(), expected_primitives.size());
+  for (size_t i = 0; i < actual_primitives.size(); ++i) {
+    for (size_t v = 0; v < N; ++v) {
+      EXPECT_EQ(actual_primitives[i].vertices[v], expected_primitives[i].vertices[v]);
+    }
+  }
+}
+
+void ExpectSamePrimitives(const MockBatcher& actual, const MockBatcher& expected) {
+  // Layers are stored in an unordered map, whose order depends on the order they were added in.
+  std::vector<float> actual_layers = actual.GetLayers();
+  std::vector<float> expected_layers = expected.GetLayers();
+  std::sort(actual_layers.begin(), actual_layers.end());
+  std::sort(expected_layers.begin(), expected_layers.end());
+  ASSERT_EQ(actual_layers, expected_layers);
+  for (float layer : expected_layers) {
+    const PrimitiveBuffers& actual_buffers = actual.GetPrimitiveBuffers().at(layer);
+    const PrimitiveBuffers& expected_buffers = expected.GetPrimitiveBuffers().at(layer);
+
+    std::vector<Line> actual_lines = ToVector(actual_buffers.line_buffer.lines_);
+    std::vector<Line> expected_lines = ToVector(expected_buffers.line_buffer.lines_);
+    ASSERT_EQ(actual_lines.size(), expected_lines.size());
+    for (size_t i = 0; i < actual_lines.size(); ++i) {
+      EXPECT_EQ(actual_lines[i].start_point, expected_lines[i].start_point);
+      EXPECT_EQ(actual_lines[i].end_point, expected_lines[i].end_point);
+    }
+    EXPECT_EQ(ToVector(actual_buffers.line_buffer.colors_),
+              ToVector(expected_buffers.line_buffer.colors_));
+    EXPECT_EQ(ToVector(actual_buffers.line_buffer.picking_colors_),
+              ToVector(expected_buffers.line_buffer.picking_colors_));
+
+    ExpectVerticesEq<4>(actual_buffers.box_buffer.boxes_, expected_buffers.box_buffer.boxes_);
+    EXPECT_EQ(ToVector(actual_buffers.box_buffer.colors_),
+              ToVector(expected_buffers.box_buffer.colors_));
+    EXPECT_EQ(ToVector(actual_buffers.box_buffer.picking_colors_),
+              ToVector(expected_buffers.box_buffer.picking_colors_));
+
+    ExpectVerticesEq<3>(actual_buffers.triangle_buffer.triangles_,
+                        expected_buffers.triangle_buffer.triangles_);
+    EXPECT_EQ(ToVector(actual_buffers.triangle_buffer.colors_),
+              ToVector(expected_buffers.triangle_buffer.colors_));
+    EXPECT_EQ(ToVector(actual_buffers.triangle_buffer.picking_colors_),
+              ToVector(expected_buffers.triangle_buffer.picking_colors_));
+
+    ExpectVerticesEq<4>(actual_buffers.picking_box_buffer.boxes_,
+                        expected_buffers.picking_box_buffer.boxes_);
+    EXPECT_EQ(ToVector(actual_buffers.picking_box_buffer.picking_colors_),
+              ToVector(expected_buffers.picking_box_buffer.picking_colors_));
+  }
+}
+
+TEST(Batcher, MergingSegmentsInOrderEqualsAddingSerially) {
+  constexpr size_t kSegmentCount = 4;
+  constexpr size_t kPrimitivesPerSegment = 100;
+  constexpr size_t kPrimitiveCount = kSegmentCount * kPrimitivesPerSegment;
+  std::vector<std::string> custom_data;
+  std::vector<std::shared_ptr<PickableMock>> pickables;
+  for (size_t i = 0; i < kPrimitiveCount; ++i) {
+    custom_data.push_back(std::to_string(i));
+    pickables.push_back(std::make_shared<PickableMock>());
+  }
+
+  PickingManager serial_pm;
+  MockBatcher serial_batcher(BatcherId::kTimeGraph, &serial_pm);
+  AddPrimitives(&serial_batcher, 0, kPrimitiveCount, custom_data, pickables);
+
+  std::vector<std::unique_ptr<Batcher>> segments;
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < kSegmentCount; ++i) {
+    segments.push_back(Batcher::CreateSegment(BatcherId::kTimeGraph));
+  }
+  for (size_t i = 0; i < kSegmentCount; ++i) {
+    threads.emplace_back([&, i] {
+      AddPrimitives(segments[i].get(), i * kPrimitivesPerSegment, kPrimitivesPerSegment,
+                    custom_data, pickables);
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  PickingManager merged_pm;
+  MockBatcher merged_batcher(BatcherId::kTimeGraph, &merged_pm);
+  for (std::unique_ptr<Batcher>& segment : segments) {
+    merged_batcher.MergeFrom(segment.get());
+  }
+
+  ExpectSamePrimitives(merged_batcher, serial_batcher);
+
+  merged_batcher.Draw(/*picking=*/true);
+  const std::vector<Color>& box_colors = merged_batcher.GetDrawnBoxColors();
+  const std::vector<Color>& triangle_colors = merged_batcher.GetDrawnTriangleColors();
+  ASSERT_EQ(triangle_colors.size(), kPrimitiveCount);
+  for (const Color& color : box_colors) {
+    PickingId id = MockRenderPickingColor(color);
+    if (id.type == PickingType::kBox) {
+      const PickingUserData* user_data = merged_batcher.GetUserData(id);
+      ASSERT_NE(user_data, nullptr);
+      EXPECT_EQ(user_data->custom_data_, serial_batcher.GetUserData(id)->custom_data_);
+    } else {
+      EXPECT_EQ(id.type, PickingType::kPickable);
+      EXPECT_EQ(merged_pm.GetPickableFromId(id), serial_pm.GetPickableFromId(id));
+    }
+  }
+  for (const Color& color : triangle_colors) {
+    PickingId id = MockRenderPickingColor(color);
+    EXPECT_EQ(id.type, PickingType::kPickable);
+    EXPECT_NE(merged_pm.GetPickableFromId(id), nullptr);
+    EXPECT_EQ(merged_pm.GetPickableFromId(id), serial_pm.GetPickableFromId(id));
+  }
+}
+
+TEST(Batcher, PickingBoxesAreOnlyDrawnWhenPicking) {
+  MockBatcher batcher(BatcherId::kTimeGraph);
+  std::string custom_data = "custom data";
+  PickingUserData user_data;
+  user_data.custom_data_ = &custom_data;
+
+  batcher.AddVerticalLine(Vec2(0, 0), 10, 0, Color(255, 255, 255, 255));
+  batcher.AddPickingBox(Box(Vec2(-4, 0), Vec2(9, 10), 0), user_data);
+  ExpectDraw(batcher, 1, 0, 0);
+
+  batcher.ResetMockDrawCounts();
+  batcher.Draw(/*picking=*/true);
+  ASSERT_EQ(batcher.GetDrawnBoxColors().size(), 1);
+  ExpectCustomDataEq(batcher, batcher.GetDrawnBoxColors()[0], custom_data);
+}
+
+TEST(Batcher, UserDataIsReusedAcrossFrames) {
+  MockBatcher batcher(BatcherId::kTimeGraph);
+  std::string custom_data = "custom data";
+  PickingUserData user_data;
+  user_data.custom_data_ = &custom_data;
+
+  constexpr size_t kBoxCount = 1000;
+  for (size_t i = 0; i < kBoxCount; ++i) {
+    batcher.AddBox(Box(Vec2(0, 0), Vec2(1, 1), 0), Color(255, 0, 0, 255), user_data);
+  }
+  EXPECT_GT(batcher.GetUserDataAllocationCount(), 0);
+
+  batcher.StartNewFrame();
+  batcher.ResetUserDataAllocationCount();
+  for (size_t i = 0; i < kBoxCount; ++i) {
+    batcher.AddBox(Box(Vec2(0, 0), Vec2(1, 1), 0), Color(255, 0, 0, 255), user_data);
+  }
+  EXPECT_EQ(batcher.GetUserDataAllocationCount(), 0);
+
+  batcher.Draw(true);
+  ExpectCustomDataEq(batcher, batcher.GetDrawnBoxColors().back(), custom_data);
+}
+
+}  // namespace
@@ -8,6 +8,7 @@
 #include <filesystem>
 
 #include "App.h"
+#include "OrbitClientModel/CaptureColumns.h"
 #include "OrbitClientModel/CaptureDeserializer.h"
 #include "OrbitClientModel/CaptureSerializer.h"
 #include "TimeGraph.h"
@@ -29,6 +30,8 @@ ABSL_FLAG(bool, show_return_values, false, "Show return values on time slices");
 ABSL_FLAG(bool, enable_tracepoint_feature, false,
           "Enable the setting of the panel of kernel tracepoints");
 ABSL_FLAG(bool, thread_state, false, "Collect thread states");
+ABSL_FLAG(std::string, capture_response_compression, "none",
+          "Compression of the capture data sent by OrbitService: none, deflate or gzip");
 
 DEFINE_PROTO_FUZZER(const orbit_client_protos::CaptureDeserializerFuzzerInfo& info) {
   std::string buffer{};
@@ -36,13 +39,20 @@ DEFINE_PROTO_FUZZER(const orbit_client_protos::CaptureDeserializerFuzzerInfo& in
     google::protobuf::io::StringOutputStream stream{&buffer};
     google::protobuf::io::CodedOutputStream coded_stream{&stream};
     orbit_client_protos::CaptureHeader capture_header{};
-    capture_header.set_version("1.55");
+    capture_header.set_version(capture_deserializer::internal::kRequiredCaptureVersion);
 
     capture_serializer::WriteMessage(&capture_header, &coded_stream);
-    capture_serializer::WriteMessage(&info.capture_info(), &coded_stream);
-    for (const auto& timer : info.timers()) {
-      capture_serializer::WriteMessage(&timer, &coded_stream);
+    // The whole CaptureInfo goes in the metadata chunk, which the deserializer loads like any
+    // other chunk, so that all its fields are fuzzed.
+    capture_serializer::internal::CaptureChunkWriter chunk_writer{&coded_stream};
+    chunk_writer.WriteChunk(orbit_client_protos::kCaptureInfoChunk, info.capture_info());
+    capture_columns::TimerColumnsBuilder timers_builder;
+    for (const orbit_client_protos::TimerInfo& timer : info.timers()) {
+      timers_builder.Add(timer);
     }
+    chunk_writer.WriteChunk(orbit_client_protos::kTimersChunk, timers_builder.Build(),
+                            timers_builder.min_timestamp_ns(), timers_builder.max_timestamp_ns());
+    chunk_writer.Finish();
   }
 
   std::unique_ptr<OrbitApp> app = OrbitApp::Create({}, nullptr);
@@ -0,0 +1,153 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <absl/time/time.h>
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "OrbitBase/ThreadPool.h"
+#include "OrbitClientData/Callstack.h"
+#include "OrbitClientData/ModuleManager.h"
+#include "OrbitClientData/ProcessData.h"
+#include "OrbitClientData/TracepointCustom.h"
+#include "OrbitClientData/UserDefinedCaptureData.h"
+#include "OrbitClientModel/CaptureColumns.h"
+#include "OrbitClientModel/CaptureData.h"
+#include "OrbitClientModel/CaptureSerializer.h"
+#include "TimerChain.h"
+#include "capture_data.pb.h"
+#include "process.pb.h"
+
+namespace {
+
+using orbit_client_data::ModuleManager;
+using orbit_client_protos::CallstackEvent;
+using orbit_client_protos::TimerInfo;
+
+constexpr int32_t kThreadCount = 8;
+constexpr int kCallstackCount = 1000;
+
+// A capture with sampling data of kThreadCount threads, with one callstack event per timer.
+std::unique_ptr<CaptureData> CreateCaptureData(ModuleManager* module_manager, int event_count) {
+  orbit_grpc_protos::ProcessInfo process_info;
+  process_info.set_name("benchmark");
+  process_info.set_pid(42);
+  auto capture_data = std::make_unique<CaptureData>(
+      ProcessData{process_info}, module_manager,
+      absl::flat_hash_map<uint64_t, orbit_client_protos::FunctionInfo>{}, TracepointInfoSet{},
+      UserDefinedCaptureData{});
+
+  std::mt19937_64 random_engine{0};
+  std::vector<uint64_t> callstack_hashes;
+  for (int i = 0; i < kCallstackCount; ++i) {
+    std::vector<uint64_t> frames(8);
+    for (uint64_t& frame : frames) {
+      frame = 0x7f0000000000 + random_engine() % 0x100000;
+    }
+    CallStack callstack(std::move(frames));
+    callstack_hashes.push_back(callstack.GetHash());
+    capture_data->AddUniqueCallStack(callstack);
+  }
+  for (int i = 0; i < event_count; ++i) {
+    CallstackEvent callstack_event;
+    callstack_event.set_time(1000 * static_cast<uint64_t>(i));
+    callstack_event.set_thread_id(1 + i % kThreadCount);
+    callstack_event.set_callstack_hash(callstack_hashes[random_engine() % kCallstackCount]);
+    capture_data->AddCallstackEvent(callstack_event);
+  }
+  return capture_data;
+}
+
+// One chain of timers per thread, like the timers of dynamically instrumented functions.
+std::vector<std::shared_ptr<TimerChain>> CreateTimerChains(int timer_count) {
+  std::mt19937_64 random_engine{1};
+  std::uniform_int_distribution<uint64_t> duration_distribution{100, 10'000};
+  std::vector<std::shared_ptr<TimerChain>> chains(kThreadCount);
+  for (std::shared_ptr<TimerChain>& chain : chains) {
+    chain = std::make_shared<TimerChain>();
+  }
+  uint64_t timestamp_ns = 0;
+  for (int i = 0; i < timer_count; ++i) {
+    TimerInfo timer;
+    timer.set_process_id(42);
+    timer.set_thread_id(1 + i % kThreadCount);
+    timer.set_depth(1);
+    timer.set_processor(-1);
+    timer.set_function_address(0x7f0000001000 + 0x100 * (random_engine() % 20));
+    timer.set_start(timestamp_ns);
+    timestamp_ns += duration_distribution(random_engine);
+    timer.set_end(timestamp_ns);
+    chains[i % kThreadCount]->push_back(timer);
+  }
+  return chains;
+}
+
+// The sections App::OnSaveCapture creates for the chains of the timer tracks.
+std::vector<capture_serializer::TimersSection> CreateTimersSections(
+    const std::vector<std::shared_ptr<TimerChain>>& chains) {
+  std::vector<capture_serializer::TimersSection> sections;
+  for (const std::shared_ptr<TimerChain>& chain : chains) {
+    for (uint64_t begin = 0; begin < chain->size();
+         begin += capture_serializer::internal::kTimersPerChunk) {
+      const uint64_t end =
+          std::min<uint64_t>(begin + capture_serializer::internal::kTimersPerChunk, chain->size());
+      sections.emplace_back([chain, begin, end](capture_columns::TimerColumnsBuilder* builder) {
+        chain->AddToColumns(begin, end, builder);
+      });
+    }
+  }
+  return sections;
+}
+
+// Saves a synthetic capture with as many timers as callstack events. The second argument is the
+// number of threads of the thread pool that encodes the sections, 0 for encoding them on the
+// calling thread, and the third selects whether to compress the chunks. Reports the size of the
+// capture file.
+void BM_SaveCapture(benchmark::State& state) {
+  const auto event_count = static_cast<int>(state.range(0));
+  const auto thread_count = static_cast<size_t>(state.range(1));
+  const bool compress_chunks = state.range(2) != 0;
+
+  ModuleManager module_manager;
+  std::unique_ptr<CaptureData> capture_data = CreateCaptureData(&module_manager, event_count);
+  std::vector<std::shared_ptr<TimerChain>> chains = CreateTimerChains(event_count);
+  std::unique_ptr<ThreadPool> thread_pool;
+  if (thread_count > 0) {
+    thread_pool = ThreadPool::Create(thread_count, thread_count, absl::Seconds(1));
+  }
+
+  size_t file_size = 0;
+  for (auto _ : state) {
+    std::ostringstream stream;
+    capture_serializer::internal::Save(stream, *capture_data, {}, CreateTimersSections(chains),
+                                       thread_pool.get(), compress_chunks);
+    file_size = static_cast<size_t>(stream.tellp());
+  }
+  if (thread_pool != nullptr) thread_pool->ShutdownAndWait();
+
+  state.SetItemsProcessed(state.iterations() * 2 * event_count);
+  state.counters["file_MB"] = static_cast<double>(file_size) / (1 << 20);
+}
+
+BENCHMARK(BM_SaveCapture)
+    ->Apply([](benchmark::internal::Benchmark* benchmark) {
+      for (int event_count : {1 << 18, 1 << 21}) {
+        for (int thread_count : {0, 4, 8}) {
+          for (int compress_chunks : {0, 1}) {
+            benchmark->Args({event_count, thread_count, compress_chunks});
+          }
+        }
+      }
+    })
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+}  // namespace
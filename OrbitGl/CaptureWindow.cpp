@@ -157,8 +157,6 @@ void CaptureWindow::Pick(int x, int y) {
   PickingId pick_id = PickingId::FromPixelValue(value);
 
   Pick(pick_id, x, y);
-
-  NeedsUpdate();
 }
 
 void CaptureWindow::Pick(PickingId picking_id, int x, int y) {
@@ -184,6 +182,8 @@ void CaptureWindow::SelectTextBox(const TextBox* text_box) {
   GOrbitApp->SelectTextBox(text_box);
   GOrbitApp->set_selected_thread_id(text_box->GetTimerInfo().thread_id());
   needs_check_highlight_change_ = true;
+  // The selection is drawn by the primitives, which picking alone doesn't update.
+  NeedsUpdate();
 
   const TimerInfo& timer_info = text_box->GetTimerInfo();
 
@@ -208,10 +208,10 @@ void CaptureWindow::Hover(int x, int y) {
       tooltip = pickable->GetTooltip();
     }
   } else {
-    PickingUserData* user_data = batcher.GetUserData(pick_id);
+    const PickingUserData* user_data = batcher.GetUserData(pick_id);
 
-    if (user_data && user_data->generate_tooltip_) {
-      tooltip = user_data->generate_tooltip_(pick_id);
+    if (user_data && user_data->track_) {
+      tooltip = user_data->track_->GetBoxTooltip(pick_id);
     }
   }
 
@@ -237,7 +237,7 @@ void CaptureWindow::PostRender() {
     hover_timer_.Restart();
 
     Hover(mouse_screen_x_, mouse_screen_y_);
-    NeedsUpdate();
+    NeedsRedraw();
     GlCanvas::Render(screen_width_, screen_height_);
     hover_timer_.Restart();
   }
@@ -461,10 +461,17 @@ void CaptureWindow::OnCaptureStarted() {
   NeedsRedraw();
 }
 
+bool CaptureWindow::ShouldReportRenderStats() const { return true; }
+
 bool CaptureWindow::ShouldAutoZoom() const { return GOrbitApp->IsCapturing(); }
 
 void CaptureWindow::Draw() {
   ORBIT_SCOPE("CaptureWindow::Draw");
+  Timer frame_timer;
+  time_graph_.GetBatcher().ResetDrawCallCount();
+  time_graph_.GetBatcher().ResetUserDataAllocationCount();
+  ui_batcher_.ResetDrawCallCount();
+
   if (ShouldAutoZoom()) {
     ZoomAll();
   }
@@ -524,6 +531,17 @@ void CaptureWindow::Draw() {
       RenderText(layer);
     }
   }
+
+  last_frame_draw_call_count_ =
+      time_graph_.GetBatcher().GetDrawCallCount() + ui_batcher_.GetDrawCallCount();
+  last_frame_cpu_time_ms_ = frame_timer.ElapsedMillis();
+  last_frame_user_data_allocation_count_ = time_graph_.GetBatcher().GetUserDataAllocationCount();
+  if (ShouldReportRenderStats()) {
+    ORBIT_UINT64("Capture window draw calls", last_frame_draw_call_count_);
+    ORBIT_UINT64("Capture window picking user data reallocations",
+                 last_frame_user_data_allocation_count_);
+    ORBIT_DOUBLE("Capture window frame CPU time (ms)", last_frame_cpu_time_ms_);
+  }
 }
 
 void CaptureWindow::DrawScreenSpace() {
@@ -696,10 +714,15 @@ void CaptureWindow::RenderImGui() {
       IMGUI_VAR_TO_TEXT(time_graph_.GetCaptureMin());
       IMGUI_VAR_TO_TEXT(time_graph_.GetCaptureMax());
       IMGUI_VAR_TO_TEXT(time_graph_.GetTimeWindowUs());
+      IMGUI_VAR_TO_TEXT(time_graph_.GetBatcher().IsRetained());
+      IMGUI_VAR_TO_TEXT(last_frame_draw_call_count_);
+      IMGUI_VAR_TO_TEXT(last_frame_cpu_time_ms_);
+      IMGUI_VAR_TO_TEXT(last_frame_user_data_allocation_count_);
 
       const CaptureData* capture_data = time_graph_.GetCaptureData();
       if (capture_data != nullptr) {
-        IMGUI_VAR_TO_TEXT(capture_data->GetCallstackData()->callstack_events_by_tid().size());
+        IMGUI_VAR_TO_TEXT(
+            capture_data->GetCallstackData()->GetCallstackEventsCountsPerTid().size());
         IMGUI_VAR_TO_TEXT(capture_data->GetCallstackData()->GetCallstackEventsCount());
       }
 
@@ -69,6 +69,9 @@ class CaptureWindow : public GlCanvas {
  protected:
   [[nodiscard]] virtual const char* GetHelpText() const;
   [[nodiscard]] virtual bool ShouldAutoZoom() const;
+  // Whether to send the draw call count, CPU time and picking data allocations of each frame to
+  // the introspection window.
+  [[nodiscard]] virtual bool ShouldReportRenderStats() const;
 
  protected:
   uint32_t font_size_;
@@ -80,4 +83,8 @@ class CaptureWindow : public GlCanvas {
 
   bool click_was_drag_ = false;
   bool background_clicked_ = false;
+
+  uint32_t last_frame_draw_call_count_ = 0;
+  double last_frame_cpu_time_ms_ = 0;
+  uint32_t last_frame_user_data_allocation_count_ = 0;
 };
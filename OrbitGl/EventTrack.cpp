@@ -66,67 +66,62 @@ void EventTrack::Draw(GlCanvas* canvas, PickingMode picking_mode, float z_offset
   canvas_ = canvas;
 }
 
-void EventTrack::UpdatePrimitives(uint64_t min_tick, uint64_t max_tick, PickingMode picking_mode,
-                                  float z_offset) {
+void EventTrack::UpdatePrimitives(uint64_t min_tick, uint64_t max_tick,
+                                  PickingMode /*picking_mode*/, float z_offset) {
   Batcher* batcher = &time_graph_->GetBatcher();
   const TimeGraphLayout& layout = time_graph_->GetLayout();
   float z = GlCanvas::kZValueEvent + z_offset;
   float track_height = layout.GetEventTrackHeight();
-  const bool picking = picking_mode != PickingMode::kNone;
 
   const Color kWhite(255, 255, 255, 255);
   const Color kGreenSelection(0, 255, 0, 255);
   const CaptureData* capture_data = time_graph_->GetCaptureData();
   CHECK(capture_data != nullptr);
 
-  if (!picking) {
-    // Sampling Events
-    auto action_on_callstack_events = [=](const orbit_client_protos::CallstackEvent& event) {
-      uint64_t time = event.time();
-      if (time > min_tick && time < max_tick) {
-        Vec2 pos(time_graph_->GetWorldFromTick(time), pos_[1]);
-        batcher->AddVerticalLine(pos, -track_height, z, kWhite);
-      }
-    };
-
-    if (thread_id_ == orbit_base::kAllProcessThreadsTid) {
-      capture_data->GetCallstackData()->ForEachCallstackEvent(action_on_callstack_events);
-    } else {
-      capture_data->GetCallstackData()->ForEachCallstackEventOfTid(thread_id_,
-                                                                   action_on_callstack_events);
+  // Only visit the events strictly between min_tick and max_tick.
+  auto for_each_visible_callstack_event_span =
+      [&](const std::function<void(int32_t thread_id, absl::Span<const uint64_t> times,
+                                   absl::Span<const CallstackID> callstack_ids)>& action) {
+        if (max_tick <= min_tick + 1) return;
+        const CallstackData* callstack_data = capture_data->GetCallstackData();
+        if (thread_id_ == orbit_base::kAllProcessThreadsTid) {
+          callstack_data->ForEachCallstackEventSpanInTimeRange(min_tick + 1, max_tick, action);
+        } else {
+          callstack_data->ForEachCallstackEventSpanOfTidInTimeRange(
+              thread_id_, min_tick + 1, max_tick,
+              [this, &action](absl::Span<const uint64_t> times,
+                              absl::Span<const CallstackID> callstack_ids) {
+                action(thread_id_, times, callstack_ids);
+              });
+        }
+      };
+
+  // Sampling Events. Boxes, only drawn when picking, make picking easier than lines would, even
+  // if this may cause samples to overlap.
+  constexpr const float kPickingBoxWidth = 9.0f;
+  constexpr const float kPickingBoxOffset = (kPickingBoxWidth - 1.0f) / 2.0f;
+  pickable_samples_.clear();
+  for_each_visible_callstack_event_span([=](int32_t thread_id, absl::Span<const uint64_t> times,
+                                            absl::Span<const CallstackID> /*callstack_ids*/) {
+    for (uint64_t time : times) {
+      float x = time_graph_->GetWorldFromTick(time);
+      batcher->AddVerticalLine(Vec2(x, pos_[1]), -track_height, z, kWhite);
+
+      Box box(Vec2(x - kPickingBoxOffset, pos_[1] - track_height + 1),
+              Vec2(kPickingBoxWidth, track_height), z);
+      PickingUserData user_data;
+      user_data.track_ = this;
+      // The events of the CallstackData can move or be removed, so the tooltip looks the sample up
+      // again.
+      user_data.custom_data_ = &pickable_samples_.emplace_back(PickableSample{thread_id, time});
+      batcher->AddPickingBox(box, user_data);
     }
+  });
 
-    // Draw selected events
-    Color selectedColor[2];
-    Fill(selectedColor, kGreenSelection);
-    for (const CallstackEvent& event : time_graph_->GetSelectedCallstackEvents(thread_id_)) {
-      Vec2 pos(time_graph_->GetWorldFromTick(event.time()), pos_[1]);
-      batcher->AddVerticalLine(pos, -track_height, z, kGreenSelection);
-    }
-  } else {
-    // Draw boxes instead of lines to make picking easier, even if this may
-    // cause samples to overlap
-    constexpr const float kPickingBoxWidth = 9.0f;
-    constexpr const float kPickingBoxOffset = (kPickingBoxWidth - 1.0f) / 2.0f;
-
-    auto action_on_callstack_events = [=](const orbit_client_protos::CallstackEvent& event) {
-      uint64_t time = event.time();
-      if (time > min_tick && time < max_tick) {
-        Vec2 pos(time_graph_->GetWorldFromTick(time) - kPickingBoxOffset,
-                 pos_[1] - track_height + 1);
-        Vec2 size(kPickingBoxWidth, track_height);
-        auto user_data = std::make_unique<PickingUserData>(
-            nullptr, [&](PickingId id) -> std::string { return GetSampleTooltip(id); });
-        user_data->custom_data_ = &event;
-        batcher->AddShadedBox(pos, size, z, kGreenSelection, std::move(user_data));
-      }
-    };
-    if (thread_id_ == orbit_base::kAllProcessThreadsTid) {
-      capture_data->GetCallstackData()->ForEachCallstackEvent(action_on_callstack_events);
-    } else {
-      capture_data->GetCallstackData()->ForEachCallstackEventOfTid(thread_id_,
-                                                                   action_on_callstack_events);
-    }
+  // Draw selected events
+  for (const CallstackEvent& event : time_graph_->GetSelectedCallstackEvents(thread_id_)) {
+    Vec2 pos(time_graph_->GetWorldFromTick(event.time()), pos_[1]);
+    batcher->AddVerticalLine(pos, -track_height, z, kGreenSelection);
   }
 }
 
@@ -229,7 +224,7 @@ std::string EventTrack::FormatCallstackForTooltip(const CallStack& callstack, in
   return result;
 }
 
-std::string EventTrack::GetSampleTooltip(PickingId id) const {
+std::string EventTrack::GetBoxTooltip(PickingId id) const {
   static const std::string unknown_return_text = "Function call information missing";
 
   auto user_data = time_graph_->GetBatcher().GetUserData(id);
@@ -240,10 +235,8 @@ std::string EventTrack::GetSampleTooltip(PickingId id) const {
   const CaptureData* capture_data = time_graph_->GetCaptureData();
   CHECK(capture_data != nullptr);
   const CallstackData* callstack_data = capture_data->GetCallstackData();
-  const auto* callstack_event = static_cast<const CallstackEvent*>(user_data->custom_data_);
-
-  uint64_t callstack_hash = callstack_event->callstack_hash();
-  const CallStack* callstack = callstack_data->GetCallStack(callstack_hash);
+  const auto* sample = static_cast<const PickableSample*>(user_data->custom_data_);
+  const CallStack* callstack = callstack_data->GetCallStackOfEvent(sample->thread_id, sample->time);
   if (callstack == nullptr) {
     return unknown_return_text;
   }
@@ -4,6 +4,9 @@
 
 #pragma once
 
+#include <cstdint>
+#include <deque>
+
 #include "OrbitClientData/CallstackTypes.h"
 #include "Track.h"
 
@@ -39,9 +42,18 @@ class EventTrack : public Track {
 
  protected:
   void SelectEvents();
-  [[nodiscard]] std::string GetSampleTooltip(PickingId id) const;
+  [[nodiscard]] std::string GetBoxTooltip(PickingId id) const override;
   [[nodiscard]] std::string SafeGetFormattedFunctionName(uint64_t addr, int max_line_length) const;
   [[nodiscard]] std::string FormatCallstackForTooltip(const CallStack& callstack,
                                                       int max_line_length = 80, int max_lines = 20,
                                                       int bottom_n_lines = 5) const;
+
+ private:
+  struct PickableSample {
+    int32_t thread_id;
+    uint64_t time;
+  };
+  // The samples the picking boxes of the last update refer to. Adding to a deque doesn't move the
+  // samples already in it.
+  std::deque<PickableSample> pickable_samples_;
 };
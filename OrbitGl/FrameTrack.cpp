@@ -139,25 +139,10 @@ void FrameTrack::OnTimer(const TimerInfo& timer_info) {
 }
 
 void FrameTrack::SetTimesliceText(const TimerInfo& timer_info, double elapsed_us, float min_x,
-                                  float z_offset, TextBox* text_box) {
-  TimeGraphLayout layout = time_graph_->GetLayout();
-  if (text_box->GetText().empty()) {
-    std::string time = GetPrettyTime(absl::Microseconds(elapsed_us));
-    text_box->SetElapsedTimeTextLength(time.length());
-
-    std::string text = absl::StrFormat("Frame #%u: %s", timer_info.user_data_key(), time.c_str());
-    text_box->SetText(text);
-  }
-
-  const Color kTextWhite(255, 255, 255, 255);
-  const Vec2& box_pos = text_box->GetPos();
-  const Vec2& box_size = text_box->GetSize();
-  float pos_x = std::max(box_pos[0], min_x);
-  float max_size = box_pos[0] + box_size[0] - pos_x;
-  text_renderer_->AddTextTrailingCharsPrioritized(
-      text_box->GetText().c_str(), pos_x, text_box->GetPos()[1] + layout.GetTextOffset(),
-      GlCanvas::kZValueBox + z_offset, kTextWhite, text_box->GetElapsedTimeTextLength(),
-      time_graph_->CalculateZoomedFontSize(), max_size);
+                                  float z_offset, const Vec2& pos, const Vec2& size) {
+  std::string time = GetPrettyTime(absl::Microseconds(elapsed_us));
+  std::string text = absl::StrFormat("Frame #%u: %s", timer_info.user_data_key(), time.c_str());
+  DrawTimesliceText(text, time.length(), min_x, z_offset, pos, size);
 }
 
 std::string FrameTrack::GetTooltip() const {
@@ -187,7 +172,7 @@ std::string FrameTrack::GetTooltip() const {
 }
 
 std::string FrameTrack::GetBoxTooltip(PickingId id) const {
-  const TextBox* text_box = time_graph_->GetBatcher().GetTextBox(id);
+  const TextBox* text_box = time_graph_->GetBatcher().GetTemporaryTextBox(id);
   if (!text_box) {
     return "";
   }
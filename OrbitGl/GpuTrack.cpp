@@ -41,7 +41,6 @@ std::string MapGpuTimelineToTrackLabel(std::string_view timeline) {
 GpuTrack::GpuTrack(TimeGraph* time_graph, std::shared_ptr<StringManager> string_manager,
                    uint64_t timeline_hash)
     : TimerTrack(time_graph) {
-  text_renderer_ = time_graph->GetTextRenderer();
   timeline_hash_ = timeline_hash;
   string_manager_ = string_manager;
 
@@ -118,31 +117,17 @@ bool GpuTrack::TimerFilter(const TimerInfo& timer_info) const {
   return true;
 }
 
-void GpuTrack::SetTimesliceText(const TimerInfo& timer_info, double elapsed_us, float min_x,
-                                float z_offset, TextBox* text_box) {
-  TimeGraphLayout layout = time_graph_->GetLayout();
-  if (text_box->GetText().empty()) {
-    std::string time = GetPrettyTime(absl::Microseconds(elapsed_us));
-
-    text_box->SetElapsedTimeTextLength(time.length());
-
-    CHECK(timer_info.type() == TimerInfo::kGpuActivity);
+// The filter above is only active when the track is collapsed.
+bool GpuTrack::CanUseLevelOfDetail() const { return !collapse_toggle_->IsCollapsed(); }
 
-    std::string text = absl::StrFormat(
-        "%s  %s", time_graph_->GetStringManager()->Get(timer_info.user_data_key()).value_or(""),
-        time.c_str());
-    text_box->SetText(text);
-  }
-
-  const Color kTextWhite(255, 255, 255, 255);
-  const Vec2& box_pos = text_box->GetPos();
-  const Vec2& box_size = text_box->GetSize();
-  float pos_x = std::max(box_pos[0], min_x);
-  float max_size = box_pos[0] + box_size[0] - pos_x;
-  text_renderer_->AddTextTrailingCharsPrioritized(
-      text_box->GetText().c_str(), pos_x, text_box->GetPos()[1] + layout.GetTextOffset(),
-      GlCanvas::kZValueBox + z_offset, kTextWhite, text_box->GetElapsedTimeTextLength(),
-      time_graph_->CalculateZoomedFontSize(), max_size);
+void GpuTrack::SetTimesliceText(const TimerInfo& timer_info, double elapsed_us, float min_x,
+                                float z_offset, const Vec2& pos, const Vec2& size) {
+  CHECK(timer_info.type() == TimerInfo::kGpuActivity);
+  std::string time = GetPrettyTime(absl::Microseconds(elapsed_us));
+  std::string text = absl::StrFormat(
+      "%s  %s", time_graph_->GetStringManager()->Get(timer_info.user_data_key()).value_or(""),
+      time.c_str());
+  DrawTimesliceText(text, time.length(), min_x, z_offset, pos, size);
 }
 
 std::string GpuTrack::GetTooltip() const {
@@ -180,7 +165,7 @@ const TextBox* GpuTrack::GetRight(const TextBox* text_box) const {
 }
 
 std::string GpuTrack::GetBoxTooltip(PickingId id) const {
-  const TextBox* text_box = time_graph_->GetBatcher().GetTextBox(id);
+  const TextBox* text_box = time_graph_->GetBatcher().GetTemporaryTextBox(id);
   if (!text_box || text_box->GetTimerInfo().type() == TimerInfo::kCoreActivity) {
     return "";
   }
@@ -4,13 +4,16 @@
 
 #include "GraphTrack.h"
 
+#include <algorithm>
+#include <utility>
+
 #include "GlCanvas.h"
 
 GraphTrack::GraphTrack(TimeGraph* time_graph, std::string name)
     : Track(time_graph), name_(std::move(name)) {}
 
-void GraphTrack::UpdatePrimitives(uint64_t min_tick, uint64_t max_tick, PickingMode picking_mode,
-                                  float z_offset) {
+void GraphTrack::UpdatePrimitives(uint64_t min_tick, uint64_t max_tick,
+                                  PickingMode /*picking_mode*/, float z_offset) {
   Batcher* batcher = &time_graph_->GetBatcher();
   GlCanvas* canvas = time_graph_->GetCanvas();
 
@@ -28,45 +31,106 @@ void GraphTrack::UpdatePrimitives(uint64_t min_tick, uint64_t max_tick, PickingM
   Box box(pos_, Vec2(size_[0], -size_[1]), track_z);
   batcher->AddBox(box, color, shared_from_this());
 
-  const bool picking = picking_mode != PickingMode::kNone;
-  if (!picking) {
-    double time_range = static_cast<double>(max_tick - min_tick);
-    if (values_.size() < 2 || time_range == 0) return;
-
-    auto it = values_.upper_bound(min_tick);
-    if (it == values_.end()) return;
-    if (it != values_.begin()) --it;
-    uint64_t previous_time = it->first;
-    double last_normalized_value = (it->second - min_) * inv_value_range_;
-    constexpr float kDotRadius = 2.f;
-    float base_y = pos_[1] - size_[1];
-    float y1 = 0;
-    DrawSquareDot(batcher,
-                  Vec2(time_graph_->GetWorldFromTick(previous_time),
-                       base_y + static_cast<float>(last_normalized_value) * size_[1]),
-                  kDotRadius, dot_z, kDotColor);
-
-    for (++it; it != values_.end(); ++it) {
-      if (previous_time > max_tick) break;
-      uint64_t time = it->first;
-      double normalized_value = (it->second - min_) * inv_value_range_;
-      float x0 = time_graph_->GetWorldFromTick(previous_time);
-      float x1 = time_graph_->GetWorldFromTick(time);
-      float y0 = base_y + static_cast<float>(last_normalized_value) * size_[1];
-      y1 = base_y + static_cast<float>(normalized_value) * size_[1];
-      batcher->AddLine(Vec2(x0, y0), Vec2(x1, y0), graph_z, kLineColor);
-      batcher->AddLine(Vec2(x1, y0), Vec2(x1, y1), graph_z, kLineColor);
-      DrawSquareDot(batcher, Vec2(x1, y1), kDotRadius, dot_z, kDotColor);
-
-      previous_time = time;
-      last_normalized_value = normalized_value;
+  // Graph lines and dots are picked as the track, like its background.
+  double time_range = static_cast<double>(max_tick - min_tick);
+  if (values_.size() < 2 || time_range == 0) return;
+
+  // When zoomed out, draw one range of values per pixel instead of every value.
+  uint64_t ticks_per_pixel = (max_tick - min_tick) / std::max(canvas->GetWidth(), 1);
+  std::optional<uint32_t> lod_level = lod_.GetLevelFor(ticks_per_pixel);
+  if (lod_level.has_value()) {
+    if (lod_needs_rebuild_) {
+      lod_.Clear();
+      for (const auto& [time, value] : values_) {
+        CHECK(lod_.Add(time, ValueRange{value, value, value, time, time}));
+      }
+      lod_needs_rebuild_ = false;
     }
+    DrawLod(batcher, lod_level.value(), min_tick, max_tick, z_offset);
+    return;
+  }
+
+  auto it = values_.upper_bound(min_tick);
+  if (it == values_.end()) return;
+  if (it != values_.begin()) --it;
+  uint64_t previous_time = it->first;
+  double last_normalized_value = (it->second - min_) * inv_value_range_;
+  constexpr float kDotRadius = 2.f;
+  float base_y = pos_[1] - size_[1];
+  float y1 = 0;
+  DrawSquareDot(batcher,
+                Vec2(time_graph_->GetWorldFromTick(previous_time),
+                     base_y + static_cast<float>(last_normalized_value) * size_[1]),
+                kDotRadius, dot_z, kDotColor);
+
+  for (++it; it != values_.end(); ++it) {
+    if (previous_time > max_tick) break;
+    uint64_t time = it->first;
+    double normalized_value = (it->second - min_) * inv_value_range_;
+    float x0 = time_graph_->GetWorldFromTick(previous_time);
+    float x1 = time_graph_->GetWorldFromTick(time);
+    float y0 = base_y + static_cast<float>(last_normalized_value) * size_[1];
+    y1 = base_y + static_cast<float>(normalized_value) * size_[1];
+    batcher->AddLine(Vec2(x0, y0), Vec2(x1, y0), graph_z, kLineColor, shared_from_this());
+    batcher->AddLine(Vec2(x1, y0), Vec2(x1, y1), graph_z, kLineColor, shared_from_this());
+    DrawSquareDot(batcher, Vec2(x1, y1), kDotRadius, dot_z, kDotColor);
+
+    previous_time = time;
+    last_normalized_value = normalized_value;
+  }
 
-    if (!values_.empty()) {
-      float x0 = time_graph_->GetWorldFromTick(previous_time);
-      float x1 = time_graph_->GetWorldFromTick(max_tick);
-      batcher->AddLine(Vec2(x0, y1), Vec2(x1, y1), graph_z, kLineColor);
+  if (!values_.empty()) {
+    float x0 = time_graph_->GetWorldFromTick(previous_time);
+    float x1 = time_graph_->GetWorldFromTick(max_tick);
+    batcher->AddLine(Vec2(x0, y1), Vec2(x1, y1), graph_z, kLineColor, shared_from_this());
+  }
+}
+
+void GraphTrack::DrawLod(Batcher* batcher, uint32_t level, uint64_t min_tick, uint64_t max_tick,
+                         float z_offset) {
+  const Color kLineColor(0, 128, 255, 128);
+  float graph_z = GlCanvas::kZValueEventBar + z_offset;
+  float base_y = pos_[1] - size_[1];
+  auto get_y = [this, base_y](double value) {
+    return base_y + static_cast<float>((value - min_) * inv_value_range_) * size_[1];
+  };
+
+  // Start from the last value before the first bucket, as buckets can begin before min_tick.
+  uint64_t first_bucket_start =
+      LodPyramid<ValueRange>::GetBucketStart(level, min_tick >> level);
+  std::optional<std::pair<uint64_t, double>> previous_point;
+  if (first_bucket_start > 0) previous_point = GetPreviousValueAndTime(first_bucket_start - 1);
+  std::optional<double> previous_value;
+  float previous_x = 0;
+  if (previous_point.has_value()) {
+    previous_value = previous_point->second;
+    previous_x = time_graph_->GetWorldFromTick(previous_point->first);
+  }
+
+  lod_.ForEachBucket(level, min_tick, max_tick, [&](const LodPyramid<ValueRange>::Bucket& bucket) {
+    const ValueRange& range = bucket.summary;
+    float x0 = time_graph_->GetWorldFromTick(range.first_time);
+    double low = range.min;
+    double high = range.max;
+    if (previous_value.has_value()) {
+      float previous_y = get_y(previous_value.value());
+      batcher->AddLine(Vec2(previous_x, previous_y), Vec2(x0, previous_y), graph_z, kLineColor,
+                       shared_from_this());
+      low = std::min(low, previous_value.value());
+      high = std::max(high, previous_value.value());
     }
+    // All the values in the bucket fall in the same pixel, only show their range.
+    batcher->AddLine(Vec2(x0, get_y(low)), Vec2(x0, get_y(high)), graph_z, kLineColor,
+                     shared_from_this());
+    previous_value = range.last;
+    previous_x = time_graph_->GetWorldFromTick(range.last_time);
+  });
+
+  if (previous_value.has_value()) {
+    float previous_y = get_y(previous_value.value());
+    float x1 = time_graph_->GetWorldFromTick(max_tick);
+    batcher->AddLine(Vec2(previous_x, previous_y), Vec2(x1, previous_y), graph_z, kLineColor,
+                     shared_from_this());
   }
 }
 
@@ -96,7 +160,7 @@ void GraphTrack::Draw(GlCanvas* canvas, PickingMode picking_mode, float z_offset
 void GraphTrack::DrawSquareDot(Batcher* batcher, Vec2 center, float radius, float z, Color color) {
   Vec2 position(center[0] - radius, center[1] - radius);
   Vec2 size(2 * radius, 2 * radius);
-  batcher->AddBox(Box(position, size, z), color);
+  batcher->AddBox(Box(position, size, z), color, shared_from_this());
 }
 
 void GraphTrack::DrawLabel(GlCanvas* canvas, Vec2 target_pos, const std::string text,
@@ -134,7 +198,24 @@ void GraphTrack::DrawLabel(GlCanvas* canvas, Vec2 target_pos, const std::string
                                     font_size, text_box_size[0]);
 }
 
+bool GraphTrack::ValueRange::Merge(const ValueRange& other) {
+  min = std::min(min, other.min);
+  max = std::max(max, other.max);
+  if (other.last_time >= last_time) {
+    last = other.last;
+    last_time = other.last_time;
+  }
+  first_time = std::min(first_time, other.first_time);
+  return true;
+}
+
 void GraphTrack::AddValue(double value, uint64_t time) {
+  if (!values_.empty() && time <= values_.rbegin()->first) {
+    lod_needs_rebuild_ = true;
+  }
+  if (!lod_needs_rebuild_) {
+    CHECK(lod_.Add(time, ValueRange{value, value, value, time, time}));
+  }
   values_[time] = value;
   max_ = std::max(max_, value);
   min_ = std::min(min_, value);
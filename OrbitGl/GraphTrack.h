@@ -8,6 +8,7 @@
 #include <limits>
 #include <optional>
 
+#include "LodPyramid.h"
 #include "Timer.h"
 #include "Track.h"
 
@@ -30,7 +31,27 @@ class GraphTrack : public Track {
   void DrawSquareDot(Batcher* batcher, Vec2 center, float radius, float z, Color color);
   void DrawLabel(GlCanvas* canvas, Vec2 target_pos, std::string text, Color text_color,
                  Color font_color, float z);
+  void DrawLod(Batcher* batcher, uint32_t level, uint64_t min_tick, uint64_t max_tick,
+               float z_offset);
+
+  // Summary of a level-of-detail bucket: the range of values and the last value in it.
+  struct ValueRange {
+    double min;
+    double max;
+    double last;
+    uint64_t first_time;
+    uint64_t last_time;
+
+    bool Merge(const ValueRange& other);
+  };
+  // 1 us to ~18 minutes per bucket.
+  static constexpr uint32_t kMinLodLevel = 10;
+  static constexpr uint32_t kMaxLodLevel = 40;
+
   std::map<uint64_t, double> values_;
+  // Values are usually added in order of time. If not, the pyramid is rebuilt when needed.
+  LodPyramid<ValueRange> lod_{kMinLodLevel, kMaxLodLevel};
+  bool lod_needs_rebuild_ = false;
   double min_ = std::numeric_limits<double>::max();
   double max_ = std::numeric_limits<double>::lowest();
   double value_range_ = 0;
@@ -57,3 +57,6 @@ void IntrospectionWindow::ToggleRecording() {
 }
 
 bool IntrospectionWindow::ShouldAutoZoom() const { return IsIntrospecting(); }
+
+// Reporting its own frames would make the introspection window record itself.
+bool IntrospectionWindow::ShouldReportRenderStats() const { return false; }
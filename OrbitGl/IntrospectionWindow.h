@@ -22,6 +22,7 @@ class IntrospectionWindow : public CaptureWindow {
  protected:
   [[nodiscard]] const char* GetHelpText() const override;
   [[nodiscard]] bool ShouldAutoZoom() const override;
+  [[nodiscard]] bool ShouldReportRenderStats() const override;
 
  private:
   std::unique_ptr<orbit_base::TracingListener> introspection_listener_;
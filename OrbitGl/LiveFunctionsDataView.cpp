@@ -372,29 +372,34 @@ FunctionInfo* LiveFunctionsDataView::GetSelectedFunction(unsigned int row) {
 std::pair<TextBox*, TextBox*> LiveFunctionsDataView::GetMinMax(const FunctionInfo& function) const {
   const CaptureData& capture_data = GOrbitApp->GetCaptureData();
   auto function_address = capture_data.GetAbsoluteAddress(function);
-  TextBox* min_box = nullptr;
-  TextBox* max_box = nullptr;
+  const TimerBlock* min_block = nullptr;
+  size_t min_index = 0;
+  const TimerBlock* max_block = nullptr;
+  size_t max_index = 0;
   std::vector<std::shared_ptr<TimerChain>> chains =
       GCurrentTimeGraph->GetAllThreadTrackTimerChains();
   for (auto& chain : chains) {
     if (!chain) continue;
     for (auto& block : *chain) {
       for (size_t i = 0; i < block.size(); i++) {
-        TextBox& box = block[i];
-        if (box.GetTimerInfo().function_address() == function_address) {
-          uint64_t elapsed_nanos = box.GetTimerInfo().end() - box.GetTimerInfo().start();
-          if (min_box == nullptr ||
-              elapsed_nanos < (min_box->GetTimerInfo().end() - min_box->GetTimerInfo().start())) {
-            min_box = &box;
+        if (block.GetFunctionAddress(i) == function_address) {
+          uint64_t elapsed_nanos = block.GetEnd(i) - block.GetStart(i);
+          if (min_block == nullptr ||
+              elapsed_nanos < (min_block->GetEnd(min_index) - min_block->GetStart(min_index))) {
+            min_block = &block;
+            min_index = i;
           }
-          if (max_box == nullptr ||
-              elapsed_nanos > (max_box->GetTimerInfo().end() - max_box->GetTimerInfo().start())) {
-            max_box = &box;
+          if (max_block == nullptr ||
+              elapsed_nanos > (max_block->GetEnd(max_index) - max_block->GetStart(max_index))) {
+            max_block = &block;
+            max_index = i;
           }
         }
       }
     }
   }
+  TextBox* min_box = min_block != nullptr ? min_block->GetTextBox(min_index) : nullptr;
+  TextBox* max_box = max_block != nullptr ? max_block->GetTextBox(max_index) : nullptr;
   return std::make_pair(min_box, max_box);
 }
 
@@ -0,0 +1,128 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_GL_LOD_PYRAMID_H_
+#define ORBIT_GL_LOD_PYRAMID_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "OrbitBase/Logging.h"
+
+// LodPyramid keeps level-of-detail summaries of values added in order of time, at power-of-two
+// time resolutions: at level l, time is split in buckets of 2^l ns, and each bucket in which at
+// least one value was added holds the merged summary of those values. Only levels in
+// [min_level, max_level] are kept, so that the finest level doesn't hold one bucket per value,
+// and PruneFinestLevels raises min_level to bound the memory of the pyramid. When zoomed out,
+// drawing one bucket per pixel then costs O(pixels) instead of O(values).
+//
+// Summary must provide `bool Merge(const Summary& other)`, which merges other into the summary
+// and returns whether the summary changed. A bucket at a coarser level summarizes a superset of
+// the values of a bucket at a finer level: when merging a value doesn't change the finer bucket,
+// it is assumed not to change the coarser ones either.
+template <typename Summary>
+class LodPyramid {
+ public:
+  struct Bucket {
+    // The bucket covers [id << level, (id + 1) << level).
+    uint64_t id;
+    Summary summary;
+  };
+
+  LodPyramid(uint32_t min_level, uint32_t max_level)
+      : min_level_(min_level), levels_(max_level - min_level + 1) {
+    CHECK(min_level <= max_level && max_level < 64);
+  }
+
+  // Returns false, and doesn't add the value, if time is in a bucket before the last bucket of
+  // the finest level, i.e., if values are not added in order of time. The pyramid then needs to
+  // be cleared and rebuilt.
+  [[nodiscard]] bool Add(uint64_t time, const Summary& summary) {
+    for (size_t i = 0; i < levels_.size(); ++i) {
+      std::vector<Bucket>& buckets = levels_[i];
+      uint64_t id = time >> (min_level_ + i);
+      if (buckets.empty() || buckets.back().id < id) {
+        buckets.push_back(Bucket{id, summary});
+        ++bucket_count_;
+      } else if (buckets.back().id == id) {
+        if (!buckets.back().summary.Merge(summary)) break;
+      } else {
+        CHECK(i == 0);
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void Clear() {
+    for (std::vector<Bucket>& buckets : levels_) {
+      buckets.clear();
+      buckets.shrink_to_fit();
+    }
+    bucket_count_ = 0;
+  }
+
+  // Removes the finest levels, but never the coarsest one, until at most max_bucket_count buckets
+  // are left. Values only end up in more buckets over time, so removed levels are not rebuilt.
+  void PruneFinestLevels(size_t max_bucket_count) {
+    size_t level_count = 0;
+    while (bucket_count_ > max_bucket_count && level_count + 1 < levels_.size()) {
+      bucket_count_ -= levels_[level_count].size();
+      ++level_count;
+    }
+    if (level_count == 0) return;
+    levels_.erase(levels_.begin(), levels_.begin() + level_count);
+    min_level_ += static_cast<uint32_t>(level_count);
+  }
+
+  // Returns the coarsest level whose buckets are not wider than max_bucket_width, or nullopt if
+  // even the finest level is too coarse.
+  [[nodiscard]] std::optional<uint32_t> GetLevelFor(uint64_t max_bucket_width) const {
+    if (max_bucket_width == 0) return std::nullopt;
+    uint32_t level = 63;
+    while ((uint64_t{1} << level) > max_bucket_width) --level;
+    if (level < min_level_) return std::nullopt;
+    return std::min<uint32_t>(level, min_level_ + static_cast<uint32_t>(levels_.size()) - 1);
+  }
+
+  [[nodiscard]] static uint64_t GetBucketStart(uint32_t level, uint64_t id) { return id << level; }
+
+  // Calls visitor(const Bucket&) for all buckets of level that intersect [min_time, max_time], in
+  // order of time.
+  template <typename Visitor>
+  void ForEachBucket(uint32_t level, uint64_t min_time, uint64_t max_time,
+                     Visitor&& visitor) const {
+    CHECK(level >= min_level_ && level - min_level_ < levels_.size());
+    const std::vector<Bucket>& buckets = levels_[level - min_level_];
+    uint64_t min_id = min_time >> level;
+    uint64_t max_id = max_time >> level;
+    auto it = std::partition_point(buckets.begin(), buckets.end(),
+                                   [min_id](const Bucket& bucket) { return bucket.id < min_id; });
+    for (; it != buckets.end() && it->id <= max_id; ++it) {
+      visitor(*it);
+    }
+  }
+
+  [[nodiscard]] uint32_t GetMinLevel() const { return min_level_; }
+
+  [[nodiscard]] size_t GetBucketCount() const { return bucket_count_; }
+
+  // The memory allocated for the buckets, including the spare capacity of the levels.
+  [[nodiscard]] size_t GetByteCount() const {
+    size_t byte_count = 0;
+    for (const std::vector<Bucket>& buckets : levels_) {
+      byte_count += buckets.capacity() * sizeof(Bucket);
+    }
+    return byte_count;
+  }
+
+ private:
+  uint32_t min_level_;
+  std::vector<std::vector<Bucket>> levels_;
+  size_t bucket_count_ = 0;
+};
+
+#endif  // ORBIT_GL_LOD_PYRAMID_H_
@@ -0,0 +1,127 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "LodPyramid.h"
+
+namespace {
+
+struct Count {
+  uint64_t count;
+
+  bool Merge(const Count& other) {
+    count += other.count;
+    return true;
+  }
+};
+
+struct Max {
+  uint64_t value;
+
+  bool Merge(const Max& other) {
+    if (other.value <= value) return false;
+    value = other.value;
+    return true;
+  }
+};
+
+template <typename Summary>
+std::vector<typename LodPyramid<Summary>::Bucket> GetBuckets(const LodPyramid<Summary>& pyramid,
+                                                             uint32_t level, uint64_t min_time,
+                                                             uint64_t max_time) {
+  std::vector<typename LodPyramid<Summary>::Bucket> buckets;
+  pyramid.ForEachBucket(level, min_time, max_time,
+                        [&buckets](const auto& bucket) { buckets.push_back(bucket); });
+  return buckets;
+}
+
+}  // namespace
+
+TEST(LodPyramid, SummarizesValuesPerBucket) {
+  LodPyramid<Count> pyramid(2, 4);
+  for (uint64_t time : {0, 1, 3, 4, 9, 17, 18}) {
+    ASSERT_TRUE(pyramid.Add(time, Count{1}));
+  }
+
+  // Buckets of 4: [0, 4) has 3 values, [4, 8) 1, [8, 12) 1, [16, 20) 2.
+  auto buckets = GetBuckets(pyramid, 2, 0, 100);
+  ASSERT_EQ(buckets.size(), 4);
+  EXPECT_EQ(buckets[0].id, 0);
+  EXPECT_EQ(buckets[0].summary.count, 3);
+  EXPECT_EQ(buckets[3].id, 4);
+  EXPECT_EQ(buckets[3].summary.count, 2);
+
+  // Buckets of 16: [0, 16) has 5 values, [16, 32) 2.
+  buckets = GetBuckets(pyramid, 4, 0, 100);
+  ASSERT_EQ(buckets.size(), 2);
+  EXPECT_EQ(buckets[0].summary.count, 5);
+  EXPECT_EQ(buckets[1].summary.count, 2);
+
+  // Only buckets intersecting [5, 9] at level 2.
+  buckets = GetBuckets(pyramid, 2, 5, 9);
+  ASSERT_EQ(buckets.size(), 2);
+  EXPECT_EQ(buckets[0].id, 1);
+  EXPECT_EQ(buckets[1].id, 2);
+  EXPECT_EQ(LodPyramid<Count>::GetBucketStart(2, buckets[1].id), 8);
+
+  EXPECT_EQ(pyramid.GetBucketCount(), 4 + 3 + 2);
+}
+
+TEST(LodPyramid, StopsMergingWhenSummaryDoesNotChange) {
+  LodPyramid<Max> pyramid(0, 3);
+  ASSERT_TRUE(pyramid.Add(0, Max{5}));
+  ASSERT_TRUE(pyramid.Add(1, Max{3}));
+  ASSERT_TRUE(pyramid.Add(1, Max{4}));
+  ASSERT_TRUE(pyramid.Add(2, Max{7}));
+
+  EXPECT_EQ(GetBuckets(pyramid, 0, 1, 1)[0].summary.value, 4);
+  EXPECT_EQ(GetBuckets(pyramid, 1, 0, 1)[0].summary.value, 5);
+  EXPECT_EQ(GetBuckets(pyramid, 3, 0, 7)[0].summary.value, 7);
+}
+
+TEST(LodPyramid, RejectsValuesBeforeLastBucket) {
+  LodPyramid<Count> pyramid(2, 4);
+  ASSERT_TRUE(pyramid.Add(8, Count{1}));
+  EXPECT_TRUE(pyramid.Add(9, Count{1}));
+  EXPECT_FALSE(pyramid.Add(7, Count{1}));
+  EXPECT_EQ(GetBuckets(pyramid, 2, 0, 100).size(), 1);
+
+  pyramid.Clear();
+  EXPECT_EQ(pyramid.GetBucketCount(), 0);
+  EXPECT_TRUE(pyramid.Add(7, Count{1}));
+}
+
+TEST(LodPyramid, GetLevelFor) {
+  LodPyramid<Count> pyramid(4, 10);
+  EXPECT_FALSE(pyramid.GetLevelFor(0).has_value());
+  EXPECT_FALSE(pyramid.GetLevelFor(15).has_value());
+  EXPECT_EQ(pyramid.GetLevelFor(16), 4);
+  EXPECT_EQ(pyramid.GetLevelFor(100), 6);
+  EXPECT_EQ(pyramid.GetLevelFor(1 << 20), 10);
+}
+
+TEST(LodPyramid, PruneFinestLevels) {
+  LodPyramid<Count> pyramid(0, 3);
+  for (uint64_t time = 0; time < 8; ++time) {
+    ASSERT_TRUE(pyramid.Add(time, Count{1}));
+  }
+  ASSERT_EQ(pyramid.GetBucketCount(), 8 + 4 + 2 + 1);
+
+  pyramid.PruneFinestLevels(7);
+  EXPECT_EQ(pyramid.GetMinLevel(), 1);
+  EXPECT_EQ(pyramid.GetBucketCount(), 4 + 2 + 1);
+  EXPECT_FALSE(pyramid.GetLevelFor(1).has_value());
+  EXPECT_EQ(GetBuckets(pyramid, 1, 0, 7)[1].summary.count, 2);
+
+  // The coarsest level is always kept.
+  pyramid.PruneFinestLevels(0);
+  EXPECT_EQ(pyramid.GetMinLevel(), 3);
+  EXPECT_EQ(pyramid.GetBucketCount(), 1);
+  ASSERT_TRUE(pyramid.Add(8, Count{1}));
+  EXPECT_EQ(GetBuckets(pyramid, 3, 0, 15).size(), 2);
+}
@@ -8,8 +8,9 @@
 #include "absl/strings/str_format.h"
 
 SamplingReport::SamplingReport(
-    PostProcessedSamplingData post_processed_sampling_data,
-    absl::flat_hash_map<CallstackID, std::shared_ptr<CallStack>> unique_callstacks,
+    std::shared_ptr<const PostProcessedSamplingData> post_processed_sampling_data,
+    std::shared_ptr<const absl::flat_hash_map<CallstackID, std::shared_ptr<CallStack>>>
+        unique_callstacks,
     bool has_summary)
     : post_processed_sampling_data_{std::move(post_processed_sampling_data)},
       unique_callstacks_{std::move(unique_callstacks)},
@@ -31,7 +32,7 @@ void SamplingReport::ClearReport() {
 }
 
 void SamplingReport::FillReport() {
-  const auto& sample_data = post_processed_sampling_data_.GetThreadSampleData();
+  const auto& sample_data = post_processed_sampling_data_->GetThreadSampleData();
 
   for (const ThreadSampleData& thread_sample_data : sample_data) {
     SamplingReportDataView thread_report;
@@ -44,7 +45,7 @@ void SamplingReport::FillReport() {
 
 void SamplingReport::UpdateDisplayedCallstack() {
   selected_sorted_callstack_report_ =
-      post_processed_sampling_data_.GetSortedCallstackReportFromAddress(selected_address_,
+      post_processed_sampling_data_->GetSortedCallstackReportFromAddress(selected_address_,
                                                                         selected_thread_id_);
   if (selected_sorted_callstack_report_->callstacks_count.empty()) {
     ClearReport();
@@ -54,15 +55,16 @@ void SamplingReport::UpdateDisplayedCallstack() {
 }
 
 void SamplingReport::UpdateReport(
-    PostProcessedSamplingData post_processed_sampling_data,
-    absl::flat_hash_map<CallstackID, std::shared_ptr<CallStack>> unique_callstacks) {
+    std::shared_ptr<const PostProcessedSamplingData> post_processed_sampling_data,
+    std::shared_ptr<const absl::flat_hash_map<CallstackID, std::shared_ptr<CallStack>>>
+        unique_callstacks) {
   unique_callstacks_ = std::move(unique_callstacks);
   post_processed_sampling_data_ = std::move(post_processed_sampling_data);
 
   for (SamplingReportDataView& thread_report : thread_reports_) {
     ThreadID thread_id = thread_report.GetThreadID();
     const ThreadSampleData* thread_sample_data =
-        post_processed_sampling_data_.GetThreadSampleDataByThreadId(thread_id);
+        post_processed_sampling_data_->GetThreadSampleDataByThreadId(thread_id);
     if (thread_sample_data != nullptr) {
       thread_report.SetSampledFunctions(thread_sample_data->sampled_function);
     }
@@ -130,8 +132,8 @@ void SamplingReport::OnCallstackIndexChanged(size_t index) {
   if (index < selected_sorted_callstack_report_->callstacks_count.size()) {
     const CallstackCount& cs = selected_sorted_callstack_report_->callstacks_count[index];
     selected_callstack_index_ = index;
-    auto it = unique_callstacks_.find(cs.callstack_id);
-    CHECK(it != unique_callstacks_.end());
+    auto it = unique_callstacks_->find(cs.callstack_id);
+    CHECK(it != unique_callstacks_->end());
     callstack_data_view_->SetCallStack(*it->second);
   } else {
     selected_callstack_index_ = 0;
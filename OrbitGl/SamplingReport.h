@@ -18,12 +18,17 @@
 
 class SamplingReport {
  public:
+  // The data is shared, e.g., with the post-processor of a live capture, which updates it in place
+  // before calling UpdateReport.
   explicit SamplingReport(
-      PostProcessedSamplingData post_processed_sampling_data,
-      absl::flat_hash_map<CallstackID, std::shared_ptr<CallStack>> unique_callstacks,
+      std::shared_ptr<const PostProcessedSamplingData> post_processed_sampling_data,
+      std::shared_ptr<const absl::flat_hash_map<CallstackID, std::shared_ptr<CallStack>>>
+          unique_callstacks,
       bool has_summary = true);
-  void UpdateReport(PostProcessedSamplingData post_processed_sampling_data,
-                    absl::flat_hash_map<CallstackID, std::shared_ptr<CallStack>> unique_callstacks);
+  void UpdateReport(
+      std::shared_ptr<const PostProcessedSamplingData> post_processed_sampling_data,
+      std::shared_ptr<const absl::flat_hash_map<CallstackID, std::shared_ptr<CallStack>>>
+          unique_callstacks);
   [[nodiscard]] std::vector<SamplingReportDataView>& GetThreadReports() { return thread_reports_; };
   void SetCallstackDataView(CallStackDataView* data_view) { callstack_data_view_ = data_view; };
   void OnSelectAddress(uint64_t address, ThreadID thread_id);
@@ -32,7 +37,7 @@ class SamplingReport {
   [[nodiscard]] std::string GetSelectedCallstackString() const;
   void SetUiRefreshFunc(std::function<void()> func) { ui_refresh_func_ = std::move(func); };
   [[nodiscard]] bool HasCallstacks() const { return selected_sorted_callstack_report_ != nullptr; };
-  [[nodiscard]] bool HasSamples() const { return !unique_callstacks_.empty(); }
+  [[nodiscard]] bool HasSamples() const { return !unique_callstacks_->empty(); }
   [[nodiscard]] bool has_summary() const { return has_summary_; }
   void ClearReport();
 
@@ -42,8 +47,9 @@ class SamplingReport {
   void UpdateDisplayedCallstack();
 
  protected:
-  PostProcessedSamplingData post_processed_sampling_data_;
-  absl::flat_hash_map<CallstackID, std::shared_ptr<CallStack>> unique_callstacks_;
+  std::shared_ptr<const PostProcessedSamplingData> post_processed_sampling_data_;
+  std::shared_ptr<const absl::flat_hash_map<CallstackID, std::shared_ptr<CallStack>>>
+      unique_callstacks_;
   std::vector<SamplingReportDataView> thread_reports_;
   CallStackDataView* callstack_data_view_;
 
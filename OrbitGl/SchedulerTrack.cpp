@@ -64,7 +64,7 @@ void SchedulerTrack::UpdateBoxHeight() {
 }
 
 std::string SchedulerTrack::GetBoxTooltip(PickingId id) const {
-  const TextBox* text_box = time_graph_->GetBatcher().GetTextBox(id);
+  const TextBox* text_box = time_graph_->GetBatcher().GetTemporaryTextBox(id);
   if (!text_box) {
     return "";
   }
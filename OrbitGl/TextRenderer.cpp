@@ -11,12 +11,7 @@
 #include "GlCanvas.h"
 #include "GlUtils.h"
 #include "OrbitBase/ExecutablePath.h"
-
-typedef struct {
-  float x, y, z;     // position
-  float s, t;        // texture
-  float r, g, b, a;  // color
-} vertex_t;
+#include "absl/strings/string_view.h"
 
 bool TextRenderer::draw_outline_ = false;
 
@@ -143,9 +138,9 @@ void TextRenderer::DrawOutline(Batcher* batcher, vertex_buffer_t* vertex_buffer)
     GLuint i1 = *static_cast<const GLuint*>(vector_get(vertex_buffer->indices, i + 1));
     GLuint i2 = *static_cast<const GLuint*>(vector_get(vertex_buffer->indices, i + 2));
 
-    vertex_t v0 = *static_cast<const vertex_t*>(vector_get(vertex_buffer->vertices, i0));
-    vertex_t v1 = *static_cast<const vertex_t*>(vector_get(vertex_buffer->vertices, i1));
-    vertex_t v2 = *static_cast<const vertex_t*>(vector_get(vertex_buffer->vertices, i2));
+    Vertex v0 = *static_cast<const Vertex*>(vector_get(vertex_buffer->vertices, i0));
+    Vertex v1 = *static_cast<const Vertex*>(vector_get(vertex_buffer->vertices, i1));
+    Vertex v2 = *static_cast<const Vertex*>(vector_get(vertex_buffer->vertices, i2));
 
     // TODO: This should be pickable??
     batcher->AddLine(Vec2(v0.x, v0.y), Vec2(v1.x, v1.y), GlCanvas::kZValueSlider, color);
@@ -154,6 +149,51 @@ void TextRenderer::DrawOutline(Batcher* batcher, vertex_buffer_t* vertex_buffer)
   }
 }
 
+const TextRenderer::GlyphRun& TextRenderer::GetGlyphRun(texture_font_t* font, const char* text) {
+  auto& glyph_runs = glyph_runs_by_font_[font];
+  auto it = glyph_runs.find(absl::string_view(text));
+  if (it != glyph_runs.end()) return it->second;
+
+  if (glyph_run_count_ >= kMaxGlyphRunCount) {
+    for (auto& [unused_font, runs] : glyph_runs_by_font_) runs.clear();
+    glyph_run_count_ = 0;
+  }
+
+  GlyphRun glyph_run;
+  vec2 pen{{0.f, 0.f}};
+  bool is_first_line = true;
+  const size_t length = strlen(text);
+  for (size_t i = 0; i < length; ++i) {
+    if (!texture_font_find_glyph(font, text + i)) {
+      texture_font_load_glyph(font, text + i);
+    }
+    texture_glyph_t* glyph = texture_font_get_glyph(font, text + i);
+    float kerning =
+        (i == 0 || glyph == nullptr) ? 0.f : texture_glyph_get_kerning(glyph, text + i - 1);
+
+    if (is_first_line && glyph != nullptr) {
+      glyph_run.first_line_advance += kerning + glyph->advance_x;
+    }
+
+    if (text[i] == '\n') {
+      is_first_line = false;
+      pen.x = 0.f;
+      pen.y -= font->height;
+      continue;
+    }
+
+    if (glyph != nullptr) {
+      pen.x += kerning;
+      glyph_run.glyphs.push_back(PositionedGlyph{glyph, pen, i});
+      pen.x += glyph->advance_x;
+    }
+  }
+  glyph_run.end_pen = pen;
+
+  ++glyph_run_count_;
+  return glyph_runs.emplace(text, std::move(glyph_run)).first->second;
+}
+
 void TextRenderer::AddTextInternal(texture_font_t* font, const char* text, const vec4& color,
                                    vec2* pen, float max_size, float z, vec2* out_text_pos,
                                    vec2* out_text_size) {
@@ -166,55 +206,59 @@ void TextRenderer::AddTextInternal(texture_font_t* font, const char* text, const
   float min_y = FLT_MAX;
   float max_y = -FLT_MAX;
   constexpr std::array<GLuint, 6> indices = {0, 1, 2, 0, 2, 3};
-  vec2 initial_pen = *pen;
-
-  for (size_t i = 0; i < strlen(text); ++i) {
-    if (text[i] == '\n') {
-      pen->x = initial_pen.x;
-      pen->y -= font->height;
-      continue;
+  const vec2 initial_pen = *pen;
+
+  const GlyphRun& glyph_run = GetGlyphRun(font, text);
+  vertices_.clear();
+  indices_.clear();
+  pen->x = initial_pen.x + glyph_run.end_pen.x;
+  pen->y = initial_pen.y + glyph_run.end_pen.y;
+
+  for (const PositionedGlyph& positioned_glyph : glyph_run.glyphs) {
+    const texture_glyph_t* glyph = positioned_glyph.glyph;
+    float pen_x = initial_pen.x + positioned_glyph.pen.x;
+    float pen_y = initial_pen.y + positioned_glyph.pen.y;
+
+    float x0 = floorf(pen_x + glyph->offset_x);
+    float y0 = floorf(pen_y + glyph->offset_y);
+    float x1 = floorf(x0 + glyph->width);
+    float y1 = floorf(y0 - glyph->height);
+
+    float s0 = glyph->s0;
+    float t0 = glyph->t0;
+    float s1 = glyph->s1;
+    float t1 = glyph->t1;
+
+    min_x = std::min(min_x, x0);
+    max_x = std::max(max_x, x1);
+    min_y = std::min(min_y, y1);
+    max_y = std::max(max_y, y0);
+
+    str_width = max_x - min_x;
+
+    if (str_width > max_width) {
+      pen->x = pen_x;
+      pen->y = pen_y;
+      break;
     }
 
-    if (!texture_font_find_glyph(font, text + i)) {
-      texture_font_load_glyph(font, text + i);
+    auto first_index = static_cast<GLuint>(vertices_.size());
+    for (GLuint index : indices) {
+      indices_.push_back(first_index + index);
     }
+    vertices_.push_back(Vertex{x0, y0, z, s0, t0, r, g, b, a});
+    vertices_.push_back(Vertex{x0, y1, z, s0, t1, r, g, b, a});
+    vertices_.push_back(Vertex{x1, y1, z, s1, t1, r, g, b, a});
+    vertices_.push_back(Vertex{x1, y0, z, s1, t0, r, g, b, a});
+  }
 
-    texture_glyph_t* glyph = texture_font_get_glyph(font, text + i);
-    if (glyph != nullptr) {
-      float kerning = (i == 0) ? 0.0f : texture_glyph_get_kerning(glyph, text + i - 1);
-      pen->x += kerning;
-
-      float x0 = floorf(pen->x + glyph->offset_x);
-      float y0 = floorf(pen->y + glyph->offset_y);
-      float x1 = floorf(x0 + glyph->width);
-      float y1 = floorf(y0 - glyph->height);
-
-      float s0 = glyph->s0;
-      float t0 = glyph->t0;
-      float s1 = glyph->s1;
-      float t1 = glyph->t1;
-
-      vertex_t vertices[4] = {{x0, y0, z, s0, t0, r, g, b, a},
-                              {x0, y1, z, s0, t1, r, g, b, a},
-                              {x1, y1, z, s1, t1, r, g, b, a},
-                              {x1, y0, z, s1, t0, r, g, b, a}};
-
-      min_x = std::min(min_x, x0);
-      max_x = std::max(max_x, x1);
-      min_y = std::min(min_y, y1);
-      max_y = std::max(max_y, y0);
-
-      str_width = max_x - min_x;
-
-      if (str_width > max_width) {
-        break;
-      }
-      if (!vertex_buffers_by_layer_.count(z)) {
-        vertex_buffers_by_layer_[z] = vertex_buffer_new("vertex:3f,tex_coord:2f,color:4f");
-      }
-      vertex_buffer_push_back(vertex_buffers_by_layer_.at(z), vertices, 4, indices.data(), 6);
-      pen->x += glyph->advance_x;
+  // Add all glyphs at once rather than one vertex_buffer_push_back per glyph.
+  if (!vertices_.empty()) {
+    if (!vertex_buffers_by_layer_.count(z)) {
+      vertex_buffers_by_layer_[z] = vertex_buffer_new("vertex:3f,tex_coord:2f,color:4f");
     }
+    vertex_buffer_push_back(vertex_buffers_by_layer_.at(z), vertices_.data(), vertices_.size(),
+                            indices_.data(), indices_.size());
   }
 
   if (out_text_pos) {
@@ -263,47 +307,43 @@ float TextRenderer::AddTextTrailingCharsPrioritized(const char* text, float x, f
     Init();
   }
 
-  float temp_pen_x = ToScreenSpace(x);
+  std::optional<std::string> elided_text =
+      ElideTextTrailingCharsPrioritized(text, x, trailing_chars_length, font_size, max_size);
+  const char* fitting_text = elided_text.has_value() ? elided_text->c_str() : text;
+  AddText(fitting_text, x, y, z, color, font_size, max_size);
+  return GetStringWidth(fitting_text, font_size);
+}
+
+std::optional<std::string> TextRenderer::ElideTextTrailingCharsPrioritized(
+    const char* text, float x, size_t trailing_chars_length, uint32_t font_size, float max_size) {
+  float start_pen_x = ToScreenSpace(x);
   float max_width = max_size == -1.f ? FLT_MAX : ToScreenSpace(max_size);
   float string_width = 0.f;
   int min_x = INT_MAX;
   int max_x = -INT_MAX;
 
+  // Use the cached advances of the glyphs instead of measuring the text character by character.
   const size_t text_length = strlen(text);
-  texture_font_t* font = GetFont(font_size);
-  size_t i;
-  for (i = 0; i < text_length; ++i) {
-    if (!texture_font_find_glyph(font, text + i)) {
-      texture_font_load_glyph(font, text + i);
-    }
-
-    texture_glyph_t* glyph = texture_font_get_glyph(font, text + i);
-    if (glyph != NULL) {
-      float kerning = 0.0f;
-      if (i > 0) {
-        kerning = texture_glyph_get_kerning(glyph, text + i - 1);
-      }
-      temp_pen_x += kerning;
-      int x0 = static_cast<int>(temp_pen_x + glyph->offset_x);
-      int x1 = static_cast<int>(x0 + glyph->width);
-
-      min_x = std::min(min_x, x0);
-      max_x = std::max(max_x, x1);
-      string_width = float(max_x - min_x);
-
-      if (string_width > max_width) {
-        break;
-      }
-
-      temp_pen_x += glyph->advance_x;
+  const GlyphRun& glyph_run = GetGlyphRun(GetFont(font_size), text);
+  size_t fitting_chars_count = text_length;
+  for (const PositionedGlyph& positioned_glyph : glyph_run.glyphs) {
+    const texture_glyph_t* glyph = positioned_glyph.glyph;
+    int x0 = static_cast<int>(start_pen_x + positioned_glyph.pen.x + glyph->offset_x);
+    int x1 = static_cast<int>(x0 + glyph->width);
+
+    min_x = std::min(min_x, x0);
+    max_x = std::max(max_x, x1);
+    string_width = static_cast<float>(max_x - min_x);
+
+    if (string_width > max_width) {
+      fitting_chars_count = positioned_glyph.char_index;
+      break;
     }
   }
 
   // TODO: Technically, we'd want the size of "... <TIME>" + remaining
   // characters
 
-  auto fitting_chars_count = i;
-
   static const char* ELLIPSIS_TEXT = "... ";
   static const size_t ELLIPSIS_TEXT_LEN = strlen(ELLIPSIS_TEXT);
   static const size_t LEADING_CHARS_COUNT = 1;
@@ -311,22 +351,16 @@ float TextRenderer::AddTextTrailingCharsPrioritized(const char* text, float x, f
 
   bool use_ellipsis_text = (fitting_chars_count < text_length) &&
                            (fitting_chars_count > (trailing_chars_length + ELLIPSIS_BUFFER_SIZE));
+  if (!use_ellipsis_text) return std::nullopt;
 
-  if (!use_ellipsis_text) {
-    AddText(text, x, y, z, color, font_size, max_size);
-    return GetStringWidth(text, font_size);
-  } else {
-    auto leading_char_count = fitting_chars_count - (trailing_chars_length + ELLIPSIS_TEXT_LEN);
+  auto leading_char_count = fitting_chars_count - (trailing_chars_length + ELLIPSIS_TEXT_LEN);
 
-    std::string modified_text(text, leading_char_count);
-    modified_text.append(ELLIPSIS_TEXT);
+  std::string modified_text(text, leading_char_count);
+  modified_text.append(ELLIPSIS_TEXT);
 
-    auto timePosition = text_length - trailing_chars_length;
-    modified_text.append(&text[timePosition], trailing_chars_length);
-
-    AddText(modified_text.c_str(), x, y, z, color, font_size, max_size);
-    return GetStringWidth(modified_text.c_str(), font_size);
-  }
+  auto timePosition = text_length - trailing_chars_length;
+  modified_text.append(&text[timePosition], trailing_chars_length);
+  return modified_text;
 }
 
 float TextRenderer::GetStringWidth(const char* text, uint32_t font_size) {
@@ -338,43 +372,16 @@ float TextRenderer::GetStringHeight(const char* text, uint32_t font_size) {
 }
 
 int TextRenderer::GetStringWidthScreenSpace(const char* text, uint32_t font_size) {
-  float string_width = 0;
-
-  std::size_t len = strlen(text);
-  for (std::size_t i = 0; i < len; ++i) {
-    texture_glyph_t* glyph = texture_font_get_glyph(GetFont(font_size), text + i);
-    if (glyph != NULL) {
-      float kerning = 0.0f;
-      if (i > 0) {
-        kerning = texture_glyph_get_kerning(glyph, text + i - 1);
-      }
-
-      string_width += kerning;
-      string_width += glyph->advance_x;
-    }
-
-    // Only return width of first line.
-    if (text[i] == '\n') break;
-  }
-
-  return static_cast<int>(ceil(string_width));
+  // Only return width of first line.
+  return static_cast<int>(ceil(GetGlyphRun(GetFont(font_size), text).first_line_advance));
 }
 
 int TextRenderer::GetStringHeightScreenSpace(const char* text, uint32_t font_size) {
   int max_height = 0.f;
-  texture_font_t* font = GetFont(font_size);
-  for (std::size_t i = 0; i < strlen(text); ++i) {
-    if (!texture_font_find_glyph(font, text + i)) {
-      texture_font_load_glyph(font, text + i);
-    }
-
-    texture_glyph_t* glyph = texture_font_get_glyph(font, text + i);
-    if (glyph != nullptr) {
-      max_height = std::max(max_height, glyph->offset_y);
-    }
-
+  for (const PositionedGlyph& positioned_glyph : GetGlyphRun(GetFont(font_size), text).glyphs) {
     // Only return height of first line.
-    if (text[i] == '\n') break;
+    if (positioned_glyph.pen.y != 0.f) break;
+    max_height = std::max(max_height, positioned_glyph.glyph->offset_y);
   }
   return max_height;
 }
@@ -408,3 +415,30 @@ void TextRenderer::Clear() {
     vertex_buffer_clear(buffer);
   }
 }
+
+void TextRendererSegment::AddText(const char* text, float x, float y, float z, const Color& color,
+                                  uint32_t font_size, float max_size, bool right_justified,
+                                  Vec2* out_text_pos, Vec2* out_text_size) {
+  CHECK(out_text_pos == nullptr && out_text_size == nullptr);
+  texts_.push_back(Text{text, x, y, z, color, font_size, max_size, right_justified});
+}
+
+float TextRendererSegment::AddTextTrailingCharsPrioritized(const char* text, float x, float y,
+                                                           float z, const Color& color,
+                                                           size_t trailing_chars_length,
+                                                           uint32_t font_size, float max_size) {
+  absl::MutexLock lock(text_renderer_mutex_);
+  std::optional<std::string> elided_text = text_renderer_->ElideTextTrailingCharsPrioritized(
+      text, x, trailing_chars_length, font_size, max_size);
+  const char* fitting_text = elided_text.has_value() ? elided_text->c_str() : text;
+  texts_.push_back(Text{fitting_text, x, y, z, color, font_size, max_size, false});
+  return text_renderer_->GetStringWidth(fitting_text, font_size);
+}
+
+void TextRendererSegment::MoveTo(TextRenderer* text_renderer) {
+  for (const Text& text : texts_) {
+    text_renderer->AddText(text.text.c_str(), text.x, text.y, text.z, text.color, text.font_size,
+                           text.max_size, text.right_justified);
+  }
+  texts_.clear();
+}
@@ -7,13 +7,19 @@
 #include <freetype-gl/mat4.h>
 
 #include <map>
+#include <optional>
+#include <string>
+#include <vector>
 
 #include "Batcher.h"
 #include "OpenGl.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
 
 namespace ftgl {
 struct vertex_buffer_t;
 struct texture_font_t;
+struct texture_glyph_t;
 }  // namespace ftgl
 
 class GlCanvas;
@@ -21,7 +27,7 @@ class GlCanvas;
 class TextRenderer {
  public:
   explicit TextRenderer();
-  ~TextRenderer();
+  virtual ~TextRenderer();
 
   void Init();
   void Clear();
@@ -31,13 +37,19 @@ class TextRenderer {
   void RenderDebug(Batcher* batcher);
   [[nodiscard]] std::vector<float> GetLayers() const;
 
-  void AddText(const char* text, float x, float y, float z, const Color& color, uint32_t font_size,
-               float max_size = -1.f, bool right_justified = false, Vec2* out_text_pos = nullptr,
-               Vec2* out_text_size = nullptr);
+  virtual void AddText(const char* text, float x, float y, float z, const Color& color,
+                       uint32_t font_size, float max_size = -1.f, bool right_justified = false,
+                       Vec2* out_text_pos = nullptr, Vec2* out_text_size = nullptr);
 
-  float AddTextTrailingCharsPrioritized(const char* text, float x, float y, float z,
-                                        const Color& color, size_t trailing_chars_length,
-                                        uint32_t font_size, float max_size);
+  virtual float AddTextTrailingCharsPrioritized(const char* text, float x, float y, float z,
+                                                const Color& color, size_t trailing_chars_length,
+                                                uint32_t font_size, float max_size);
+
+  // Returns nullopt if text fits in max_size. Otherwise, if text is long enough, returns text with
+  // the characters before its last trailing_chars_length ones elided so that it fits, which is
+  // the text AddTextTrailingCharsPrioritized adds.
+  [[nodiscard]] std::optional<std::string> ElideTextTrailingCharsPrioritized(
+      const char* text, float x, size_t trailing_chars_length, uint32_t font_size, float max_size);
 
   [[nodiscard]] float GetStringWidth(const char* text, uint32_t font_size);
   [[nodiscard]] float GetStringHeight(const char* text, uint32_t font_size);
@@ -58,6 +70,42 @@ class TextRenderer {
   void DrawOutline(Batcher* batcher, vertex_buffer_t* buffer);
 
  private:
+  // Vertex layout of the "vertex:3f,tex_coord:2f,color:4f" vertex buffers.
+  struct Vertex {
+    float x, y, z;     // position
+    float s, t;        // texture
+    float r, g, b, a;  // color
+  };
+
+  struct PositionedGlyph {
+    texture_glyph_t* glyph;
+    // Pen position relative to the start of the text, with kerning applied.
+    vec2 pen;
+    // Index in the text of the character this is the glyph of.
+    size_t char_index;
+  };
+
+  // The glyphs of a text laid out with a font, so that adding or measuring the same text again
+  // doesn't look up glyphs and kernings character by character.
+  struct GlyphRun {
+    std::vector<PositionedGlyph> glyphs;
+    // Pen position after the last glyph, relative to the start of the text.
+    vec2 end_pen;
+    // Sum of advances and kernings up to the first line break, the width text is measured with.
+    float first_line_advance = 0.f;
+  };
+
+  [[nodiscard]] const GlyphRun& GetGlyphRun(texture_font_t* font, const char* text);
+
+  // Cleared when it gets too large, as labels containing times are rarely repeated exactly.
+  static constexpr size_t kMaxGlyphRunCount = 64 * 1024;
+  absl::flat_hash_map<const texture_font_t*, absl::flat_hash_map<std::string, GlyphRun>>
+      glyph_runs_by_font_;
+  size_t glyph_run_count_ = 0;
+  // Reused to add the vertices of a text to a vertex buffer at once.
+  std::vector<Vertex> vertices_;
+  std::vector<GLuint> indices_;
+
   texture_atlas_t* texture_atlas_;
   std::unordered_map<float, vertex_buffer_t*> vertex_buffers_by_layer_;
   std::map<uint32_t, texture_font_t*> fonts_by_size_;
@@ -71,6 +119,41 @@ class TextRenderer {
   static bool draw_outline_;
 };
 
+// Records the text added to it, to add it to a TextRenderer later. The glyph atlas of a
+// TextRenderer can't be shared between threads, so tracks updated in parallel add their text to
+// a segment each, and the segments are then moved to the TextRenderer in order, which gives the
+// same result as adding the text to it directly. Text is measured with the TextRenderer the
+// segment is moved to, under a mutex shared by all segments of that TextRenderer.
+class TextRendererSegment : public TextRenderer {
+ public:
+  TextRendererSegment(TextRenderer* text_renderer, absl::Mutex* text_renderer_mutex)
+      : text_renderer_(text_renderer), text_renderer_mutex_(text_renderer_mutex) {}
+
+  void AddText(const char* text, float x, float y, float z, const Color& color, uint32_t font_size,
+               float max_size = -1.f, bool right_justified = false, Vec2* out_text_pos = nullptr,
+               Vec2* out_text_size = nullptr) override;
+  float AddTextTrailingCharsPrioritized(const char* text, float x, float y, float z,
+                                        const Color& color, size_t trailing_chars_length,
+                                        uint32_t font_size, float max_size) override;
+
+  void MoveTo(TextRenderer* text_renderer);
+
+ private:
+  struct Text {
+    std::string text;
+    float x;
+    float y;
+    float z;
+    Color color;
+    uint32_t font_size;
+    float max_size;
+    bool right_justified;
+  };
+  TextRenderer* text_renderer_;
+  absl::Mutex* text_renderer_mutex_;
+  std::vector<Text> texts_;
+};
+
 inline vec4 ColorToVec4(const Color& color) {
   const float coeff = 1.f / 255.f;
   vec4 vec;
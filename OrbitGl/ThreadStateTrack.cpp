@@ -96,7 +96,7 @@ static std::string GetThreadStateName(ThreadStateSliceInfo::ThreadState state) {
   }
 }
 
-std::string ThreadStateTrack::GetThreadStateSliceTooltip(PickingId id) const {
+std::string ThreadStateTrack::GetBoxTooltip(PickingId id) const {
   auto user_data = time_graph_->GetBatcher().GetUserData(id);
   if (user_data == nullptr || user_data->custom_data_ == nullptr) {
     return "";
@@ -142,20 +142,20 @@ void ThreadStateTrack::UpdatePrimitives(uint64_t min_tick, uint64_t max_tick,
 
         const Color color = GetThreadStateColor(slice.thread_state());
 
-        auto user_data = std::make_unique<PickingUserData>(
-            nullptr, [&](PickingId id) { return GetThreadStateSliceTooltip(id); });
-        user_data->custom_data_ = &slice;
+        PickingUserData user_data;
+        user_data.track_ = this;
+        user_data.custom_data_ = &slice;
 
         if (slice.end_timestamp_ns() - slice.begin_timestamp_ns() > pixel_delta_ns) {
           Box box(pos, size, GlCanvas::kZValueEvent + z_offset);
-          batcher->AddBox(box, color, std::move(user_data));
+          batcher->AddBox(box, color, user_data);
         } else {
           // Make this slice cover an entire pixel and don't draw subsequent slices that would
           // coincide with the same pixel.
           // Use AddBox instead of AddVerticalLine as otherwise the tops of Boxes and lines wouldn't
           // be properly aligned.
           Box box(pos, {pixel_width_in_world_coords, size[1]}, GlCanvas::kZValueEvent + z_offset);
-          batcher->AddBox(box, color, std::move(user_data));
+          batcher->AddBox(box, color, user_data);
 
           if (pixel_delta_ns != 0) {
             ignore_until_ns =
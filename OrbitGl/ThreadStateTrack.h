@@ -29,7 +29,7 @@ class ThreadStateTrack final : public Track {
   bool IsEmpty() const override;
 
  private:
-  std::string GetThreadStateSliceTooltip(PickingId id) const;
+  std::string GetBoxTooltip(PickingId id) const override;
 };
 
 #endif  // ORBIT_GL_THREAD_STATE_TRACK_H_
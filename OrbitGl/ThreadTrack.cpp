@@ -47,7 +47,7 @@ const TextBox* ThreadTrack::GetRight(const TextBox* text_box) const {
 }
 
 std::string ThreadTrack::GetBoxTooltip(PickingId id) const {
-  const TextBox* text_box = time_graph_->GetBatcher().GetTextBox(id);
+  const TextBox* text_box = time_graph_->GetBatcher().GetTemporaryTextBox(id);
   if (!text_box || text_box->GetTimerInfo().type() == TimerInfo::kCoreActivity) {
     return "";
   }
@@ -58,7 +58,12 @@ std::string ThreadTrack::GetBoxTooltip(PickingId id) const {
                    : nullptr;
 
   if (!func) {
-    return text_box->GetText();
+    // Only introspection timers have no function, see SetTimesliceText.
+    const TimerInfo& timer_info = text_box->GetTimerInfo();
+    auto api_event = ManualInstrumentationManager::ApiEventFromTimerInfo(timer_info);
+    return absl::StrFormat(
+        "%s %s", api_event.name,
+        GetPrettyTime(TicksToDuration(timer_info.start(), timer_info.end())).c_str());
   }
 
   std::string function_name;
@@ -241,47 +246,31 @@ void ThreadTrack::SetTrackColor(Color color) {
 }
 
 void ThreadTrack::SetTimesliceText(const TimerInfo& timer_info, double elapsed_us, float min_x,
-                                   float z_offset, TextBox* text_box) {
-  TimeGraphLayout layout = time_graph_->GetLayout();
-  if (text_box->GetText().empty()) {
-    std::string time = GetPrettyTime(absl::Microseconds(elapsed_us));
-    text_box->SetElapsedTimeTextLength(time.length());
-
-    const FunctionInfo* func = GOrbitApp->GetSelectedFunction(timer_info.function_address());
-    if (func) {
-      std::string extra_info = GetExtraInfo(timer_info);
-      std::string name;
-      if (func->orbit_type() == FunctionInfo::kOrbitTimerStart) {
-        auto api_event = ManualInstrumentationManager::ApiEventFromTimerInfo(timer_info);
-        name = api_event.name;
-      } else {
-        name = function_utils::GetDisplayName(*func);
-      }
-
-      std::string text = absl::StrFormat("%s %s %s", name, extra_info.c_str(), time.c_str());
-
-      text_box->SetText(text);
-    } else if (timer_info.type() == TimerInfo::kIntrospection) {
+                                   float z_offset, const Vec2& pos, const Vec2& size) {
+  std::string time = GetPrettyTime(absl::Microseconds(elapsed_us));
+  std::string text;
+  const FunctionInfo* func = GOrbitApp->GetSelectedFunction(timer_info.function_address());
+  if (func) {
+    std::string extra_info = GetExtraInfo(timer_info);
+    std::string name;
+    if (func->orbit_type() == FunctionInfo::kOrbitTimerStart) {
       auto api_event = ManualInstrumentationManager::ApiEventFromTimerInfo(timer_info);
-      std::string text = absl::StrFormat("%s %s", api_event.name, time.c_str());
-      text_box->SetText(text);
+      name = api_event.name;
     } else {
-      ERROR(
-          "Unexpected case in ThreadTrack::SetTimesliceText, function=\"%s\", "
-          "type=%d",
-          func->name(), static_cast<int>(timer_info.type()));
+      name = function_utils::GetDisplayName(*func);
     }
+    text = absl::StrFormat("%s %s %s", name, extra_info.c_str(), time.c_str());
+  } else if (timer_info.type() == TimerInfo::kIntrospection) {
+    auto api_event = ManualInstrumentationManager::ApiEventFromTimerInfo(timer_info);
+    text = absl::StrFormat("%s %s", api_event.name, time.c_str());
+  } else {
+    ERROR(
+        "Unexpected case in ThreadTrack::SetTimesliceText, function_address=%#x, "
+        "type=%d",
+        timer_info.function_address(), static_cast<int>(timer_info.type()));
   }
 
-  const Color kTextWhite(255, 255, 255, 255);
-  const Vec2& box_pos = text_box->GetPos();
-  const Vec2& box_size = text_box->GetSize();
-  float pos_x = std::max(box_pos[0], min_x);
-  float max_size = box_pos[0] + box_size[0] - pos_x;
-  text_renderer_->AddTextTrailingCharsPrioritized(
-      text_box->GetText().c_str(), pos_x, text_box->GetPos()[1] + layout.GetTextOffset(),
-      GlCanvas::kZValueBox + z_offset, kTextWhite, text_box->GetElapsedTimeTextLength(),
-      time_graph_->CalculateZoomedFontSize(), max_size);
+  DrawTimesliceText(text, time.length(), min_x, z_offset, pos, size);
 }
 
 std::string ThreadTrack::GetTooltip() const {
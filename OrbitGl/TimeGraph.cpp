@@ -27,6 +27,7 @@
 #include "ThreadTrack.h"
 #include "absl/flags/flag.h"
 #include "absl/strings/str_format.h"
+#include "absl/synchronization/blocking_counter.h"
 
 using orbit_client_protos::CallstackEvent;
 using orbit_client_protos::FunctionInfo;
@@ -34,6 +35,15 @@ using orbit_client_protos::TimerInfo;
 
 TimeGraph* GCurrentTimeGraph = nullptr;
 
+namespace {
+
+// The segments the tracks updated by the calling thread add to, while tracks are updated in
+// parallel.
+thread_local Batcher* current_batcher_segment = nullptr;
+thread_local TextRenderer* current_text_renderer_segment = nullptr;
+
+}  // namespace
+
 TimeGraph::TimeGraph(uint32_t font_size) : font_size_(font_size), batcher_(BatcherId::kTimeGraph) {
   scheduler_track_ = GetOrCreateSchedulerTrack();
 
@@ -47,9 +57,12 @@ TimeGraph::TimeGraph(uint32_t font_size) : font_size_(font_size), batcher_(Batch
   num_cores_ = 0;
   manual_instrumentation_manager_ = GOrbitApp->GetManualInstrumentationManager();
   manual_instrumentation_manager_->AddAsyncTimerListener(async_timer_info_listener_.get());
+  update_thread_pool_ =
+      ThreadPool::Create(1 /*min_size*/, kMaxTrackGroupCount - 1 /*max_size*/, absl::Seconds(1));
 }
 
 TimeGraph::~TimeGraph() {
+  update_thread_pool_->ShutdownAndWait();
   manual_instrumentation_manager_->RemoveAsyncTimerListener(async_timer_info_listener_.get());
 }
 
@@ -473,50 +486,81 @@ void TimeGraph::Select(const TextBox* text_box) {
 
 const TextBox* TimeGraph::FindPreviousFunctionCall(uint64_t function_address, uint64_t current_time,
                                                    std::optional<int32_t> thread_id) const {
-  const TextBox* previous_box = nullptr;
+  const TimerBlock* previous_box_block = nullptr;
+  size_t previous_box_index = 0;
   uint64_t previous_box_time = std::numeric_limits<uint64_t>::lowest();
+  if (current_time == 0) return nullptr;
   std::vector<std::shared_ptr<TimerChain>> chains = GetAllThreadTrackTimerChains();
   for (auto& chain : chains) {
     if (!chain) continue;
-    for (const auto& block : *chain) {
+    // Only timers ending in (previous_box_time, current_time) are candidates.
+    auto [first_index, last_index] =
+        chain->GetIndexRangeIntersecting(previous_box_time + 1, current_time - 1);
+    for (TimerChainIterator it = chain->GetBlockIteratorContaining(first_index);
+         it != chain->end() && it->GetChainIndex(0) < last_index; ++it) {
+      const TimerBlock& block = *it;
       if (!block.Intersects(previous_box_time, current_time)) continue;
-      for (uint64_t i = 0; i < block.size(); i++) {
-        const TextBox& box = block[i];
-        auto box_time = box.GetTimerInfo().end();
-        if ((box.GetTimerInfo().function_address() == function_address) &&
-            (!thread_id || thread_id.value() == box.GetTimerInfo().thread_id()) &&
-            (box_time < current_time) && (previous_box_time < box_time)) {
-          previous_box = &box;
+      uint64_t block_first_index = block.GetChainIndex(0);
+      uint64_t first_i = first_index > block_first_index ? first_index - block_first_index : 0;
+      uint64_t last_i = std::min(block.size(), last_index - block_first_index);
+      for (uint64_t i = first_i; i < last_i; i++) {
+        auto box_time = block.GetEnd(i);
+        if ((box_time < current_time) && (previous_box_time < box_time) &&
+            (block.GetFunctionAddress(i) == function_address) &&
+            (!thread_id || thread_id.value() == block.GetThreadId(i))) {
+          previous_box_block = &block;
+          previous_box_index = i;
           previous_box_time = box_time;
         }
       }
     }
   }
-  return previous_box;
+  if (previous_box_block == nullptr) return nullptr;
+  return previous_box_block->GetTextBox(previous_box_index);
 }
 
 const TextBox* TimeGraph::FindNextFunctionCall(uint64_t function_address, uint64_t current_time,
                                                std::optional<int32_t> thread_id) const {
-  const TextBox* next_box = nullptr;
+  const TimerBlock* next_box_block = nullptr;
+  size_t next_box_index = 0;
   uint64_t next_box_time = std::numeric_limits<uint64_t>::max();
+  if (current_time == std::numeric_limits<uint64_t>::max()) return nullptr;
   std::vector<std::shared_ptr<TimerChain>> chains = GetAllThreadTrackTimerChains();
   for (auto& chain : chains) {
     if (!chain) continue;
-    for (const auto& block : *chain) {
+    // Only timers ending in (current_time, next_box_time) are candidates.
+    auto [first_index, last_index] =
+        chain->GetIndexRangeIntersecting(current_time + 1, next_box_time - 1);
+    for (TimerChainIterator it = chain->GetBlockIteratorContaining(first_index);
+         it != chain->end() && it->GetChainIndex(0) < last_index; ++it) {
+      const TimerBlock& block = *it;
       if (!block.Intersects(current_time, next_box_time)) continue;
-      for (uint64_t i = 0; i < block.size(); i++) {
-        const TextBox& box = block[i];
-        auto box_time = box.GetTimerInfo().end();
-        if ((box.GetTimerInfo().function_address() == function_address) &&
-            (!thread_id || thread_id.value() == box.GetTimerInfo().thread_id()) &&
-            (box_time > current_time) && (next_box_time > box_time)) {
-          next_box = &box;
+      uint64_t block_first_index = block.GetChainIndex(0);
+      uint64_t first_i = first_index > block_first_index ? first_index - block_first_index : 0;
+      uint64_t last_i = std::min(block.size(), last_index - block_first_index);
+      for (uint64_t i = first_i; i < last_i; i++) {
+        auto box_time = block.GetEnd(i);
+        if ((box_time > current_time) && (next_box_time > box_time) &&
+            (block.GetFunctionAddress(i) == function_address) &&
+            (!thread_id || thread_id.value() == block.GetThreadId(i))) {
+          next_box_block = &block;
+          next_box_index = i;
           next_box_time = box_time;
         }
       }
     }
   }
-  return next_box;
+  if (next_box_block == nullptr) return nullptr;
+  return next_box_block->GetTextBox(next_box_index);
+}
+
+Batcher& TimeGraph::GetBatcher() {
+  return current_batcher_segment != nullptr ? *current_batcher_segment : batcher_;
+}
+
+TextRenderer* TimeGraph::GetTextRenderer() {
+  return current_text_renderer_segment != nullptr ? current_text_renderer_segment
+                                                  : &text_renderer_static_;
 }
 
 void TimeGraph::NeedsUpdate() {
@@ -580,15 +624,23 @@ void TimeGraph::SelectEvents(float world_start, float world_end, int32_t thread_
 }
 
 const std::vector<CallstackEvent>& TimeGraph::GetSelectedCallstackEvents(int32_t tid) {
-  return selected_callstack_events_per_thread_[tid];
+  // Called while updating tracks in parallel, so this must not insert into the map.
+  static const std::vector<CallstackEvent> kNoEvents;
+  auto it = selected_callstack_events_per_thread_.find(tid);
+  if (it == selected_callstack_events_per_thread_.end()) return kNoEvents;
+  return it->second;
 }
 
 void TimeGraph::Draw(GlCanvas* canvas, PickingMode picking_mode) {
   ORBIT_SCOPE("TimeGraph::Draw");
   current_mouse_time_ns_ = GetTickFromWorld(canvas_->GetMouseX());
 
-  const bool picking = picking_mode != PickingMode::kNone;
-  if ((!picking && needs_update_primitives_) || picking) {
+  // While capturing, primitives are updated every frame, so there is nothing to retain.
+  batcher_.SetRetained(!GOrbitApp->IsCapturing());
+
+  // Tracks add the same primitives whether picking or not, so picking, e.g., when hovering, draws
+  // the retained primitives instead of updating them.
+  if (needs_update_primitives_) {
     UpdatePrimitives(picking_mode);
   }
 
@@ -1004,6 +1056,12 @@ void TimeGraph::SortTracks() {
   }
 }
 
+void TimeGraph::SetSortedTracks(std::vector<std::shared_ptr<Track>> sorted_tracks) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  sorted_tracks_ = std::move(sorted_tracks);
+  UpdateFilteredTrackList();
+}
+
 void TimeGraph::UpdateFilteredTrackList() {
   if (thread_filter_.empty()) {
     sorted_filtered_tracks_ = sorted_tracks_;
@@ -1089,6 +1147,15 @@ int TimeGraph::FindMovingTrackIndex() {
 }
 
 void TimeGraph::UpdateTracks(uint64_t min_tick, uint64_t max_tick, PickingMode picking_mode) {
+  if (sorted_filtered_tracks_.size() > 1 &&
+      UpdateTracksInParallel(min_tick, max_tick, picking_mode)) {
+    return;
+  }
+  UpdateTracksSerially(min_tick, max_tick, picking_mode);
+}
+
+void TimeGraph::UpdateTracksSerially(uint64_t min_tick, uint64_t max_tick,
+                                     PickingMode picking_mode) {
   // Make sure track tab fits in the viewport.
   float current_y = -layout_.GetSchedulerTrackOffset() - layout_.GetTrackTabHeight();
   float pinned_tracks_height = 0.f;
@@ -1123,6 +1190,85 @@ void TimeGraph::UpdateTracks(uint64_t min_tick, uint64_t max_tick, PickingMode p
   min_y_ = current_y;
 }
 
+bool TimeGraph::UpdateTracksInParallel(uint64_t min_tick, uint64_t max_tick,
+                                       PickingMode picking_mode) {
+  ORBIT_SCOPE_FUNCTION;
+  // Lay out the tracks as in UpdateTracks, but with their heights before updating them.
+  std::vector<std::pair<Track*, float>> tracks_and_z_offsets;
+  std::vector<float> heights;
+  float current_y = -layout_.GetSchedulerTrackOffset() - layout_.GetTrackTabHeight();
+  for (auto& track : sorted_filtered_tracks_) {
+    if (!track->IsPinned()) continue;
+    track->SetY(current_y + canvas_->GetWorldTopLeftY() - layout_.GetTopMargin() -
+                layout_.GetSchedulerTrackOffset());
+    tracks_and_z_offsets.emplace_back(track.get(), GlCanvas::kZOffsetPinnedTrack);
+    heights.push_back(track->GetHeight());
+    current_y -= (heights.back() + layout_.GetSpaceBetweenTracks());
+  }
+  for (auto& track : sorted_filtered_tracks_) {
+    if (track->IsPinned()) continue;
+    track->SetY(current_y);
+    tracks_and_z_offsets.emplace_back(track.get(),
+                                      track->IsMoving() ? GlCanvas::kZOffsetMovingTack : 0.f);
+    heights.push_back(track->GetHeight());
+    current_y -= (heights.back() + layout_.GetSpaceBetweenTracks());
+  }
+
+  // Each group of consecutive tracks fills its own segments. Merging the segments in order then
+  // gives the same primitives and text as updating all tracks in order on this thread.
+  const size_t group_count = std::min(tracks_and_z_offsets.size(), kMaxTrackGroupCount);
+  while (batcher_segments_.size() < group_count) {
+    batcher_segments_.push_back(Batcher::CreateSegment(BatcherId::kTimeGraph));
+    text_renderer_segments_.push_back(std::make_unique<TextRendererSegment>(
+        &text_renderer_static_, &text_renderer_static_mutex_));
+  }
+  // The segments measure text with text_renderer_static_, whose fonts are loaded with the GL
+  // context of this thread. Without a canvas, there is no text to measure.
+  if (canvas_ != nullptr) text_renderer_static_.Init();
+
+  auto update_group = [&](size_t group) {
+    ORBIT_SCOPE("Update track group");
+    current_batcher_segment = batcher_segments_[group].get();
+    current_text_renderer_segment = text_renderer_segments_[group].get();
+    size_t begin = tracks_and_z_offsets.size() * group / group_count;
+    size_t end = tracks_and_z_offsets.size() * (group + 1) / group_count;
+    for (size_t i = begin; i < end; ++i) {
+      auto [track, z_offset] = tracks_and_z_offsets[i];
+      track->UpdatePrimitives(min_tick, max_tick, picking_mode, z_offset);
+    }
+    current_batcher_segment = nullptr;
+    current_text_renderer_segment = nullptr;
+  };
+
+  absl::BlockingCounter groups_left(group_count - 1);
+  for (size_t group = 0; group + 1 < group_count; ++group) {
+    update_thread_pool_->Schedule([&update_group, &groups_left, group] {
+      update_group(group);
+      groups_left.DecrementCount();
+    });
+  }
+  update_group(group_count - 1);
+  groups_left.Wait();
+
+  for (size_t group = 0; group < group_count; ++group) {
+    batcher_.MergeFrom(batcher_segments_[group].get());
+    text_renderer_segments_[group]->MoveTo(&text_renderer_static_);
+  }
+
+  // Updating a track can increase its depth, and so move the tracks below it. Depths are mostly
+  // updated when timers are added, so this is rare.
+  for (size_t i = 0; i < tracks_and_z_offsets.size(); ++i) {
+    if (tracks_and_z_offsets[i].first->GetHeight() != heights[i]) {
+      batcher_.StartNewFrame();
+      text_renderer_static_.Clear();
+      return false;
+    }
+  }
+
+  min_y_ = current_y;
+  return true;
+}
+
 void TimeGraph::SelectAndZoom(const TextBox* text_box) {
   CHECK(text_box);
   Zoom(text_box->GetTimerInfo());
@@ -19,6 +19,7 @@
 #include "GraphTrack.h"
 #include "ManualInstrumentationManager.h"
 #include "OrbitBase/Profiling.h"
+#include "OrbitBase/ThreadPool.h"
 #include "OrbitBase/Tracing.h"
 #include "OrbitClientModel/CaptureData.h"
 #include "SchedulerTrack.h"
@@ -30,6 +31,7 @@
 #include "Timer.h"
 #include "TimerChain.h"
 #include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
 #include "capture_data.pb.h"
 
 class TimeGraph {
@@ -48,6 +50,10 @@ class TimeGraph {
   void UpdateFilteredTrackList();
   void UpdateMovingTrackSorting();
   void UpdateTracks(uint64_t min_tick, uint64_t max_tick, PickingMode picking_mode);
+  void UpdateTracksSerially(uint64_t min_tick, uint64_t max_tick, PickingMode picking_mode);
+  // Returns false, with nothing updated, if updating a track changed its height.
+  [[nodiscard]] bool UpdateTracksInParallel(uint64_t min_tick, uint64_t max_tick,
+                                            PickingMode picking_mode);
   void SelectEvents(float world_start, float world_end, int32_t thread_id);
   const std::vector<orbit_client_protos::CallstackEvent>& GetSelectedCallstackEvents(int32_t tid);
 
@@ -113,7 +119,8 @@ class TimeGraph {
 
   [[nodiscard]] int GetNumDrawnTextBoxes() { return num_drawn_text_boxes_; }
   void SetTextRenderer(TextRenderer* text_renderer) { text_renderer_ = text_renderer; }
-  [[nodiscard]] TextRenderer* GetTextRenderer() { return &text_renderer_static_; }
+  // While tracks are updated in parallel, these return the segments of the calling thread.
+  [[nodiscard]] TextRenderer* GetTextRenderer();
   void SetStringManager(std::shared_ptr<StringManager> str_manager);
   [[nodiscard]] StringManager* GetStringManager() { return string_manager_.get(); }
   void SetCanvas(GlCanvas* canvas);
@@ -121,7 +128,7 @@ class TimeGraph {
   [[nodiscard]] uint32_t CalculateZoomedFontSize() const {
     return lround((font_size_)*layout_.GetScale());
   }
-  [[nodiscard]] Batcher& GetBatcher() { return batcher_; }
+  [[nodiscard]] Batcher& GetBatcher();
   [[nodiscard]] uint32_t GetNumTimers() const;
   [[nodiscard]] uint32_t GetNumCores() const { return num_cores_; }
   [[nodiscard]] std::vector<std::shared_ptr<TimerChain>> GetAllTimerChains() const;
@@ -188,6 +195,8 @@ class TimeGraph {
       const orbit_client_protos::FunctionInfo& function);
 
   void AddTrack(std::shared_ptr<Track> track);
+  // Sets the tracks to draw, in order, instead of SortTracks.
+  void SetSortedTracks(std::vector<std::shared_ptr<Track>> sorted_tracks);
   int FindMovingTrackIndex();
 
   [[nodiscard]] std::vector<int32_t> GetSortedThreadIds();
@@ -243,6 +252,16 @@ class TimeGraph {
   bool draw_text_ = true;
 
   Batcher batcher_;
+  // Filled by groups of tracks updated in parallel, and then merged into batcher_ and
+  // text_renderer_static_.
+  static constexpr size_t kMaxTrackGroupCount = 16;
+  std::vector<std::unique_ptr<Batcher>> batcher_segments_;
+  std::vector<std::unique_ptr<TextRendererSegment>> text_renderer_segments_;
+  // Held by the segments to measure text with text_renderer_static_.
+  absl::Mutex text_renderer_static_mutex_;
+  // Dedicated to updating groups of tracks, so that frames don't wait for the tasks of the app's
+  // thread pool.
+  std::unique_ptr<ThreadPool> update_thread_pool_;
   Timer last_thread_reorder_;
 
   // TODO(b/174655559): Use absl's mutex here.
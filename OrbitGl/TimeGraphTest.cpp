@@ -0,0 +1,141 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "App.h"
+#include "ApplicationOptions.h"
+#include "Batcher.h"
+#include "Geometry.h"
+#include "TimeGraph.h"
+#include "Track.h"
+
+namespace {
+
+// A track adding a row of boxes, whose user data identifies the track and the box.
+class FakeTrack : public Track {
+ public:
+  FakeTrack(TimeGraph* time_graph, size_t index, float height, size_t box_count)
+      : Track(time_graph), height_(height) {
+    for (size_t i = 0; i < box_count; ++i) {
+      box_ids_.emplace_back(index, i);
+    }
+  }
+
+  [[nodiscard]] Type GetType() const override { return kUnknown; }
+  [[nodiscard]] bool IsEmpty() const override { return false; }
+  [[nodiscard]] float GetHeight() const override { return height_; }
+
+  void UpdatePrimitives(uint64_t /*min_tick*/, uint64_t /*max_tick*/,
+                        PickingMode /*picking_mode*/, float z_offset) override {
+    Batcher& batcher = time_graph_->GetBatcher();
+    for (size_t i = 0; i < box_ids_.size(); ++i) {
+      PickingUserData user_data;
+      user_data.track_ = this;
+      user_data.custom_data_ = &box_ids_[i];
+      Box box(Vec2(static_cast<float>(i), pos_[1] - height_), Vec2(1.f, height_), z_offset);
+      batcher.AddBox(box, Color(255, 0, 0, 255), user_data);
+    }
+    height_ += height_increment_;
+  }
+
+  void SetHeightIncrement(float height_increment) { height_increment_ = height_increment; }
+
+ private:
+  float height_;
+  float height_increment_ = 0.f;
+  std::vector<std::pair<size_t, size_t>> box_ids_;
+};
+
+class TestTimeGraph : public TimeGraph {
+ public:
+  TestTimeGraph() : TimeGraph(/*font_size=*/14) {
+    // More tracks than groups of tracks, with different heights and numbers of boxes.
+    constexpr size_t kTrackCount = 40;
+    std::vector<std::shared_ptr<Track>> tracks;
+    for (size_t i = 0; i < kTrackCount; ++i) {
+      auto track = std::make_shared<FakeTrack>(this, i, 10.f + static_cast<float>(i), i % 7 * 10);
+      box_count_ += i % 7 * 10;
+      fake_tracks_.push_back(track.get());
+      tracks.push_back(std::move(track));
+    }
+    SetSortedTracks(std::move(tracks));
+  }
+
+  [[nodiscard]] const std::vector<FakeTrack*>& GetFakeTracks() const { return fake_tracks_; }
+
+  // The track and box of each box added, in order of picking id.
+  [[nodiscard]] std::vector<std::pair<size_t, size_t>> GetBoxIds() {
+    std::vector<std::pair<size_t, size_t>> box_ids;
+    for (size_t i = 0; i < box_count_; ++i) {
+      const PickingUserData* user_data =
+          GetBatcher().GetUserData(PickingId::Create(PickingType::kBox, static_cast<uint32_t>(i)));
+      box_ids.push_back(*static_cast<const std::pair<size_t, size_t>*>(user_data->custom_data_));
+    }
+    return box_ids;
+  }
+
+ private:
+  std::vector<FakeTrack*> fake_tracks_;
+  size_t box_count_ = 0;
+};
+
+class TimeGraphTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    GOrbitApp = std::make_unique<OrbitApp>(ApplicationOptions{}, nullptr);
+  }
+
+  void TearDown() override {
+    GOrbitApp->GetThreadPool()->ShutdownAndWait();
+    GOrbitApp = nullptr;
+  }
+};
+
+void ExpectSameTracksAndBoxes(TestTimeGraph* actual, TestTimeGraph* expected) {
+  ASSERT_EQ(actual->GetFakeTracks().size(), expected->GetFakeTracks().size());
+  for (size_t i = 0; i < actual->GetFakeTracks().size(); ++i) {
+    EXPECT_EQ(actual->GetFakeTracks()[i]->GetPos()[1], expected->GetFakeTracks()[i]->GetPos()[1]);
+  }
+  // Layers are stored in an unordered map, whose order depends on the order they were added in.
+  std::vector<float> actual_layers = actual->GetBatcher().GetLayers();
+  std::vector<float> expected_layers = expected->GetBatcher().GetLayers();
+  std::sort(actual_layers.begin(), actual_layers.end());
+  std::sort(expected_layers.begin(), expected_layers.end());
+  EXPECT_EQ(actual_layers, expected_layers);
+  EXPECT_EQ(actual->GetBoxIds(), expected->GetBoxIds());
+}
+
+}  // namespace
+
+TEST_F(TimeGraphTest, UpdatingTracksInParallelEqualsUpdatingThemSerially) {
+  TestTimeGraph serial_time_graph;
+  serial_time_graph.UpdateTracksSerially(0, 1000, PickingMode::kNone);
+
+  TestTimeGraph parallel_time_graph;
+  ASSERT_TRUE(parallel_time_graph.UpdateTracksInParallel(0, 1000, PickingMode::kNone));
+
+  ExpectSameTracksAndBoxes(&parallel_time_graph, &serial_time_graph);
+}
+
+TEST_F(TimeGraphTest, UpdatingTracksInParallelFailsWithoutSideEffectsWhenAHeightChanges) {
+  TestTimeGraph serial_time_graph;
+  serial_time_graph.GetFakeTracks()[3]->SetHeightIncrement(5.f);
+  serial_time_graph.UpdateTracksSerially(0, 1000, PickingMode::kNone);
+  serial_time_graph.GetBatcher().StartNewFrame();
+  serial_time_graph.UpdateTracksSerially(0, 1000, PickingMode::kNone);
+
+  TestTimeGraph parallel_time_graph;
+  parallel_time_graph.GetFakeTracks()[3]->SetHeightIncrement(5.f);
+  EXPECT_FALSE(parallel_time_graph.UpdateTracksInParallel(0, 1000, PickingMode::kNone));
+  parallel_time_graph.UpdateTracksSerially(0, 1000, PickingMode::kNone);
+
+  ExpectSameTracksAndBoxes(&parallel_time_graph, &serial_time_graph);
+}
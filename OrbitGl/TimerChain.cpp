@@ -8,30 +8,74 @@
 
 #include "OrbitBase/Logging.h"
 
-void TimerBlock::Add(const TextBox& item) {
+using orbit_client_protos::TimerInfo;
+
+void TimerBlock::Add(const TimerInfo& timer_info) {
   if (size_ == kBlockSize) {
     if (next_ == nullptr) {
-      next_ = new TimerBlock(chain_, this);
+      next_ = new TimerBlock(chain_, this, first_index_ + kBlockSize);
+      absl::MutexLock lock(&chain_->mutex_);
+      chain_->blocks_.push_back(next_);
     }
 
     chain_->current_ = next_;
     ++chain_->num_blocks_;
-    next_->Add(item);
+    next_->Add(timer_info);
     return;
   }
 
   CHECK(size_ < kBlockSize);
-  data_[size_] = item;
+  if (timer_info.start() < chain_->last_start_ && chain_->is_sorted_by_start_) {
+    chain_->is_sorted_by_start_ = false;
+    absl::MutexLock lock(&chain_->mutex_);
+    chain_->lod_.Clear();
+  }
+  chain_->last_start_ = timer_info.start();
+  starts_[size_] = timer_info.start();
+  ends_[size_] = timer_info.end();
+  user_data_keys_[size_] = timer_info.user_data_key();
+  key_ids_[size_] = chain_->InternKey(timer_info);
+  chain_->AddExtras(first_index_ + size_, timer_info);
   ++size_;
   ++chain_->num_items_;
-  min_timestamp_ = std::min(item.GetTimerInfo().start(), min_timestamp_);
-  max_timestamp_ = std::max(item.GetTimerInfo().end(), max_timestamp_);
+  min_timestamp_ = std::min(timer_info.start(), min_timestamp_);
+  max_timestamp_ = std::max(timer_info.end(), max_timestamp_);
+  max_end_up_to_block_ = std::max(timer_info.end(), max_end_up_to_block_);
+  if (size_ == kBlockSize && chain_->is_sorted_by_start_) {
+    chain_->AddToLod(*this);
+  }
 }
 
 bool TimerBlock::Intersects(uint64_t min, uint64_t max) const {
   return (min <= max_timestamp_ && max >= min_timestamp_);
 }
 
+uint64_t TimerBlock::GetFunctionAddress(size_t idx) const {
+  return chain_->GetKey(key_ids_[idx]).function_address;
+}
+
+int32_t TimerBlock::GetThreadId(size_t idx) const {
+  return chain_->GetKey(key_ids_[idx]).thread_id;
+}
+
+void TimerBlock::GetTimerInfo(size_t idx, TimerInfo* timer_info) const {
+  chain_->GetTimerInfo(*this, idx, timer_info);
+}
+
+TimerInfo TimerBlock::GetTimerInfo(size_t idx) const {
+  TimerInfo timer_info;
+  chain_->GetTimerInfo(*this, idx, &timer_info);
+  return timer_info;
+}
+
+TextBox* TimerBlock::GetTextBox(size_t idx) const {
+  return chain_->GetTextBox(*this, idx, /*is_kept=*/true);
+}
+
+TextBox* TimerBlock::GetTemporaryTextBox(size_t idx) const {
+  return chain_->GetTextBox(*this, idx, /*is_kept=*/false);
+}
+
 TimerChain::~TimerChain() {
   // Find last block in chain
   while (current_->next_) current_ = current_->next_;
@@ -44,47 +88,316 @@ TimerChain::~TimerChain() {
   }
 }
 
-TimerBlock* TimerChain::GetBlockContaining(const TextBox* element) const {
-  TimerBlock* block = root_;
-  while (block) {
-    uint32_t size = block->size_;
-    if (size) {
-      TextBox* begin = &block->data_[0];
-      TextBox* end = &block->data_[size - 1];
-      if (begin <= element && end >= element) {
-        return block;
+void TimerChain::AddToLod(const TimerBlock& block) {
+  absl::MutexLock lock(&mutex_);
+  for (size_t k = 0; k < block.size_; ++k) {
+    LongestTimer longest_timer{block.first_index_ + k, block.ends_[k] - block.starts_[k]};
+    // Can't fail, as timers are added in order of start.
+    CHECK(lod_.Add(block.starts_[k], longest_timer));
+  }
+  lod_timer_count_ = block.first_index_ + block.size_;
+  lod_.PruneFinestLevels(lod_timer_count_ / kMinTimersPerLodBucket);
+}
+
+uint32_t TimerChain::InternKey(const TimerInfo& timer_info) {
+  TimerKey key{timer_info.function_address(), timer_info.timeline_hash(),
+               timer_info.process_id(),       timer_info.thread_id(),
+               timer_info.depth(),            timer_info.type(),
+               timer_info.processor()};
+  auto it = key_ids_.find(key);
+  if (it != key_ids_.end()) {
+    return it->second;
+  }
+
+  const uint32_t key_id = key_count_.load(std::memory_order_relaxed);
+  auto [chunk, offset] = GetKeyChunkAndOffset(key_id);
+  CHECK(chunk < kKeyChunkCount);
+  if (offset == 0) {
+    key_chunks_[chunk] = std::make_unique<TimerKey[]>(kFirstKeyChunkSize << chunk);
+  }
+  key_chunks_[chunk][offset] = key;
+  key_count_.store(key_id + 1, std::memory_order_release);
+  key_ids_.emplace(key, key_id);
+  return key_id;
+}
+
+std::pair<size_t, size_t> TimerChain::GetKeyChunkAndOffset(uint32_t key_id) {
+  // Chunk c holds kFirstKeyChunkSize << c keys, the ids from kFirstKeyChunkSize * (2^c - 1).
+  uint64_t chunk_begin = 0;
+  size_t chunk = 0;
+  while (key_id - chunk_begin >= (uint64_t{kFirstKeyChunkSize} << chunk)) {
+    chunk_begin += uint64_t{kFirstKeyChunkSize} << chunk;
+    ++chunk;
+  }
+  return std::make_pair(chunk, key_id - chunk_begin);
+}
+
+void TimerChain::AddExtras(uint64_t index, const TimerInfo& timer_info) {
+  if (timer_info.callstack_id() == 0 && timer_info.registers_size() == 0) {
+    return;
+  }
+
+  absl::MutexLock lock(&mutex_);
+  TimerExtras& extras = extras_[index];
+  extras.callstack_id = timer_info.callstack_id();
+  extras.registers.assign(timer_info.registers().begin(), timer_info.registers().end());
+  has_extras_ = true;
+}
+
+const TimerChain::TimerKey& TimerChain::GetKey(uint32_t key_id) const {
+  // Synchronizes with the store in InternKey, after which the key is not modified anymore.
+  CHECK(key_id < key_count_.load(std::memory_order_acquire));
+  auto [chunk, offset] = GetKeyChunkAndOffset(key_id);
+  return key_chunks_[chunk][offset];
+}
+
+void TimerChain::GetTimerInfo(const TimerBlock& block, size_t idx, TimerInfo* timer_info) const {
+  CHECK(idx < block.size_);
+  timer_info->Clear();
+  timer_info->set_start(block.starts_[idx]);
+  timer_info->set_end(block.ends_[idx]);
+  timer_info->set_user_data_key(block.user_data_keys_[idx]);
+
+  const TimerKey& key = GetKey(block.key_ids_[idx]);
+  timer_info->set_function_address(key.function_address);
+  timer_info->set_timeline_hash(key.timeline_hash);
+  timer_info->set_process_id(key.process_id);
+  timer_info->set_thread_id(key.thread_id);
+  timer_info->set_depth(key.depth);
+  timer_info->set_type(static_cast<TimerInfo::Type>(key.type));
+  timer_info->set_processor(key.processor);
+
+  if (!has_extras_) {
+    return;
+  }
+  absl::ReaderMutexLock lock(&mutex_);
+  auto extras_it = extras_.find(block.first_index_ + idx);
+  if (extras_it != extras_.end()) {
+    timer_info->set_callstack_id(extras_it->second.callstack_id);
+    for (uint64_t register_value : extras_it->second.registers) {
+      timer_info->add_registers(register_value);
+    }
+  }
+}
+
+void TimerChain::AddToColumns(uint64_t begin, uint64_t end,
+                              capture_columns::TimerColumnsBuilder* builder) const {
+  end = std::min(end, size());
+  absl::ReaderMutexLock lock(&mutex_);
+  uint64_t index = begin;
+  while (index < end) {
+    const TimerBlock* block = blocks_[index / kBlockSize];
+    const uint64_t block_end = std::min(end, block->first_index_ + block->size_);
+    if (index >= block_end) break;
+    for (; index < block_end; ++index) {
+      const size_t idx = index - block->first_index_;
+      const TimerKey& key = GetKey(block->key_ids_[idx]);
+      capture_columns::TimerFields timer;
+      timer.start = block->starts_[idx];
+      timer.end = block->ends_[idx];
+      timer.user_data_key = block->user_data_keys_[idx];
+      timer.function_address = key.function_address;
+      timer.timeline_hash = key.timeline_hash;
+      timer.process_id = key.process_id;
+      timer.thread_id = key.thread_id;
+      timer.depth = key.depth;
+      timer.type = key.type;
+      timer.processor = key.processor;
+      if (has_extras_) {
+        auto extras_it = extras_.find(index);
+        if (extras_it != extras_.end()) {
+          timer.callstack_id = extras_it->second.callstack_id;
+          timer.registers = extras_it->second.registers;
+        }
       }
+      builder->Add(timer);
     }
-    block = block->next_;
   }
+}
 
-  return nullptr;
+TextBox* TimerChain::GetTextBox(const TimerBlock& block, size_t idx, bool is_kept) const {
+  uint64_t index = block.first_index_ + idx;
+  {
+    absl::MutexLock lock(&mutex_);
+    auto it = text_boxes_.find(index);
+    if (it != text_boxes_.end()) {
+      CachedTextBox& cached_text_box = it->second;
+      if (is_kept) {
+        cached_text_box.is_kept = true;
+      } else {
+        cached_text_box.is_used_since_eviction = true;
+      }
+      return &cached_text_box.text_box;
+    }
+  }
+
+  CachedTextBox cached_text_box{TextBox(Vec2(0, 0), Vec2(0, 0), ""), is_kept, !is_kept};
+  cached_text_box.text_box.SetTimerInfo(block.GetTimerInfo(idx));
+
+  absl::MutexLock lock(&mutex_);
+  auto [it, inserted] = text_boxes_.try_emplace(index, std::move(cached_text_box));
+  if (inserted) {
+    text_box_indices_.emplace(&it->second.text_box, index);
+  }
+  return &it->second.text_box;
 }
 
-TextBox* TimerChain::GetElementAfter(const TextBox* element) const {
-  auto block = GetBlockContaining(element);
-  if (block) {
-    TextBox* begin = &block->data_[0];
-    uint32_t index = element - begin;
-    if (index < block->size_ - 1) {
-      return &block->data_[++index];
+void TimerChain::EvictUnusedTemporaryTextBoxes() {
+  absl::MutexLock lock(&mutex_);
+  for (auto it = text_boxes_.begin(); it != text_boxes_.end();) {
+    CachedTextBox& cached_text_box = it->second;
+    if (!cached_text_box.is_kept && !cached_text_box.is_used_since_eviction) {
+      text_box_indices_.erase(&cached_text_box.text_box);
+      text_boxes_.erase(it++);
+      continue;
     }
-    if (block->next_ && block->next_->size_) {
-      return &block->next_->data_[0];
+    cached_text_box.is_used_since_eviction = false;
+    ++it;
+  }
+}
+
+const TimerBlock* TimerChain::GetBlockContaining(uint64_t index) const {
+  const TimerBlock* block = nullptr;
+  {
+    absl::ReaderMutexLock lock(&mutex_);
+    uint64_t block_index = index / kBlockSize;
+    if (block_index >= blocks_.size()) return nullptr;
+    block = blocks_[block_index];
+  }
+  if (index >= block->first_index_ + block->size_) return nullptr;
+  return block;
+}
+
+uint64_t TimerChain::GetFirstIndexStartingAfter(uint64_t time) const {
+  if (!is_sorted_by_start_) {
+    for (const TimerBlock* block = root_; block != nullptr; block = block->next_) {
+      for (size_t k = 0; k < block->size_; ++k) {
+        if (block->starts_[k] > time) return block->first_index_ + k;
+      }
     }
+    return num_items_;
+  }
+
+  const TimerBlock* block = nullptr;
+  {
+    absl::ReaderMutexLock lock(&mutex_);
+    auto block_it = std::partition_point(
+        blocks_.begin(), blocks_.end(), [time](const TimerBlock* block) {
+          return block->size_ > 0 && block->starts_[block->size_ - 1] <= time;
+        });
+    if (block_it == blocks_.end()) return num_items_;
+    block = *block_it;
   }
-  return nullptr;
+  const uint64_t* start_it = std::upper_bound(block->starts_, block->starts_ + block->size_, time);
+  return block->first_index_ + (start_it - block->starts_);
 }
 
-TextBox* TimerChain::GetElementBefore(const TextBox* element) const {
-  auto block = GetBlockContaining(element);
-  if (block) {
-    TextBox* begin = &block->data_[0];
-    uint32_t index = element - begin;
-    if (index > 0) {
-      return &block->data_[--index];
+uint64_t TimerChain::GetFirstIndexEndingAtOrAfter(uint64_t time) const {
+  const TimerBlock* block = nullptr;
+  {
+    absl::ReaderMutexLock lock(&mutex_);
+    auto block_it = std::partition_point(
+        blocks_.begin(), blocks_.end(),
+        [time](const TimerBlock* block) { return block->max_end_up_to_block_ < time; });
+    if (block_it == blocks_.end()) return num_items_;
+    block = *block_it;
+  }
+  // As all previous blocks end before time, this is the first timer whose end reaches time.
+  for (size_t k = 0; k < block->size_; ++k) {
+    if (block->ends_[k] >= time) return block->first_index_ + k;
+  }
+  return block->first_index_ + block->size_;
+}
+
+std::pair<uint64_t, uint64_t> TimerChain::GetIndexRangeIntersecting(uint64_t min,
+                                                                    uint64_t max) const {
+  uint64_t last = is_sorted_by_start_ ? GetFirstIndexStartingAfter(max) : num_items_;
+  uint64_t first = std::min(GetFirstIndexEndingAtOrAfter(min), last);
+  return std::make_pair(first, last);
+}
+
+std::optional<std::vector<uint64_t>> TimerChain::GetLodIndices(uint64_t min, uint64_t max,
+                                                               uint64_t ticks_per_pixel) const {
+  if (!is_sorted_by_start_) return std::nullopt;
+  std::vector<uint64_t> indices;
+  uint64_t first_index = GetFirstIndexEndingAtOrAfter(min);
+  const TimerBlock* first_block = GetBlockContaining(first_index);
+  if (first_block == nullptr) return indices;
+  // Also include the timers starting before min that still intersect [min, max].
+  uint64_t min_start = std::min(min, first_block->starts_[first_index - first_block->first_index_]);
+
+  std::optional<uint32_t> level;
+  uint64_t lod_timer_count = 0;
+  std::optional<uint64_t> bucket_id;
+  uint64_t bucket_duration = 0;
+  {
+    absl::ReaderMutexLock lock(&mutex_);
+    level = lod_.GetLevelFor(ticks_per_pixel);
+    if (!level.has_value() || !is_sorted_by_start_) return std::nullopt;
+    lod_.ForEachBucket(level.value(), min_start, max,
+                       [&](const LodPyramid<LongestTimer>::Bucket& bucket) {
+                         indices.push_back(bucket.summary.index);
+                         bucket_id = bucket.id;
+                         bucket_duration = bucket.summary.duration;
+                       });
+    lod_timer_count = lod_timer_count_;
+  }
+
+  // The timers of the last block are only added to lod_ once the block is full, so pick the
+  // longest timer per bucket of the remaining ones here, continuing the last bucket of lod_.
+  uint64_t index = std::max(lod_timer_count, first_index);
+  const TimerBlock* block = GetBlockContaining(index);
+  for (; block != nullptr; block = block->next_) {
+    for (size_t k = index - block->first_index_; k < block->size_; ++k) {
+      if (block->starts_[k] > max) return indices;
+      uint64_t id = block->starts_[k] >> level.value();
+      uint64_t duration = block->ends_[k] - block->starts_[k];
+      if (bucket_id != id) {
+        bucket_id = id;
+        bucket_duration = duration;
+        indices.push_back(block->first_index_ + k);
+      } else if (duration > bucket_duration) {
+        bucket_duration = duration;
+        indices.back() = block->first_index_ + k;
+      }
     }
-    if (block->prev_) return &block->prev_->data_[block->prev_->size_ - 1];
+    index = block->first_index_ + block->size_;
   }
-  return nullptr;
+  return indices;
+}
+
+uint64_t TimerChain::GetLodByteCount() const {
+  absl::ReaderMutexLock lock(&mutex_);
+  return lod_.GetByteCount();
+}
+
+TextBox* TimerChain::GetTextBox(uint64_t index) const {
+  const TimerBlock* block = GetBlockContaining(index);
+  if (block == nullptr) return nullptr;
+  return block->GetTextBox(index - block->first_index_);
+}
+
+TextBox* TimerChain::GetTemporaryTextBox(uint64_t index) const {
+  const TimerBlock* block = GetBlockContaining(index);
+  if (block == nullptr) return nullptr;
+  return block->GetTemporaryTextBox(index - block->first_index_);
+}
+
+std::optional<uint64_t> TimerChain::GetIndexOf(const TextBox* text_box) const {
+  absl::ReaderMutexLock lock(&mutex_);
+  auto it = text_box_indices_.find(text_box);
+  if (it == text_box_indices_.end()) return std::nullopt;
+  return it->second;
+}
+
+TextBox* TimerChain::GetElementAfter(const TextBox* element) const {
+  std::optional<uint64_t> index = GetIndexOf(element);
+  if (!index.has_value() || index.value() + 1 >= num_items_) return nullptr;
+  return GetTextBox(index.value() + 1);
+}
+
+TextBox* TimerChain::GetElementBefore(const TextBox* element) const {
+  std::optional<uint64_t> index = GetIndexOf(element);
+  if (!index.has_value() || index.value() == 0) return nullptr;
+  return GetTextBox(index.value() - 1);
 }
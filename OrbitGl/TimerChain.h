@@ -6,11 +6,23 @@
 #define ORBIT_GL_TIMER_CHAIN_
 
 #include <algorithm>
+#include <array>
 #include <atomic>
 #include <cstdint>
 #include <limits>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
 
+#include "LodPyramid.h"
+#include "OrbitClientModel/CaptureColumns.h"
 #include "TextBox.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/node_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "capture_data.pb.h"
 
 static constexpr int kBlockSize = 1024;
 class TimerChain;
@@ -21,22 +33,28 @@ class TimerChain;
 // entire block by using the Intersects(t_min, t_max) method. This effectively
 // tests if any of the timers stored in this block intersects with the [t_min,
 // t_max] interval.
+// Timers are not stored as TimerInfo protos but in columns: start and end
+// timestamps, the user data key (e.g., the return value), and the id of the
+// remaining fields interned in the chain (function address, thread id, depth,
+// ...), which take few distinct values per chain.
 class TimerBlock {
   friend class TimerChain;
   friend class TimerChainIterator;
 
  public:
-  TimerBlock(TimerChain* chain, TimerBlock* prev)
+  TimerBlock(TimerChain* chain, TimerBlock* prev, uint64_t first_index)
       : prev_(prev),
         next_(nullptr),
         chain_(chain),
+        first_index_(first_index),
         size_(0),
         min_timestamp_(std::numeric_limits<uint64_t>::max()),
-        max_timestamp_(std::numeric_limits<uint64_t>::min()) {}
+        max_timestamp_(std::numeric_limits<uint64_t>::min()),
+        max_end_up_to_block_(prev != nullptr ? prev->max_end_up_to_block_ : 0) {}
 
-  // Adds an item to the block. If capacity of this block is reached, a new
-  // blocked is allocated and the item is added to the new block.
-  void Add(const TextBox& item);
+  // Adds a timer to the block. If capacity of this block is reached, a new
+  // blocked is allocated and the timer is added to the new block.
+  void Add(const orbit_client_protos::TimerInfo& timer_info);
 
   // Tests if [min, max] intersects with [min_timestamp, max_timestamp], where
   // {min, max}_timestamp are the minimum and maximum timestamp of the timers
@@ -45,24 +63,48 @@ class TimerBlock {
 
   uint64_t size() const { return size_; }
 
-  TextBox& operator[](std::size_t idx) { return data_[idx]; }
+  [[nodiscard]] uint64_t GetStart(size_t idx) const { return starts_[idx]; }
+  [[nodiscard]] uint64_t GetEnd(size_t idx) const { return ends_[idx]; }
+  [[nodiscard]] uint64_t GetFunctionAddress(size_t idx) const;
+  [[nodiscard]] int32_t GetThreadId(size_t idx) const;
 
-  const TextBox& operator[](std::size_t idx) const { return data_[idx]; }
+  // Index of the timer in the whole chain.
+  [[nodiscard]] uint64_t GetChainIndex(size_t idx) const { return first_index_ + idx; }
+
+  // Overwrites timer_info with the timer at idx. Reusing the same TimerInfo for
+  // many timers avoids allocations.
+  void GetTimerInfo(size_t idx, orbit_client_protos::TimerInfo* timer_info) const;
+  [[nodiscard]] orbit_client_protos::TimerInfo GetTimerInfo(size_t idx) const;
+
+  // TextBoxes are only created when needed (for picking, selection, ...) and then live as long as
+  // the chain.
+  [[nodiscard]] TextBox* GetTextBox(size_t idx) const;
+  // Returns a TextBox for the timer at idx, for showing its tooltip. Unlike the ones
+  // returned by GetTextBox, it is only valid until TimerChain::EvictUnusedTemporaryTextBoxes is
+  // called twice.
+  [[nodiscard]] TextBox* GetTemporaryTextBox(size_t idx) const;
 
  private:
   TimerBlock* prev_;
   TimerBlock* next_;
   TimerChain* chain_;
+  uint64_t first_index_;
   uint64_t size_;
-  TextBox data_[kBlockSize];
+  uint64_t starts_[kBlockSize];
+  uint64_t ends_[kBlockSize];
+  uint64_t user_data_keys_[kBlockSize];
+  uint32_t key_ids_[kBlockSize];
 
   uint64_t min_timestamp_;
   uint64_t max_timestamp_;
+  // Maximum end of the timers of this block and of all previous ones, non-decreasing along the
+  // chain.
+  uint64_t max_end_up_to_block_;
 };
 
 // TimerChainIterator iterates over all *blocks* of the chain, not the
-// individual items (TextBox instances) that are stored in the blocks (this is
-// different from the BlockIterator in BlockChain.h).
+// individual timers that are stored in the blocks (this is different from the
+// BlockIterator in BlockChain.h).
 class TimerChainIterator {
  public:
   explicit TimerChainIterator(TimerBlock* block) : block_(block) {}
@@ -95,33 +137,185 @@ class TimerChainIterator {
 // is a difference compared with BlockChain in how the iterators work: Here,
 // the iterator runs over blocks, in BlockChain the iterator runs over the
 // individually stored elements.
+// Timers are added by a single thread, while others can read them.
 class TimerChain {
   friend class TimerBlock;
 
  public:
-  TimerChain() : num_blocks_(1), num_items_(0) { root_ = current_ = new TimerBlock(this, nullptr); }
+  TimerChain() : num_blocks_(1), num_items_(0) {
+    root_ = current_ = new TimerBlock(this, nullptr, 0);
+    absl::MutexLock lock(&mutex_);
+    blocks_.push_back(root_);
+  }
 
   ~TimerChain();
 
-  void push_back(const TextBox& item) { current_->Add(item); }
+  TimerChain(const TimerChain&) = delete;
+  TimerChain& operator=(const TimerChain&) = delete;
+
+  void push_back(const orbit_client_protos::TimerInfo& timer_info) { current_->Add(timer_info); }
   [[nodiscard]] bool empty() const { return num_items_ == 0; }
   [[nodiscard]] uint64_t size() const { return num_items_; }
+  [[nodiscard]] uint64_t GetNumBlocks() const { return num_blocks_; }
 
-  [[nodiscard]] TimerBlock* GetBlockContaining(const TextBox* element) const;
+  // Returns the TextBox of the timer at index in the chain, creating it if needed. It lives as long
+  // as the chain.
+  [[nodiscard]] TextBox* GetTextBox(uint64_t index) const;
+  // Same as TimerBlock::GetTemporaryTextBox, or nullptr if index is not in the chain.
+  [[nodiscard]] TextBox* GetTemporaryTextBox(uint64_t index) const;
+  // Call this before each time the timers are drawn: it destroys the TextBoxes only obtained with
+  // GetTemporaryTextBox that were not used since the previous call, so that those of the timers
+  // hovered for tooltips don't accumulate.
+  void EvictUnusedTemporaryTextBoxes();
+  // Returns the index in the chain of a TextBox obtained from this chain.
+  [[nodiscard]] std::optional<uint64_t> GetIndexOf(const TextBox* text_box) const;
 
   [[nodiscard]] TextBox* GetElementAfter(const TextBox* element) const;
 
   [[nodiscard]] TextBox* GetElementBefore(const TextBox* element) const;
 
+  // Timers of the same depth of a track are usually added in order of start (they don't overlap,
+  // and are added as they end). The lookups below then use binary search, otherwise they fall back
+  // to linear search where needed.
+  [[nodiscard]] bool IsSortedByStart() const { return is_sorted_by_start_; }
+
+  // Returns the index of the first timer that starts after time, or size() if there is none. If
+  // the chain is not sorted by start, this is the first one in the order timers were added.
+  [[nodiscard]] uint64_t GetFirstIndexStartingAfter(uint64_t time) const;
+  // Returns the index of the first timer that ends at or after time, or size() if there is none.
+  // All timers before it end before time, whether the chain is sorted by start or not.
+  [[nodiscard]] uint64_t GetFirstIndexEndingAtOrAfter(uint64_t time) const;
+  // Returns the range of indices [first, last) out of which no timer intersects [min, max]. Timers
+  // in the range still need to be tested, but when zoomed in there are only few that don't
+  // intersect.
+  [[nodiscard]] std::pair<uint64_t, uint64_t> GetIndexRangeIntersecting(uint64_t min,
+                                                                        uint64_t max) const;
+
+  // Returns the indices of the timers to draw in [min, max] when a pixel spans ticks_per_pixel:
+  // for each bucket of the coarsest power-of-two width not wider than a pixel, the longest timer
+  // starting in it. Timers wider than a pixel are always among them, as other timers of the same
+  // depth starting in their bucket end before they start. Returns nullopt if zoomed in too far
+  // for this to help, or if the chain is not sorted by start.
+  [[nodiscard]] std::optional<std::vector<uint64_t>> GetLodIndices(uint64_t min, uint64_t max,
+                                                                   uint64_t ticks_per_pixel) const;
+
+  // The memory allocated for the level-of-detail summaries used by GetLodIndices.
+  [[nodiscard]] uint64_t GetLodByteCount() const;
+
+  // Adds the timers with indices in [begin, end) to builder, reading them from the columns of the
+  // blocks rather than through TimerInfos. Can be called from any thread.
+  void AddToColumns(uint64_t begin, uint64_t end,
+                    capture_columns::TimerColumnsBuilder* builder) const;
+
+  // Returns an iterator to the block containing index, or end() if index is not in the chain.
+  [[nodiscard]] TimerChainIterator GetBlockIteratorContaining(uint64_t index) const {
+    return TimerChainIterator(const_cast<TimerBlock*>(GetBlockContaining(index)));
+  }
+
   [[nodiscard]] TimerChainIterator begin() { return TimerChainIterator(root_); }
 
   [[nodiscard]] TimerChainIterator end() { return TimerChainIterator(nullptr); }
 
  private:
+  // The fields of a TimerInfo that take few distinct values in a chain.
+  struct TimerKey {
+    uint64_t function_address;
+    uint64_t timeline_hash;
+    int32_t process_id;
+    int32_t thread_id;
+    uint32_t depth;
+    int32_t type;
+    int32_t processor;
+
+    bool operator==(const TimerKey& other) const {
+      return function_address == other.function_address && timeline_hash == other.timeline_hash &&
+             process_id == other.process_id && thread_id == other.thread_id &&
+             depth == other.depth && type == other.type && processor == other.processor;
+    }
+
+    template <typename H>
+    friend H AbslHashValue(H h, const TimerKey& key) {
+      return H::combine(std::move(h), key.function_address, key.timeline_hash, key.process_id,
+                        key.thread_id, key.depth, key.type, key.processor);
+    }
+  };
+
+  // The fields of a TimerInfo that are rarely set.
+  struct TimerExtras {
+    uint64_t callstack_id = 0;
+    std::vector<uint64_t> registers;
+  };
+
+  // Summary of a level-of-detail bucket: the longest timer starting in it.
+  struct LongestTimer {
+    uint64_t index;
+    uint64_t duration;
+
+    bool Merge(const LongestTimer& other) {
+      if (other.duration <= duration) return false;
+      *this = other;
+      return true;
+    }
+  };
+
+  // 4 us to ~18 minutes per bucket.
+  static constexpr uint32_t kMinLodLevel = 12;
+  static constexpr uint32_t kMaxLodLevel = 40;
+  // The finest levels of lod_ are pruned to keep at most one bucket per this many timers.
+  static constexpr uint64_t kMinTimersPerLodBucket = 4;
+
+  // Adds the timers of a full block to lod_, taking mutex_ once per block.
+  void AddToLod(const TimerBlock& block);
+  [[nodiscard]] uint32_t InternKey(const orbit_client_protos::TimerInfo& timer_info);
+  void AddExtras(uint64_t index, const orbit_client_protos::TimerInfo& timer_info);
+  // Returns the chunk of key_chunks_ holding key_id and the offset of the key in it.
+  [[nodiscard]] static std::pair<size_t, size_t> GetKeyChunkAndOffset(uint32_t key_id);
+  [[nodiscard]] const TimerKey& GetKey(uint32_t key_id) const;
+  void GetTimerInfo(const TimerBlock& block, size_t idx,
+                    orbit_client_protos::TimerInfo* timer_info) const;
+  [[nodiscard]] TextBox* GetTextBox(const TimerBlock& block, size_t idx, bool is_kept) const;
+  [[nodiscard]] const TimerBlock* GetBlockContaining(uint64_t index) const;
+
   TimerBlock* root_;
   TimerBlock* current_;
   uint64_t num_blocks_;
   uint64_t num_items_;
+
+  // Only accessed by the thread adding timers.
+  absl::flat_hash_map<TimerKey, uint32_t> key_ids_;
+  uint64_t last_start_ = 0;
+  std::atomic<bool> is_sorted_by_start_ = true;
+
+  // Keys are only appended, and read by any thread without locking: they are stored in chunks
+  // that never move, of doubling sizes so that a fixed array of chunks is enough for all key ids,
+  // and key_count_ is only increased once the key is written.
+  static constexpr uint32_t kFirstKeyChunkSize = 16;
+  static constexpr size_t kKeyChunkCount = 29;
+  std::array<std::unique_ptr<TimerKey[]>, kKeyChunkCount> key_chunks_;
+  std::atomic<uint32_t> key_count_ = 0;
+  std::atomic<bool> has_extras_ = false;
+
+  struct CachedTextBox {
+    TextBox text_box;
+    // Whether the TextBox was obtained with GetTextBox, in which case it is never evicted.
+    bool is_kept = false;
+    bool is_used_since_eviction = false;
+  };
+
+  mutable absl::Mutex mutex_;
+  // Allows binary search over the blocks.
+  std::vector<TimerBlock*> blocks_ ABSL_GUARDED_BY(mutex_);
+  absl::flat_hash_map<uint64_t, TimerExtras> extras_ ABSL_GUARDED_BY(mutex_);
+  mutable absl::node_hash_map<uint64_t, CachedTextBox> text_boxes_ ABSL_GUARDED_BY(mutex_);
+  mutable absl::flat_hash_map<const TextBox*, uint64_t> text_box_indices_
+      ABSL_GUARDED_BY(mutex_);
+  // Only maintained while the chain is sorted by start, and only holds the timers of full blocks.
+  // Buckets take 24 bytes, so pruning to one bucket per kMinTimersPerLodBucket timers bounds lod_
+  // to 6 bytes per timer, or 12 with the spare capacity of the levels, next to the 28 bytes per
+  // timer of the blocks. Zoomed in further than the finest level left, GetLodIndices returns
+  // nullopt and the timers in view are visited instead.
+  LodPyramid<LongestTimer> lod_ ABSL_GUARDED_BY(mutex_){kMinLodLevel, kMaxLodLevel};
+  uint64_t lod_timer_count_ ABSL_GUARDED_BY(mutex_) = 0;
 };
 
 #endif
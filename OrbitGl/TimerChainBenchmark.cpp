@@ -0,0 +1,182 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "CoreMath.h"
+#include "TimerChain.h"
+#include "capture_data.pb.h"
+
+namespace {
+
+using orbit_client_protos::TimerInfo;
+
+// The layout of a timer before timers were stored in columns: each timer was a TextBox owning a
+// copy of its TimerInfo.
+struct TextBoxWrappedTimerInfo {
+  Vec2 pos;
+  Vec2 size;
+  std::string text;
+  TimerInfo timer_info;
+  size_t elapsed_time_text_length;
+};
+
+// Timers of dynamically instrumented functions of one thread, at one depth. The second argument
+// is the number of registers (function arguments) recorded for each timer.
+std::vector<TimerInfo> CreateTimers(int timer_count, int register_count) {
+  std::mt19937_64 random_engine{0};
+  std::uniform_int_distribution<uint64_t> duration_distribution{100, 10'000};
+  std::uniform_int_distribution<uint64_t> function_distribution{0, 19};
+  std::vector<TimerInfo> timers(timer_count);
+  uint64_t timestamp_ns = 0;
+  for (TimerInfo& timer : timers) {
+    timer.set_process_id(42);
+    timer.set_thread_id(43);
+    timer.set_depth(1);
+    timer.set_processor(-1);
+    timer.set_function_address(0x7f0000001000 + 0x100 * function_distribution(random_engine));
+    timer.set_start(timestamp_ns);
+    timestamp_ns += duration_distribution(random_engine);
+    timer.set_end(timestamp_ns);
+    timer.set_user_data_key(random_engine());
+    for (int i = 0; i < register_count; ++i) {
+      timer.add_registers(random_engine());
+    }
+  }
+  return timers;
+}
+
+// Reports the memory used per timer by a TimerChain, including its level-of-detail summaries, and
+// by the layout it replaced. The time per iteration is the time spent adding the timers.
+void BM_TimerChainBytesPerTimer(benchmark::State& state) {
+  const auto timer_count = static_cast<int>(state.range(0));
+  const auto register_count = static_cast<int>(state.range(1));
+  std::vector<TimerInfo> timers = CreateTimers(timer_count, register_count);
+
+  uint64_t num_blocks = 0;
+  uint64_t lod_bytes = 0;
+  for (auto _ : state) {
+    TimerChain chain;
+    for (const TimerInfo& timer : timers) {
+      chain.push_back(timer);
+    }
+    num_blocks = chain.GetNumBlocks();
+    lod_bytes = chain.GetLodByteCount();
+    benchmark::DoNotOptimize(chain.size());
+  }
+
+  // The interned fields take a few entries per chain, negligible compared to the blocks. Timers
+  // with registers also take an entry in a hash map from timer index to callstack id and registers,
+  // approximated without the slack of the hash map.
+  double extras_bytes_per_timer =
+      register_count == 0 ? 0
+                          : 2 * sizeof(uint64_t) + sizeof(std::vector<uint64_t>) +
+                                static_cast<double>(register_count) * sizeof(uint64_t);
+  double chain_bytes = static_cast<double>(num_blocks * sizeof(TimerBlock) + lod_bytes) +
+                       static_cast<double>(timer_count) * extras_bytes_per_timer;
+  // Before, blocks had the same number of timers, but each timer took a TextBox, plus the heap
+  // memory of the registers in the TimerInfo.
+  double legacy_bytes = static_cast<double>(num_blocks * kBlockSize) *
+                            static_cast<double>(sizeof(TextBoxWrappedTimerInfo)) +
+                        static_cast<double>(timer_count) *
+                            static_cast<double>(timers[0].SpaceUsedLong() - sizeof(TimerInfo));
+
+  state.SetItemsProcessed(state.iterations() * timer_count);
+  state.counters["bytes/timer"] = chain_bytes / timer_count;
+  state.counters["lod_bytes/timer"] = static_cast<double>(lod_bytes) / timer_count;
+  state.counters["legacy_bytes/timer"] = legacy_bytes / timer_count;
+}
+
+BENCHMARK(BM_TimerChainBytesPerTimer)
+    ->Apply([](benchmark::internal::Benchmark* benchmark) {
+      for (int register_count : {0, 6}) {
+        for (int timer_count : {1 << 16, 1 << 20}) {
+          benchmark->Args({timer_count, register_count});
+        }
+      }
+    })
+    ->Unit(benchmark::kMillisecond);
+
+// The work TimerTrack::UpdatePrimitives does to find the timers to draw when the whole capture
+// fits in the width of the canvas, for timers split into chains of 2^20 timers (e.g., depths of
+// different threads). The second argument selects whether to use the level-of-detail summaries
+// of the chains or to visit all timers, skipping the ones in already drawn pixels.
+void BM_FindTimersToDrawZoomedOut(benchmark::State& state) {
+  constexpr int kTimersPerChain = 1 << 20;
+  constexpr uint64_t kCanvasWidth = 2000;
+  const auto timer_count = static_cast<int>(state.range(0));
+  const bool use_lod = state.range(1) != 0;
+
+  std::vector<TimerInfo> timers = CreateTimers(kTimersPerChain, 0);
+  std::vector<std::unique_ptr<TimerChain>> chains;
+  for (int i = 0; i < timer_count; i += kTimersPerChain) {
+    auto chain = std::make_unique<TimerChain>();
+    for (int j = 0; j < kTimersPerChain && i + j < timer_count; ++j) {
+      chain->push_back(timers[j]);
+    }
+    chains.push_back(std::move(chain));
+  }
+  uint64_t min_tick = 0;
+  uint64_t max_tick = timers.back().end();
+  uint64_t pixel_delta_in_ticks = (max_tick - min_tick) / kCanvasWidth;
+
+  uint64_t drawn_count = 0;
+  for (auto _ : state) {
+    drawn_count = 0;
+    for (const std::unique_ptr<TimerChain>& chain : chains) {
+      uint64_t min_ignore = std::numeric_limits<uint64_t>::max();
+      uint64_t max_ignore = std::numeric_limits<uint64_t>::min();
+      auto visit_timer = [&](const TimerBlock& block, size_t k) {
+        uint64_t timer_start = block.GetStart(k);
+        uint64_t timer_end = block.GetEnd(k);
+        if (min_tick > timer_end || max_tick < timer_start) return;
+        if (timer_start >= min_ignore && timer_end <= max_ignore) return;
+        benchmark::DoNotOptimize(block.GetFunctionAddress(k));
+        ++drawn_count;
+        min_ignore = min_tick + ((timer_start - min_tick) / pixel_delta_in_ticks) *
+                                    pixel_delta_in_ticks;
+        max_ignore = min_ignore + pixel_delta_in_ticks;
+      };
+
+      std::optional<std::vector<uint64_t>> lod_indices =
+          use_lod ? chain->GetLodIndices(min_tick, max_tick, pixel_delta_in_ticks) : std::nullopt;
+      if (lod_indices.has_value()) {
+        if (lod_indices->empty()) continue;
+        TimerChainIterator it = chain->GetBlockIteratorContaining(lod_indices->front());
+        for (uint64_t index : *lod_indices) {
+          while (index >= it->GetChainIndex(it->size())) ++it;
+          visit_timer(*it, index - it->GetChainIndex(0));
+        }
+        continue;
+      }
+      for (const TimerBlock& block : *chain) {
+        for (size_t k = 0; k < block.size(); ++k) {
+          visit_timer(block, k);
+        }
+      }
+    }
+  }
+
+  state.counters["drawn_timers"] = static_cast<double>(drawn_count);
+}
+
+BENCHMARK(BM_FindTimersToDrawZoomedOut)
+    ->Apply([](benchmark::internal::Benchmark* benchmark) {
+      for (int use_lod : {0, 1}) {
+        for (int timer_count : {1 << 20, 50'000'000}) {
+          benchmark->Args({timer_count, use_lod});
+        }
+      }
+    })
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace
@@ -0,0 +1,325 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <google/protobuf/util/message_differencer.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "OrbitClientModel/CaptureColumns.h"
+#include "TextBox.h"
+#include "TimerChain.h"
+#include "capture_data.pb.h"
+
+using orbit_client_protos::TimerInfo;
+
+namespace {
+
+TimerInfo CreateTimer(uint64_t start) {
+  TimerInfo timer;
+  timer.set_start(start);
+  timer.set_end(start + 10);
+  timer.set_process_id(42);
+  timer.set_thread_id(43);
+  timer.set_depth(2);
+  timer.set_type(TimerInfo::kNone);
+  timer.set_processor(-1);
+  timer.set_function_address(0x1000 + start % 3);
+  timer.set_user_data_key(start * 7);
+  return timer;
+}
+
+}  // namespace
+
+TEST(TimerChain, StoresAllFieldsOfTimerInfo) {
+  TimerChain chain;
+  TimerInfo simple_timer = CreateTimer(1);
+  TimerInfo timer_with_extras = CreateTimer(100);
+  timer_with_extras.set_type(TimerInfo::kGpuActivity);
+  timer_with_extras.set_timeline_hash(1234);
+  timer_with_extras.set_callstack_id(5);
+  timer_with_extras.add_registers(6);
+  timer_with_extras.add_registers(7);
+  chain.push_back(simple_timer);
+  chain.push_back(timer_with_extras);
+  ASSERT_EQ(chain.size(), 2);
+
+  const TimerBlock& block = *chain.begin();
+  EXPECT_EQ(block.GetStart(1), 100);
+  EXPECT_EQ(block.GetEnd(1), 110);
+  EXPECT_EQ(block.GetFunctionAddress(1), 0x1001);
+  EXPECT_EQ(block.GetThreadId(1), 43);
+  EXPECT_TRUE(
+      google::protobuf::util::MessageDifferencer::Equals(block.GetTimerInfo(0), simple_timer));
+  EXPECT_TRUE(
+      google::protobuf::util::MessageDifferencer::Equals(block.GetTimerInfo(1), timer_with_extras));
+
+  // Reusing a TimerInfo must not keep fields of the previous timer.
+  TimerInfo reused_timer;
+  block.GetTimerInfo(1, &reused_timer);
+  block.GetTimerInfo(0, &reused_timer);
+  EXPECT_TRUE(google::protobuf::util::MessageDifferencer::Equals(reused_timer, simple_timer));
+}
+
+TEST(TimerChain, SpansMultipleBlocks) {
+  TimerChain chain;
+  constexpr uint64_t kTimerCount = 3 * kBlockSize + 5;
+  for (uint64_t i = 0; i < kTimerCount; ++i) {
+    chain.push_back(CreateTimer(i * 20));
+  }
+  EXPECT_EQ(chain.size(), kTimerCount);
+  EXPECT_EQ(chain.GetNumBlocks(), 4);
+
+  uint64_t index = 0;
+  for (const TimerBlock& block : chain) {
+    for (size_t k = 0; k < block.size(); ++k) {
+      EXPECT_EQ(block.GetChainIndex(k), index);
+      EXPECT_EQ(block.GetStart(k), index * 20);
+      ++index;
+    }
+  }
+  EXPECT_EQ(index, kTimerCount);
+}
+
+TEST(TimerChain, AddsRangesToColumns) {
+  TimerChain chain;
+  constexpr uint64_t kTimerCount = 2 * kBlockSize + 5;
+  std::vector<TimerInfo> timers;
+  for (uint64_t i = 0; i < kTimerCount; ++i) {
+    TimerInfo& timer = timers.emplace_back(CreateTimer(i * 20));
+    if (i % 100 == 0) {
+      timer.set_callstack_id(i);
+      timer.add_registers(i + 1);
+    }
+    chain.push_back(timer);
+  }
+
+  // A range across blocks, and one past the end of the chain.
+  for (const auto& [begin, end] : std::vector<std::pair<uint64_t, uint64_t>>{
+           {kBlockSize - 3, 2 * kBlockSize + 2}, {2 * kBlockSize, kTimerCount + 10}}) {
+    capture_columns::TimerColumnsBuilder builder;
+    chain.AddToColumns(begin, end, &builder);
+    const uint64_t expected_end = std::min(end, kTimerCount);
+    ASSERT_EQ(builder.size(), expected_end - begin);
+
+    std::string payload = builder.Build();
+    auto columns = capture_columns::TimerColumns::Create(payload);
+    ASSERT_TRUE(columns.has_value());
+    TimerInfo timer;
+    for (uint64_t i = begin; i < expected_end; ++i) {
+      columns.value().Decode(i - begin, &timer);
+      EXPECT_TRUE(google::protobuf::util::MessageDifferencer::Equals(timer, timers[i]));
+    }
+  }
+}
+
+TEST(TimerChain, TextBoxesAreCreatedOnceAndNavigable) {
+  TimerChain chain;
+  for (uint64_t i = 0; i < kBlockSize + 1; ++i) {
+    chain.push_back(CreateTimer(i * 20));
+  }
+
+  TextBox* last_of_first_block = chain.GetTextBox(kBlockSize - 1);
+  ASSERT_NE(last_of_first_block, nullptr);
+  EXPECT_EQ(last_of_first_block->GetTimerInfo().start(), (kBlockSize - 1) * 20);
+  EXPECT_EQ(chain.GetTextBox(kBlockSize - 1), last_of_first_block);
+  EXPECT_EQ(chain.begin()->GetTextBox(kBlockSize - 1), last_of_first_block);
+  EXPECT_EQ(chain.GetIndexOf(last_of_first_block), kBlockSize - 1);
+
+  TextBox* first_of_second_block = chain.GetElementAfter(last_of_first_block);
+  ASSERT_NE(first_of_second_block, nullptr);
+  EXPECT_EQ(first_of_second_block->GetTimerInfo().start(), kBlockSize * 20);
+  EXPECT_EQ(chain.GetElementAfter(first_of_second_block), nullptr);
+  EXPECT_EQ(chain.GetElementBefore(first_of_second_block), last_of_first_block);
+  EXPECT_EQ(chain.GetElementBefore(chain.GetTextBox(0)), nullptr);
+
+  EXPECT_EQ(chain.GetTextBox(kBlockSize + 1), nullptr);
+  TextBox unrelated_text_box;
+  EXPECT_FALSE(chain.GetIndexOf(&unrelated_text_box).has_value());
+}
+
+TEST(TimerChain, EvictsTemporaryTextBoxesNotUsedSincePreviousEviction) {
+  TimerChain chain;
+  for (uint64_t i = 0; i < 3; ++i) {
+    chain.push_back(CreateTimer(i * 20));
+  }
+  const TimerBlock& block = *chain.begin();
+
+  TextBox* kept_text_box = chain.GetTextBox(0);
+  TextBox* first_temporary_text_box = block.GetTemporaryTextBox(1);
+  TextBox* second_temporary_text_box = block.GetTemporaryTextBox(2);
+  EXPECT_EQ(first_temporary_text_box->GetTimerInfo().start(), 20);
+  EXPECT_EQ(block.GetTemporaryTextBox(0), kept_text_box);
+
+  chain.EvictUnusedTemporaryTextBoxes();
+  EXPECT_EQ(chain.GetIndexOf(first_temporary_text_box), 1);
+  EXPECT_EQ(chain.GetIndexOf(second_temporary_text_box), 2);
+
+  EXPECT_EQ(block.GetTemporaryTextBox(1), first_temporary_text_box);
+  chain.EvictUnusedTemporaryTextBoxes();
+  EXPECT_EQ(chain.GetIndexOf(first_temporary_text_box), 1);
+  EXPECT_FALSE(chain.GetIndexOf(second_temporary_text_box).has_value());
+
+  // Getting a temporary TextBox with GetTextBox keeps it.
+  EXPECT_EQ(chain.GetTextBox(1), first_temporary_text_box);
+  chain.EvictUnusedTemporaryTextBoxes();
+  chain.EvictUnusedTemporaryTextBoxes();
+  EXPECT_EQ(chain.GetIndexOf(kept_text_box), 0);
+  EXPECT_EQ(chain.GetIndexOf(first_temporary_text_box), 1);
+}
+
+TEST(TimerChain, InternsManyDistinctKeys) {
+  TimerChain chain;
+  constexpr uint64_t kTimerCount = 5000;
+  for (uint64_t i = 0; i < kTimerCount; ++i) {
+    TimerInfo timer = CreateTimer(i * 20);
+    timer.set_function_address(0x1000 + i);
+    timer.set_thread_id(static_cast<int32_t>(i % 7));
+    chain.push_back(timer);
+  }
+
+  uint64_t index = 0;
+  for (const TimerBlock& block : chain) {
+    for (size_t k = 0; k < block.size(); ++k) {
+      EXPECT_EQ(block.GetFunctionAddress(k), 0x1000 + index);
+      EXPECT_EQ(block.GetThreadId(k), index % 7);
+      ++index;
+    }
+  }
+  EXPECT_EQ(index, kTimerCount);
+}
+
+TEST(TimerChain, FindsIndicesByTimeWhenSortedByStart) {
+  TimerChain chain;
+  constexpr uint64_t kTimerCount = 2 * kBlockSize + 5;
+  // Timers [i * 20, i * 20 + 10].
+  for (uint64_t i = 0; i < kTimerCount; ++i) {
+    chain.push_back(CreateTimer(i * 20));
+  }
+  ASSERT_TRUE(chain.IsSortedByStart());
+
+  EXPECT_EQ(chain.GetFirstIndexStartingAfter(0), 1);
+  EXPECT_EQ(chain.GetFirstIndexStartingAfter(19), 1);
+  EXPECT_EQ(chain.GetFirstIndexStartingAfter(20), 2);
+  EXPECT_EQ(chain.GetFirstIndexStartingAfter(kBlockSize * 20 - 1), kBlockSize);
+  EXPECT_EQ(chain.GetFirstIndexStartingAfter(kTimerCount * 20), kTimerCount);
+
+  EXPECT_EQ(chain.GetFirstIndexEndingAtOrAfter(0), 0);
+  EXPECT_EQ(chain.GetFirstIndexEndingAtOrAfter(10), 0);
+  EXPECT_EQ(chain.GetFirstIndexEndingAtOrAfter(11), 1);
+  EXPECT_EQ(chain.GetFirstIndexEndingAtOrAfter(kBlockSize * 20 + 10), kBlockSize);
+  EXPECT_EQ(chain.GetFirstIndexEndingAtOrAfter(kTimerCount * 20), kTimerCount);
+
+  // [1015, 1045] intersects [1000, 1010], [1020, 1030] and [1040, 1050].
+  auto [first, last] = chain.GetIndexRangeIntersecting(1005, 1045);
+  EXPECT_EQ(first, 50);
+  EXPECT_EQ(last, 53);
+  // [1012, 1018] falls between two timers.
+  std::tie(first, last) = chain.GetIndexRangeIntersecting(1012, 1018);
+  EXPECT_EQ(first, last);
+  EXPECT_EQ(chain.GetBlockIteratorContaining(kBlockSize + 3)->GetChainIndex(0), kBlockSize);
+  EXPECT_EQ(chain.GetBlockIteratorContaining(kTimerCount), chain.end());
+}
+
+TEST(TimerChain, FindsIndicesByTimeWhenNotSortedByStart) {
+  TimerChain chain;
+  chain.push_back(CreateTimer(100));
+  chain.push_back(CreateTimer(0));
+  TimerInfo long_timer = CreateTimer(50);
+  long_timer.set_end(500);
+  chain.push_back(long_timer);
+  chain.push_back(CreateTimer(200));
+  ASSERT_FALSE(chain.IsSortedByStart());
+
+  EXPECT_EQ(chain.GetFirstIndexStartingAfter(0), 0);
+  EXPECT_EQ(chain.GetFirstIndexStartingAfter(100), 3);
+  EXPECT_EQ(chain.GetFirstIndexEndingAtOrAfter(111), 2);
+  EXPECT_EQ(chain.GetFirstIndexEndingAtOrAfter(501), 4);
+
+  // Without sorted starts, the range can't end before the last timer.
+  auto [first, last] = chain.GetIndexRangeIntersecting(0, 5);
+  EXPECT_EQ(first, 0);
+  EXPECT_EQ(last, 4);
+  std::tie(first, last) = chain.GetIndexRangeIntersecting(300, 400);
+  EXPECT_EQ(first, 2);
+  EXPECT_EQ(last, 4);
+}
+
+TEST(TimerChain, GetLodIndicesReturnsLongestTimerPerBucket) {
+  TimerChain chain;
+  // A timer of 10 ns every 20 ns, and every 100 timers, a long one.
+  uint64_t time = 0;
+  for (uint64_t i = 0; i < 10'000; ++i) {
+    TimerInfo timer = CreateTimer(time);
+    if (i % 100 == 99) timer.set_end(time + 1'000);
+    chain.push_back(timer);
+    time = timer.end() + 10;
+  }
+
+  // Zoomed in, all timers are visited.
+  EXPECT_FALSE(chain.GetLodIndices(0, time, 1).has_value());
+
+  // Buckets of 2^14 ns hold ~5 long timers each, which are the ones returned.
+  std::optional<std::vector<uint64_t>> indices = chain.GetLodIndices(0, time, 20'000);
+  ASSERT_TRUE(indices.has_value());
+  EXPECT_GT(indices->size(), 10);
+  EXPECT_LT(indices->size(), 20);
+  for (uint64_t index : *indices) {
+    EXPECT_EQ(index % 100, 99);
+  }
+  EXPECT_TRUE(std::is_sorted(indices->begin(), indices->end()));
+
+  // A timer starting before min, but ending after it, is included.
+  const TimerBlock& block = *chain.GetBlockIteratorContaining(99);
+  uint64_t long_timer_start = block.GetStart(99);
+  indices = chain.GetLodIndices(long_timer_start + 500, long_timer_start + 600, 1 << 12);
+  ASSERT_TRUE(indices.has_value());
+  ASSERT_FALSE(indices->empty());
+  EXPECT_EQ(indices->front(), 99);
+
+  // Not sorted by start anymore.
+  chain.push_back(CreateTimer(0));
+  EXPECT_FALSE(chain.GetLodIndices(0, time, 20'000).has_value());
+}
+
+TEST(TimerChain, GetLodIndicesIncludesTimersOfTheLastBlock) {
+  TimerChain chain;
+  // Two timers per bucket of 2^12 ns, the second one longer, in a block that is not full yet.
+  for (uint64_t i = 0; i < 10; ++i) {
+    TimerInfo timer = CreateTimer(i * 4096);
+    chain.push_back(timer);
+    timer.set_start(i * 4096 + 100);
+    timer.set_end(i * 4096 + 200);
+    chain.push_back(timer);
+  }
+  ASSERT_EQ(chain.GetNumBlocks(), 1);
+
+  std::optional<std::vector<uint64_t>> indices = chain.GetLodIndices(0, 10 * 4096, 4096);
+  ASSERT_TRUE(indices.has_value());
+  ASSERT_EQ(indices->size(), 10);
+  for (uint64_t i = 0; i < indices->size(); ++i) {
+    EXPECT_EQ(indices->at(i), 2 * i + 1);
+  }
+}
+
+TEST(TimerChain, PrunesLodLevelsFinerThanTimers) {
+  TimerChain chain;
+  // One timer every ~1 ms: buckets narrower than that hold a single timer each.
+  constexpr uint64_t kTimerCount = 8 * kBlockSize;
+  for (uint64_t i = 0; i < kTimerCount; ++i) {
+    chain.push_back(CreateTimer(i * 1'000'000));
+  }
+
+  EXPECT_LE(chain.GetLodByteCount(), 12 * kTimerCount);
+  EXPECT_FALSE(chain.GetLodIndices(0, kTimerCount * 1'000'000, 1 << 12).has_value());
+  std::optional<std::vector<uint64_t>> indices =
+      chain.GetLodIndices(0, kTimerCount * 1'000'000, 1 << 24);
+  ASSERT_TRUE(indices.has_value());
+  EXPECT_LT(indices->size(), kTimerCount / 8);
+}
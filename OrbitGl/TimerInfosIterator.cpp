@@ -8,6 +8,7 @@ TimerInfosIterator& TimerInfosIterator::operator++() {
   ++timer_index_;
   // Still inside block?
   if (timer_index_ < blocks_it_->size()) {
+    UpdateTimerInfo();
     return *this;
   }
 
@@ -16,6 +17,7 @@ TimerInfosIterator& TimerInfosIterator::operator++() {
   ++blocks_it_;
   // Still inside the chain?
   if (blocks_it_ != (*chains_it_)->end()) {
+    UpdateTimerInfo();
     return *this;
   }
 
@@ -24,8 +26,17 @@ TimerInfosIterator& TimerInfosIterator::operator++() {
   // Still inside chains?
   if (chains_it_ != chains_end_it_) {
     blocks_it_ = (*chains_it_)->begin();
+    UpdateTimerInfo();
     return *this;
   }
 
   return *this;
-}
\ No newline at end of file
+}
+
+void TimerInfosIterator::UpdateTimerInfo() {
+  if (chains_it_ == chains_end_it_ || blocks_it_ == (*chains_it_)->end() ||
+      timer_index_ >= blocks_it_->size()) {
+    return;
+  }
+  blocks_it_->GetTimerInfo(timer_index_, &timer_info_);
+}
@@ -19,7 +19,9 @@ class TimerInfosIterator {
         chains_end_it_(end),
         blocks_it_((chains_it_ != chains_end_it_) ? (*chains_it_)->begin()
                                                   : TimerChainIterator(nullptr)),
-        timer_index_(0) {}
+        timer_index_(0) {
+    UpdateTimerInfo();
+  }
 
   TimerInfosIterator& operator=(const TimerInfosIterator& other) = default;
   TimerInfosIterator(const TimerInfosIterator& other) = default;
@@ -28,13 +30,9 @@ class TimerInfosIterator {
 
   TimerInfosIterator& operator++();
 
-  const orbit_client_protos::TimerInfo& operator*() const {
-    return (*blocks_it_)[timer_index_].GetTimerInfo();
-  }
+  const orbit_client_protos::TimerInfo& operator*() const { return timer_info_; }
 
-  const orbit_client_protos::TimerInfo* operator->() const {
-    return &(*blocks_it_)[timer_index_].GetTimerInfo();
-  }
+  const orbit_client_protos::TimerInfo* operator->() const { return &timer_info_; }
 
   bool operator==(const TimerInfosIterator& other) const {
     return chains_it_ == other.chains_it_ && blocks_it_ == other.blocks_it_ &&
@@ -43,10 +41,14 @@ class TimerInfosIterator {
   bool operator!=(const TimerInfosIterator& other) const { return !(other == *this); }
 
  private:
+  // Timers are stored in columns in the blocks, so the current one is copied to timer_info_.
+  void UpdateTimerInfo();
+
   std::vector<std::shared_ptr<TimerChain>>::const_iterator chains_it_;
   std::vector<std::shared_ptr<TimerChain>>::const_iterator chains_end_it_;
   TimerChainIterator blocks_it_;
   uint32_t timer_index_;
+  orbit_client_protos::TimerInfo timer_info_;
 };
 
 #endif  // ORBITGL_TIMER_INFOS_ITERATOR_H_
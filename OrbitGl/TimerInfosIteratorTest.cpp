@@ -5,7 +5,6 @@
 #include <gmock/gmock-matchers.h>
 #include <gtest/gtest.h>
 
-#include "TextBox.h"
 #include "TimerChain.h"
 #include "TimerInfosIterator.h"
 #include "capture_data.pb.h"
@@ -15,18 +14,15 @@ using orbit_client_protos::TimerInfo;
 TEST(TimerInfosIterator, Access) {
   std::vector<std::shared_ptr<TimerChain>> chains;
   std::shared_ptr<TimerChain> chain = std::make_shared<TimerChain>();
-  TextBox box;
   TimerInfo timer;
   timer.set_function_address(1);
-  // Need to set the end, as SetTimerInfo will refuse that timer otherwise.
   timer.set_end(1);
-  box.SetTimerInfo(timer);
-  chain->push_back(box);
+  chain->push_back(timer);
   chains.push_back(chain);
 
   // Just validate setting worked as expected
   EXPECT_EQ(1, timer.function_address());
-  EXPECT_EQ(1, box.GetTimerInfo().function_address());
+  EXPECT_EQ(1, chain->begin()->GetFunctionAddress(0));
 
   // Now create an iterator and test to access it
   TimerInfosIterator it(chains.begin(), chains.end());
@@ -37,13 +33,10 @@ TEST(TimerInfosIterator, Access) {
 TEST(TimerInfosIterator, Copy) {
   std::vector<std::shared_ptr<TimerChain>> chains;
   std::shared_ptr<TimerChain> chain = std::make_shared<TimerChain>();
-  TextBox box;
   TimerInfo timer;
   timer.set_function_address(1);
-  // Need to set the end, as SetTimerInfo will refuse that timer otherwise.
   timer.set_end(1);
-  box.SetTimerInfo(timer);
-  chain->push_back(box);
+  chain->push_back(timer);
   chains.push_back(chain);
 
   // Now create an iterator and test to access it
@@ -70,13 +63,10 @@ TEST(TimerInfosIterator, Copy) {
 TEST(TimerInfosIterator, Move) {
   std::vector<std::shared_ptr<TimerChain>> chains;
   std::shared_ptr<TimerChain> chain = std::make_shared<TimerChain>();
-  TextBox box;
   TimerInfo timer;
   timer.set_function_address(1);
-  // Need to set the end, as SetTimerInfo will refuse that timer otherwise.
   timer.set_end(1);
-  box.SetTimerInfo(timer);
-  chain->push_back(box);
+  chain->push_back(timer);
   chains.push_back(chain);
 
   // Now create an iterator and test to access it
@@ -95,12 +85,10 @@ TEST(TimerInfosIterator, Move) {
 TEST(TimerInfosIterator, Equality) {
   std::vector<std::shared_ptr<TimerChain>> chains;
   std::shared_ptr<TimerChain> chain = std::make_shared<TimerChain>();
-  TextBox box;
   TimerInfo timer;
   timer.set_function_address(1);
   timer.set_end(1);
-  box.SetTimerInfo(timer);
-  chain->push_back(box);
+  chain->push_back(timer);
   chains.push_back(chain);
 
   // Now create an iterators and test equality
@@ -146,13 +134,11 @@ TEST(TimerInfosIterator, ForEachLarge) {
   for (size_t chain_count = 0; chain_count < 12; ++chain_count) {
     std::shared_ptr<TimerChain> chain = std::make_shared<TimerChain>();
     for (size_t box_count = 0; box_count < max_timers; ++box_count) {
-      TextBox box;
-      TimerInfo timer;
+          TimerInfo timer;
       timer.set_function_address(count);
       timer.set_start(count);
       timer.set_end(count + 1);
-      box.SetTimerInfo(timer);
-      chain->push_back(box);
+      chain->push_back(timer);
       expected.push_back(count);
       ++count;
     }
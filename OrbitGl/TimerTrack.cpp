@@ -4,7 +4,9 @@
 
 #include "TimerTrack.h"
 
+#include <algorithm>
 #include <limits>
+#include <optional>
 
 #include "App.h"
 #include "EventTrack.h"
@@ -20,9 +22,7 @@ using orbit_client_protos::TimerInfo;
 
 ABSL_DECLARE_FLAG(bool, show_return_values);
 
-TimerTrack::TimerTrack(TimeGraph* time_graph) : Track(time_graph) {
-  text_renderer_ = time_graph->GetTextRenderer();
-}
+TimerTrack::TimerTrack(TimeGraph* time_graph) : Track(time_graph) {}
 
 void TimerTrack::Draw(GlCanvas* canvas, PickingMode picking_mode, float z_offset) {
   float track_height = GetHeight();
@@ -53,6 +53,18 @@ void TimerTrack::UpdateBoxHeight() { box_height_ = time_graph_->GetLayout().GetT
 
 float TimerTrack::GetTextBoxHeight(const TimerInfo& /*timer_info*/) const { return box_height_; }
 
+void TimerTrack::DrawTimesliceText(const std::string& text, size_t elapsed_time_length,
+                                   float min_x, float z_offset, const Vec2& pos,
+                                   const Vec2& size) {
+  const Color kTextWhite(255, 255, 255, 255);
+  float pos_x = std::max(pos[0], min_x);
+  float max_size = pos[0] + size[0] - pos_x;
+  time_graph_->GetTextRenderer()->AddTextTrailingCharsPrioritized(
+      text.c_str(), pos_x, pos[1] + time_graph_->GetLayout().GetTextOffset(),
+      GlCanvas::kZValueBox + z_offset, kTextWhite, elapsed_time_length,
+      time_graph_->CalculateZoomedFontSize(), max_size);
+}
+
 void TimerTrack::UpdatePrimitives(uint64_t min_tick, uint64_t max_tick,
                                   PickingMode /*picking_mode*/, float z_offset) {
   UpdateBoxHeight();
@@ -79,10 +91,102 @@ void TimerTrack::UpdatePrimitives(uint64_t min_tick, uint64_t max_tick,
   uint64_t pixel_delta_in_ticks = time_window_ns / canvas->GetWidth();
   uint64_t min_timegraph_tick = time_graph_->GetTickFromUs(time_graph_->GetMinTimeUs());
 
+  // Timers are stored in columns: only create the TimerInfo of the timers that pass the cheap
+  // checks on their timestamps, and reuse the same one.
+  TimerInfo timer_info;
   for (auto& chain : chains_by_depth) {
     if (!chain) continue;
-    for (TimerChainIterator it = chain->begin(); it != chain->end(); ++it) {
-      TimerBlock& block = *it;
+    chain->EvictUnusedTemporaryTextBoxes();
+    std::optional<uint64_t> selected_index =
+        selected_textbox != nullptr ? chain->GetIndexOf(selected_textbox) : std::nullopt;
+
+    auto draw_timer = [&](const TimerBlock& block, size_t k) {
+      uint64_t timer_start = block.GetStart(k);
+      uint64_t timer_end = block.GetEnd(k);
+      if (min_tick > timer_end || max_tick < timer_start) return;
+      if (timer_start >= min_ignore && timer_end <= max_ignore) return;
+      block.GetTimerInfo(k, &timer_info);
+      if (!TimerFilter(timer_info)) return;
+      uint64_t function_address = timer_info.function_address();
+
+      UpdateDepth(timer_info.depth() + 1);
+      double start_us = time_graph_->GetUsFromTick(timer_start);
+      double end_us = time_graph_->GetUsFromTick(timer_end);
+      double elapsed_us = end_us - start_us;
+      double normalized_start = start_us * inv_time_window;
+      double normalized_length = elapsed_us * inv_time_window;
+      float world_timer_width = static_cast<float>(normalized_length * world_width);
+      float world_timer_x = static_cast<float>(world_start_x + normalized_start * world_width);
+      float world_timer_y = GetYFromDepth(timer_info.depth());
+
+      bool is_visible_width = normalized_length * canvas->GetWidth() > 1;
+      bool is_selected = selected_index.has_value() && block.GetChainIndex(k) == *selected_index;
+      bool is_highlighted = !is_selected && function_address == highlighted_address;
+
+      Vec2 pos(world_timer_x, world_timer_y);
+      Vec2 size(world_timer_width, GetTextBoxHeight(timer_info));
+      float z = GlCanvas::kZValueBox + z_offset;
+      const Color kHighlightColor(100, 181, 246, 255);
+      Color color = is_highlighted ? kHighlightColor : GetTimerColor(timer_info, is_selected);
+
+      PickingUserData user_data;
+      user_data.track_ = this;
+
+      // The TextBox of the timer is only created when its tooltip is shown or it gets selected.
+      user_data.timer_chain_ = chain.get();
+      user_data.timer_index_ = block.GetChainIndex(k);
+
+      if (is_visible_width) {
+        if (!is_collapsed) {
+          SetTimesliceText(timer_info, elapsed_us, world_start_x, z_offset, pos, size);
+        }
+        batcher->AddShadedBox(pos, size, z, color, user_data);
+      } else {
+        batcher->AddVerticalLine(pos, size[1], z, color, user_data);
+        // For lines, we can ignore the entire pixel into which this event
+        // falls. We align this precisely on the pixel x-coordinate of the
+        // current line being drawn (in ticks). If pixel_delta_in_ticks is
+        // zero, we need to avoid dividing by zero, but we also wouldn't
+        // gain anything here.
+        if (pixel_delta_in_ticks != 0) {
+          min_ignore = min_timegraph_tick +
+                       ((timer_start - min_timegraph_tick) / pixel_delta_in_ticks) *
+                           pixel_delta_in_ticks;
+          max_ignore = min_ignore + pixel_delta_in_ticks;
+        }
+      }
+    };
+
+    // When zoomed out, only draw the longest timer starting in each pixel, which costs
+    // O(pixels) instead of O(timers). The selected timer is drawn in any case.
+    std::optional<std::vector<uint64_t>> lod_indices =
+        CanUseLevelOfDetail() ? chain->GetLodIndices(min_tick, max_tick, pixel_delta_in_ticks)
+                              : std::nullopt;
+    if (lod_indices.has_value()) {
+      min_ignore = std::numeric_limits<uint64_t>::max();
+      max_ignore = std::numeric_limits<uint64_t>::min();
+      if (selected_index.has_value() &&
+          !std::binary_search(lod_indices->begin(), lod_indices->end(), *selected_index)) {
+        lod_indices->insert(
+            std::lower_bound(lod_indices->begin(), lod_indices->end(), *selected_index),
+            *selected_index);
+      }
+      if (lod_indices->empty()) continue;
+      // Indices are sorted, walk the blocks instead of looking each one up.
+      TimerChainIterator it = chain->GetBlockIteratorContaining(lod_indices->front());
+      for (uint64_t index : *lod_indices) {
+        while (it != chain->end() && index >= it->GetChainIndex(it->size())) ++it;
+        if (it == chain->end()) break;
+        draw_timer(*it, index - it->GetChainIndex(0));
+      }
+      continue;
+    }
+
+    // Only visit the timers that can intersect [min_tick, max_tick], found by binary search.
+    auto [first_index, last_index] = chain->GetIndexRangeIntersecting(min_tick, max_tick);
+    for (TimerChainIterator it = chain->GetBlockIteratorContaining(first_index);
+         it != chain->end() && it->GetChainIndex(0) < last_index; ++it) {
+      const TimerBlock& block = *it;
       if (!block.Intersects(min_tick, max_tick)) continue;
 
       // We have to reset this when we go to the next depth, as otherwise we
@@ -90,58 +194,11 @@ void TimerTrack::UpdatePrimitives(uint64_t min_tick, uint64_t max_tick,
       min_ignore = std::numeric_limits<uint64_t>::max();
       max_ignore = std::numeric_limits<uint64_t>::min();
 
-      for (size_t k = 0; k < block.size(); ++k) {
-        TextBox& text_box = block[k];
-        const TimerInfo& timer_info = text_box.GetTimerInfo();
-        if (min_tick > timer_info.end() || max_tick < timer_info.start()) continue;
-        if (timer_info.start() >= min_ignore && timer_info.end() <= max_ignore) continue;
-        if (!TimerFilter(timer_info)) continue;
-        uint64_t function_address = timer_info.function_address();
-
-        UpdateDepth(timer_info.depth() + 1);
-        double start_us = time_graph_->GetUsFromTick(timer_info.start());
-        double end_us = time_graph_->GetUsFromTick(timer_info.end());
-        double elapsed_us = end_us - start_us;
-        double normalized_start = start_us * inv_time_window;
-        double normalized_length = elapsed_us * inv_time_window;
-        float world_timer_width = static_cast<float>(normalized_length * world_width);
-        float world_timer_x = static_cast<float>(world_start_x + normalized_start * world_width);
-        float world_timer_y = GetYFromDepth(timer_info.depth());
-
-        bool is_visible_width = normalized_length * canvas->GetWidth() > 1;
-        bool is_selected = &text_box == selected_textbox;
-        bool is_highlighted = !is_selected && function_address == highlighted_address;
-
-        Vec2 pos(world_timer_x, world_timer_y);
-        Vec2 size(world_timer_width, GetTextBoxHeight(timer_info));
-        float z = GlCanvas::kZValueBox + z_offset;
-        const Color kHighlightColor(100, 181, 246, 255);
-        Color color = is_highlighted ? kHighlightColor : GetTimerColor(timer_info, is_selected);
-        text_box.SetPos(pos);
-        text_box.SetSize(size);
-
-        auto user_data = std::make_unique<PickingUserData>(
-            &text_box, [&](PickingId id) { return this->GetBoxTooltip(id); });
-
-        if (is_visible_width) {
-          if (!is_collapsed) {
-            SetTimesliceText(timer_info, elapsed_us, world_start_x, z_offset, &text_box);
-          }
-          batcher->AddShadedBox(pos, size, z, color, std::move(user_data));
-        } else {
-          batcher->AddVerticalLine(pos, size[1], z, color, std::move(user_data));
-          // For lines, we can ignore the entire pixel into which this event
-          // falls. We align this precisely on the pixel x-coordinate of the
-          // current line being drawn (in ticks). If pixel_delta_in_ticks is
-          // zero, we need to avoid dividing by zero, but we also wouldn't
-          // gain anything here.
-          if (pixel_delta_in_ticks != 0) {
-            min_ignore = min_timegraph_tick +
-                         ((timer_info.start() - min_timegraph_tick) / pixel_delta_in_ticks) *
-                             pixel_delta_in_ticks;
-            max_ignore = min_ignore + pixel_delta_in_ticks;
-          }
-        }
+      uint64_t block_first_index = block.GetChainIndex(0);
+      size_t first_k = first_index > block_first_index ? first_index - block_first_index : 0;
+      size_t last_k = std::min(block.size(), last_index - block_first_index);
+      for (size_t k = first_k; k < last_k; ++k) {
+        draw_timer(block, k);
       }
     }
   }
@@ -156,15 +213,12 @@ void TimerTrack::OnTimer(const TimerInfo& timer_info) {
     process_id_ = timer_info.process_id();
   }
 
-  TextBox text_box(Vec2(0, 0), Vec2(0, 0), "");
-  text_box.SetTimerInfo(timer_info);
-
   std::shared_ptr<TimerChain> timer_chain = timers_[timer_info.depth()];
   if (timer_chain == nullptr) {
     timer_chain = std::make_shared<TimerChain>();
     timers_[timer_info.depth()] = timer_chain;
   }
-  timer_chain->push_back(text_box);
+  timer_chain->push_back(timer_info);
   ++num_timers_;
   if (timer_info.start() < min_time_) min_time_ = timer_info.start();
   if (timer_info.end() > max_time_) max_time_ = timer_info.end();
@@ -198,36 +252,20 @@ const TextBox* TimerTrack::GetFirstAfterTime(uint64_t time, uint32_t depth) cons
   std::shared_ptr<TimerChain> chain = GetTimers(depth);
   if (chain == nullptr) return nullptr;
 
-  // TODO: do better than linear search...
-  for (TimerChainIterator it = chain->begin(); it != chain->end(); ++it) {
-    for (size_t k = 0; k < it->size(); ++k) {
-      const TextBox& text_box = (*it)[k];
-      if (text_box.GetTimerInfo().start() > time) {
-        return &text_box;
-      }
-    }
-  }
-  return nullptr;
+  uint64_t index = chain->GetFirstIndexStartingAfter(time);
+  if (index >= chain->size()) return nullptr;
+  return chain->GetTextBox(index);
 }
 
 const TextBox* TimerTrack::GetFirstBeforeTime(uint64_t time, uint32_t depth) const {
   std::shared_ptr<TimerChain> chain = GetTimers(depth);
   if (chain == nullptr) return nullptr;
 
-  const TextBox* text_box = nullptr;
-
-  // TODO: do better than linear search...
-  for (TimerChainIterator it = chain->begin(); it != chain->end(); ++it) {
-    for (size_t k = 0; k < it->size(); ++k) {
-      const TextBox& box = (*it)[k];
-      if (box.GetTimerInfo().start() > time) {
-        return text_box;
-      }
-      text_box = &box;
-    }
-  }
-
-  return nullptr;
+  // The timer before the first one starting after time, which is the last one starting at or
+  // before time when the chain is sorted by start.
+  uint64_t index = chain->GetFirstIndexStartingAfter(time);
+  if (index == 0) return nullptr;
+  return chain->GetTextBox(index - 1);
 }
 
 std::shared_ptr<TimerChain> TimerTrack::GetTimers(uint32_t depth) const {
@@ -261,8 +299,6 @@ std::vector<std::shared_ptr<TimerChain>> TimerTrack::GetAllSerializableChains()
 
 bool TimerTrack::IsEmpty() const { return GetNumTimers() == 0; }
 
-std::string TimerTrack::GetBoxTooltip(PickingId /*id*/) const { return ""; }
-
 float TimerTrack::GetHeaderHeight() const {
   const TimeGraphLayout& layout = time_graph_->GetLayout();
   return layout.GetEventTrackHeight();
@@ -18,7 +18,6 @@
 #include "absl/synchronization/mutex.h"
 #include "capture_data.pb.h"
 
-class TextRenderer;
 
 class TimerTrack : public Track {
  public:
@@ -75,21 +74,27 @@ class TimerTrack : public Track {
       const orbit_client_protos::TimerInfo& /*timer_info*/) const {
     return true;
   }
+  // When zoomed out, only some of the timers are drawn, which must then not be filtered out.
+  [[nodiscard]] virtual bool CanUseLevelOfDetail() const { return true; }
 
   void UpdateDepth(uint32_t depth) {
     if (depth > depth_) depth_ = depth;
   }
   [[nodiscard]] std::shared_ptr<TimerChain> GetTimers(uint32_t depth) const;
 
+  // Draws the text of the timer in its box at pos, of the given size. This is called for every box
+  // wide enough to be visible each time primitives are updated, so it must not create a TextBox.
   virtual void SetTimesliceText(const orbit_client_protos::TimerInfo& /*timer*/,
                                 double /*elapsed_us*/, float /*min_x*/, float /*z_offset*/,
-                                TextBox* /*text_box*/) {}
-  TextRenderer* text_renderer_ = nullptr;
+                                const Vec2& /*pos*/, const Vec2& /*size*/) {}
+  // Draws text, whose last elapsed_time_length characters are the duration of the timer, in the
+  // box at pos, starting at min_x at the earliest.
+  void DrawTimesliceText(const std::string& text, size_t elapsed_time_length, float min_x,
+                         float z_offset, const Vec2& pos, const Vec2& size);
   uint32_t depth_ = 0;
   mutable absl::Mutex mutex_;
   std::map<int, std::shared_ptr<TimerChain>> timers_;
 
-  [[nodiscard]] virtual std::string GetBoxTooltip(PickingId id) const;
   float GetHeight() const override;
   float box_height_;
 };
@@ -56,12 +56,11 @@ void TracepointTrack::Draw(GlCanvas* canvas, PickingMode picking_mode, float z_o
 }
 
 void TracepointTrack::UpdatePrimitives(uint64_t min_tick, uint64_t max_tick,
-                                       PickingMode picking_mode, float z_offset) {
+                                       PickingMode /*picking_mode*/, float z_offset) {
   Batcher* batcher = &time_graph_->GetBatcher();
   const TimeGraphLayout& layout = time_graph_->GetLayout();
   float z = GlCanvas::kZValueEvent + z_offset;
   float track_height = layout.GetEventTrackHeight();
-  const bool picking = picking_mode != PickingMode::kNone;
 
   const Color kWhite(255, 255, 255, 255);
 
@@ -69,47 +68,37 @@ void TracepointTrack::UpdatePrimitives(uint64_t min_tick, uint64_t max_tick,
 
   const Color kGrey(128, 128, 128, 255);
 
-  const Color kGreenSelection(0, 255, 0, 255);
-
   const CaptureData* capture_data = time_graph_->GetCaptureData();
   CHECK(capture_data != nullptr);
 
-  if (!picking) {
-    capture_data->ForEachTracepointEventOfThreadInTimeRange(
-        thread_id_, min_tick, max_tick,
-        [&](const orbit_client_protos::TracepointEventInfo& tracepoint) {
-          uint64_t time = tracepoint.time();
-          float radius = track_height / 4;
-          Vec2 pos(time_graph_->GetWorldFromTick(time), pos_[1]);
-          if (thread_id_ == orbit_base::kAllThreadsOfAllProcessesTid) {
-            const Color color = tracepoint.pid() == capture_data->process_id() ? kGrey : kWhite;
-            batcher->AddVerticalLine(pos, -track_height, z, color);
-          } else {
-            batcher->AddVerticalLine(pos, -radius, z, kWhiteTransparent);
-            batcher->AddVerticalLine(Vec2(pos[0], pos[1] - track_height), radius, z,
-                                     kWhiteTransparent);
-            batcher->AddCircle(Vec2(pos[0], pos[1] - track_height / 2), radius, z,
-                               kWhiteTransparent);
-          }
-        });
-
-  } else {
-    constexpr float kPickingBoxWidth = 9.0f;
-    constexpr float kPickingBoxOffset = kPickingBoxWidth / 2.0f;
-
-    capture_data->ForEachTracepointEventOfThreadInTimeRange(
-        thread_id_, min_tick, max_tick,
-        [&](const orbit_client_protos::TracepointEventInfo& tracepoint) {
-          uint64_t time = tracepoint.time();
-          Vec2 pos(time_graph_->GetWorldFromTick(time) - kPickingBoxOffset,
-                   pos_[1] - track_height + 1);
-          Vec2 size(kPickingBoxWidth, track_height);
-          auto user_data = std::make_unique<PickingUserData>(
-              nullptr, [&](PickingId id) -> std::string { return GetSampleTooltip(id); });
-          user_data->custom_data_ = &tracepoint;
-          batcher->AddShadedBox(pos, size, z, kGreenSelection, std::move(user_data));
-        });
-  }
+  // Boxes, only drawn when picking, make picking easier than the thin primitives drawn.
+  constexpr float kPickingBoxWidth = 9.0f;
+  constexpr float kPickingBoxOffset = kPickingBoxWidth / 2.0f;
+
+  capture_data->ForEachTracepointEventOfThreadInTimeRange(
+      thread_id_, min_tick, max_tick,
+      [&](const orbit_client_protos::TracepointEventInfo& tracepoint) {
+        uint64_t time = tracepoint.time();
+        float radius = track_height / 4;
+        Vec2 pos(time_graph_->GetWorldFromTick(time), pos_[1]);
+        if (thread_id_ == orbit_base::kAllThreadsOfAllProcessesTid) {
+          const Color color = tracepoint.pid() == capture_data->process_id() ? kGrey : kWhite;
+          batcher->AddVerticalLine(pos, -track_height, z, color);
+        } else {
+          batcher->AddVerticalLine(pos, -radius, z, kWhiteTransparent);
+          batcher->AddVerticalLine(Vec2(pos[0], pos[1] - track_height), radius, z,
+                                   kWhiteTransparent);
+          batcher->AddCircle(Vec2(pos[0], pos[1] - track_height / 2), radius, z,
+                             kWhiteTransparent);
+        }
+
+        Box box(Vec2(pos[0] - kPickingBoxOffset, pos_[1] - track_height + 1),
+                Vec2(kPickingBoxWidth, track_height), z);
+        PickingUserData user_data;
+        user_data.track_ = this;
+        user_data.custom_data_ = &tracepoint;
+        batcher->AddPickingBox(box, user_data);
+      });
 }
 
 void TracepointTrack::SetPos(float x, float y) { pos_ = Vec2(x, y); }
@@ -123,7 +112,7 @@ void TracepointTrack::OnPick(int x, int y) {
 
 void TracepointTrack::OnRelease() { picked_ = false; }
 
-std::string TracepointTrack::GetSampleTooltip(PickingId id) const {
+std::string TracepointTrack::GetBoxTooltip(PickingId id) const {
   auto user_data = time_graph_->GetBatcher().GetUserData(id);
   CHECK(user_data && user_data->custom_data_);
 
@@ -21,7 +21,7 @@ class TracepointTrack : public EventTrack {
   void OnPick(int x, int y) override;
   void OnRelease() override;
 
-  std::string GetSampleTooltip(PickingId id) const;
+  std::string GetBoxTooltip(PickingId id) const override;
   bool IsEmpty() const override;
 };
 
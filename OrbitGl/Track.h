@@ -66,6 +66,9 @@ class Track : public Pickable, public std::enable_shared_from_this<Track> {
     return num_prioritized_trailing_characters_;
   }
 
+  // Returns the tooltip of a primitive this track added to the batcher with PickingUserData.
+  [[nodiscard]] virtual std::string GetBoxTooltip(PickingId /*id*/) const { return ""; }
+
   [[nodiscard]] virtual std::vector<std::shared_ptr<TimerChain>> GetTimers() { return {}; }
   [[nodiscard]] virtual std::vector<std::shared_ptr<TimerChain>> GetAllChains() { return {}; }
   [[nodiscard]] virtual std::vector<std::shared_ptr<TimerChain>> GetAllSerializableChains() {
@@ -16,3 +16,5 @@ ABSL_FLAG(bool, show_return_values, false, "Show return values on time slices");
 ABSL_FLAG(bool, enable_tracepoint_feature, false,
           "Enable the setting of the panel of kernel tracepoints");
 ABSL_FLAG(bool, thread_state, false, "Collect thread states");
+ABSL_FLAG(std::string, capture_response_compression, "none",
+          "Compression of the capture data sent by OrbitService: none, deflate or gzip");
@@ -0,0 +1,96 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_LINUX_TRACING_FIXED_SIZE_BUFFER_POOL_H_
+#define ORBIT_LINUX_TRACING_FIXED_SIZE_BUFFER_POOL_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "OrbitBase/Logging.h"
+#include "concurrentqueue.h"
+
+namespace LinuxTracing {
+
+// FixedSizeBufferPool recycles buffers of a fixed size instead of returning them to the allocator.
+// It is used for the stack copies of stack samples, which are the largest and most frequent
+// allocations when reading perf_event_open ring buffers. Buffers are usually acquired by the
+// threads reading the ring buffers and released by the threads processing the events, so
+// acquiring and releasing are thread-safe and lock-free.
+// At most max_free_buffer_count buffers are kept for reuse, to bound the memory held after a
+// burst of events.
+class FixedSizeBufferPool {
+ public:
+  class Deleter {
+   public:
+    Deleter() = default;
+    explicit Deleter(FixedSizeBufferPool* pool) : pool_{pool} {}
+
+    void operator()(char* buffer) const {
+      if (pool_ != nullptr) {
+        pool_->Release(buffer);
+      } else {
+        delete[] buffer;
+      }
+    }
+
+   private:
+    FixedSizeBufferPool* pool_ = nullptr;
+  };
+
+  // A buffer that is returned to the pool it comes from, if any, when destroyed.
+  using Buffer = std::unique_ptr<char[], Deleter>;
+
+  FixedSizeBufferPool(size_t buffer_size, size_t max_free_buffer_count)
+      : buffer_size_{buffer_size}, max_free_buffer_count_{max_free_buffer_count} {}
+
+  ~FixedSizeBufferPool() {
+    char* buffer;
+    while (free_buffers_.try_dequeue(buffer)) {
+      delete[] buffer;
+    }
+  }
+
+  FixedSizeBufferPool(const FixedSizeBufferPool&) = delete;
+  FixedSizeBufferPool& operator=(const FixedSizeBufferPool&) = delete;
+  FixedSizeBufferPool(FixedSizeBufferPool&&) = delete;
+  FixedSizeBufferPool& operator=(FixedSizeBufferPool&&) = delete;
+
+  // The content of the returned buffer is uninitialized.
+  [[nodiscard]] Buffer Acquire() {
+    char* buffer;
+    if (free_buffers_.try_dequeue(buffer)) {
+      ++reused_buffer_count_;
+    } else {
+      buffer = new char[buffer_size_];
+      ++allocated_buffer_count_;
+    }
+    return Buffer{buffer, Deleter{this}};
+  }
+
+  [[nodiscard]] size_t GetBufferSize() const { return buffer_size_; }
+  [[nodiscard]] uint64_t GetAllocatedBufferCount() const { return allocated_buffer_count_; }
+  [[nodiscard]] uint64_t GetReusedBufferCount() const { return reused_buffer_count_; }
+
+ private:
+  void Release(char* buffer) {
+    CHECK(buffer != nullptr);
+    // size_approx is enough here, as max_free_buffer_count_ only needs to be a rough bound.
+    if (free_buffers_.size_approx() >= max_free_buffer_count_ || !free_buffers_.enqueue(buffer)) {
+      delete[] buffer;
+    }
+  }
+
+  const size_t buffer_size_;
+  const size_t max_free_buffer_count_;
+  moodycamel::ConcurrentQueue<char*> free_buffers_;
+  std::atomic<uint64_t> allocated_buffer_count_ = 0;
+  std::atomic<uint64_t> reused_buffer_count_ = 0;
+};
+
+}  // namespace LinuxTracing
+
+#endif  // ORBIT_LINUX_TRACING_FIXED_SIZE_BUFFER_POOL_H_
@@ -0,0 +1,75 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "FixedSizeBufferPool.h"
+
+namespace LinuxTracing {
+
+TEST(FixedSizeBufferPool, ReusesReleasedBuffers) {
+  FixedSizeBufferPool pool{16, 4};
+  EXPECT_EQ(pool.GetBufferSize(), 16);
+
+  FixedSizeBufferPool::Buffer buffer = pool.Acquire();
+  ASSERT_NE(buffer, nullptr);
+  std::memset(buffer.get(), 0xAB, pool.GetBufferSize());
+  char* address = buffer.get();
+  EXPECT_EQ(pool.GetAllocatedBufferCount(), 1);
+  EXPECT_EQ(pool.GetReusedBufferCount(), 0);
+
+  buffer.reset();
+  buffer = pool.Acquire();
+  EXPECT_EQ(buffer.get(), address);
+  EXPECT_EQ(pool.GetAllocatedBufferCount(), 1);
+  EXPECT_EQ(pool.GetReusedBufferCount(), 1);
+}
+
+TEST(FixedSizeBufferPool, KeepsAtMostMaxFreeBuffers) {
+  FixedSizeBufferPool pool{16, 2};
+
+  std::vector<FixedSizeBufferPool::Buffer> buffers;
+  for (int i = 0; i < 4; ++i) {
+    buffers.emplace_back(pool.Acquire());
+  }
+  EXPECT_EQ(pool.GetAllocatedBufferCount(), 4);
+  buffers.clear();
+
+  for (int i = 0; i < 4; ++i) {
+    buffers.emplace_back(pool.Acquire());
+  }
+  EXPECT_EQ(pool.GetReusedBufferCount(), 2);
+  EXPECT_EQ(pool.GetAllocatedBufferCount(), 6);
+}
+
+TEST(FixedSizeBufferPool, DefaultDeleterDoesNotNeedPool) {
+  FixedSizeBufferPool::Buffer buffer{new char[16]};
+  std::memset(buffer.get(), 0, 16);
+  buffer.reset();
+  EXPECT_EQ(buffer, nullptr);
+}
+
+TEST(FixedSizeBufferPool, BuffersCanBeReleasedOnOtherThreads) {
+  constexpr int kBufferCount = 1000;
+  FixedSizeBufferPool pool{64, kBufferCount};
+
+  std::vector<FixedSizeBufferPool::Buffer> buffers;
+  for (int i = 0; i < kBufferCount; ++i) {
+    buffers.emplace_back(pool.Acquire());
+  }
+  std::thread release_thread{[&buffers] { buffers.clear(); }};
+  release_thread.join();
+
+  for (int i = 0; i < kBufferCount; ++i) {
+    buffers.emplace_back(pool.Acquire());
+  }
+  EXPECT_EQ(pool.GetAllocatedBufferCount(), kBufferCount);
+  EXPECT_EQ(pool.GetReusedBufferCount(), kBufferCount);
+}
+
+}  // namespace LinuxTracing
@@ -19,6 +19,13 @@ inline uint64_t MonotonicTimestampNs() {
   return 1'000'000'000llu * ts.tv_sec + ts.tv_nsec;
 }
 
+// CPU time consumed so far by the calling thread.
+inline uint64_t ThreadCpuTimeNs() {
+  timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return 1'000'000'000llu * ts.tv_sec + ts.tv_nsec;
+}
+
 std::optional<std::string> ReadFile(std::string_view filename);
 
 std::string ReadMaps(pid_t pid);
@@ -17,6 +17,7 @@
 #include <utility>
 #include <vector>
 
+#include "FixedSizeBufferPool.h"
 #include "Function.h"
 #include "KernelTracepoints.h"
 #include "OrbitBase/MakeUniqueForOverwrite.h"
@@ -154,10 +155,15 @@ class LostPerfEvent : public PerfEvent {
 struct dynamically_sized_perf_event_stack_sample {
   struct dynamically_sized_perf_event_sample_stack_user {
     uint64_t dyn_size;
-    std::unique_ptr<char[]> data;
+    FixedSizeBufferPool::Buffer data;
 
     explicit dynamically_sized_perf_event_sample_stack_user(uint64_t dyn_size)
-        : dyn_size{dyn_size}, data{make_unique_for_overwrite<char[]>(dyn_size)} {}
+        : dyn_size{dyn_size}, data{make_unique_for_overwrite<char[]>(dyn_size).release()} {}
+
+    dynamically_sized_perf_event_sample_stack_user(uint64_t dyn_size, FixedSizeBufferPool* pool)
+        : dyn_size{dyn_size}, data{pool->Acquire()} {
+      CHECK(dyn_size <= pool->GetBufferSize());
+    }
   };
 
   perf_event_header header;
@@ -166,6 +172,8 @@ struct dynamically_sized_perf_event_stack_sample {
   dynamically_sized_perf_event_sample_stack_user stack;
 
   explicit dynamically_sized_perf_event_stack_sample(uint64_t dyn_size) : stack{dyn_size} {}
+  dynamically_sized_perf_event_stack_sample(uint64_t dyn_size, FixedSizeBufferPool* stack_pool)
+      : stack{dyn_size, stack_pool} {}
 };
 
 class StackSamplePerfEvent : public PerfEvent {
@@ -175,6 +183,11 @@ class StackSamplePerfEvent : public PerfEvent {
   explicit StackSamplePerfEvent(uint64_t dyn_size)
       : ring_buffer_record{std::make_unique<dynamically_sized_perf_event_stack_sample>(dyn_size)} {}
 
+  // The stack copy comes from stack_pool and is returned to it when the event is destroyed.
+  StackSamplePerfEvent(uint64_t dyn_size, FixedSizeBufferPool* stack_pool)
+      : ring_buffer_record{
+            std::make_unique<dynamically_sized_perf_event_stack_sample>(dyn_size, stack_pool)} {}
+
   uint64_t GetTimestamp() const override { return ring_buffer_record->sample_id.time; }
 
   void Accept(PerfEventVisitor* visitor) override;
@@ -105,23 +105,32 @@ static constexpr uint16_t SAMPLE_STACK_USER_SIZE = 65000;
 static_assert(sizeof(void*) == 8);
 static constexpr uint16_t SAMPLE_STACK_USER_SIZE_8BYTES = 8;
 
+// All the *_event_open functions below take a wakeup_watermark_bytes argument. When it is zero,
+// the kernel uses its default and only wakes up poll/epoll waiters on the resulting ring buffer
+// when it is half full. When it is not zero, waiters are woken up every time this many bytes have
+// been written to the ring buffer. This is only relevant for the file descriptor on which the ring
+// buffer is then created, not for the file descriptors redirected to it.
+
 // perf_event_open for context switches.
-int context_switch_event_open(pid_t pid, int32_t cpu);
+int context_switch_event_open(pid_t pid, int32_t cpu, uint32_t wakeup_watermark_bytes);
 
 // perf_event_open for task (fork and exit) and mmap records in the same buffer.
-int mmap_task_event_open(pid_t pid, int32_t cpu);
+int mmap_task_event_open(pid_t pid, int32_t cpu, uint32_t wakeup_watermark_bytes);
 
 // perf_event_open for stack sampling.
-int stack_sample_event_open(uint64_t period_ns, pid_t pid, int32_t cpu);
+int stack_sample_event_open(uint64_t period_ns, pid_t pid, int32_t cpu,
+                            uint32_t wakeup_watermark_bytes);
 
 // perf_event_open for stack sampling using frame pointers.
-int callchain_sample_event_open(uint64_t period_ns, pid_t pid, int32_t cpu);
+int callchain_sample_event_open(uint64_t period_ns, pid_t pid, int32_t cpu,
+                                uint32_t wakeup_watermark_bytes);
 
 // perf_event_open for uprobes and uretprobes.
 int uprobes_retaddr_event_open(const char* module, uint64_t function_offset, pid_t pid,
-                               int32_t cpu);
+                               int32_t cpu, uint32_t wakeup_watermark_bytes);
 
-int uretprobes_event_open(const char* module, uint64_t function_offset, pid_t pid, int32_t cpu);
+int uretprobes_event_open(const char* module, uint64_t function_offset, pid_t pid, int32_t cpu,
+                          uint32_t wakeup_watermark_bytes);
 
 // Create the ring buffer to use perf_event_open in sampled mode.
 void* perf_event_open_mmap_ring_buffer(int fd, uint64_t mmap_length);
@@ -131,7 +140,7 @@ void* perf_event_open_mmap_ring_buffer(int fd, uint64_t mmap_length);
 // (for example, "sched_waking"). Returns the file descriptor for the
 // perf event or -1 in case of any errors.
 int tracepoint_event_open(const char* tracepoint_category, const char* tracepoint_name, pid_t pid,
-                          int32_t cpu);
+                          int32_t cpu, uint32_t wakeup_watermark_bytes);
 
 }  // namespace LinuxTracing
 
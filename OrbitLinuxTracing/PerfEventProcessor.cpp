@@ -6,6 +6,7 @@
 
 #include <OrbitBase/Logging.h>
 
+#include <algorithm>
 #include <memory>
 #include <utility>
 
@@ -38,15 +39,19 @@ void PerfEventProcessor::ProcessAllEvents() {
   }
 }
 
-void PerfEventProcessor::ProcessOldEvents() {
+uint64_t PerfEventProcessor::ProcessOldEvents(uint64_t watermark_ns) {
   CHECK(!visitors_.empty());
   uint64_t current_timestamp_ns = MonotonicTimestampNs();
+  uint64_t delay_threshold_ns = current_timestamp_ns > kProcessingDelayMs * 1'000'000
+                                    ? current_timestamp_ns - kProcessingDelayMs * 1'000'000 - 1
+                                    : 0;
+  uint64_t process_up_to_ns = std::max(watermark_ns, delay_threshold_ns);
 
   while (event_queue_.HasEvent()) {
     PerfEvent* event = event_queue_.TopEvent();
 
     // Do not read the most recent events as out-of-order events could (and will) arrive.
-    if (event->GetTimestamp() + kProcessingDelayMs * 1'000'000 >= current_timestamp_ns) {
+    if (event->GetTimestamp() > process_up_to_ns) {
       break;
     }
     // Events are guaranteed to be processed in order of timestamp
@@ -59,6 +64,7 @@ void PerfEventProcessor::ProcessOldEvents() {
     }
     event_queue_.PopEvent();
   }
+  return process_up_to_ns;
 }
 
 }  // namespace LinuxTracing
@@ -20,17 +20,26 @@ namespace LinuxTracing {
 
 // This class receives perf_event_open events coming from several ring buffers
 // and processes them in order according to their timestamps.
-// Its implementation builds on the assumption that we never expect events with
-// a timestamp older than kProcessingDelayMs to be added. By not processing
-// events that are not older than this delay, we will never process events out
-// of order.
+// The caller can pass a watermark to ProcessOldEvents: a timestamp such that
+// all events from all ring buffers with a timestamp up to it have already been
+// added. Events up to the watermark can be processed without risking to
+// process events out of order.
+// When no watermark is available, or when the watermark lags behind (e.g.,
+// because a ring buffer is being read slowly), the implementation builds on
+// the assumption that we never expect events with a timestamp older than
+// kProcessingDelayMs to be added. By not processing events that are neither
+// older than this delay nor covered by the watermark, we will never process
+// events out of order.
 class PerfEventProcessor {
  public:
   void AddEvent(std::unique_ptr<PerfEvent> event);
 
   void ProcessAllEvents();
 
-  void ProcessOldEvents();
+  // Processes the events that are older than kProcessingDelayMs or whose
+  // timestamp is not greater than watermark_ns. Returns the timestamp up to
+  // which events have been processed.
+  uint64_t ProcessOldEvents(uint64_t watermark_ns = 0);
 
   void AddVisitor(PerfEventVisitor* visitor) { visitors_.push_back(visitor); }
 
@@ -114,6 +114,31 @@ TEST_F(PerfEventProcessorTest, DiscardedOutOfOrderCounter) {
   processor_.ProcessOldEvents();
 }
 
+TEST_F(PerfEventProcessorTest, ProcessOldEventsUpToWatermark) {
+  uint64_t first_timestamp_ns = MonotonicTimestampNs();
+  processor_.AddEvent(MakeFakePerfEvent(11, first_timestamp_ns));
+  processor_.AddEvent(MakeFakePerfEvent(22, first_timestamp_ns + 1));
+  processor_.AddEvent(MakeFakePerfEvent(11, first_timestamp_ns + 2));
+
+  // Events up to the watermark are processed without waiting for the processing delay.
+  EXPECT_CALL(mock_visitor_, visit).Times(2);
+  EXPECT_EQ(processor_.ProcessOldEvents(first_timestamp_ns + 1), first_timestamp_ns + 1);
+  ::testing::Mock::VerifyAndClearExpectations(&mock_visitor_);
+
+  // An event older than the watermark contradicts it and is discarded.
+  processor_.AddEvent(MakeFakePerfEvent(33, first_timestamp_ns));
+  EXPECT_EQ(discarded_out_of_order_counter_, 1);
+
+  EXPECT_CALL(mock_visitor_, visit).Times(0);
+  processor_.ProcessOldEvents(first_timestamp_ns + 1);
+  ::testing::Mock::VerifyAndClearExpectations(&mock_visitor_);
+
+  // Without a more recent watermark, the remaining event is processed after the processing delay.
+  std::this_thread::sleep_for(std::chrono::milliseconds(kDelayBeforeProcessOldEventsMs));
+  EXPECT_CALL(mock_visitor_, visit).Times(1);
+  processor_.ProcessOldEvents(first_timestamp_ns + 1);
+}
+
 TEST_F(PerfEventProcessorTest, ProcessOldEventsNeedsVisitor) {
   processor_.ClearVisitors();
   processor_.AddEvent(MakeFakePerfEvent(11, MonotonicTimestampNs()));
@@ -4,94 +4,128 @@
 
 #include "PerfEventQueue.h"
 
+#include <utility>
+
+#include "OrbitBase/Logging.h"
+
 namespace LinuxTracing {
 
+void PerfEventQueue::EventRingQueue::push(std::unique_ptr<PerfEvent> event) {
+  if (size_ == events_.size()) {
+    // Grow, moving the events to the beginning of the new vector in order.
+    static constexpr size_t kInitialCapacity = 8;
+    std::vector<std::unique_ptr<PerfEvent>> new_events(
+        events_.empty() ? kInitialCapacity : 2 * events_.size());
+    for (size_t i = 0; i < size_; ++i) {
+      new_events[i] = std::move(events_[(begin_ + i) & (events_.size() - 1)]);
+    }
+    events_ = std::move(new_events);
+    begin_ = 0;
+  }
+
+  back_timestamp_ns_ = event->GetTimestamp();
+  events_[(begin_ + size_) & (events_.size() - 1)] = std::move(event);
+  ++size_;
+}
+
+std::unique_ptr<PerfEvent> PerfEventQueue::EventRingQueue::pop() {
+  CHECK(size_ > 0);
+  std::unique_ptr<PerfEvent> event = std::move(events_[begin_]);
+  begin_ = (begin_ + 1) & (events_.size() - 1);
+  --size_;
+  return event;
+}
+
 void PerfEventQueue::PushEvent(std::unique_ptr<PerfEvent> event) {
-  int origin_fd = event->GetOriginFileDescriptor();
-  if (auto queue_it = queues_.find(origin_fd); queue_it != queues_.end()) {
-    const std::unique_ptr<std::queue<std::unique_ptr<PerfEvent>>>& queue = queue_it->second;
+  uint32_t buffer_index = GetOrCreateBufferIndex(event->GetOriginFileDescriptor());
+  EventRingQueue& queue = queues_[buffer_index];
+  uint64_t timestamp_ns = event->GetTimestamp();
+  CHECK(timestamp_ns != kEmptyQueueTimestamp);
 
-    CHECK(!queue->empty());
+  if (!queue.empty()) {
     // Fundamental assumption: events from the same file descriptor come already in order.
-    CHECK(event->GetTimestamp() >= queue->back()->GetTimestamp());
-    queue->push(std::move(event));
-
-  } else {
-    queue_it =
-        queues_.emplace(origin_fd, std::make_unique<std::queue<std::unique_ptr<PerfEvent>>>())
-            .first;
-    const std::unique_ptr<std::queue<std::unique_ptr<PerfEvent>>>& queue = queue_it->second;
-
-    queue->push(std::move(event));
-    queues_heap_.emplace_back(queue.get());
-    MoveUpHeapBack();
+    CHECK(timestamp_ns >= queue.back_timestamp_ns());
+    queue.push(std::move(event));
+    // The oldest event of this queue hasn't changed, so the tree doesn't need to be updated.
+    return;
   }
+
+  queue.push(std::move(event));
+  leaf_timestamps_ns_[buffer_index] = timestamp_ns;
+  UpdateTournamentTree(buffer_index);
 }
 
-bool PerfEventQueue::HasEvent() { return !queues_heap_.empty(); }
+bool PerfEventQueue::HasEvent() const {
+  uint32_t winner = winners_.empty() ? 0 : winners_[0];
+  return leaf_timestamps_ns_[winner] != kEmptyQueueTimestamp;
+}
 
-PerfEvent* PerfEventQueue::TopEvent() { return queues_heap_.front()->front().get(); }
+PerfEvent* PerfEventQueue::TopEvent() {
+  uint32_t winner = winners_.empty() ? 0 : winners_[0];
+  return queues_[winner].front().get();
+}
 
 std::unique_ptr<PerfEvent> PerfEventQueue::PopEvent() {
-  std::queue<std::unique_ptr<PerfEvent>>* top_queue = queues_heap_.front();
-  std::unique_ptr<PerfEvent> top_event = std::move(top_queue->front());
-  top_queue->pop();
-
-  if (top_queue->empty()) {
-    int top_fd = top_event->GetOriginFileDescriptor();
-    queues_.erase(top_fd);
-    std::swap(queues_heap_.front(), queues_heap_.back());
-    queues_heap_.pop_back();
-    MoveDownHeapFront();
-  } else {
-    MoveDownHeapFront();
-  }
-
+  uint32_t winner = winners_.empty() ? 0 : winners_[0];
+  EventRingQueue& queue = queues_[winner];
+  std::unique_ptr<PerfEvent> top_event = queue.pop();
+  leaf_timestamps_ns_[winner] =
+      queue.empty() ? kEmptyQueueTimestamp : queue.front()->GetTimestamp();
+  UpdateTournamentTree(winner);
   return top_event;
 }
 
-void PerfEventQueue::MoveDownHeapFront() {
-  if (queues_heap_.empty()) {
-    return;
+uint32_t PerfEventQueue::GetOrCreateBufferIndex(int origin_fd) {
+  CHECK(origin_fd >= 0);
+  size_t fd = static_cast<size_t>(origin_fd);
+  if (fd >= fd_to_buffer_index_.size()) {
+    fd_to_buffer_index_.resize(fd + 1, kNoBufferIndex);
+  }
+  if (fd_to_buffer_index_[fd] != kNoBufferIndex) {
+    return fd_to_buffer_index_[fd];
   }
 
-  size_t current_index = 0;
-  size_t new_index;
-  while (true) {
-    new_index = current_index;
-    size_t left_index = current_index * 2 + 1;
-    size_t right_index = current_index * 2 + 2;
-    if (left_index < queues_heap_.size() && queues_heap_[left_index]->front()->GetTimestamp() <
-                                                queues_heap_[new_index]->front()->GetTimestamp()) {
-      new_index = left_index;
-    }
-    if (right_index < queues_heap_.size() && queues_heap_[right_index]->front()->GetTimestamp() <
-                                                 queues_heap_[new_index]->front()->GetTimestamp()) {
-      new_index = right_index;
-    }
-    if (new_index != current_index) {
-      std::swap(queues_heap_[new_index], queues_heap_[current_index]);
-      current_index = new_index;
-    } else {
-      break;
-    }
+  auto buffer_index = static_cast<uint32_t>(queues_.size());
+  fd_to_buffer_index_[fd] = buffer_index;
+  queues_.emplace_back();
+  if (queues_.size() > leaf_count_) {
+    leaf_count_ *= 2;
+    leaf_timestamps_ns_.resize(leaf_count_, kEmptyQueueTimestamp);
+    RebuildTournamentTree();
   }
+  return buffer_index;
 }
 
-void PerfEventQueue::MoveUpHeapBack() {
-  if (queues_heap_.empty()) {
-    return;
+uint32_t PerfEventQueue::GetWinnerOfNode(size_t node) const {
+  // In the implicit tree, the leaves follow the leaf_count_ - 1 internal nodes.
+  if (node >= leaf_count_ - 1) {
+    return static_cast<uint32_t>(node - (leaf_count_ - 1));
   }
+  return winners_[node];
+}
 
-  size_t current_index = queues_heap_.size() - 1;
-  while (current_index > 0) {
-    size_t parent_index = (current_index - 1) / 2;
-    if (queues_heap_[parent_index]->front()->GetTimestamp() <=
-        queues_heap_[current_index]->front()->GetTimestamp()) {
-      break;
-    }
-    std::swap(queues_heap_[parent_index], queues_heap_[current_index]);
-    current_index = parent_index;
+void PerfEventQueue::ComputeWinnerOfInternalNode(size_t node) {
+  uint32_t left_winner = GetWinnerOfNode(2 * node + 1);
+  uint32_t right_winner = GetWinnerOfNode(2 * node + 2);
+  // On ties, prefer the ring buffer that was seen first.
+  winners_[node] = leaf_timestamps_ns_[left_winner] <= leaf_timestamps_ns_[right_winner]
+                       ? left_winner
+                       : right_winner;
+}
+
+void PerfEventQueue::UpdateTournamentTree(uint32_t buffer_index) {
+  size_t node = leaf_count_ - 1 + buffer_index;
+  while (node > 0) {
+    node = (node - 1) / 2;
+    ComputeWinnerOfInternalNode(node);
+  }
+}
+
+void PerfEventQueue::RebuildTournamentTree() {
+  winners_.resize(leaf_count_ - 1);
+  // Children have higher indices than their parent, so compute the winners backwards.
+  for (size_t node = winners_.size(); node > 0; --node) {
+    ComputeWinnerOfInternalNode(node - 1);
   }
 }
 
@@ -5,11 +5,10 @@
 #ifndef ORBIT_LINUX_TRACING_PERF_EVENT_QUEUE_H_
 #define ORBIT_LINUX_TRACING_PERF_EVENT_QUEUE_H_
 
-#include <absl/container/flat_hash_map.h>
-#include <absl/hash/hash.h>
-
+#include <cstddef>
+#include <cstdint>
+#include <limits>
 #include <memory>
-#include <queue>
 #include <vector>
 
 #include "PerfEvent.h"
@@ -21,30 +20,65 @@ namespace LinuxTracing {
 //
 // Instead of keeping a single priority queue with all the events to process, on which push/pop
 // operations would be logarithmic in the number of events, we leverage the fact that events coming
-// from the same perf_event_open ring buffer are already sorted. We then keep a priority queue of
-// queues, where the events in each queue come from the same ring buffer. Whenever an event is
-// removed from a queue, we need to move such queue down the priority queue.
+// from the same perf_event_open ring buffer are already sorted. We then keep one queue per ring
+// buffer and merge the queues with a tournament tree, whose operations are logarithmic in the
+// number of ring buffers.
 //
-// In order to be able to add an event to a queue, we also need to maintain the association between
-// a queue and its ring buffer, which is what the map is for. We use the file descriptor used to
-// read from the ring buffer as identifier for a ring buffer.
+// Ring buffers are identified by the file descriptor used to read from them. Each file descriptor
+// is assigned a dense index the first time it is seen, which identifies both its queue and its
+// leaf in the tournament tree. The queues are contiguous circular buffers, and the timestamp of
+// the oldest event of each queue is cached next to the tree, so that the merge doesn't need to
+// follow pointers to the events.
 class PerfEventQueue {
  public:
   void PushEvent(std::unique_ptr<PerfEvent> event);
-  [[nodiscard]] bool HasEvent();
+  [[nodiscard]] bool HasEvent() const;
   [[nodiscard]] PerfEvent* TopEvent();
   std::unique_ptr<PerfEvent> PopEvent();
 
  private:
-  // Floats down the element at the top of the heap to its correct place. Used when the key
-  // of the top element changes, or as part of the process of removing the top element.
-  void MoveDownHeapFront();
-  // Floats up an element that it is know should be further up in the heap. Used on insertion.
-  void MoveUpHeapBack();
+  // A growable FIFO queue stored in a single power-of-two-sized vector.
+  class EventRingQueue {
+   public:
+    [[nodiscard]] bool empty() const { return size_ == 0; }
+    [[nodiscard]] const std::unique_ptr<PerfEvent>& front() const { return events_[begin_]; }
+    [[nodiscard]] uint64_t back_timestamp_ns() const { return back_timestamp_ns_; }
+    void push(std::unique_ptr<PerfEvent> event);
+    std::unique_ptr<PerfEvent> pop();
 
- private:
-  absl::flat_hash_map<int, std::unique_ptr<std::queue<std::unique_ptr<PerfEvent>>>> queues_;
-  std::vector<std::queue<std::unique_ptr<PerfEvent>>*> queues_heap_;
+   private:
+    std::vector<std::unique_ptr<PerfEvent>> events_;
+    size_t begin_ = 0;
+    size_t size_ = 0;
+    uint64_t back_timestamp_ns_ = 0;
+  };
+
+  static constexpr uint32_t kNoBufferIndex = std::numeric_limits<uint32_t>::max();
+  // Key of the leaves whose queue is empty (or that don't correspond to any ring buffer), so that
+  // they never win against a non-empty queue.
+  static constexpr uint64_t kEmptyQueueTimestamp = std::numeric_limits<uint64_t>::max();
+
+  uint32_t GetOrCreateBufferIndex(int origin_fd);
+  // Recomputes the winners on the path from the leaf of buffer_index to the root, after the
+  // timestamp of the oldest event of that buffer has changed.
+  void UpdateTournamentTree(uint32_t buffer_index);
+  // Rebuilds the whole tree, after the number of leaves has changed.
+  void RebuildTournamentTree();
+  [[nodiscard]] uint32_t GetWinnerOfNode(size_t node) const;
+  void ComputeWinnerOfInternalNode(size_t node);
+
+  std::vector<uint32_t> fd_to_buffer_index_;
+  std::vector<EventRingQueue> queues_;
+
+  // Number of leaves of the tournament tree: the smallest power of two not less than the number of
+  // queues (and at least one).
+  size_t leaf_count_ = 1;
+  // For each leaf, the timestamp of the oldest event in its queue, or kEmptyQueueTimestamp.
+  std::vector<uint64_t> leaf_timestamps_ns_ = {kEmptyQueueTimestamp};
+  // Implicit binary tree of size leaf_count_ - 1: node i has children 2i+1 and 2i+2, and the
+  // children of the last level of internal nodes are the leaves. Each internal node contains the
+  // index of the leaf with the oldest event in its subtree. Empty if leaf_count_ is 1.
+  std::vector<uint32_t> winners_;
 };
 
 }  // namespace LinuxTracing
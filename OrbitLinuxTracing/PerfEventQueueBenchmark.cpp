@@ -0,0 +1,94 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "PerfEvent.h"
+#include "PerfEventQueue.h"
+
+namespace LinuxTracing {
+
+namespace {
+
+class TestEvent : public PerfEvent {
+ public:
+  explicit TestEvent(int origin_fd) { SetOriginFileDescriptor(origin_fd); }
+
+  uint64_t GetTimestamp() const override { return timestamp_; }
+  void SetTimestamp(uint64_t timestamp) { timestamp_ = timestamp; }
+
+  void Accept(PerfEventVisitor* /*visitor*/) override {}
+
+ private:
+  uint64_t timestamp_ = 0;
+};
+
+// Pushes kEventsPerBuffer events for each of the ring buffers given as argument, interleaved in
+// the way TracerThread reads them (a few events from each ring buffer in turn, with timestamps
+// that overlap between ring buffers), then pops them all. Reports the time per pushed and popped
+// event. The events are reused across iterations so that their allocation is not measured.
+void BM_PerfEventQueuePushAndPop(benchmark::State& state) {
+  static constexpr uint64_t kEventsPerBuffer = 1000;
+  static constexpr uint64_t kEventsPerRoundRobinBatch = 5;
+  static constexpr uint64_t kTimestampStep = 10'000;
+  const auto buffer_count = static_cast<int>(state.range(0));
+
+  std::vector<std::vector<std::unique_ptr<PerfEvent>>> events_per_fd(buffer_count);
+  std::vector<std::vector<uint64_t>> timestamp_jitters_per_fd(buffer_count);
+  std::mt19937 random_engine{0};
+  std::uniform_int_distribution<uint64_t> jitter_distribution{0, kTimestampStep};
+  for (int fd = 0; fd < buffer_count; ++fd) {
+    for (uint64_t event_index = 0; event_index < kEventsPerBuffer; ++event_index) {
+      events_per_fd[fd].emplace_back(std::make_unique<TestEvent>(fd));
+      timestamp_jitters_per_fd[fd].push_back(jitter_distribution(random_engine));
+    }
+  }
+
+  PerfEventQueue event_queue;
+  std::vector<uint64_t> popped_count_per_fd(buffer_count);
+  uint64_t base_timestamp = 0;
+  for (auto _ : state) {
+    for (uint64_t batch_begin = 0; batch_begin < kEventsPerBuffer;
+         batch_begin += kEventsPerRoundRobinBatch) {
+      for (int fd = 0; fd < buffer_count; ++fd) {
+        for (uint64_t event_index = batch_begin;
+             event_index < batch_begin + kEventsPerRoundRobinBatch; ++event_index) {
+          std::unique_ptr<PerfEvent>& event = events_per_fd[fd][event_index];
+          // As the jitter is at most kTimestampStep, timestamps are increasing for each fd, as
+          // required by PerfEventQueue, but overlap between fds.
+          static_cast<TestEvent*>(event.get())
+              ->SetTimestamp(base_timestamp + event_index * kTimestampStep +
+                             timestamp_jitters_per_fd[fd][event_index]);
+          event_queue.PushEvent(std::move(event));
+        }
+      }
+    }
+
+    std::fill(popped_count_per_fd.begin(), popped_count_per_fd.end(), 0);
+    while (event_queue.HasEvent()) {
+      std::unique_ptr<PerfEvent> event = event_queue.PopEvent();
+      int fd = event->GetOriginFileDescriptor();
+      events_per_fd[fd][popped_count_per_fd[fd]++] = std::move(event);
+    }
+    base_timestamp += (kEventsPerBuffer + 1) * kTimestampStep;
+  }
+
+  const auto event_count =
+      static_cast<double>(state.iterations() * kEventsPerBuffer * buffer_count);
+  state.SetItemsProcessed(static_cast<int64_t>(event_count));
+  state.counters["ns/event"] = benchmark::Counter(
+      event_count / 1e9, benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+
+BENCHMARK(BM_PerfEventQueuePushAndPop)->RangeMultiplier(2)->Range(16, 256);
+
+}  // namespace
+
+}  // namespace LinuxTracing
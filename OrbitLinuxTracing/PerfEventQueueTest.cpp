@@ -175,4 +175,34 @@ TEST(PerfEventQueue, FdWithOldestAndNewestEvent) {
   EXPECT_FALSE(event_queue.HasEvent());
 }
 
+TEST(PerfEventQueue, ManyFdsInterleaved) {
+  constexpr int kFdCount = 100;
+  constexpr uint64_t kRoundCount = 50;
+  PerfEventQueue event_queue;
+
+  // In round r, fd i gets an event with timestamp i + r * kFdCount. Fds are pushed in decreasing
+  // order, so that the oldest events and the new fds don't come in timestamp order. After each
+  // round, the events of the previous round are the oldest ones and are popped.
+  for (uint64_t round = 0; round < kRoundCount; ++round) {
+    for (int fd = kFdCount - 1; fd >= 0; --fd) {
+      event_queue.PushEvent(MakeTestEvent(fd, fd + round * kFdCount));
+    }
+    if (round == 0) {
+      continue;
+    }
+    for (uint64_t timestamp = (round - 1) * kFdCount; timestamp < round * kFdCount; ++timestamp) {
+      ASSERT_TRUE(event_queue.HasEvent());
+      EXPECT_EQ(event_queue.TopEvent()->GetTimestamp(), timestamp);
+      EXPECT_EQ(event_queue.PopEvent()->GetTimestamp(), timestamp);
+    }
+  }
+
+  for (uint64_t timestamp = (kRoundCount - 1) * kFdCount; timestamp < kRoundCount * kFdCount;
+       ++timestamp) {
+    ASSERT_TRUE(event_queue.HasEvent());
+    EXPECT_EQ(event_queue.PopEvent()->GetTimestamp(), timestamp);
+  }
+  EXPECT_FALSE(event_queue.HasEvent());
+}
+
 }  // namespace LinuxTracing
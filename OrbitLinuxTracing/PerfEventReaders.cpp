@@ -61,13 +61,15 @@ pid_t ReadSampleRecordPid(PerfEventRingBuffer* ring_buffer) {
   return pid;
 }
 
-std::unique_ptr<StackSamplePerfEvent> ConsumeStackSamplePerfEvent(PerfEventRingBuffer* ring_buffer,
-                                                                  const perf_event_header& header) {
+std::unique_ptr<StackSamplePerfEvent> ConsumeStackSamplePerfEvent(
+    PerfEventRingBuffer* ring_buffer, const perf_event_header& header,
+    FixedSizeBufferPool* stack_pool) {
   // Data in the ring buffer has the layout of perf_event_stack_sample, but we
   // copy it into dynamically_sized_perf_event_stack_sample.
   uint64_t dyn_size;
   ring_buffer->ReadValueAtOffset(&dyn_size, offsetof(perf_event_stack_sample, stack.dyn_size));
-  auto event = std::make_unique<StackSamplePerfEvent>(dyn_size);
+  auto event = stack_pool != nullptr ? std::make_unique<StackSamplePerfEvent>(dyn_size, stack_pool)
+                                     : std::make_unique<StackSamplePerfEvent>(dyn_size);
   event->ring_buffer_record->header = header;
   ring_buffer->ReadValueAtOffset(&event->ring_buffer_record->sample_id,
                                  offsetof(perf_event_stack_sample, sample_id));
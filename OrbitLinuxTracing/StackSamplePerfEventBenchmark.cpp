@@ -0,0 +1,55 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <benchmark/benchmark.h>
+
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "FixedSizeBufferPool.h"
+#include "PerfEvent.h"
+#include "PerfEventOpen.h"
+
+namespace LinuxTracing {
+
+namespace {
+
+// Creates stack sample events like TracerThread does when reading a ring buffer, and destroys them
+// on another thread like the deferred events thread does after processing them. The argument
+// selects whether the stack copies come from a FixedSizeBufferPool (1) or from new[] (0).
+void BM_CreateAndDestroyStackSamplePerfEvents(benchmark::State& state) {
+  static constexpr size_t kEventsPerBatch = 256;
+  const bool use_pool = state.range(0) != 0;
+  FixedSizeBufferPool pool{SAMPLE_STACK_USER_SIZE, kEventsPerBatch};
+  std::vector<char> stack(SAMPLE_STACK_USER_SIZE);
+
+  uint64_t event_count = 0;
+  for (auto _ : state) {
+    std::vector<std::unique_ptr<StackSamplePerfEvent>> events;
+    events.reserve(kEventsPerBatch);
+    for (size_t i = 0; i < kEventsPerBatch; ++i) {
+      auto event = use_pool ? std::make_unique<StackSamplePerfEvent>(stack.size(), &pool)
+                            : std::make_unique<StackSamplePerfEvent>(stack.size());
+      std::memcpy(event->GetStackData(), stack.data(), stack.size());
+      events.emplace_back(std::move(event));
+    }
+    std::thread destroy_thread{[&events] { events.clear(); }};
+    destroy_thread.join();
+    event_count += kEventsPerBatch;
+  }
+
+  state.counters["events/s"] =
+      benchmark::Counter(static_cast<double>(event_count), benchmark::Counter::kIsRate);
+  state.counters["buffer allocations"] =
+      use_pool ? static_cast<double>(pool.GetAllocatedBufferCount())
+               : static_cast<double>(event_count);
+}
+
+BENCHMARK(BM_CreateAndDestroyStackSamplePerfEvents)->Arg(0)->Arg(1)->UseRealTime();
+
+}  // namespace
+
+}  // namespace LinuxTracing
@@ -5,6 +5,7 @@
 #include "TracerThread.h"
 
 #include <OrbitBase/Logging.h>
+#include <OrbitBase/SafeStrerror.h>
 #include <OrbitBase/Tracing.h>
 #include <absl/container/flat_hash_map.h>
 #include <absl/container/flat_hash_set.h>
@@ -12,9 +13,14 @@
 #include <absl/strings/str_format.h>
 #include <pthread.h>
 #include <stddef.h>
+#include <sys/epoll.h>
 #include <unistd.h>
 
 #include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <limits>
 #include <string>
 #include <string_view>
 #include <thread>
@@ -40,6 +46,9 @@ TracerThread::TracerThread(const CaptureOptions& capture_options)
     : trace_context_switches_{capture_options.trace_context_switches()},
       pid_{capture_options.pid()},
       unwinding_method_{capture_options.unwinding_method()},
+      wakeup_mode_{capture_options.wakeup_mode()},
+      ring_buffer_reader_thread_count_{capture_options.ring_buffer_reader_thread_count()},
+      unwinding_thread_count_{capture_options.unwinding_thread_count()},
       trace_thread_state_{capture_options.trace_thread_state()},
       trace_gpu_driver_{capture_options.trace_gpu_driver()} {
   if (unwinding_method_ != CaptureOptions::kUndefined) {
@@ -78,6 +87,15 @@ TracerThread::TracerThread(const CaptureOptions& capture_options)
   }
 }
 
+uint32_t TracerThread::ComputeWakeupWatermarkBytes(uint64_t ring_buffer_size_kb) const {
+  if (wakeup_mode_ != CaptureOptions::kEventDriven) {
+    return 0;
+  }
+  // Wake up early enough that the ring buffer doesn't overflow while we are being scheduled, but
+  // not for every single record.
+  return static_cast<uint32_t>(ring_buffer_size_kb * 1024 / WAKEUP_WATERMARK_RING_BUFFER_FRACTION);
+}
+
 namespace {
 void CloseFileDescriptors(const std::vector<int>& fds) {
   for (int fd : fds) {
@@ -96,7 +114,8 @@ bool TracerThread::OpenContextSwitches(const std::vector<int32_t>& cpus) {
   std::vector<int> context_switch_tracing_fds;
   std::vector<PerfEventRingBuffer> context_switch_ring_buffers;
   for (int32_t cpu : cpus) {
-    int context_switch_fd = context_switch_event_open(-1, cpu);
+    int context_switch_fd = context_switch_event_open(
+        -1, cpu, ComputeWakeupWatermarkBytes(CONTEXT_SWITCHES_RING_BUFFER_SIZE_KB));
     std::string buffer_name = absl::StrFormat("context_switch_%d", cpu);
     PerfEventRingBuffer context_switch_ring_buffer{
         context_switch_fd, CONTEXT_SWITCHES_RING_BUFFER_SIZE_KB, buffer_name};
@@ -121,7 +140,9 @@ bool TracerThread::OpenContextSwitches(const std::vector<int32_t>& cpus) {
 
 void TracerThread::InitUprobesEventVisitor() {
   ORBIT_SCOPE_FUNCTION;
-  uprobes_unwinding_visitor_ = std::make_unique<UprobesUnwindingVisitor>(ReadMaps(pid_));
+  uprobes_unwinding_visitor_ = std::make_unique<UprobesUnwindingVisitor>(
+      ReadMaps(pid_),
+      unwinding_method_ == CaptureOptions::kDwarf ? unwinding_thread_count_ : 0);
   uprobes_unwinding_visitor_->SetListener(listener_);
   uprobes_unwinding_visitor_->SetUnwindErrorsAndDiscardedSamplesCounters(
       &stats_.unwind_error_count, &stats_.discarded_samples_in_uretprobes_count);
@@ -135,7 +156,8 @@ bool TracerThread::OpenUprobes(const LinuxTracing::Function& function,
   const char* module = function.BinaryPath().c_str();
   const uint64_t offset = function.FileOffset();
   for (int32_t cpu : cpus) {
-    int fd = uprobes_retaddr_event_open(module, offset, -1, cpu);
+    int fd = uprobes_retaddr_event_open(module, offset, -1, cpu,
+                                        ComputeWakeupWatermarkBytes(UPROBES_RING_BUFFER_SIZE_KB));
     if (fd < 0) {
       ERROR("Opening uprobe %#lx on cpu %d", function.VirtualAddress(), cpu);
       return false;
@@ -152,7 +174,8 @@ bool TracerThread::OpenUretprobes(const LinuxTracing::Function& function,
   const char* module = function.BinaryPath().c_str();
   const uint64_t offset = function.FileOffset();
   for (int32_t cpu : cpus) {
-    int fd = uretprobes_event_open(module, offset, -1, cpu);
+    int fd = uretprobes_event_open(module, offset, -1, cpu,
+                                   ComputeWakeupWatermarkBytes(UPROBES_RING_BUFFER_SIZE_KB));
     if (fd < 0) {
       ERROR("Opening uretprobe %#lx on cpu %d", function.VirtualAddress(), cpu);
       return false;
@@ -264,7 +287,8 @@ bool TracerThread::OpenMmapTask(const std::vector<int32_t>& cpus) {
   std::vector<int> mmap_task_tracing_fds;
   std::vector<PerfEventRingBuffer> mmap_task_ring_buffers;
   for (int32_t cpu : cpus) {
-    int mmap_task_fd = mmap_task_event_open(-1, cpu);
+    int mmap_task_fd =
+        mmap_task_event_open(-1, cpu, ComputeWakeupWatermarkBytes(MMAP_TASK_RING_BUFFER_SIZE_KB));
     std::string buffer_name = absl::StrFormat("mmap_task_%d", cpu);
     PerfEventRingBuffer mmap_task_ring_buffer{mmap_task_fd, MMAP_TASK_RING_BUFFER_SIZE_KB,
                                               buffer_name};
@@ -291,14 +315,16 @@ bool TracerThread::OpenSampling(const std::vector<int32_t>& cpus) {
   ORBIT_SCOPE_FUNCTION;
   std::vector<int> sampling_tracing_fds;
   std::vector<PerfEventRingBuffer> sampling_ring_buffers;
+  const uint32_t wakeup_watermark_bytes = ComputeWakeupWatermarkBytes(SAMPLING_RING_BUFFER_SIZE_KB);
   for (int32_t cpu : cpus) {
     int sampling_fd;
     switch (unwinding_method_) {
       case CaptureOptions::kFramePointers:
-        sampling_fd = callchain_sample_event_open(sampling_period_ns_, -1, cpu);
+        sampling_fd =
+            callchain_sample_event_open(sampling_period_ns_, -1, cpu, wakeup_watermark_bytes);
         break;
       case CaptureOptions::kDwarf:
-        sampling_fd = stack_sample_event_open(sampling_period_ns_, -1, cpu);
+        sampling_fd = stack_sample_event_open(sampling_period_ns_, -1, cpu, wakeup_watermark_bytes);
         break;
       case CaptureOptions::kUndefined:
       default:
@@ -377,7 +403,7 @@ struct TracepointToOpen {
 
 static bool OpenFileDescriptorsAndRingBuffersForAllTracepoints(
     const std::vector<TracepointToOpen>& tracepoints_to_open, const std::vector<int32_t>& cpus,
-    std::vector<int>* tracing_fds, uint64_t ring_buffer_size_kb,
+    std::vector<int>* tracing_fds, uint64_t ring_buffer_size_kb, uint32_t wakeup_watermark_bytes,
     absl::flat_hash_map<int32_t, int>* tracepoint_ring_buffer_fds_per_cpu_for_redirection,
     std::vector<PerfEventRingBuffer>* ring_buffers) {
   ORBIT_SCOPE_FUNCTION;
@@ -389,7 +415,8 @@ static bool OpenFileDescriptorsAndRingBuffersForAllTracepoints(
     const char* tracepoint_category = tracepoints_to_open[tracepoint_index].tracepoint_category;
     const char* tracepoint_name = tracepoints_to_open[tracepoint_index].tracepoint_name;
     for (int32_t cpu : cpus) {
-      int tracepoint_fd = tracepoint_event_open(tracepoint_category, tracepoint_name, -1, cpu);
+      int tracepoint_fd = tracepoint_event_open(tracepoint_category, tracepoint_name, -1, cpu,
+                                                wakeup_watermark_bytes);
       if (tracepoint_fd == -1) {
         ERROR("Opening %s:%s tracepoint for cpu %d", tracepoint_category, tracepoint_name, cpu);
         tracepoint_event_open_errors = true;
@@ -442,6 +469,7 @@ bool TracerThread::OpenThreadNameTracepoints(const std::vector<int32_t>& cpus) {
   return OpenFileDescriptorsAndRingBuffersForAllTracepoints(
       {{"task", "task_newtask", &task_newtask_ids_}, {"task", "task_rename", &task_rename_ids_}},
       cpus, &tracing_fds_, THREAD_NAMES_RING_BUFFER_SIZE_KB,
+      ComputeWakeupWatermarkBytes(THREAD_NAMES_RING_BUFFER_SIZE_KB),
       &thread_name_tracepoint_ring_buffer_fds_per_cpu, &ring_buffers_);
 }
 
@@ -460,6 +488,7 @@ bool TracerThread::OpenThreadStateTracepoints(const std::vector<int32_t>& cpus)
       {{"sched", "sched_switch", &sched_switch_ids_},
        {"sched", "sched_wakeup", &sched_wakeup_ids_}},
       cpus, &tracing_fds_, THREAD_STATE_RING_BUFFER_SIZE_KB,
+      ComputeWakeupWatermarkBytes(THREAD_STATE_RING_BUFFER_SIZE_KB),
       &thread_state_tracepoint_ring_buffer_fds_per_cpu, &ring_buffers_);
 }
 
@@ -489,8 +518,9 @@ bool TracerThread::OpenGpuTracepoints(const std::vector<int32_t>& cpus) {
       {{"amdgpu", "amdgpu_cs_ioctl", &amdgpu_cs_ioctl_ids_},
        {"amdgpu", "amdgpu_sched_run_job", &amdgpu_sched_run_job_ids_},
        {"dma_fence", "dma_fence_signaled", &dma_fence_signaled_ids_}},
-      cpus, &tracing_fds_, GPU_TRACING_RING_BUFFER_SIZE_KB, &gpu_tracepoint_ring_buffer_fds_per_cpu,
-      &ring_buffers_);
+      cpus, &tracing_fds_, GPU_TRACING_RING_BUFFER_SIZE_KB,
+      ComputeWakeupWatermarkBytes(GPU_TRACING_RING_BUFFER_SIZE_KB),
+      &gpu_tracepoint_ring_buffer_fds_per_cpu, &ring_buffers_);
 }
 
 bool TracerThread::OpenInstrumentedTracepoints(const std::vector<int32_t>& cpus) {
@@ -503,6 +533,7 @@ bool TracerThread::OpenInstrumentedTracepoints(const std::vector<int32_t>& cpus)
     tracepoint_event_open_errors |= !OpenFileDescriptorsAndRingBuffersForAllTracepoints(
         {{selected_tracepoint.category().c_str(), selected_tracepoint.name().c_str(), &stream_ids}},
         cpus, &tracing_fds_, INSTRUMENTED_TRACEPOINTS_RING_BUFFER_SIZE_KB,
+        ComputeWakeupWatermarkBytes(INSTRUMENTED_TRACEPOINTS_RING_BUFFER_SIZE_KB),
         &tracepoint_ring_buffer_fds_per_cpu, &ring_buffers_);
 
     for (const auto& stream_id : stream_ids) {
@@ -513,6 +544,207 @@ bool TracerThread::OpenInstrumentedTracepoints(const std::vector<int32_t>& cpus)
   return !tracepoint_event_open_errors;
 }
 
+void TracerThread::CreateRingBufferReaders() {
+  ORBIT_SCOPE_FUNCTION;
+  size_t reader_count = std::max<size_t>(
+      1, std::min<size_t>(ring_buffer_reader_thread_count_, ring_buffers_.size()));
+  // RingBufferReader is not movable, so it can't be added to the vector with resize.
+  ring_buffer_readers_ = std::vector<RingBufferReader>(reader_count);
+
+  // Ring buffers of the same kind are opened consecutively, one per cpu. Striping them across the
+  // readers gives each reader a subset of the cpus for every kind of ring buffer, which spreads
+  // the load evenly even if some kinds of ring buffers are much busier than others.
+  for (size_t ring_buffer_index = 0; ring_buffer_index < ring_buffers_.size();
+       ++ring_buffer_index) {
+    RingBufferReader& reader = ring_buffer_readers_[ring_buffer_index % reader_count];
+    reader.ring_buffers.push_back(&ring_buffers_[ring_buffer_index]);
+    reader.ring_buffers_drained_timestamps_ns.push_back(0);
+  }
+
+  if (reader_count == 1) {
+    // The only reader uses deferred_events_ directly.
+    return;
+  }
+
+  for (RingBufferReader& reader : ring_buffer_readers_) {
+    reader.deferred_events = std::make_unique<DeferredEventsQueue>();
+    reader.deferred_events_producer_token =
+        std::make_unique<moodycamel::ProducerToken>(*reader.deferred_events);
+    for (PerfEventRingBuffer* ring_buffer : reader.ring_buffers) {
+      ring_buffer_readers_by_fd_.emplace(ring_buffer->GetFileDescriptor(), &reader);
+    }
+  }
+}
+
+bool TracerThread::OpenRingBuffersEpoll(RingBufferReader* reader) {
+  ORBIT_SCOPE_FUNCTION;
+  reader->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  if (reader->epoll_fd == -1) {
+    ERROR("epoll_create1: %s", SafeStrerror(errno));
+    return false;
+  }
+
+  for (const PerfEventRingBuffer* ring_buffer : reader->ring_buffers) {
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = ring_buffer->GetFileDescriptor();
+    if (epoll_ctl(reader->epoll_fd, EPOLL_CTL_ADD, ring_buffer->GetFileDescriptor(), &event) != 0) {
+      ERROR("epoll_ctl for ring buffer '%s': %s", ring_buffer->GetName().c_str(),
+            SafeStrerror(errno));
+      close(reader->epoll_fd);
+      reader->epoll_fd = -1;
+      return false;
+    }
+  }
+  return true;
+}
+
+void TracerThread::WaitForRingBuffersData(RingBufferReader* reader) {
+  uint64_t wait_begin_ns = MonotonicTimestampNs();
+  if (reader->epoll_fd != -1) {
+    ORBIT_SCOPE("epoll_wait");
+    // Which ring buffers are ready doesn't matter, as all of them are read anyway after waking up.
+    // The timeout makes sure that exit_requested is still checked periodically and that ring
+    // buffers that never reach their wakeup watermark still get drained.
+    std::array<epoll_event, EPOLL_MAX_EVENTS> events{};
+    int ret = epoll_wait(reader->epoll_fd, events.data(), events.size(), EVENT_DRIVEN_MAX_WAIT_MS);
+    if (ret == -1 && errno != EINTR) {
+      ERROR("epoll_wait: %s", SafeStrerror(errno));
+    }
+  } else {
+    // Sleep if there was no new event in the last iteration so that we are
+    // not constantly polling. Don't sleep so long that ring buffers overflow.
+    // TODO: Refine this sleeping pattern, possibly using exponential backoff.
+    ORBIT_SCOPE("Sleep");
+    usleep(IDLE_TIME_ON_EMPTY_RING_BUFFERS_US);
+  }
+  stats_.tracer_idle_ns += MonotonicTimestampNs() - wait_begin_ns;
+}
+
+void TracerThread::ReadRingBuffers(RingBufferReader* reader,
+                                   const std::shared_ptr<std::atomic<bool>>& exit_requested) {
+  const bool is_first_reader = reader == &ring_buffer_readers_[0];
+  uint64_t last_cpu_time_ns = ThreadCpuTimeNs();
+  bool last_iteration_saw_events = false;
+
+  while (!(*exit_requested)) {
+    ORBIT_SCOPE("TracerThread::Run iteration");
+
+    if (!last_iteration_saw_events) {
+      // Periodically print event statistics.
+      if (is_first_reader) {
+        PrintStatsIfTimerElapsed();
+      }
+
+      WaitForRingBuffersData(reader);
+    }
+
+    last_iteration_saw_events = false;
+
+    // Read and process events from all ring buffers. In order to ensure that no
+    // buffer is read constantly while others overflow, we schedule the reading
+    // using round-robin like scheduling.
+    for (size_t ring_buffer_index = 0; ring_buffer_index < reader->ring_buffers.size();
+         ++ring_buffer_index) {
+      if (*exit_requested) {
+        break;
+      }
+      PerfEventRingBuffer* ring_buffer = reader->ring_buffers[ring_buffer_index];
+      // Records with a timestamp older than this are visible in the ring buffer by now. If the
+      // ring buffer is found empty below, they have all been read.
+      uint64_t drained_timestamp_ns = MonotonicTimestampNs();
+
+      // Read up to ROUND_ROBIN_POLLING_BATCH_SIZE (5) new events.
+      // TODO: Some event types (e.g., stack samples) have a much longer
+      //  processing time but are less frequent than others (e.g., context
+      //  switches). Take this into account in our scheduling algorithm.
+      for (int32_t read_from_this_buffer = 0;
+           read_from_this_buffer < ROUND_ROBIN_POLLING_BATCH_SIZE; ++read_from_this_buffer) {
+        if (*exit_requested) {
+          break;
+        }
+        if (!ring_buffer->HasNewData()) {
+          reader->ring_buffers_drained_timestamps_ns[ring_buffer_index] = drained_timestamp_ns;
+          break;
+        }
+
+        last_iteration_saw_events = true;
+        ProcessRecord(ring_buffer);
+      }
+    }
+
+    // The events read so far have already been deferred, so they will be consumed by the time
+    // this watermark is read. See ProcessDeferredEvents. The only reader has no ring buffers if
+    // none could be opened, in which case there is nothing to publish.
+    if (!reader->ring_buffers_drained_timestamps_ns.empty()) {
+      reader->watermark_ns.store(
+          *std::min_element(reader->ring_buffers_drained_timestamps_ns.begin(),
+                            reader->ring_buffers_drained_timestamps_ns.end()),
+          std::memory_order_release);
+    }
+
+    if (last_iteration_saw_events && reader->deferred_events != nullptr) {
+      NotifyReaderDeferredEvents();
+    }
+
+    uint64_t cpu_time_ns = ThreadCpuTimeNs();
+    stats_.tracer_cpu_time_ns += cpu_time_ns - last_cpu_time_ns;
+    last_cpu_time_ns = cpu_time_ns;
+  }
+}
+
+void TracerThread::ProcessRecord(PerfEventRingBuffer* ring_buffer) {
+  perf_event_header header;
+  ring_buffer->ReadHeader(&header);
+
+  // perf_event_header::type contains the type of record, e.g.,
+  // PERF_RECORD_SAMPLE, PERF_RECORD_MMAP, etc., defined in enum
+  // perf_event_type in linux/perf_event.h.
+  switch (header.type) {
+    case PERF_RECORD_SWITCH:
+      // Note: as we are recording context switches on CPUs and not on
+      // threads, we don't expect this type of record.
+      ERROR(
+          "Unexpected PERF_RECORD_SWITCH in ring buffer '%s' (only "
+          "PERF_RECORD_SWITCH_CPU_WIDE are expected)",
+          ring_buffer->GetName().c_str());
+      break;
+    case PERF_RECORD_SWITCH_CPU_WIDE:
+      ProcessContextSwitchCpuWideEvent(header, ring_buffer);
+      break;
+    case PERF_RECORD_FORK:
+      ProcessForkEvent(header, ring_buffer);
+      break;
+    case PERF_RECORD_EXIT:
+      ProcessExitEvent(header, ring_buffer);
+      break;
+    case PERF_RECORD_MMAP:
+      ProcessMmapEvent(header, ring_buffer);
+      break;
+    case PERF_RECORD_SAMPLE:
+      ProcessSampleEvent(header, ring_buffer);
+      break;
+    case PERF_RECORD_LOST:
+      ProcessLostEvent(header, ring_buffer);
+      break;
+    case PERF_RECORD_THROTTLE:
+      // We don't use throttle/unthrottle events, but log them separately
+      // from the default 'Unexpected perf_event_header::type' case.
+      LOG("PERF_RECORD_THROTTLE in ring buffer '%s'", ring_buffer->GetName().c_str());
+      ring_buffer->SkipRecord(header);
+      break;
+    case PERF_RECORD_UNTHROTTLE:
+      LOG("PERF_RECORD_UNTHROTTLE in ring buffer '%s'", ring_buffer->GetName().c_str());
+      ring_buffer->SkipRecord(header);
+      break;
+    default:
+      ERROR("Unexpected perf_event_header::type in ring buffer '%s': %u",
+            ring_buffer->GetName().c_str(), header.type);
+      ring_buffer->SkipRecord(header);
+      break;
+  }
+}
+
 void TracerThread::Run(const std::shared_ptr<std::atomic<bool>>& exit_requested) {
   FAIL_IF(listener_ == nullptr, "No listener set");
 
@@ -607,6 +839,16 @@ void TracerThread::Run(const std::shared_ptr<std::atomic<bool>>& exit_requested)
 
   perf_event_open_errors |= !OpenInstrumentedTracepoints(all_cpus);
 
+  CreateRingBufferReaders();
+
+  if (wakeup_mode_ == CaptureOptions::kEventDriven) {
+    for (RingBufferReader& reader : ring_buffer_readers_) {
+      if (!OpenRingBuffersEpoll(&reader)) {
+        ERROR("Waiting for ring buffer wakeups: falling back to polling");
+      }
+    }
+  }
+
   if (uprobes_event_open_errors) {
     LOG("There were errors with perf_event_open, including for uprobes: did "
         "you forget to run as root?");
@@ -632,106 +874,32 @@ void TracerThread::Run(const std::shared_ptr<std::atomic<bool>>& exit_requested)
 
   stats_.Reset();
 
-  bool last_iteration_saw_events = false;
   std::thread deferred_events_thread(&TracerThread::ProcessDeferredEvents, this);
 
-  while (!(*exit_requested)) {
-    ORBIT_SCOPE("TracerThread::Run iteration");
-
-    if (!last_iteration_saw_events) {
-      // Periodically print event statistics.
-      PrintStatsIfTimerElapsed();
-
-      // Sleep if there was no new event in the last iteration so that we are
-      // not constantly polling. Don't sleep so long that ring buffers overflow.
-      // TODO: Refine this sleeping pattern, possibly using exponential backoff.
-      {
-        ORBIT_SCOPE("Sleep");
-        usleep(IDLE_TIME_ON_EMPTY_RING_BUFFERS_US);
-      }
-    }
-
-    last_iteration_saw_events = false;
-
-    // Read and process events from all ring buffers. In order to ensure that no
-    // buffer is read constantly while others overflow, we schedule the reading
-    // using round-robin like scheduling.
-    for (PerfEventRingBuffer& ring_buffer : ring_buffers_) {
-      if (*exit_requested) {
-        break;
-      }
-
-      // Read up to ROUND_ROBIN_POLLING_BATCH_SIZE (5) new events.
-      // TODO: Some event types (e.g., stack samples) have a much longer
-      //  processing time but are less frequent than others (e.g., context
-      //  switches). Take this into account in our scheduling algorithm.
-      for (int32_t read_from_this_buffer = 0;
-           read_from_this_buffer < ROUND_ROBIN_POLLING_BATCH_SIZE; ++read_from_this_buffer) {
-        if (*exit_requested) {
-          break;
-        }
-        if (!ring_buffer.HasNewData()) {
-          break;
-        }
-
-        last_iteration_saw_events = true;
-        perf_event_header header;
-        ring_buffer.ReadHeader(&header);
-
-        // perf_event_header::type contains the type of record, e.g.,
-        // PERF_RECORD_SAMPLE, PERF_RECORD_MMAP, etc., defined in enum
-        // perf_event_type in linux/perf_event.h.
-        switch (header.type) {
-          case PERF_RECORD_SWITCH:
-            // Note: as we are recording context switches on CPUs and not on
-            // threads, we don't expect this type of record.
-            ERROR(
-                "Unexpected PERF_RECORD_SWITCH in ring buffer '%s' (only "
-                "PERF_RECORD_SWITCH_CPU_WIDE are expected)",
-                ring_buffer.GetName().c_str());
-            break;
-          case PERF_RECORD_SWITCH_CPU_WIDE:
-            ProcessContextSwitchCpuWideEvent(header, &ring_buffer);
-            break;
-          case PERF_RECORD_FORK:
-            ProcessForkEvent(header, &ring_buffer);
-            break;
-          case PERF_RECORD_EXIT:
-            ProcessExitEvent(header, &ring_buffer);
-            break;
-          case PERF_RECORD_MMAP:
-            ProcessMmapEvent(header, &ring_buffer);
-            break;
-          case PERF_RECORD_SAMPLE:
-            ProcessSampleEvent(header, &ring_buffer);
-            break;
-          case PERF_RECORD_LOST:
-            ProcessLostEvent(header, &ring_buffer);
-            break;
-          case PERF_RECORD_THROTTLE:
-            // We don't use throttle/unthrottle events, but log them separately
-            // from the default 'Unexpected perf_event_header::type' case.
-            LOG("PERF_RECORD_THROTTLE in ring buffer '%s'", ring_buffer.GetName().c_str());
-            ring_buffer.SkipRecord(header);
-            break;
-          case PERF_RECORD_UNTHROTTLE:
-            LOG("PERF_RECORD_UNTHROTTLE in ring buffer '%s'", ring_buffer.GetName().c_str());
-            ring_buffer.SkipRecord(header);
-            break;
-          default:
-            ERROR("Unexpected perf_event_header::type in ring buffer '%s': %u",
-                  ring_buffer.GetName().c_str(), header.type);
-            ring_buffer.SkipRecord(header);
-            break;
-        }
-      }
-    }
+  // The first reader runs on this thread, the others on their own threads.
+  std::vector<std::thread> reader_threads;
+  for (size_t reader_index = 1; reader_index < ring_buffer_readers_.size(); ++reader_index) {
+    reader_threads.emplace_back([this, reader_index, &exit_requested] {
+      pthread_setname_np(pthread_self(), "RingBuf.Reader");
+      ReadRingBuffers(&ring_buffer_readers_[reader_index], exit_requested);
+    });
+  }
+  ReadRingBuffers(&ring_buffer_readers_[0], exit_requested);
+  for (std::thread& reader_thread : reader_threads) {
+    reader_thread.join();
   }
 
   // Finish processing all deferred events.
-  stop_deferred_thread_ = true;
+  {
+    // Set the flag while holding the mutex so that the notification can't get lost between
+    // WaitForDeferredEvents checking the flag and starting to wait.
+    std::lock_guard<std::mutex> lock(deferred_events_mutex_);
+    stop_deferred_thread_ = true;
+  }
+  deferred_events_cv_.notify_one();
   deferred_events_thread.join();
   event_processor_.ProcessAllEvents();
+  uprobes_unwinding_visitor_->FinishUnwindingStackSamples();
 
   if (trace_thread_state_) {
     thread_state_visitor_->ProcessRemainingOpenStates(MonotonicTimestampNs());
@@ -742,6 +910,14 @@ void TracerThread::Run(const std::shared_ptr<std::atomic<bool>>& exit_requested)
     perf_event_disable(fd);
   }
 
+  for (const RingBufferReader& reader : ring_buffer_readers_) {
+    if (reader.epoll_fd != -1) {
+      close(reader.epoll_fd);
+    }
+  }
+  ring_buffer_readers_by_fd_.clear();
+  ring_buffer_readers_.clear();
+
   // Close the ring buffers.
   {
     ORBIT_SCOPE("ring_buffers_.clear()");
@@ -780,12 +956,16 @@ void TracerThread::ProcessContextSwitchCpuWideEvent(const perf_event_header& hea
     if (event.IsSwitchOut()) {
       // Careful: when a switch out is caused by the thread exiting, pid and tid
       // have value -1.
-      std::optional<SchedulingSlice> scheduling_slice =
-          context_switch_manager_.ProcessContextSwitchOut(pid, tid, cpu, time);
+      std::optional<SchedulingSlice> scheduling_slice;
+      {
+        std::lock_guard<std::mutex> lock(context_switch_manager_mutex_);
+        scheduling_slice = context_switch_manager_.ProcessContextSwitchOut(pid, tid, cpu, time);
+      }
       if (scheduling_slice.has_value()) {
         listener_->OnSchedulingSlice(std::move(scheduling_slice.value()));
       }
     } else {
+      std::lock_guard<std::mutex> lock(context_switch_manager_mutex_);
       context_switch_manager_.ProcessContextSwitchIn(pid, tid, cpu, time);
     }
   }
@@ -921,7 +1101,7 @@ void TracerThread::ProcessSampleEvent(const perf_event_header& header,
     // e.g., with header.misc == PERF_RECORD_MISC_KERNEL,
     // in general they seem to produce valid callstacks.
 
-    auto event = ConsumeStackSamplePerfEvent(ring_buffer, header);
+    auto event = ConsumeStackSamplePerfEvent(ring_buffer, header, &stack_sample_buffer_pool_);
     event->SetOriginFileDescriptor(fd);
     DeferEvent(std::move(event));
     ++stats_.sample_count;
@@ -972,14 +1152,17 @@ void TracerThread::ProcessSampleEvent(const perf_event_header& header,
     auto event = ConsumeTracepointPerfEvent<AmdgpuCsIoctlPerfEvent>(ring_buffer, header);
     // Do not filter GPU tracepoint events based on pid as we want to have
     // visibility into all GPU activity across the system.
+    std::lock_guard<std::mutex> lock(gpu_event_processor_mutex_);
     gpu_event_processor_->PushEvent(*event);
     ++stats_.gpu_events_count;
   } else if (is_amdgpu_sched_run_job_event) {
     auto event = ConsumeTracepointPerfEvent<AmdgpuSchedRunJobPerfEvent>(ring_buffer, header);
+    std::lock_guard<std::mutex> lock(gpu_event_processor_mutex_);
     gpu_event_processor_->PushEvent(*event);
     ++stats_.gpu_events_count;
   } else if (is_dma_fence_signaled_event) {
     auto event = ConsumeTracepointPerfEvent<DmaFenceSignaledPerfEvent>(ring_buffer, header);
+    std::lock_guard<std::mutex> lock(gpu_event_processor_mutex_);
     gpu_event_processor_->PushEvent(*event);
     ++stats_.gpu_events_count;
 
@@ -1015,34 +1198,132 @@ void TracerThread::ProcessLostEvent(const perf_event_header& header,
   LostPerfEvent event;
   ring_buffer->ConsumeRecord(header, &event.ring_buffer_record);
   stats_.lost_count += event.GetNumLost();
+  std::lock_guard<std::mutex> lock(stats_.lost_count_per_buffer_mutex);
   stats_.lost_count_per_buffer[ring_buffer] += event.GetNumLost();
 }
 
 void TracerThread::DeferEvent(std::unique_ptr<PerfEvent> event) {
-  std::lock_guard<std::mutex> lock(deferred_events_mutex_);
-  deferred_events_.emplace_back(std::move(event));
+  uint64_t current_timestamp_ns = MonotonicTimestampNs();
+  if (current_timestamp_ns > event->GetTimestamp()) {
+    uint64_t read_latency_ns = current_timestamp_ns - event->GetTimestamp();
+    ++stats_.read_latency_count;
+    stats_.read_latency_sum_ns += read_latency_ns;
+    uint64_t read_latency_max_ns = stats_.read_latency_max_ns;
+    while (read_latency_ns > read_latency_max_ns &&
+           !stats_.read_latency_max_ns.compare_exchange_weak(read_latency_max_ns,
+                                                             read_latency_ns)) {
+    }
+  }
+
+  if (!ring_buffer_readers_by_fd_.empty()) {
+    RingBufferReader* reader = ring_buffer_readers_by_fd_.at(event->GetOriginFileDescriptor());
+    reader->deferred_events->enqueue(*reader->deferred_events_producer_token, std::move(event));
+    return;
+  }
+
+  bool was_empty;
+  {
+    std::lock_guard<std::mutex> lock(deferred_events_mutex_);
+    was_empty = deferred_events_.empty();
+    if (was_empty) {
+      first_deferred_event_timestamp_ns_ = current_timestamp_ns;
+    }
+    deferred_events_.emplace_back(std::move(event));
+  }
+
+  // Only the first event of a batch needs to wake up the deferred events thread: it will then
+  // consume all the events deferred in the meantime.
+  if (was_empty && wakeup_mode_ == CaptureOptions::kEventDriven) {
+    deferred_events_cv_.notify_one();
+  }
+}
+
+void TracerThread::NotifyReaderDeferredEvents() {
+  {
+    std::lock_guard<std::mutex> lock(deferred_events_mutex_);
+    if (reader_deferred_events_pending_) {
+      return;
+    }
+    reader_deferred_events_pending_ = true;
+    first_deferred_event_timestamp_ns_ = MonotonicTimestampNs();
+  }
+  if (wakeup_mode_ == CaptureOptions::kEventDriven) {
+    deferred_events_cv_.notify_one();
+  }
+}
+
+uint64_t TracerThread::ComputeDeferredEventsWatermarkNs() {
+  uint64_t watermark_ns = std::numeric_limits<uint64_t>::max();
+  for (const RingBufferReader& reader : ring_buffer_readers_) {
+    watermark_ns = std::min(watermark_ns, reader.watermark_ns.load(std::memory_order_acquire));
+  }
+  return watermark_ns > WATERMARK_SAFETY_MARGIN_NS ? watermark_ns - WATERMARK_SAFETY_MARGIN_NS : 0;
 }
 
 std::vector<std::unique_ptr<PerfEvent>> TracerThread::ConsumeDeferredEvents() {
-  std::lock_guard<std::mutex> lock(deferred_events_mutex_);
-  std::vector<std::unique_ptr<PerfEvent>> events(std::move(deferred_events_));
-  deferred_events_.clear();
+  std::vector<std::unique_ptr<PerfEvent>> events;
+  {
+    std::lock_guard<std::mutex> lock(deferred_events_mutex_);
+    if (!deferred_events_.empty() || reader_deferred_events_pending_) {
+      ++stats_.deferred_events_handoff_count;
+      stats_.deferred_events_handoff_latency_sum_ns +=
+          MonotonicTimestampNs() - first_deferred_event_timestamp_ns_;
+    }
+    events = std::move(deferred_events_);
+    deferred_events_.clear();
+    // Events enqueued by readers after this point will be signaled again.
+    reader_deferred_events_pending_ = false;
+  }
+
+  // Each queue only contains events from the ring buffers of a single reader, in the order in
+  // which they were read, so PerfEventProcessor can still merge them by timestamp.
+  for (RingBufferReader& reader : ring_buffer_readers_) {
+    if (reader.deferred_events == nullptr) {
+      continue;
+    }
+    size_t dequeued_event_count;
+    do {
+      size_t event_count_before = events.size();
+      events.resize(event_count_before + DEFERRED_EVENTS_DEQUEUE_BATCH_SIZE);
+      dequeued_event_count = reader.deferred_events->try_dequeue_bulk(
+          events.begin() + event_count_before, DEFERRED_EVENTS_DEQUEUE_BATCH_SIZE);
+      events.resize(event_count_before + dequeued_event_count);
+    } while (dequeued_event_count == DEFERRED_EVENTS_DEQUEUE_BATCH_SIZE);
+  }
   return events;
 }
 
+void TracerThread::WaitForDeferredEvents() {
+  std::unique_lock<std::mutex> lock(deferred_events_mutex_);
+  // Also wake up periodically, as the watermark can advance without new events, allowing events
+  // that have already been added to event_processor_ to be processed.
+  deferred_events_cv_.wait_for(lock, std::chrono::milliseconds(EVENT_DRIVEN_MAX_WAIT_MS), [this] {
+    return !deferred_events_.empty() || reader_deferred_events_pending_ || stop_deferred_thread_;
+  });
+}
+
 void TracerThread::ProcessDeferredEvents() {
   pthread_setname_np(pthread_self(), "Proc.Def.Events");
   bool should_exit = false;
+  uint64_t last_watermark_ns = 0;
   while (!should_exit) {
     ORBIT_SCOPE("ProcessDeferredEvents iteration");
     // When "should_exit" becomes true, we know that we have stopped generating
     // deferred events. The last iteration will consume all remaining events.
     should_exit = stop_deferred_thread_;
+    // Compute the watermark before consuming the deferred events: as the readers only advance
+    // their watermarks after deferring the events read up to them, all events older than the
+    // watermark are among the events consumed now or earlier.
+    uint64_t watermark_ns = ComputeDeferredEventsWatermarkNs();
     std::vector<std::unique_ptr<PerfEvent>> events = ConsumeDeferredEvents();
-    if (events.empty()) {
-      // TODO: use a wait/notify mechanism instead of check/sleep.
-      ORBIT_SCOPE("Sleep");
-      usleep(IDLE_TIME_ON_EMPTY_DEFERRED_EVENTS_US);
+    if (events.empty() && watermark_ns == last_watermark_ns) {
+      if (wakeup_mode_ == CaptureOptions::kEventDriven) {
+        ORBIT_SCOPE("Wait");
+        WaitForDeferredEvents();
+      } else {
+        ORBIT_SCOPE("Sleep");
+        usleep(IDLE_TIME_ON_EMPTY_DEFERRED_EVENTS_US);
+      }
     } else {
       {
         ORBIT_SCOPE("AddEvents");
@@ -1052,9 +1333,16 @@ void TracerThread::ProcessDeferredEvents() {
       }
       {
         ORBIT_SCOPE("ProcessOldEvents");
-        event_processor_.ProcessOldEvents();
+        uint64_t processed_up_to_ns = event_processor_.ProcessOldEvents(watermark_ns);
+        uint64_t current_timestamp_ns = MonotonicTimestampNs();
+        if (current_timestamp_ns > processed_up_to_ns) {
+          ++stats_.processing_delay_count;
+          stats_.processing_delay_sum_ns += current_timestamp_ns - processed_up_to_ns;
+        }
       }
+      last_watermark_ns = watermark_ns;
     }
+    stats_.deferred_events_thread_cpu_time_ns = ThreadCpuTimeNs();
   }
 }
 
@@ -1106,8 +1394,13 @@ void TracerThread::Reset() {
 
   effective_capture_start_timestamp_ns_ = 0;
 
+  ring_buffer_readers_.clear();
+  ring_buffer_readers_by_fd_.clear();
+
   stop_deferred_thread_ = false;
   deferred_events_.clear();
+  reader_deferred_events_pending_ = false;
+  first_deferred_event_timestamp_ns_ = 0;
   context_switch_manager_.Clear();
   uprobes_unwinding_visitor_.reset();
   thread_state_visitor_.reset();
@@ -1122,19 +1415,22 @@ void TracerThread::PrintStatsIfTimerElapsed() {
     double actual_window_s =
         static_cast<double>(timestamp_ns - stats_.event_count_begin_ns) / NS_PER_SECOND;
     LOG("Events per second (and total) last %.3f s:", actual_window_s);
-    LOG("  sched switches: %.0f/s (%lu)", stats_.sched_switch_count / actual_window_s,
-        stats_.sched_switch_count);
-    LOG("  samples: %.0f/s (%lu)", stats_.sample_count / actual_window_s, stats_.sample_count);
-    LOG("  u(ret)probes: %.0f/s (%lu)", stats_.uprobes_count / actual_window_s,
-        stats_.uprobes_count);
-    LOG("  gpu events: %.0f/s (%lu)", stats_.gpu_events_count / actual_window_s,
-        stats_.gpu_events_count);
-
+    uint64_t sched_switch_count = stats_.sched_switch_count;
+    LOG("  sched switches: %.0f/s (%lu)", sched_switch_count / actual_window_s,
+        sched_switch_count);
+    uint64_t sample_count = stats_.sample_count;
+    LOG("  samples: %.0f/s (%lu)", sample_count / actual_window_s, sample_count);
+    uint64_t uprobes_count = stats_.uprobes_count;
+    LOG("  u(ret)probes: %.0f/s (%lu)", uprobes_count / actual_window_s, uprobes_count);
+    uint64_t gpu_events_count = stats_.gpu_events_count;
+    LOG("  gpu events: %.0f/s (%lu)", gpu_events_count / actual_window_s, gpu_events_count);
+
+    uint64_t lost_count = stats_.lost_count;
+    std::lock_guard<std::mutex> lost_count_per_buffer_lock(stats_.lost_count_per_buffer_mutex);
     if (stats_.lost_count_per_buffer.empty()) {
-      LOG("  lost: %.0f/s (%lu)", stats_.lost_count / actual_window_s, stats_.lost_count);
+      LOG("  lost: %.0f/s (%lu)", lost_count / actual_window_s, lost_count);
     } else {
-      LOG("  LOST: %.0f/s (%lu), of which:", stats_.lost_count / actual_window_s,
-          stats_.lost_count);
+      LOG("  LOST: %.0f/s (%lu), of which:", lost_count / actual_window_s, lost_count);
       for (const auto& buffer_and_lost_count : stats_.lost_count_per_buffer) {
         LOG("    from %s: %.0f/s (%lu)", buffer_and_lost_count.first->GetName().c_str(),
             buffer_and_lost_count.second / actual_window_s, buffer_and_lost_count.second);
@@ -1147,14 +1443,50 @@ void TracerThread::PrintStatsIfTimerElapsed() {
                                           : "DISCARDED AS OUT OF ORDER",
         discarded_out_of_order_count / actual_window_s, discarded_out_of_order_count);
 
+    LOG("  stack sample buffers (total): %lu allocated, %lu reused",
+        stack_sample_buffer_pool_.GetAllocatedBufferCount(),
+        stack_sample_buffer_pool_.GetReusedBufferCount());
+
     uint64_t unwind_error_count = stats_.unwind_error_count;
     LOG("  unwind errors: %.0f/s (%lu) [%.1f%%])", unwind_error_count / actual_window_s,
-        unwind_error_count, 100.0 * unwind_error_count / stats_.sample_count);
+        unwind_error_count, 100.0 * unwind_error_count / sample_count);
     uint64_t discarded_samples_in_uretprobes_count = stats_.discarded_samples_in_uretprobes_count;
     LOG("  discarded samples in u(ret)probes: %.0f/s (%lu) [%.1f%%]",
         discarded_samples_in_uretprobes_count / actual_window_s,
         discarded_samples_in_uretprobes_count,
-        100.0 * discarded_samples_in_uretprobes_count / stats_.sample_count);
+        100.0 * discarded_samples_in_uretprobes_count / sample_count);
+
+    // These allow comparing CaptureOptions::kPolling and CaptureOptions::kEventDriven.
+    double actual_window_ns = actual_window_s * NS_PER_SECOND;
+    LOG("  %s wakeups, %lu ring buffer reader thread(s):",
+        ring_buffer_readers_[0].epoll_fd != -1 ? "event-driven" : "polling",
+        ring_buffer_readers_.size());
+    LOG("    ring buffer reader threads: idle %.1f%% (average), cpu %.1f%% (total)",
+        100.0 * stats_.tracer_idle_ns / actual_window_ns / ring_buffer_readers_.size(),
+        100.0 * stats_.tracer_cpu_time_ns / actual_window_ns);
+    LOG("    deferred events thread: cpu %.1f%%",
+        100.0 *
+            (stats_.deferred_events_thread_cpu_time_ns -
+             stats_.deferred_events_thread_cpu_time_begin_ns) /
+            actual_window_ns);
+    uint64_t read_latency_count = stats_.read_latency_count;
+    LOG("    read latency: avg %.0f us, max %.0f us",
+        read_latency_count == 0
+            ? 0.0
+            : static_cast<double>(stats_.read_latency_sum_ns) / read_latency_count / 1000,
+        stats_.read_latency_max_ns / 1000.0);
+    uint64_t processing_delay_count = stats_.processing_delay_count;
+    LOG("    processing delay: avg %.1f ms",
+        processing_delay_count == 0
+            ? 0.0
+            : static_cast<double>(stats_.processing_delay_sum_ns) / processing_delay_count /
+                  NS_PER_MILLISECOND);
+    uint64_t deferred_events_handoff_count = stats_.deferred_events_handoff_count;
+    LOG("    deferred events handoff latency: avg %.0f us",
+        deferred_events_handoff_count == 0
+            ? 0.0
+            : static_cast<double>(stats_.deferred_events_handoff_latency_sum_ns) /
+                  deferred_events_handoff_count / 1000);
     stats_.Reset();
   }
 }
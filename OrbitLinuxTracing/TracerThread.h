@@ -14,6 +14,7 @@
 #include <tracepoint.pb.h>
 
 #include <atomic>
+#include <condition_variable>
 #include <cstdint>
 #include <limits>
 #include <memory>
@@ -22,15 +23,18 @@
 #include <vector>
 
 #include "ContextSwitchManager.h"
+#include "FixedSizeBufferPool.h"
 #include "GpuTracepointEventProcessor.h"
 #include "LinuxTracingUtils.h"
 #include "ManualInstrumentationConfig.h"
 #include "PerfEvent.h"
+#include "PerfEventOpen.h"
 #include "PerfEventProcessor.h"
 #include "PerfEventRingBuffer.h"
 #include "ThreadStateVisitor.h"
 #include "UprobesUnwindingVisitor.h"
 #include "capture.pb.h"
+#include "concurrentqueue.h"
 
 namespace LinuxTracing {
 
@@ -57,6 +61,10 @@ class TracerThread {
     return std::nullopt;
   }
 
+  // Returns the wakeup watermark to pass to the *_event_open functions for a ring buffer of the
+  // given size, depending on the wakeup mode.
+  [[nodiscard]] uint32_t ComputeWakeupWatermarkBytes(uint64_t ring_buffer_size_kb) const;
+
   bool OpenContextSwitches(const std::vector<int32_t>& cpus);
   void InitUprobesEventVisitor();
   bool OpenUserSpaceProbes(const std::vector<int32_t>& cpus);
@@ -84,6 +92,29 @@ class TracerThread {
 
   bool OpenInstrumentedTracepoints(const std::vector<int32_t>& cpus);
 
+  // Each reader owns a subset of the ring buffers and reads them on its own thread. With more than
+  // one reader, each reader defers events to its own single-producer queue instead of to
+  // deferred_events_, so that readers don't contend on deferred_events_mutex_.
+  using DeferredEventsQueue = moodycamel::ConcurrentQueue<std::unique_ptr<PerfEvent>>;
+  struct RingBufferReader {
+    std::vector<PerfEventRingBuffer*> ring_buffers;
+    // For each ring buffer, the last time it was found empty before moving on to the next one.
+    std::vector<uint64_t> ring_buffers_drained_timestamps_ns;
+    // Minimum of ring_buffers_drained_timestamps_ns, published after the events read up to it
+    // have been deferred. All events with an older timestamp have been deferred.
+    std::atomic<uint64_t> watermark_ns = 0;
+    int epoll_fd = -1;
+    std::unique_ptr<DeferredEventsQueue> deferred_events;
+    std::unique_ptr<moodycamel::ProducerToken> deferred_events_producer_token;
+  };
+
+  void CreateRingBufferReaders();
+  bool OpenRingBuffersEpoll(RingBufferReader* reader);
+  void WaitForRingBuffersData(RingBufferReader* reader);
+  void ReadRingBuffers(RingBufferReader* reader,
+                       const std::shared_ptr<std::atomic<bool>>& exit_requested);
+  void ProcessRecord(PerfEventRingBuffer* ring_buffer);
+
   void ProcessContextSwitchCpuWideEvent(const perf_event_header& header,
                                         PerfEventRingBuffer* ring_buffer);
   void ProcessForkEvent(const perf_event_header& header, PerfEventRingBuffer* ring_buffer);
@@ -93,7 +124,10 @@ class TracerThread {
   void ProcessLostEvent(const perf_event_header& header, PerfEventRingBuffer* ring_buffer);
 
   void DeferEvent(std::unique_ptr<PerfEvent> event);
+  void NotifyReaderDeferredEvents();
+  [[nodiscard]] uint64_t ComputeDeferredEventsWatermarkNs();
   std::vector<std::unique_ptr<PerfEvent>> ConsumeDeferredEvents();
+  void WaitForDeferredEvents();
   void ProcessDeferredEvents();
 
   void RetrieveThreadNamesSystemWide();
@@ -122,10 +156,29 @@ class TracerThread {
   static constexpr uint32_t IDLE_TIME_ON_EMPTY_RING_BUFFERS_US = 100;
   static constexpr uint32_t IDLE_TIME_ON_EMPTY_DEFERRED_EVENTS_US = 1000;
 
+  // Subtracted from the watermark of the ring buffers to account for the short time between the
+  // kernel taking the timestamp of a record and the record becoming visible in the ring buffer.
+  static constexpr uint64_t WATERMARK_SAFETY_MARGIN_NS = 1'000'000;
+
+  // With CaptureOptions::kEventDriven, epoll is woken up when a ring buffer is filled by this
+  // fraction of its size, or after EVENT_DRIVEN_MAX_WAIT_MS at the latest.
+  static constexpr uint64_t WAKEUP_WATERMARK_RING_BUFFER_FRACTION = 8;
+  static constexpr int EVENT_DRIVEN_MAX_WAIT_MS = 10;
+  static constexpr size_t EPOLL_MAX_EVENTS = 64;
+
+  static constexpr size_t DEFERRED_EVENTS_DEQUEUE_BATCH_SIZE = 10'000;
+
+  // Stack copies of stack samples that are kept for reuse once their events have been processed.
+  // As each has size SAMPLE_STACK_USER_SIZE, this amounts to about 16 MB.
+  static constexpr size_t MAX_FREE_STACK_SAMPLE_BUFFERS = 256;
+
   bool trace_context_switches_;
   pid_t pid_;
   uint64_t sampling_period_ns_;
   orbit_grpc_protos::CaptureOptions::UnwindingMethod unwinding_method_;
+  orbit_grpc_protos::CaptureOptions::WakeupMode wakeup_mode_;
+  uint32_t ring_buffer_reader_thread_count_;
+  uint32_t unwinding_thread_count_;
   std::vector<Function> instrumented_functions_;
   ManualInstrumentationConfig manual_instrumentation_config_;
   bool trace_thread_state_;
@@ -134,8 +187,16 @@ class TracerThread {
 
   TracerListener* listener_ = nullptr;
 
+  // Declared before everything that can hold events, so that it outlives them.
+  FixedSizeBufferPool stack_sample_buffer_pool_{SAMPLE_STACK_USER_SIZE,
+                                                MAX_FREE_STACK_SAMPLE_BUFFERS};
+
   std::vector<int> tracing_fds_;
   std::vector<PerfEventRingBuffer> ring_buffers_;
+  std::vector<RingBufferReader> ring_buffer_readers_;
+  // Only filled when there is more than one reader, to route deferred events to the queue of the
+  // reader that read them.
+  absl::flat_hash_map<int, RingBufferReader*> ring_buffer_readers_by_fd_;
 
   absl::flat_hash_map<uint64_t, const Function*> uprobes_uretprobes_ids_to_function_;
   absl::flat_hash_set<uint64_t> uprobes_ids_;
@@ -156,10 +217,15 @@ class TracerThread {
   std::atomic<bool> stop_deferred_thread_ = false;
   std::vector<std::unique_ptr<PerfEvent>> deferred_events_;
   std::mutex deferred_events_mutex_;
+  std::condition_variable deferred_events_cv_;
+  bool reader_deferred_events_pending_ = false;
+  uint64_t first_deferred_event_timestamp_ns_ = 0;
+  std::mutex context_switch_manager_mutex_;
   ContextSwitchManager context_switch_manager_;
   std::unique_ptr<UprobesUnwindingVisitor> uprobes_unwinding_visitor_;
   std::unique_ptr<ThreadStateVisitor> thread_state_visitor_;
   PerfEventProcessor event_processor_;
+  std::mutex gpu_event_processor_mutex_;
   std::unique_ptr<GpuTracepointEventProcessor> gpu_event_processor_;
 
   struct EventStats {
@@ -174,18 +240,47 @@ class TracerThread {
       discarded_out_of_order_count = 0;
       unwind_error_count = 0;
       discarded_samples_in_uretprobes_count = 0;
+      tracer_idle_ns = 0;
+      tracer_cpu_time_ns = 0;
+      deferred_events_thread_cpu_time_begin_ns = deferred_events_thread_cpu_time_ns;
+      read_latency_count = 0;
+      read_latency_sum_ns = 0;
+      read_latency_max_ns = 0;
+      deferred_events_handoff_count = 0;
+      deferred_events_handoff_latency_sum_ns = 0;
+      processing_delay_count = 0;
+      processing_delay_sum_ns = 0;
     }
 
     uint64_t event_count_begin_ns = 0;
-    uint64_t sched_switch_count = 0;
-    uint64_t sample_count = 0;
-    uint64_t uprobes_count = 0;
-    uint64_t gpu_events_count = 0;
-    uint64_t lost_count = 0;
+    std::atomic<uint64_t> sched_switch_count = 0;
+    std::atomic<uint64_t> sample_count = 0;
+    std::atomic<uint64_t> uprobes_count = 0;
+    std::atomic<uint64_t> gpu_events_count = 0;
+    std::atomic<uint64_t> lost_count = 0;
+    std::mutex lost_count_per_buffer_mutex;
     absl::flat_hash_map<PerfEventRingBuffer*, uint64_t> lost_count_per_buffer{};
     std::atomic<uint64_t> discarded_out_of_order_count = 0;
     std::atomic<uint64_t> unwind_error_count = 0;
     std::atomic<uint64_t> discarded_samples_in_uretprobes_count = 0;
+
+    // Time spent waiting for new data, and CPU time, summed over the threads reading the ring
+    // buffers.
+    std::atomic<uint64_t> tracer_idle_ns = 0;
+    std::atomic<uint64_t> tracer_cpu_time_ns = 0;
+    // Not reset, as this is the total CPU time of the deferred events thread so far.
+    std::atomic<uint64_t> deferred_events_thread_cpu_time_ns = 0;
+    uint64_t deferred_events_thread_cpu_time_begin_ns = 0;
+    // Time from the timestamp of an event to when it is read from its ring buffer.
+    std::atomic<uint64_t> read_latency_count = 0;
+    std::atomic<uint64_t> read_latency_sum_ns = 0;
+    std::atomic<uint64_t> read_latency_max_ns = 0;
+    // Time from the current time to the timestamp up to which deferred events have been processed.
+    std::atomic<uint64_t> processing_delay_count = 0;
+    std::atomic<uint64_t> processing_delay_sum_ns = 0;
+    // Time from when a batch of deferred events starts to when it is consumed.
+    std::atomic<uint64_t> deferred_events_handoff_count = 0;
+    std::atomic<uint64_t> deferred_events_handoff_latency_sum_ns = 0;
   };
 
   static constexpr uint64_t EVENT_STATS_WINDOW_S = 5;
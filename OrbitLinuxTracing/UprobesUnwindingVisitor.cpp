@@ -9,7 +9,10 @@
 #include <unwindstack/MapInfo.h>
 #include <unwindstack/Unwinder.h>
 
+#include <absl/time/time.h>
+
 #include <algorithm>
+#include <array>
 #include <optional>
 #include <utility>
 
@@ -25,6 +28,17 @@ using orbit_grpc_protos::Callstack;
 using orbit_grpc_protos::CallstackSample;
 using orbit_grpc_protos::FunctionCall;
 
+UprobesUnwindingVisitor::UprobesUnwindingVisitor(const std::string& initial_maps,
+                                                 uint32_t unwinding_thread_count)
+    : current_maps_{LibunwindstackUnwinder::ParseMaps(initial_maps)} {
+  if (unwinding_thread_count > 1) {
+    unwinding_thread_pool_ = ThreadPool::Create(unwinding_thread_count, unwinding_thread_count,
+                                                absl::Seconds(1));
+  }
+}
+
+UprobesUnwindingVisitor::~UprobesUnwindingVisitor() { FinishUnwindingStackSamples(); }
+
 void UprobesUnwindingVisitor::visit(StackSamplePerfEvent* event) {
   CHECK(listener_ != nullptr);
 
@@ -35,8 +49,65 @@ void UprobesUnwindingVisitor::visit(StackSamplePerfEvent* event) {
   return_address_manager_.PatchSample(event->GetTid(), event->GetRegisters()[PERF_REG_X86_SP],
                                       event->GetStackData(), event->GetStackSize());
 
-  const std::vector<unwindstack::FrameData>& libunwindstack_callstack = unwinder_.Unwind(
-      current_maps_.get(), event->GetRegisters(), event->GetStackData(), event->GetStackSize());
+  if (unwinding_thread_pool_ == nullptr) {
+    ReportUnwoundStackSample(
+        {event->GetTid(), event->GetTimestamp(),
+         unwinder_.Unwind(current_maps_.get(), event->GetRegisters(), event->GetStackData(),
+                          event->GetStackSize())});
+    return;
+  }
+
+  uint64_t sample_index;
+  {
+    absl::MutexLock lock{&pending_stack_samples_mutex_};
+    sample_index = first_pending_stack_sample_index_ + pending_stack_samples_.size();
+    pending_stack_samples_.emplace_back(std::nullopt);
+  }
+
+  pid_t tid = event->GetTid();
+  uint64_t timestamp_ns = event->GetTimestamp();
+  std::array<uint64_t, PERF_REG_X86_64_MAX> registers = event->GetRegisters();
+  // This visitor is the only one interested in stack samples, so take the
+  // (large) stack copy from the event instead of copying it again.
+  std::unique_ptr<dynamically_sized_perf_event_stack_sample> record =
+      std::move(event->ring_buffer_record);
+  unwinding_thread_pool_->Schedule([this, sample_index, maps = current_maps_, tid, timestamp_ns,
+                                    registers, record = std::move(record)] {
+    OnStackSampleUnwound(sample_index,
+                         {tid, timestamp_ns,
+                          unwinder_.Unwind(maps.get(), registers, record->stack.data.get(),
+                                           record->stack.dyn_size)});
+  });
+}
+
+void UprobesUnwindingVisitor::OnStackSampleUnwound(uint64_t sample_index,
+                                                   UnwoundStackSample unwound_sample) {
+  absl::MutexLock lock{&pending_stack_samples_mutex_};
+  pending_stack_samples_[sample_index - first_pending_stack_sample_index_] =
+      std::move(unwound_sample);
+
+  // Report all the samples that are now complete and not preceded by samples
+  // still being unwound. Do it while holding the mutex to preserve the order.
+  while (!pending_stack_samples_.empty() && pending_stack_samples_.front().has_value()) {
+    ReportUnwoundStackSample(pending_stack_samples_.front().value());
+    pending_stack_samples_.pop_front();
+    ++first_pending_stack_sample_index_;
+  }
+}
+
+void UprobesUnwindingVisitor::FinishUnwindingStackSamples() {
+  if (unwinding_thread_pool_ == nullptr) {
+    return;
+  }
+  unwinding_thread_pool_->ShutdownAndWait();
+  unwinding_thread_pool_.reset();
+
+  absl::MutexLock lock{&pending_stack_samples_mutex_};
+  CHECK(pending_stack_samples_.empty());
+}
+
+void UprobesUnwindingVisitor::ReportUnwoundStackSample(const UnwoundStackSample& unwound_sample) {
+  const std::vector<unwindstack::FrameData>& libunwindstack_callstack = unwound_sample.frames;
 
   if (libunwindstack_callstack.empty()) {
     if (unwind_error_counter_ != nullptr) {
@@ -55,8 +126,8 @@ void UprobesUnwindingVisitor::visit(StackSamplePerfEvent* event) {
   }
 
   CallstackSample sample;
-  sample.set_tid(event->GetTid());
-  sample.set_timestamp_ns(event->GetTimestamp());
+  sample.set_tid(unwound_sample.tid);
+  sample.set_timestamp_ns(unwound_sample.timestamp_ns);
 
   Callstack* callstack = sample.mutable_callstack();
   for (const unwindstack::FrameData& libunwindstack_frame : libunwindstack_callstack) {
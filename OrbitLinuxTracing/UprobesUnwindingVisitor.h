@@ -5,15 +5,19 @@
 #ifndef ORBIT_LINUX_TRACING_UPROBES_UNWINDING_VISITOR_H_
 #define ORBIT_LINUX_TRACING_UPROBES_UNWINDING_VISITOR_H_
 
+#include <OrbitBase/ThreadPool.h>
 #include <OrbitLinuxTracing/TracerListener.h>
 #include <absl/container/flat_hash_map.h>
 #include <absl/hash/hash.h>
+#include <absl/synchronization/mutex.h>
 #include <sys/types.h>
 #include <unwindstack/Maps.h>
 
 #include <atomic>
 #include <cstdint>
+#include <deque>
 #include <memory>
+#include <optional>
 #include <string>
 #include <tuple>
 #include <vector>
@@ -41,17 +45,22 @@ namespace LinuxTracing {
 // TODO: Make this more robust to losing uprobes or uretprobes events, if this
 //  is still observed. For example, pass the address of uretprobes and compare
 //  it against the address of uprobes on the stack.
+// With more than one unwinding thread, stack samples are unwound concurrently
+// on a thread pool. Each sample keeps a reference to the maps that were current
+// when it was visited, and the resulting callstacks are reported to the
+// listener in the order in which the samples were visited, i.e., by timestamp.
 
 class UprobesUnwindingVisitor : public PerfEventVisitor {
  public:
-  explicit UprobesUnwindingVisitor(const std::string& initial_maps)
-      : current_maps_{LibunwindstackUnwinder::ParseMaps(initial_maps)} {}
+  explicit UprobesUnwindingVisitor(const std::string& initial_maps,
+                                   uint32_t unwinding_thread_count = 0);
+  ~UprobesUnwindingVisitor() override;
 
   UprobesUnwindingVisitor(const UprobesUnwindingVisitor&) = delete;
   UprobesUnwindingVisitor& operator=(const UprobesUnwindingVisitor&) = delete;
 
-  UprobesUnwindingVisitor(UprobesUnwindingVisitor&&) = default;
-  UprobesUnwindingVisitor& operator=(UprobesUnwindingVisitor&&) = default;
+  UprobesUnwindingVisitor(UprobesUnwindingVisitor&&) = delete;
+  UprobesUnwindingVisitor& operator=(UprobesUnwindingVisitor&&) = delete;
 
   void SetListener(TracerListener* listener) { listener_ = listener; }
 
@@ -68,12 +77,35 @@ class UprobesUnwindingVisitor : public PerfEventVisitor {
   void visit(UretprobesPerfEvent* event) override;
   void visit(MapsPerfEvent* event) override;
 
+  // Blocks until all the stack samples visited so far have been unwound and
+  // reported to the listener.
+  void FinishUnwindingStackSamples();
+
  private:
+  struct UnwoundStackSample {
+    pid_t tid;
+    uint64_t timestamp_ns;
+    std::vector<unwindstack::FrameData> frames;
+  };
+
+  void ReportUnwoundStackSample(const UnwoundStackSample& unwound_sample);
+  void OnStackSampleUnwound(uint64_t sample_index, UnwoundStackSample unwound_sample);
+
   UprobesFunctionCallManager function_call_manager_{};
   UprobesReturnAddressManager return_address_manager_{};
-  std::unique_ptr<unwindstack::BufferMaps> current_maps_;
+  // Replaced, not modified, on every maps change, so that stack samples that
+  // are still being unwound can keep using the previous version.
+  std::shared_ptr<unwindstack::BufferMaps> current_maps_;
   LibunwindstackUnwinder unwinder_{};
 
+  std::unique_ptr<ThreadPool> unwinding_thread_pool_;
+  absl::Mutex pending_stack_samples_mutex_;
+  // Samples submitted to unwinding_thread_pool_ and not reported yet, in the
+  // order in which they were visited. std::nullopt while still being unwound.
+  std::deque<std::optional<UnwoundStackSample>> pending_stack_samples_
+      ABSL_GUARDED_BY(pending_stack_samples_mutex_);
+  uint64_t first_pending_stack_sample_index_ ABSL_GUARDED_BY(pending_stack_samples_mutex_) = 0;
+
   TracerListener* listener_ = nullptr;
 
   std::atomic<uint64_t>* unwind_error_counter_ = nullptr;
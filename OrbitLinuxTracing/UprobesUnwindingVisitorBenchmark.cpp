@@ -0,0 +1,153 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <OrbitLinuxTracing/TracerListener.h>
+#include <benchmark/benchmark.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <unwindstack/MachineX86_64.h>
+#include <unwindstack/RegsGetLocal.h>
+#include <unwindstack/RegsX86_64.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include "LinuxTracingUtils.h"
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/Profiling.h"
+#include "PerfEvent.h"
+#include "PerfEventOpen.h"
+#include "UprobesUnwindingVisitor.h"
+
+namespace LinuxTracing {
+
+namespace {
+
+class CountingTracerListener : public TracerListener {
+ public:
+  void OnSchedulingSlice(orbit_grpc_protos::SchedulingSlice /*scheduling_slice*/) override {}
+  void OnCallstackSample(orbit_grpc_protos::CallstackSample /*callstack_sample*/) override {
+    ++callstack_sample_count_;
+  }
+  void OnFunctionCall(orbit_grpc_protos::FunctionCall /*function_call*/) override {}
+  void OnIntrospectionScope(
+      orbit_grpc_protos::IntrospectionScope /*introspection_scope*/) override {}
+  void OnGpuJob(orbit_grpc_protos::GpuJob /*gpu_job*/) override {}
+  void OnThreadName(orbit_grpc_protos::ThreadName /*thread_name*/) override {}
+  void OnThreadStateSlice(orbit_grpc_protos::ThreadStateSlice /*thread_state_slice*/) override {}
+  void OnAddressInfo(orbit_grpc_protos::AddressInfo /*address_info*/) override {}
+  void OnTracepointEvent(orbit_grpc_protos::TracepointEvent /*tracepoint_event*/) override {}
+  void OnModulesUpdate(orbit_grpc_protos::ModulesUpdateEvent /*modules_update_event*/) override {}
+
+  [[nodiscard]] uint64_t GetCallstackSampleCount() const { return callstack_sample_count_; }
+
+ private:
+  std::atomic<uint64_t> callstack_sample_count_ = 0;
+};
+
+// A stack sample of the calling thread, taken like perf_event_open would take it.
+struct LocalStackSample {
+  perf_event_sample_regs_user_all regs{};
+  std::unique_ptr<char[]> stack_data;
+  uint64_t stack_size = 0;
+};
+
+__attribute__((noinline)) LocalStackSample TakeLocalStackSample() {
+  unwindstack::RegsX86_64 local_regs;
+  unwindstack::RegsGetLocal(&local_regs);
+
+  LocalStackSample sample;
+  sample.regs.ax = local_regs[unwindstack::X86_64_REG_RAX];
+  sample.regs.bx = local_regs[unwindstack::X86_64_REG_RBX];
+  sample.regs.cx = local_regs[unwindstack::X86_64_REG_RCX];
+  sample.regs.dx = local_regs[unwindstack::X86_64_REG_RDX];
+  sample.regs.si = local_regs[unwindstack::X86_64_REG_RSI];
+  sample.regs.di = local_regs[unwindstack::X86_64_REG_RDI];
+  sample.regs.bp = local_regs[unwindstack::X86_64_REG_RBP];
+  sample.regs.sp = local_regs[unwindstack::X86_64_REG_RSP];
+  sample.regs.ip = local_regs[unwindstack::X86_64_REG_RIP];
+  sample.regs.r8 = local_regs[unwindstack::X86_64_REG_R8];
+  sample.regs.r9 = local_regs[unwindstack::X86_64_REG_R9];
+  sample.regs.r10 = local_regs[unwindstack::X86_64_REG_R10];
+  sample.regs.r11 = local_regs[unwindstack::X86_64_REG_R11];
+  sample.regs.r12 = local_regs[unwindstack::X86_64_REG_R12];
+  sample.regs.r13 = local_regs[unwindstack::X86_64_REG_R13];
+  sample.regs.r14 = local_regs[unwindstack::X86_64_REG_R14];
+  sample.regs.r15 = local_regs[unwindstack::X86_64_REG_R15];
+
+  // Copy the stack from the stack pointer up, without reading past the end of
+  // the stack of this thread.
+  pthread_attr_t attr;
+  CHECK(pthread_getattr_np(pthread_self(), &attr) == 0);
+  void* stack_addr;
+  size_t stack_size;
+  CHECK(pthread_attr_getstack(&attr, &stack_addr, &stack_size) == 0);
+  pthread_attr_destroy(&attr);
+  uint64_t stack_end = reinterpret_cast<uint64_t>(stack_addr) + stack_size;
+  sample.stack_size = std::min<uint64_t>(SAMPLE_STACK_USER_SIZE, stack_end - sample.regs.sp);
+  sample.stack_data = std::make_unique<char[]>(sample.stack_size);
+  std::memcpy(sample.stack_data.get(), reinterpret_cast<const void*>(sample.regs.sp),
+              sample.stack_size);
+  return sample;
+}
+
+// Recurse a bit so that the samples have a callstack of realistic depth.
+__attribute__((noinline)) LocalStackSample TakeLocalStackSampleAtDepth(int depth) {
+  if (depth == 0) {
+    return TakeLocalStackSample();
+  }
+  LocalStackSample sample = TakeLocalStackSampleAtDepth(depth - 1);
+  benchmark::DoNotOptimize(sample);
+  return sample;
+}
+
+std::unique_ptr<StackSamplePerfEvent> MakeStackSamplePerfEvent(const LocalStackSample& sample,
+                                                               uint64_t timestamp_ns) {
+  auto event = std::make_unique<StackSamplePerfEvent>(sample.stack_size);
+  event->ring_buffer_record->sample_id.pid = getpid();
+  event->ring_buffer_record->sample_id.tid = GetCurrentThreadId();
+  event->ring_buffer_record->sample_id.time = timestamp_ns;
+  event->ring_buffer_record->regs = sample.regs;
+  std::memcpy(event->GetStackData(), sample.stack_data.get(), sample.stack_size);
+  return event;
+}
+
+// Measures how many stack samples per second UprobesUnwindingVisitor can
+// unwind with the number of unwinding threads given as argument. This includes
+// creating the events, which in TracerThread happens on another thread.
+void BM_UnwindStackSamples(benchmark::State& state) {
+  static constexpr int kCallstackDepth = 32;
+  LocalStackSample sample = TakeLocalStackSampleAtDepth(kCallstackDepth);
+
+  CountingTracerListener listener;
+  uint64_t sample_count = 0;
+  {
+    UprobesUnwindingVisitor visitor{ReadMaps(getpid()), static_cast<uint32_t>(state.range(0))};
+    visitor.SetListener(&listener);
+
+    for (auto _ : state) {
+      std::unique_ptr<StackSamplePerfEvent> event =
+          MakeStackSamplePerfEvent(sample, MonotonicTimestampNs());
+      visitor.visit(event.get());
+      ++sample_count;
+    }
+    visitor.FinishUnwindingStackSamples();
+  }
+
+  CHECK(listener.GetCallstackSampleCount() <= sample_count);
+  state.counters["samples/s"] =
+      benchmark::Counter(static_cast<double>(sample_count), benchmark::Counter::kIsRate);
+  state.counters["unwound"] = static_cast<double>(listener.GetCallstackSampleCount());
+}
+
+BENCHMARK(BM_UnwindStackSamples)->Arg(0)->Arg(2)->Arg(4)->Arg(8)->Arg(16)->UseRealTime();
+
+}  // namespace
+
+}  // namespace LinuxTracing
@@ -0,0 +1,104 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "CaptureEventPacker.h"
+
+namespace orbit_service {
+
+using orbit_grpc_protos::CallstackSample;
+using orbit_grpc_protos::CaptureEvent;
+using orbit_grpc_protos::FunctionCall;
+using orbit_grpc_protos::PackedCaptureEvents;
+using orbit_grpc_protos::SchedulingSlice;
+
+namespace {
+
+// The difference is computed modulo 2^64, so that the decoder recovers the timestamp exactly by
+// adding the delta back modulo 2^64, even for timestamps that go backwards.
+int64_t ComputeTimestampDelta(uint64_t timestamp_ns, uint64_t* last_timestamp_ns) {
+  auto delta = static_cast<int64_t>(timestamp_ns - *last_timestamp_ns);
+  *last_timestamp_ns = timestamp_ns;
+  return delta;
+}
+
+}  // namespace
+
+bool CaptureEventPacker::TryPack(const CaptureEvent& event) {
+  switch (event.event_case()) {
+    case CaptureEvent::kSchedulingSlice:
+      PackSchedulingSlice(event.scheduling_slice());
+      break;
+    case CaptureEvent::kCallstackSample:
+      // Only the key can be packed. Callstacks are always interned by LinuxTracingHandler anyway.
+      if (event.callstack_sample().callstack_or_key_case() != CallstackSample::kCallstackKey) {
+        return false;
+      }
+      PackCallstackSample(event.callstack_sample());
+      break;
+    case CaptureEvent::kFunctionCall:
+      PackFunctionCall(event.function_call());
+      break;
+    default:
+      return false;
+  }
+  ++packed_event_count_;
+  return true;
+}
+
+PackedCaptureEvents CaptureEventPacker::Finish() {
+  PackedCaptureEvents packed_events = std::move(packed_events_);
+  packed_events_.Clear();
+  packed_event_count_ = 0;
+  thread_indices_.clear();
+  last_scheduling_slice_in_timestamp_ns_ = 0;
+  last_callstack_sample_timestamp_ns_ = 0;
+  last_function_call_begin_timestamp_ns_ = 0;
+  return packed_events;
+}
+
+void CaptureEventPacker::PackSchedulingSlice(const SchedulingSlice& scheduling_slice) {
+  orbit_grpc_protos::PackedSchedulingSlices* columns = packed_events_.mutable_scheduling_slices();
+  columns->add_thread_index(GetThreadIndex(scheduling_slice.pid(), scheduling_slice.tid()));
+  columns->add_core(scheduling_slice.core());
+  columns->add_in_timestamp_ns_delta(ComputeTimestampDelta(
+      scheduling_slice.in_timestamp_ns(), &last_scheduling_slice_in_timestamp_ns_));
+  columns->add_duration_ns(scheduling_slice.out_timestamp_ns() -
+                           scheduling_slice.in_timestamp_ns());
+}
+
+void CaptureEventPacker::PackCallstackSample(const CallstackSample& callstack_sample) {
+  orbit_grpc_protos::PackedCallstackSamples* columns = packed_events_.mutable_callstack_samples();
+  columns->add_thread_index(GetThreadIndex(callstack_sample.pid(), callstack_sample.tid()));
+  columns->add_callstack_key(callstack_sample.callstack_key());
+  columns->add_timestamp_ns_delta(ComputeTimestampDelta(callstack_sample.timestamp_ns(),
+                                                        &last_callstack_sample_timestamp_ns_));
+}
+
+void CaptureEventPacker::PackFunctionCall(const FunctionCall& function_call) {
+  orbit_grpc_protos::PackedFunctionCalls* columns = packed_events_.mutable_function_calls();
+  columns->add_thread_index(GetThreadIndex(function_call.pid(), function_call.tid()));
+  columns->add_absolute_address(function_call.absolute_address());
+  columns->add_begin_timestamp_ns_delta(ComputeTimestampDelta(
+      function_call.begin_timestamp_ns(), &last_function_call_begin_timestamp_ns_));
+  columns->add_duration_ns(function_call.end_timestamp_ns() - function_call.begin_timestamp_ns());
+  columns->add_depth(function_call.depth());
+  columns->add_return_value(function_call.return_value());
+  columns->add_register_count(static_cast<uint32_t>(function_call.registers_size()));
+  for (uint64_t register_value : function_call.registers()) {
+    columns->add_registers(register_value);
+  }
+}
+
+uint32_t CaptureEventPacker::GetThreadIndex(int32_t pid, int32_t tid) {
+  auto [it, inserted] = thread_indices_.try_emplace(std::make_pair(pid, tid),
+                                                    static_cast<uint32_t>(thread_indices_.size()));
+  if (inserted) {
+    orbit_grpc_protos::PackedThread* thread = packed_events_.add_threads();
+    thread->set_pid(pid);
+    thread->set_tid(tid);
+  }
+  return it->second;
+}
+
+}  // namespace orbit_service
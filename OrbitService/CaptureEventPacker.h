@@ -0,0 +1,45 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_SERVICE_CAPTURE_EVENT_PACKER_H_
+#define ORBIT_SERVICE_CAPTURE_EVENT_PACKER_H_
+
+#include <cstdint>
+#include <utility>
+
+#include "absl/container/flat_hash_map.h"
+#include "capture.pb.h"
+
+namespace orbit_service {
+
+// CaptureEventPacker accumulates the most frequent CaptureEvents (SchedulingSlices,
+// CallstackSamples with a callstack key, and FunctionCalls) into the columns of a
+// PackedCaptureEvents, which is much smaller on the wire and cheaper to decode than the individual
+// events.
+// The other events are rejected by TryPack and need to be sent individually.
+class CaptureEventPacker {
+ public:
+  // Returns true if event was packed, false if it is of a kind that cannot be packed.
+  bool TryPack(const orbit_grpc_protos::CaptureEvent& event);
+  [[nodiscard]] uint64_t GetPackedEventCount() const { return packed_event_count_; }
+  // Returns the events packed so far and resets the packer.
+  [[nodiscard]] orbit_grpc_protos::PackedCaptureEvents Finish();
+
+ private:
+  void PackSchedulingSlice(const orbit_grpc_protos::SchedulingSlice& scheduling_slice);
+  void PackCallstackSample(const orbit_grpc_protos::CallstackSample& callstack_sample);
+  void PackFunctionCall(const orbit_grpc_protos::FunctionCall& function_call);
+  uint32_t GetThreadIndex(int32_t pid, int32_t tid);
+
+  orbit_grpc_protos::PackedCaptureEvents packed_events_;
+  uint64_t packed_event_count_ = 0;
+  absl::flat_hash_map<std::pair<int32_t, int32_t>, uint32_t> thread_indices_;
+  uint64_t last_scheduling_slice_in_timestamp_ns_ = 0;
+  uint64_t last_callstack_sample_timestamp_ns_ = 0;
+  uint64_t last_function_call_begin_timestamp_ns_ = 0;
+};
+
+}  // namespace orbit_service
+
+#endif  // ORBIT_SERVICE_CAPTURE_EVENT_PACKER_H_
@@ -0,0 +1,120 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include "CaptureEventPacker.h"
+#include "capture.pb.h"
+
+namespace orbit_service {
+
+using orbit_grpc_protos::CaptureEvent;
+using orbit_grpc_protos::PackedCaptureEvents;
+
+namespace {
+
+CaptureEvent CreateSchedulingSlice(int32_t pid, int32_t tid, uint64_t in_timestamp_ns,
+                                   uint64_t out_timestamp_ns) {
+  CaptureEvent event;
+  orbit_grpc_protos::SchedulingSlice* scheduling_slice = event.mutable_scheduling_slice();
+  scheduling_slice->set_pid(pid);
+  scheduling_slice->set_tid(tid);
+  scheduling_slice->set_core(3);
+  scheduling_slice->set_in_timestamp_ns(in_timestamp_ns);
+  scheduling_slice->set_out_timestamp_ns(out_timestamp_ns);
+  return event;
+}
+
+}  // namespace
+
+TEST(CaptureEventPacker, PacksSchedulingSlicesWithDeltasAndThreadIndices) {
+  CaptureEventPacker packer;
+  EXPECT_TRUE(packer.TryPack(CreateSchedulingSlice(1, 10, 1000, 1100)));
+  EXPECT_TRUE(packer.TryPack(CreateSchedulingSlice(1, 11, 1050, 1200)));
+  // Timestamps are not necessarily increasing.
+  EXPECT_TRUE(packer.TryPack(CreateSchedulingSlice(1, 10, 900, 950)));
+  EXPECT_EQ(packer.GetPackedEventCount(), 3);
+
+  PackedCaptureEvents packed_events = packer.Finish();
+  EXPECT_EQ(packer.GetPackedEventCount(), 0);
+
+  ASSERT_EQ(packed_events.threads_size(), 2);
+  EXPECT_EQ(packed_events.threads(0).tid(), 10);
+  EXPECT_EQ(packed_events.threads(1).tid(), 11);
+
+  const orbit_grpc_protos::PackedSchedulingSlices& columns = packed_events.scheduling_slices();
+  ASSERT_EQ(columns.thread_index_size(), 3);
+  EXPECT_EQ(columns.thread_index(0), 0);
+  EXPECT_EQ(columns.thread_index(1), 1);
+  EXPECT_EQ(columns.thread_index(2), 0);
+  EXPECT_EQ(columns.in_timestamp_ns_delta(0), 1000);
+  EXPECT_EQ(columns.in_timestamp_ns_delta(1), 50);
+  EXPECT_EQ(columns.in_timestamp_ns_delta(2), -150);
+  EXPECT_EQ(columns.duration_ns(0), 100);
+  EXPECT_EQ(columns.duration_ns(1), 150);
+  EXPECT_EQ(columns.duration_ns(2), 50);
+  EXPECT_EQ(columns.core(2), 3);
+}
+
+TEST(CaptureEventPacker, PacksFunctionCallsAndCallstackSamplesWithKey) {
+  CaptureEventPacker packer;
+
+  CaptureEvent function_call_event;
+  orbit_grpc_protos::FunctionCall* function_call = function_call_event.mutable_function_call();
+  function_call->set_pid(1);
+  function_call->set_tid(2);
+  function_call->set_absolute_address(0xABCD);
+  function_call->set_begin_timestamp_ns(100);
+  function_call->set_end_timestamp_ns(180);
+  function_call->set_depth(4);
+  function_call->set_return_value(7);
+  function_call->add_registers(5);
+  function_call->add_registers(6);
+  EXPECT_TRUE(packer.TryPack(function_call_event));
+
+  CaptureEvent callstack_sample_event;
+  orbit_grpc_protos::CallstackSample* callstack_sample =
+      callstack_sample_event.mutable_callstack_sample();
+  callstack_sample->set_pid(1);
+  callstack_sample->set_tid(2);
+  callstack_sample->set_timestamp_ns(150);
+  callstack_sample->set_callstack_key(42);
+  EXPECT_TRUE(packer.TryPack(callstack_sample_event));
+
+  PackedCaptureEvents packed_events = packer.Finish();
+  ASSERT_EQ(packed_events.threads_size(), 1);
+
+  const orbit_grpc_protos::PackedFunctionCalls& function_calls = packed_events.function_calls();
+  ASSERT_EQ(function_calls.thread_index_size(), 1);
+  EXPECT_EQ(function_calls.absolute_address(0), 0xABCD);
+  EXPECT_EQ(function_calls.begin_timestamp_ns_delta(0), 100);
+  EXPECT_EQ(function_calls.duration_ns(0), 80);
+  EXPECT_EQ(function_calls.depth(0), 4);
+  EXPECT_EQ(function_calls.return_value(0), 7);
+  EXPECT_EQ(function_calls.register_count(0), 2);
+  ASSERT_EQ(function_calls.registers_size(), 2);
+  EXPECT_EQ(function_calls.registers(1), 6);
+
+  const orbit_grpc_protos::PackedCallstackSamples& callstack_samples =
+      packed_events.callstack_samples();
+  ASSERT_EQ(callstack_samples.thread_index_size(), 1);
+  EXPECT_EQ(callstack_samples.callstack_key(0), 42);
+  EXPECT_EQ(callstack_samples.timestamp_ns_delta(0), 150);
+}
+
+TEST(CaptureEventPacker, RejectsOtherEvents) {
+  CaptureEventPacker packer;
+
+  CaptureEvent callstack_sample_event;
+  callstack_sample_event.mutable_callstack_sample()->mutable_callstack()->add_pcs(1);
+  EXPECT_FALSE(packer.TryPack(callstack_sample_event));
+
+  CaptureEvent thread_name_event;
+  thread_name_event.mutable_thread_name()->set_name("thread");
+  EXPECT_FALSE(packer.TryPack(thread_name_event));
+
+  EXPECT_EQ(packer.GetPackedEventCount(), 0);
+}
+
+}  // namespace orbit_service
@@ -0,0 +1,290 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <benchmark/benchmark.h>
+#include <zlib.h>
+
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "CaptureEventPacker.h"
+#include "OrbitBase/Logging.h"
+#include "OrbitCaptureClient/CaptureEventProcessor.h"
+#include "OrbitCaptureClient/CaptureListener.h"
+#include "capture.pb.h"
+#include "services.pb.h"
+
+namespace orbit_service {
+
+namespace {
+
+using orbit_grpc_protos::CaptureEvent;
+using orbit_grpc_protos::CaptureResponse;
+
+// Speed of a slow SSH tunnel, used to estimate the time the data spends on the wire.
+constexpr double kLinkBytesPerSecond = 2.0 * 1024 * 1024;
+constexpr int kNoCompression = 0;
+
+// Creates the CaptureEvents of one second of a capture of a process with a few busy threads, with
+// DWARF unwinding at 1000 samples per second, context switches, and some instrumented functions.
+std::vector<CaptureEvent> CreateCaptureEvents() {
+  constexpr int32_t kPid = 4242;
+  constexpr int kThreadCount = 16;
+  constexpr int kCoreCount = 8;
+  constexpr int kCallstackCount = 500;
+  constexpr uint64_t kDurationNs = 1'000'000'000;
+  constexpr uint64_t kSamplingPeriodNs = 1'000'000;
+
+  std::mt19937_64 random_engine{0};
+  std::vector<CaptureEvent> events;
+
+  std::uniform_int_distribution<uint64_t> pc_distribution{0x7f0000000000, 0x7f0000ffffff};
+  std::uniform_int_distribution<int> depth_distribution{10, 40};
+  for (int callstack_index = 0; callstack_index < kCallstackCount; ++callstack_index) {
+    CaptureEvent& event = events.emplace_back();
+    event.mutable_interned_callstack()->set_key(callstack_index);
+    int depth = depth_distribution(random_engine);
+    for (int i = 0; i < depth; ++i) {
+      event.mutable_interned_callstack()->mutable_intern()->add_pcs(
+          pc_distribution(random_engine));
+    }
+  }
+
+  std::uniform_int_distribution<uint64_t> callstack_distribution{0, kCallstackCount - 1};
+  std::uniform_int_distribution<uint64_t> jitter_distribution{0, kSamplingPeriodNs / 10};
+  std::uniform_int_distribution<int> function_distribution{0, 19};
+  for (uint64_t timestamp_ns = 0; timestamp_ns < kDurationNs; timestamp_ns += kSamplingPeriodNs) {
+    for (int thread_index = 0; thread_index < kThreadCount; ++thread_index) {
+      uint64_t sample_timestamp_ns = timestamp_ns + jitter_distribution(random_engine);
+      CaptureEvent& sample_event = events.emplace_back();
+      orbit_grpc_protos::CallstackSample* sample = sample_event.mutable_callstack_sample();
+      sample->set_pid(kPid);
+      sample->set_tid(kPid + thread_index);
+      sample->set_callstack_key(callstack_distribution(random_engine));
+      sample->set_timestamp_ns(sample_timestamp_ns);
+
+      CaptureEvent& slice_event = events.emplace_back();
+      orbit_grpc_protos::SchedulingSlice* slice = slice_event.mutable_scheduling_slice();
+      slice->set_pid(kPid);
+      slice->set_tid(kPid + thread_index);
+      slice->set_core(thread_index % kCoreCount);
+      slice->set_in_timestamp_ns(sample_timestamp_ns);
+      slice->set_out_timestamp_ns(sample_timestamp_ns + jitter_distribution(random_engine));
+
+      CaptureEvent& function_call_event = events.emplace_back();
+      orbit_grpc_protos::FunctionCall* function_call = function_call_event.mutable_function_call();
+      function_call->set_pid(kPid);
+      function_call->set_tid(kPid + thread_index);
+      function_call->set_absolute_address(0x7f0000001000 +
+                                          0x100 * function_distribution(random_engine));
+      function_call->set_begin_timestamp_ns(sample_timestamp_ns);
+      function_call->set_end_timestamp_ns(sample_timestamp_ns + jitter_distribution(random_engine));
+      function_call->set_depth(function_distribution(random_engine) % 4);
+    }
+  }
+  return events;
+}
+
+// Groups the events into serialized CaptureResponses like GrpcCaptureEventSender does.
+std::vector<std::string> CreateSerializedCaptureResponses(const std::vector<CaptureEvent>& events,
+                                                          bool pack_events) {
+  constexpr int kMaxEventsPerResponse = 10'000;
+  std::vector<std::string> serialized_responses;
+  CaptureResponse response;
+  CaptureEventPacker packer;
+  auto serialize_response = [&] {
+    if (packer.GetPackedEventCount() > 0) {
+      *response.add_capture_events()->mutable_packed_capture_events() = packer.Finish();
+    }
+    serialized_responses.emplace_back(response.SerializeAsString());
+    response.clear_capture_events();
+  };
+
+  for (const CaptureEvent& event : events) {
+    if (response.capture_events_size() + packer.GetPackedEventCount() == kMaxEventsPerResponse) {
+      serialize_response();
+    }
+    if (pack_events && packer.TryPack(event)) {
+      continue;
+    }
+    *response.add_capture_events() = event;
+  }
+  serialize_response();
+  return serialized_responses;
+}
+
+uint64_t GetTotalSize(const std::vector<std::string>& serialized_responses) {
+  uint64_t total_size = 0;
+  for (const std::string& serialized_response : serialized_responses) {
+    total_size += serialized_response.size();
+  }
+  return total_size;
+}
+
+size_t Compress(const std::string& input, int level, std::vector<Bytef>* output) {
+  uLongf output_size = compressBound(input.size());
+  output->resize(output_size);
+  int result = compress2(output->data(), &output_size, reinterpret_cast<const Bytef*>(input.data()),
+                         input.size(), level);
+  CHECK(result == Z_OK);
+  return output_size;
+}
+
+void Decompress(const std::vector<Bytef>& input, size_t input_size, std::string* output) {
+  uLongf output_size = output->size();
+  int result = uncompress(reinterpret_cast<Bytef*>(output->data()), &output_size, input.data(),
+                          input_size);
+  CHECK(result == Z_OK);
+}
+
+// Compresses the CaptureResponses of one second of a capture with zlib at the level given as first
+// argument (what gRPC's deflate and gzip message compression use, at level 6), with or without
+// packed events depending on the second argument. Level 0 means that the responses are sent
+// uncompressed.
+// The time per iteration is the service CPU time spent compressing one second of capture. Also
+// reports the compression ratio, the bytes sent for one second of capture, and an estimate of the
+// average time from the moment a CaptureResponse is ready to be sent to the moment the client has
+// decompressed it, over a link of kLinkBytesPerSecond.
+void BM_CompressCaptureResponses(benchmark::State& state) {
+  const auto level = static_cast<int>(state.range(0));
+  const bool pack_events = state.range(1) != 0;
+  std::vector<std::string> serialized_responses =
+      CreateSerializedCaptureResponses(CreateCaptureEvents(), pack_events);
+
+  uint64_t uncompressed_byte_count = GetTotalSize(serialized_responses);
+
+  std::vector<Bytef> compressed_response;
+  uint64_t compressed_byte_count = 0;
+  for (auto _ : state) {
+    compressed_byte_count = 0;
+    for (const std::string& serialized_response : serialized_responses) {
+      if (level == kNoCompression) {
+        compressed_byte_count += serialized_response.size();
+        continue;
+      }
+      compressed_byte_count += Compress(serialized_response, level, &compressed_response);
+    }
+    benchmark::DoNotOptimize(compressed_response.data());
+  }
+
+  // Measure the latency separately, one response at a time, outside of the timed loop.
+  double total_latency_s = 0;
+  std::string decompressed_response;
+  for (const std::string& serialized_response : serialized_responses) {
+    if (level == kNoCompression) {
+      total_latency_s += static_cast<double>(serialized_response.size()) / kLinkBytesPerSecond;
+      continue;
+    }
+    decompressed_response.resize(serialized_response.size());
+    auto begin = std::chrono::steady_clock::now();
+    size_t compressed_size = Compress(serialized_response, level, &compressed_response);
+    Decompress(compressed_response, compressed_size, &decompressed_response);
+    auto end = std::chrono::steady_clock::now();
+    CHECK(decompressed_response == serialized_response);
+    total_latency_s += std::chrono::duration<double>(end - begin).count() +
+                       static_cast<double>(compressed_size) / kLinkBytesPerSecond;
+  }
+
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * uncompressed_byte_count));
+  state.counters["ratio"] =
+      static_cast<double>(uncompressed_byte_count) / static_cast<double>(compressed_byte_count);
+  state.counters["wire_bytes/s_of_capture"] = static_cast<double>(compressed_byte_count);
+  state.counters["avg_latency_ms"] =
+      1e3 * total_latency_s / static_cast<double>(serialized_responses.size());
+}
+
+BENCHMARK(BM_CompressCaptureResponses)->Apply([](benchmark::internal::Benchmark* benchmark) {
+  for (int pack_events : {0, 1}) {
+    for (int level : {kNoCompression, 1, 6, 9}) {
+      benchmark->Args({level, pack_events});
+    }
+  }
+});
+
+// Only counts the events, so that the benchmark measures the decoding in CaptureEventProcessor.
+class CountingCaptureListener : public CaptureListener {
+ public:
+  void OnCaptureStarted(ProcessData&& /*process*/,
+                        absl::flat_hash_map<uint64_t, orbit_client_protos::FunctionInfo>
+                        /*selected_functions*/,
+                        TracepointInfoSet /*selected_tracepoints*/,
+                        UserDefinedCaptureData /*user_defined_capture_data*/) override {}
+  void OnCaptureComplete() override {}
+  void OnCaptureCancelled() override {}
+  void OnCaptureFailed(ErrorMessage /*error_message*/) override {}
+  void OnTimer(const orbit_client_protos::TimerInfo& /*timer_info*/) override { ++event_count_; }
+  void OnKeyAndString(uint64_t /*key*/, std::string /*str*/) override {}
+  void OnUniqueCallStack(CallStack /*callstack*/) override {}
+  void OnCallstackEvent(orbit_client_protos::CallstackEvent /*callstack_event*/) override {
+    ++event_count_;
+  }
+  void OnThreadName(int32_t /*thread_id*/, std::string /*thread_name*/) override {}
+  void OnThreadStateSlice(
+      orbit_client_protos::ThreadStateSliceInfo /*thread_state_slice*/) override {}
+  void OnAddressInfo(orbit_client_protos::LinuxAddressInfo /*address_info*/) override {}
+  void OnUniqueTracepointInfo(uint64_t /*key*/,
+                              orbit_grpc_protos::TracepointInfo /*tracepoint_info*/) override {}
+  void OnTracepointEvent(
+      orbit_client_protos::TracepointEventInfo /*tracepoint_event_info*/) override {}
+
+  [[nodiscard]] uint64_t GetEventCount() const { return event_count_; }
+
+ private:
+  uint64_t event_count_ = 0;
+};
+
+// The time per iteration is the service CPU time spent grouping (and packing, if the argument is
+// not 0) one second of capture into CaptureResponses and serializing them. Also reports the bytes
+// sent for one second of capture, before compression.
+void BM_EncodeCaptureResponses(benchmark::State& state) {
+  const bool pack_events = state.range(0) != 0;
+  std::vector<CaptureEvent> events = CreateCaptureEvents();
+
+  uint64_t serialized_byte_count = 0;
+  for (auto _ : state) {
+    std::vector<std::string> serialized_responses =
+        CreateSerializedCaptureResponses(events, pack_events);
+    serialized_byte_count = GetTotalSize(serialized_responses);
+    benchmark::DoNotOptimize(serialized_responses.data());
+  }
+
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * events.size()));
+  state.counters["wire_bytes/s_of_capture"] = static_cast<double>(serialized_byte_count);
+}
+
+BENCHMARK(BM_EncodeCaptureResponses)->Arg(0)->Arg(1);
+
+// The time per iteration is the client CPU time spent parsing the CaptureResponses of one second
+// of capture, sent packed or not depending on the argument, and converting their events to the
+// TimerInfos and CallstackEvents given to the CaptureListener.
+void BM_DecodeCaptureResponses(benchmark::State& state) {
+  const bool pack_events = state.range(0) != 0;
+  std::vector<std::string> serialized_responses =
+      CreateSerializedCaptureResponses(CreateCaptureEvents(), pack_events);
+
+  uint64_t decoded_event_count = 0;
+  for (auto _ : state) {
+    CountingCaptureListener listener;
+    CaptureEventProcessor processor{&listener};
+    CaptureResponse response;
+    for (const std::string& serialized_response : serialized_responses) {
+      CHECK(response.ParseFromString(serialized_response));
+      processor.ProcessEvents(response.capture_events());
+    }
+    decoded_event_count = listener.GetEventCount();
+  }
+
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * decoded_event_count));
+  state.counters["wire_bytes/s_of_capture"] =
+      static_cast<double>(GetTotalSize(serialized_responses));
+}
+
+BENCHMARK(BM_DecodeCaptureResponses)->Arg(0)->Arg(1);
+
+}  // namespace
+
+}  // namespace orbit_service
@@ -5,12 +5,15 @@
 #include "CaptureServiceImpl.h"
 
 #include "CaptureEventBuffer.h"
+#include "CaptureEventPacker.h"
 #include "CaptureEventSender.h"
 #include "LinuxTracingHandler.h"
 #include "OrbitBase/Logging.h"
+#include "SenderThreadCaptureEventBuffer.h"
 
 namespace orbit_service {
 
+using orbit_grpc_protos::CaptureOptions;
 using orbit_grpc_protos::CaptureRequest;
 using orbit_grpc_protos::CaptureResponse;
 
@@ -18,76 +21,14 @@ namespace {
 
 using orbit_grpc_protos::CaptureEvent;
 
-class SenderThreadCaptureEventBuffer final : public CaptureEventBuffer {
- public:
-  explicit SenderThreadCaptureEventBuffer(CaptureEventSender* event_sender)
-      : capture_event_sender_{event_sender} {
-    CHECK(capture_event_sender_ != nullptr);
-    sender_thread_ = std::thread{[this] { SenderThread(); }};
-  }
-
-  void AddEvent(orbit_grpc_protos::CaptureEvent&& event) override {
-    absl::MutexLock lock{&event_buffer_mutex_};
-    if (stop_requested_) {
-      return;
-    }
-    event_buffer_.emplace_back(std::move(event));
-  }
-
-  void StopAndWait() {
-    CHECK(sender_thread_.joinable());
-    {
-      // Protect stop_requested_ with event_buffer_mutex_ so that we can use stop_requested_
-      // in Conditions for Await/LockWhen (specifically, in SenderThread).
-      absl::MutexLock lock{&event_buffer_mutex_};
-      stop_requested_ = true;
-    }
-    sender_thread_.join();
-  }
-
-  ~SenderThreadCaptureEventBuffer() override { CHECK(!sender_thread_.joinable()); }
-
- private:
-  void SenderThread() {
-    pthread_setname_np(pthread_self(), "SenderThread");
-    constexpr absl::Duration kSendTimeInterval = absl::Milliseconds(20);
-    // This should be lower than kMaxEventsPerResponse in GrpcCaptureEventSender::SendEvents
-    // as a few more events are likely to arrive after the condition becomes true.
-    constexpr uint64_t kSendEventCountInterval = 5000;
-
-    bool stopped = false;
-    while (!stopped) {
-      ORBIT_SCOPE("SenderThread iteration");
-      event_buffer_mutex_.LockWhenWithTimeout(absl::Condition(
-                                                  +[](SenderThreadCaptureEventBuffer* self) {
-                                                    return self->event_buffer_.size() >=
-                                                               kSendEventCountInterval ||
-                                                           self->stop_requested_;
-                                                  },
-                                                  this),
-                                              kSendTimeInterval);
-      if (stop_requested_) {
-        stopped = true;
-      }
-      std::vector<CaptureEvent> buffered_events = std::move(event_buffer_);
-      event_buffer_.clear();
-      event_buffer_mutex_.Unlock();
-      capture_event_sender_->SendEvents(std::move(buffered_events));
-    }
-  }
-
-  std::vector<orbit_grpc_protos::CaptureEvent> event_buffer_;
-  absl::Mutex event_buffer_mutex_;
-  CaptureEventSender* capture_event_sender_;
-  std::thread sender_thread_;
-  bool stop_requested_ = false;
-};
-
 class GrpcCaptureEventSender final : public CaptureEventSender {
  public:
   explicit GrpcCaptureEventSender(
-      grpc::ServerReaderWriter<CaptureResponse, CaptureRequest>* reader_writer)
-      : reader_writer_{reader_writer} {
+      grpc::ServerReaderWriter<CaptureResponse, CaptureRequest>* reader_writer,
+      bool enable_packed_capture_events, bool enable_compression)
+      : reader_writer_{reader_writer},
+        enable_packed_capture_events_{enable_packed_capture_events},
+        enable_compression_{enable_compression} {
     CHECK(reader_writer_ != nullptr);
   }
 
@@ -100,23 +41,59 @@ class GrpcCaptureEventSender final : public CaptureEventSender {
 
     constexpr uint64_t kMaxEventsPerResponse = 10'000;
     CaptureResponse response;
+    CaptureEventPacker packer;
     for (CaptureEvent& event : events) {
       // We buffer to avoid sending countless tiny messages, but we also want to
       // avoid huge messages, which would cause the capture on the client to jump
       // forward in time in few big steps and not look live anymore.
-      if (response.capture_events_size() == kMaxEventsPerResponse) {
-        reader_writer_->Write(response);
-        response.clear_capture_events();
+      if (response.capture_events_size() + packer.GetPackedEventCount() == kMaxEventsPerResponse) {
+        WriteResponse(&response, &packer);
+      }
+      if (enable_packed_capture_events_ && packer.TryPack(event)) {
+        continue;
       }
       response.mutable_capture_events()->Add(std::move(event));
     }
-    reader_writer_->Write(response);
+    WriteResponse(&response, &packer);
   }
 
  private:
+  void WriteResponse(CaptureResponse* response, CaptureEventPacker* packer) {
+    // The packed events go last, so that the interned callstacks they refer to precede them.
+    if (packer->GetPackedEventCount() > 0) {
+      *response->add_capture_events()->mutable_packed_capture_events() = packer->Finish();
+    }
+
+    grpc::WriteOptions write_options;
+    if (enable_compression_) {
+      // Compressing a few events costs more CPU than it saves bandwidth.
+      constexpr size_t kMinCompressedResponseSize = 1024;
+      size_t response_size = response->ByteSizeLong();
+      if (response_size < kMinCompressedResponseSize) {
+        write_options.set_no_compression();
+      }
+    }
+    reader_writer_->Write(*response, write_options);
+    response->clear_capture_events();
+  }
+
   grpc::ServerReaderWriter<CaptureResponse, CaptureRequest>* reader_writer_;
+  bool enable_packed_capture_events_;
+  bool enable_compression_;
 };
 
+[[nodiscard]] grpc_compression_algorithm ToGrpcCompressionAlgorithm(
+    CaptureOptions::CaptureResponseCompression compression) {
+  switch (compression) {
+    case CaptureOptions::kDeflate:
+      return GRPC_COMPRESS_DEFLATE;
+    case CaptureOptions::kGzip:
+      return GRPC_COMPRESS_GZIP;
+    default:
+      return GRPC_COMPRESS_NONE;
+  }
+}
+
 }  // namespace
 
 // LinuxTracingHandler::Stop is blocking, until all perf_event_open events have been processed
@@ -147,7 +124,7 @@ static void StopTracingHandlerAndCaptureStartStopListenersInParallel(
 }
 
 grpc::Status CaptureServiceImpl::Capture(
-    grpc::ServerContext*,
+    grpc::ServerContext* context,
     grpc::ServerReaderWriter<CaptureResponse, CaptureRequest>* reader_writer) {
   pthread_setname_np(pthread_self(), "CSImpl::Capture");
   if (is_capturing) {
@@ -157,14 +134,21 @@ grpc::Status CaptureServiceImpl::Capture(
   }
   is_capturing = true;
 
-  GrpcCaptureEventSender capture_event_sender{reader_writer};
-  SenderThreadCaptureEventBuffer capture_event_buffer{&capture_event_sender};
-  LinuxTracingHandler tracing_handler{&capture_event_buffer};
-
   CaptureRequest request;
   reader_writer->Read(&request);
   LOG("Read CaptureRequest from Capture's gRPC stream: starting capture");
 
+  // This needs to be set before the first CaptureResponse is sent.
+  grpc_compression_algorithm compression_algorithm =
+      ToGrpcCompressionAlgorithm(request.capture_options().capture_response_compression());
+  context->set_compression_algorithm(compression_algorithm);
+
+  GrpcCaptureEventSender capture_event_sender{
+      reader_writer, request.capture_options().enable_packed_capture_events(),
+      compression_algorithm != GRPC_COMPRESS_NONE};
+  SenderThreadCaptureEventBuffer capture_event_buffer{&capture_event_sender};
+  LinuxTracingHandler tracing_handler{&capture_event_buffer};
+
   tracing_handler.Start(std::move(*request.mutable_capture_options()));
   for (CaptureStartStopListener* listener : capture_start_stop_listeners_) {
     listener->OnCaptureStartRequested(&capture_event_buffer);
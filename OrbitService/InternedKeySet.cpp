@@ -0,0 +1,62 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "InternedKeySet.h"
+
+namespace orbit_service {
+
+size_t InternedKeySet::ComputeShardIndex(KeySpace key_space, uint64_t key) {
+  // Keys are hashes (or addresses) of varying quality, e.g., callstack keys are a polynomial in the
+  // program counters, so mix them with the key space and take the high bits of a multiplicative
+  // hash.
+  static_assert((kShardCount & (kShardCount - 1)) == 0);
+  static constexpr uint64_t kMultiplier = 0x9E3779B97F4A7C15;
+  uint64_t mixed = (key ^ static_cast<uint64_t>(key_space)) * kMultiplier;
+  return static_cast<size_t>(mixed >> 32) & (kShardCount - 1);
+}
+
+bool InternedKeySet::InsertIfAbsent(KeySpace key_space, uint64_t key) {
+  Shard& shard = shards_[ComputeShardIndex(key_space, key)];
+  const auto key_space_index = static_cast<size_t>(key_space);
+
+  // Any other lookup still in progress on this shard either holds or waits for its lock.
+  bool contended = shard.lookups_in_progress.fetch_add(1, std::memory_order_relaxed) > 0;
+  bool inserted;
+  {
+    absl::MutexLock lock{&shard.mutex};
+    if (contended) {
+      ++shard.contended_lookup_count;
+    }
+    inserted = shard.keys[key_space_index].insert(key).second;
+    if (inserted) {
+      ++shard.stats[key_space_index].miss_count;
+    } else {
+      ++shard.stats[key_space_index].hit_count;
+    }
+  }
+  shard.lookups_in_progress.fetch_sub(1, std::memory_order_relaxed);
+  return inserted;
+}
+
+InternedKeySet::Stats InternedKeySet::GetStats(KeySpace key_space) const {
+  const auto key_space_index = static_cast<size_t>(key_space);
+  Stats total_stats;
+  for (const Shard& shard : shards_) {
+    absl::MutexLock lock{&shard.mutex};
+    total_stats.hit_count += shard.stats[key_space_index].hit_count;
+    total_stats.miss_count += shard.stats[key_space_index].miss_count;
+  }
+  return total_stats;
+}
+
+uint64_t InternedKeySet::GetContendedLookupCount() const {
+  uint64_t total_count = 0;
+  for (const Shard& shard : shards_) {
+    absl::MutexLock lock{&shard.mutex};
+    total_count += shard.contended_lookup_count;
+  }
+  return total_count;
+}
+
+}  // namespace orbit_service
@@ -0,0 +1,71 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_SERVICE_INTERNED_KEY_SET_H_
+#define ORBIT_SERVICE_INTERNED_KEY_SET_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/synchronization/mutex.h"
+
+namespace orbit_service {
+
+// InternedKeySet remembers which keys have already been sent to the client, for the different kinds
+// of values that LinuxTracingHandler interns (addresses, callstacks, strings, tracepoints).
+// It is called concurrently by the threads that produce events, so instead of a single set behind a
+// single mutex per kind of key, keys of all kinds are spread over kShardCount independent shards.
+// Two threads only contend when they look up keys falling in the same shard at the same time.
+//
+// The number of hits (key already present), misses (key inserted), and of lookups that had to wait
+// for the lock of their shard are counted per shard, under the lock that is taken anyway. A lookup
+// waited if another lookup on the same shard was in progress when it started.
+class InternedKeySet {
+ public:
+  enum class KeySpace : size_t { kAddress = 0, kCallstack, kString, kTracepoint };
+  static constexpr size_t kKeySpaceCount = 4;
+
+  struct Stats {
+    uint64_t hit_count = 0;
+    uint64_t miss_count = 0;
+  };
+
+  InternedKeySet() = default;
+  InternedKeySet(const InternedKeySet&) = delete;
+  InternedKeySet& operator=(const InternedKeySet&) = delete;
+  InternedKeySet(InternedKeySet&&) = delete;
+  InternedKeySet& operator=(InternedKeySet&&) = delete;
+
+  // Returns true if key was not yet in the set for key_space, and inserts it. This means that the
+  // caller is the one responsible for sending the interned value.
+  [[nodiscard]] bool InsertIfAbsent(KeySpace key_space, uint64_t key);
+
+  [[nodiscard]] Stats GetStats(KeySpace key_space) const;
+  [[nodiscard]] uint64_t GetContendedLookupCount() const;
+
+ private:
+  static constexpr size_t kShardCount = 64;
+
+  // Aligned to a cache line so that threads working on different shards don't false-share.
+  struct alignas(64) Shard {
+    mutable absl::Mutex mutex;
+    std::array<absl::flat_hash_set<uint64_t>, kKeySpaceCount> keys ABSL_GUARDED_BY(mutex);
+    std::array<Stats, kKeySpaceCount> stats ABSL_GUARDED_BY(mutex);
+    uint64_t contended_lookup_count ABSL_GUARDED_BY(mutex) = 0;
+    // Number of threads between the start and the end of InsertIfAbsent on this shard.
+    std::atomic<uint32_t> lookups_in_progress = 0;
+  };
+
+  [[nodiscard]] static size_t ComputeShardIndex(KeySpace key_space, uint64_t key);
+
+  std::array<Shard, kShardCount> shards_;
+};
+
+}  // namespace orbit_service
+
+#endif  // ORBIT_SERVICE_INTERNED_KEY_SET_H_
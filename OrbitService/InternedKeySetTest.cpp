@@ -0,0 +1,66 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "InternedKeySet.h"
+
+namespace orbit_service {
+
+TEST(InternedKeySet, InsertIfAbsentAndStats) {
+  InternedKeySet interned_keys;
+  EXPECT_TRUE(interned_keys.InsertIfAbsent(InternedKeySet::KeySpace::kCallstack, 42));
+  EXPECT_FALSE(interned_keys.InsertIfAbsent(InternedKeySet::KeySpace::kCallstack, 42));
+  EXPECT_FALSE(interned_keys.InsertIfAbsent(InternedKeySet::KeySpace::kCallstack, 42));
+
+  // The same key in a different key space is a different key.
+  EXPECT_TRUE(interned_keys.InsertIfAbsent(InternedKeySet::KeySpace::kString, 42));
+  EXPECT_TRUE(interned_keys.InsertIfAbsent(InternedKeySet::KeySpace::kString, 43));
+
+  InternedKeySet::Stats callstack_stats =
+      interned_keys.GetStats(InternedKeySet::KeySpace::kCallstack);
+  EXPECT_EQ(callstack_stats.hit_count, 2);
+  EXPECT_EQ(callstack_stats.miss_count, 1);
+
+  InternedKeySet::Stats string_stats = interned_keys.GetStats(InternedKeySet::KeySpace::kString);
+  EXPECT_EQ(string_stats.hit_count, 0);
+  EXPECT_EQ(string_stats.miss_count, 2);
+
+  InternedKeySet::Stats address_stats = interned_keys.GetStats(InternedKeySet::KeySpace::kAddress);
+  EXPECT_EQ(address_stats.hit_count, 0);
+  EXPECT_EQ(address_stats.miss_count, 0);
+}
+
+TEST(InternedKeySet, EachKeyIsInsertedByExactlyOneThread) {
+  constexpr int kThreadCount = 8;
+  constexpr uint64_t kKeyCount = 10'000;
+  InternedKeySet interned_keys;
+  std::atomic<uint64_t> inserted_count = 0;
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kThreadCount; ++i) {
+    threads.emplace_back([&interned_keys, &inserted_count] {
+      for (uint64_t key = 0; key < kKeyCount; ++key) {
+        if (interned_keys.InsertIfAbsent(InternedKeySet::KeySpace::kAddress, key)) {
+          ++inserted_count;
+        }
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_EQ(inserted_count, kKeyCount);
+  InternedKeySet::Stats stats = interned_keys.GetStats(InternedKeySet::KeySpace::kAddress);
+  EXPECT_EQ(stats.miss_count, kKeyCount);
+  EXPECT_EQ(stats.hit_count, (kThreadCount - 1) * kKeyCount);
+}
+
+}  // namespace orbit_service
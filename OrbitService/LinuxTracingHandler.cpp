@@ -4,7 +4,13 @@
 
 #include "LinuxTracingHandler.h"
 
+#include <pthread.h>
+
+#include <array>
+#include <utility>
+
 #include "absl/flags/flag.h"
+#include "absl/strings/str_format.h"
 #include "llvm/Demangle/Demangle.h"
 
 namespace orbit_service {
@@ -29,6 +35,12 @@ void LinuxTracingHandler::Start(CaptureOptions capture_options) {
   tracer_->SetListener(this);
   tracer_->Start();
 
+  {
+    absl::MutexLock lock{&stats_thread_mutex_};
+    stats_thread_stop_requested_ = false;
+  }
+  stats_thread_ = std::thread{[this] { ReportInternedKeysStatsThread(); }};
+
   if (enable_introspection) {
     SetupIntrospection();
   }
@@ -58,6 +70,42 @@ void LinuxTracingHandler::Stop() {
   CHECK(tracer_ != nullptr);
   tracer_->Stop();
   tracer_.reset();
+
+  {
+    absl::MutexLock lock{&stats_thread_mutex_};
+    stats_thread_stop_requested_ = true;
+  }
+  stats_thread_.join();
+  ReportInternedKeysStats();
+}
+
+void LinuxTracingHandler::ReportInternedKeysStatsThread() {
+  pthread_setname_np(pthread_self(), "InternStatsThr");
+  constexpr absl::Duration kReportInterval = absl::Seconds(5);
+
+  absl::MutexLock lock{&stats_thread_mutex_};
+  while (!stats_thread_mutex_.AwaitWithTimeout(absl::Condition(&stats_thread_stop_requested_),
+                                               kReportInterval)) {
+    ReportInternedKeysStats();
+  }
+}
+
+void LinuxTracingHandler::ReportInternedKeysStats() {
+  static constexpr std::array<std::pair<InternedKeySet::KeySpace, const char*>,
+                              InternedKeySet::kKeySpaceCount>
+      kKeySpaceNames{{{InternedKeySet::KeySpace::kAddress, "addresses"},
+                      {InternedKeySet::KeySpace::kCallstack, "callstacks"},
+                      {InternedKeySet::KeySpace::kString, "strings"},
+                      {InternedKeySet::KeySpace::kTracepoint, "tracepoints"}}};
+  for (const auto& [key_space, name] : kKeySpaceNames) {
+    InternedKeySet::Stats stats = interned_keys_.GetStats(key_space);
+    LOG("Interned %s: %lu hits, %lu misses", name, stats.hit_count, stats.miss_count);
+    ORBIT_UINT64(absl::StrFormat("Interned %s hits", name).c_str(), stats.hit_count);
+    ORBIT_UINT64(absl::StrFormat("Interned %s misses", name).c_str(), stats.miss_count);
+  }
+  uint64_t contended_lookup_count = interned_keys_.GetContendedLookupCount();
+  LOG("Interned keys lookups that waited for a lock: %lu", contended_lookup_count);
+  ORBIT_UINT64("Interned keys contended lookups", contended_lookup_count);
 }
 
 void LinuxTracingHandler::OnSchedulingSlice(SchedulingSlice scheduling_slice) {
@@ -112,12 +160,9 @@ void LinuxTracingHandler::OnThreadStateSlice(ThreadStateSlice thread_state_slice
 }
 
 void LinuxTracingHandler::OnAddressInfo(AddressInfo address_info) {
-  {
-    absl::MutexLock lock{&addresses_seen_mutex_};
-    if (addresses_seen_.contains(address_info.absolute_address())) {
-      return;
-    }
-    addresses_seen_.emplace(address_info.absolute_address());
+  if (!interned_keys_.InsertIfAbsent(InternedKeySet::KeySpace::kAddress,
+                                     address_info.absolute_address())) {
+    return;
   }
 
   CHECK(address_info.function_name_or_key_case() == AddressInfo::kFunctionName);
@@ -161,12 +206,8 @@ uint64_t LinuxTracingHandler::ComputeCallstackKey(const Callstack& callstack) {
 
 uint64_t LinuxTracingHandler::InternCallstackIfNecessaryAndGetKey(Callstack callstack) {
   uint64_t key = ComputeCallstackKey(callstack);
-  {
-    absl::MutexLock lock{&callstack_keys_sent_mutex_};
-    if (callstack_keys_sent_.contains(key)) {
-      return key;
-    }
-    callstack_keys_sent_.emplace(key);
+  if (!interned_keys_.InsertIfAbsent(InternedKeySet::KeySpace::kCallstack, key)) {
+    return key;
   }
 
   CaptureEvent event;
@@ -182,12 +223,8 @@ uint64_t LinuxTracingHandler::ComputeStringKey(const std::string& str) {
 
 uint64_t LinuxTracingHandler::InternStringIfNecessaryAndGetKey(std::string str) {
   uint64_t key = ComputeStringKey(str);
-  {
-    absl::MutexLock lock{&string_keys_sent_mutex_};
-    if (string_keys_sent_.contains(key)) {
-      return key;
-    }
-    string_keys_sent_.emplace(key);
+  if (!interned_keys_.InsertIfAbsent(InternedKeySet::KeySpace::kString, key)) {
+    return key;
   }
 
   CaptureEvent event;
@@ -201,12 +238,8 @@ uint64_t LinuxTracingHandler::InternTracepointInfoIfNecessaryAndGetKey(
     const orbit_grpc_protos::TracepointInfo& tracepoint_info) {
   uint64_t key =
       ComputeStringKey(absl::StrCat(tracepoint_info.category(), ":", tracepoint_info.name()));
-  {
-    absl::MutexLock lock{&tracepoint_keys_sent_mutex_};
-    if (tracepoint_keys_sent_.contains(key)) {
-      return key;
-    }
-    tracepoint_keys_sent_.emplace(key);
+  if (!interned_keys_.InsertIfAbsent(InternedKeySet::KeySpace::kTracepoint, key)) {
+    return key;
   }
 
   CaptureEvent event;
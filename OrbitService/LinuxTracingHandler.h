@@ -5,12 +5,15 @@
 #ifndef ORBIT_SERVICE_LINUX_TRACING_HANDLER_H_
 #define ORBIT_SERVICE_LINUX_TRACING_HANDLER_H_
 
+#include <thread>
+
 #include "CaptureEventBuffer.h"
+#include "InternedKeySet.h"
 #include "OrbitBase/Logging.h"
 #include "OrbitBase/Tracing.h"
 #include "OrbitLinuxTracing/Tracer.h"
 #include "OrbitLinuxTracing/TracerListener.h"
-#include "absl/container/flat_hash_set.h"
+#include "absl/base/thread_annotations.h"
 #include "absl/synchronization/mutex.h"
 #include "capture.pb.h"
 
@@ -56,16 +59,17 @@ class LinuxTracingHandler : public LinuxTracing::TracerListener {
   [[nodiscard]] uint64_t InternTracepointInfoIfNecessaryAndGetKey(
       const orbit_grpc_protos::TracepointInfo& tracepoint_info);
 
-  absl::flat_hash_set<uint64_t> addresses_seen_;
-  absl::Mutex addresses_seen_mutex_;
-  absl::flat_hash_set<uint64_t> callstack_keys_sent_;
-  absl::Mutex callstack_keys_sent_mutex_;
-  absl::flat_hash_set<uint64_t> string_keys_sent_;
-  absl::Mutex string_keys_sent_mutex_;
-  absl::flat_hash_set<uint64_t> tracepoint_keys_sent_;
-  absl::Mutex tracepoint_keys_sent_mutex_;
+  // Addresses seen and callstack, string, and tracepoint keys sent.
+  InternedKeySet interned_keys_;
 
   void SetupIntrospection();
+  void ReportInternedKeysStats();
+  // Reports the interned keys stats every few seconds until stats_thread_stop_requested_.
+  void ReportInternedKeysStatsThread();
+
+  std::thread stats_thread_;
+  absl::Mutex stats_thread_mutex_;
+  bool stats_thread_stop_requested_ ABSL_GUARDED_BY(stats_thread_mutex_) = false;
 };
 
 }  // namespace orbit_service
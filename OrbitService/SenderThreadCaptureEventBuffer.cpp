@@ -0,0 +1,142 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "SenderThreadCaptureEventBuffer.h"
+
+#include <pthread.h>
+
+#include <algorithm>
+#include <utility>
+
+#include "OrbitBase/Logging.h"
+#include "OrbitBase/Tracing.h"
+
+namespace orbit_service {
+
+using orbit_grpc_protos::CaptureEvent;
+
+namespace {
+
+// AddressInfos count as interned values: they are only sent once per address, and the client
+// refers to them for every later callstack containing that address.
+bool IsInternedValue(const CaptureEvent& event) {
+  switch (event.event_case()) {
+    case CaptureEvent::kInternedCallstack:
+    case CaptureEvent::kInternedString:
+    case CaptureEvent::kInternedTracepointInfo:
+    case CaptureEvent::kAddressInfo:
+      return true;
+    default:
+      return false;
+  }
+}
+
+}  // namespace
+
+SenderThreadCaptureEventBuffer::SenderThreadCaptureEventBuffer(CaptureEventSender* event_sender,
+                                                               uint64_t max_buffered_event_count)
+    : max_buffered_event_count_{max_buffered_event_count}, capture_event_sender_{event_sender} {
+  CHECK(capture_event_sender_ != nullptr);
+  sender_thread_ = std::thread{[this] { SenderThread(); }};
+}
+
+SenderThreadCaptureEventBuffer::~SenderThreadCaptureEventBuffer() {
+  CHECK(!sender_thread_.joinable());
+}
+
+void SenderThreadCaptureEventBuffer::AddEvent(CaptureEvent&& event) {
+  // This increment and the load of stop_requested_ are ordered against the store of stop_requested_
+  // and the load of add_event_call_count_ in StopAndWait: either this call sees the stop request,
+  // or StopAndWait waits for this call to return before the sender thread drains the queue.
+  ++add_event_call_count_;
+  if (!stop_requested_) {
+    EnqueueEvent(std::move(event));
+  }
+  --add_event_call_count_;
+}
+
+void SenderThreadCaptureEventBuffer::EnqueueEvent(CaptureEvent&& event) {
+  // size_approx is enough here, as max_buffered_event_count_ and kSendEventCountInterval only need
+  // to be rough bounds.
+  size_t buffered_event_count = event_queue_.size_approx();
+  if (buffered_event_count >= max_buffered_event_count_ && !IsInternedValue(event)) {
+    ++dropped_event_count_;
+    return;
+  }
+  event_queue_.enqueue(std::move(event));
+
+  // Only the first call to see enough events takes the lock to wake up the sender thread.
+  if (buffered_event_count + 1 >= kSendEventCountInterval && !send_requested_.exchange(true)) {
+    absl::MutexLock lock{&wakeup_mutex_};
+    send_notified_ = true;
+  }
+}
+
+void SenderThreadCaptureEventBuffer::StopAndWait() {
+  CHECK(sender_thread_.joinable());
+  stop_requested_ = true;
+  // Calls to AddEvent only take a few instructions, so spin until those that might not have seen
+  // stop_requested_ have enqueued their event.
+  while (add_event_call_count_ > 0) {
+    std::this_thread::yield();
+  }
+  {
+    absl::MutexLock lock{&wakeup_mutex_};
+    stop_notified_ = true;
+  }
+  sender_thread_.join();
+
+  uint64_t dropped_event_count = dropped_event_count_;
+  if (dropped_event_count > 0) {
+    ERROR("Dropped %lu CaptureEvents as the sender could not keep up", dropped_event_count);
+  }
+}
+
+void SenderThreadCaptureEventBuffer::SenderThread() {
+  pthread_setname_np(pthread_self(), "SenderThread");
+  constexpr absl::Duration kSendTimeInterval = absl::Milliseconds(20);
+
+  bool stopped = false;
+  while (!stopped) {
+    ORBIT_SCOPE("SenderThread iteration");
+    {
+      absl::MutexLock lock{&wakeup_mutex_};
+      wakeup_mutex_.AwaitWithTimeout(
+          absl::Condition(
+              +[](SenderThreadCaptureEventBuffer* self) ABSL_EXCLUSIVE_LOCKS_REQUIRED(
+                   self->wakeup_mutex_) { return self->send_notified_ || self->stop_notified_; },
+              this),
+          kSendTimeInterval);
+      stopped = stop_notified_;
+      send_notified_ = false;
+    }
+    // Reset before draining, so that events added during the drain can request the next send.
+    send_requested_ = false;
+    DrainAndSendEvents();
+    ORBIT_UINT64("Number of dropped events", dropped_event_count_.load());
+  }
+}
+
+void SenderThreadCaptureEventBuffer::DrainAndSendEvents() {
+  constexpr size_t kDequeueBatchSize = 5000;
+
+  std::vector<CaptureEvent> buffered_events;
+  size_t dequeued_event_count;
+  do {
+    size_t event_count_before = buffered_events.size();
+    buffered_events.resize(event_count_before + kDequeueBatchSize);
+    dequeued_event_count = event_queue_.try_dequeue_bulk(
+        buffered_events.begin() + event_count_before, kDequeueBatchSize);
+    buffered_events.resize(event_count_before + dequeued_event_count);
+  } while (dequeued_event_count == kDequeueBatchSize);
+
+  // Events are only ordered per producing thread. An interned value can have been added by one
+  // thread just before another thread added an event referring to it, so send interned values
+  // first.
+  std::stable_partition(buffered_events.begin(), buffered_events.end(), IsInternedValue);
+
+  capture_event_sender_->SendEvents(std::move(buffered_events));
+}
+
+}  // namespace orbit_service
@@ -0,0 +1,80 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ORBIT_SERVICE_SENDER_THREAD_CAPTURE_EVENT_BUFFER_H_
+#define ORBIT_SERVICE_SENDER_THREAD_CAPTURE_EVENT_BUFFER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "CaptureEventBuffer.h"
+#include "CaptureEventSender.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "capture.pb.h"
+#include "concurrentqueue.h"
+
+namespace orbit_service {
+
+// This CaptureEventBuffer periodically sends the buffered CaptureEvents with a CaptureEventSender,
+// on a dedicated thread, or as soon as kSendEventCountInterval events are buffered.
+// Events are added from many threads (the tracer's, the introspection's, the producers' ones). So
+// that they don't contend on a single lock, they go to a lock-free queue that keeps a separate
+// sub-queue for each producing thread, which the sender thread drains in batches.
+// If the sender cannot keep up and max_buffered_event_count events are already waiting, new events
+// are dropped and counted, instead of letting the buffer grow without limit. Interned values and
+// AddressInfos are never dropped, as they are only sent once and later events refer to them.
+class SenderThreadCaptureEventBuffer final : public CaptureEventBuffer {
+ public:
+  static constexpr uint64_t kDefaultMaxBufferedEventCount = 4'000'000;
+  static constexpr uint64_t kSendEventCountInterval = 5000;
+
+  explicit SenderThreadCaptureEventBuffer(
+      CaptureEventSender* event_sender,
+      uint64_t max_buffered_event_count = kDefaultMaxBufferedEventCount);
+  ~SenderThreadCaptureEventBuffer() override;
+
+  SenderThreadCaptureEventBuffer(const SenderThreadCaptureEventBuffer&) = delete;
+  SenderThreadCaptureEventBuffer& operator=(const SenderThreadCaptureEventBuffer&) = delete;
+  SenderThreadCaptureEventBuffer(SenderThreadCaptureEventBuffer&&) = delete;
+  SenderThreadCaptureEventBuffer& operator=(SenderThreadCaptureEventBuffer&&) = delete;
+
+  void AddEvent(orbit_grpc_protos::CaptureEvent&& event) override;
+
+  // Sends the events still buffered and joins the sender thread. Events added by calls to AddEvent
+  // that start after StopAndWait are ignored, all the others are sent.
+  void StopAndWait();
+
+  [[nodiscard]] uint64_t GetDroppedEventCount() const { return dropped_event_count_; }
+
+ private:
+  void EnqueueEvent(orbit_grpc_protos::CaptureEvent&& event);
+  void SenderThread();
+  void DrainAndSendEvents();
+
+  moodycamel::ConcurrentQueue<orbit_grpc_protos::CaptureEvent> event_queue_;
+  const uint64_t max_buffered_event_count_;
+  std::atomic<uint64_t> dropped_event_count_ = 0;
+  std::atomic<bool> stop_requested_ = false;
+  // Number of calls to AddEvent in progress. StopAndWait waits for it to drop to zero after setting
+  // stop_requested_, so that no event gets enqueued after the last drain.
+  std::atomic<uint64_t> add_event_call_count_ = 0;
+  // Set when kSendEventCountInterval events are buffered, until the sender thread drains them.
+  std::atomic<bool> send_requested_ = false;
+
+  CaptureEventSender* capture_event_sender_;
+  std::thread sender_thread_;
+
+  // Only used for the sender thread to wait for the send interval, a send request, or the stop
+  // request.
+  absl::Mutex wakeup_mutex_;
+  bool send_notified_ ABSL_GUARDED_BY(wakeup_mutex_) = false;
+  bool stop_notified_ ABSL_GUARDED_BY(wakeup_mutex_) = false;
+};
+
+}  // namespace orbit_service
+
+#endif  // ORBIT_SERVICE_SENDER_THREAD_CAPTURE_EVENT_BUFFER_H_
@@ -0,0 +1,162 @@
+// Copyright (c) 2020 The Orbit Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "CaptureEventSender.h"
+#include "SenderThreadCaptureEventBuffer.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/synchronization/mutex.h"
+#include "capture.pb.h"
+
+namespace orbit_service {
+
+using orbit_grpc_protos::CaptureEvent;
+
+namespace {
+
+class RecordingCaptureEventSender : public CaptureEventSender {
+ public:
+  void SendEvents(std::vector<CaptureEvent>&& events) override {
+    absl::MutexLock lock{&mutex_};
+    for (CaptureEvent& event : events) {
+      sent_events_.emplace_back(std::move(event));
+    }
+  }
+
+  [[nodiscard]] std::vector<CaptureEvent> GetSentEvents() {
+    absl::MutexLock lock{&mutex_};
+    return sent_events_;
+  }
+
+ private:
+  absl::Mutex mutex_;
+  std::vector<CaptureEvent> sent_events_;
+};
+
+CaptureEvent CreateCallstackSample(int32_t tid, uint64_t timestamp_ns) {
+  CaptureEvent event;
+  event.mutable_callstack_sample()->set_tid(tid);
+  event.mutable_callstack_sample()->set_timestamp_ns(timestamp_ns);
+  return event;
+}
+
+}  // namespace
+
+TEST(SenderThreadCaptureEventBuffer, SendsAllEventsFromMultipleThreadsInOrderPerThread) {
+  constexpr int32_t kThreadCount = 4;
+  constexpr uint64_t kEventCountPerThread = 20'000;
+
+  RecordingCaptureEventSender sender;
+  SenderThreadCaptureEventBuffer buffer{&sender};
+  std::vector<std::thread> threads;
+  for (int32_t tid = 0; tid < kThreadCount; ++tid) {
+    threads.emplace_back([&buffer, tid] {
+      for (uint64_t timestamp_ns = 0; timestamp_ns < kEventCountPerThread; ++timestamp_ns) {
+        buffer.AddEvent(CreateCallstackSample(tid, timestamp_ns));
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  buffer.StopAndWait();
+
+  std::vector<CaptureEvent> sent_events = sender.GetSentEvents();
+  ASSERT_EQ(sent_events.size(), kThreadCount * kEventCountPerThread);
+  std::vector<uint64_t> next_timestamp_ns_per_thread(kThreadCount, 0);
+  for (const CaptureEvent& event : sent_events) {
+    int32_t tid = event.callstack_sample().tid();
+    EXPECT_EQ(event.callstack_sample().timestamp_ns(), next_timestamp_ns_per_thread[tid]);
+    ++next_timestamp_ns_per_thread[tid];
+  }
+  EXPECT_EQ(buffer.GetDroppedEventCount(), 0);
+}
+
+TEST(SenderThreadCaptureEventBuffer, DropsEventsButNotInternedValuesWhenFull) {
+  RecordingCaptureEventSender sender;
+  constexpr uint64_t kMaxBufferedEventCount = 100;
+  SenderThreadCaptureEventBuffer buffer{&sender, kMaxBufferedEventCount};
+
+  // The sender thread only drains the buffer every few milliseconds, much less often than needed
+  // to keep up with this loop, so events get dropped.
+  constexpr uint64_t kEventCount = 1'000'000;
+  for (uint64_t timestamp_ns = 0; timestamp_ns < kEventCount; ++timestamp_ns) {
+    buffer.AddEvent(CreateCallstackSample(1, timestamp_ns));
+  }
+  CaptureEvent interned_string_event;
+  interned_string_event.mutable_interned_string()->set_key(42);
+  for (uint64_t i = 0; i < kMaxBufferedEventCount; ++i) {
+    buffer.AddEvent(CaptureEvent{interned_string_event});
+  }
+  buffer.StopAndWait();
+
+  std::vector<CaptureEvent> sent_events = sender.GetSentEvents();
+  uint64_t dropped_event_count = buffer.GetDroppedEventCount();
+  EXPECT_GT(dropped_event_count, 0);
+  EXPECT_EQ(sent_events.size() + dropped_event_count, kEventCount + kMaxBufferedEventCount);
+
+  uint64_t interned_string_count = 0;
+  for (const CaptureEvent& event : sent_events) {
+    if (event.event_case() == CaptureEvent::kInternedString) {
+      ++interned_string_count;
+    }
+  }
+  EXPECT_EQ(interned_string_count, kMaxBufferedEventCount);
+}
+
+TEST(SenderThreadCaptureEventBuffer, DoesNotDropAddressInfosWhenFull) {
+  RecordingCaptureEventSender sender;
+  constexpr uint64_t kMaxBufferedEventCount = 100;
+  SenderThreadCaptureEventBuffer buffer{&sender, kMaxBufferedEventCount};
+
+  // The AddressInfos are spread among the samples, so that most of them are added while the buffer
+  // is full.
+  constexpr uint64_t kEventCount = 1'000'000;
+  constexpr uint64_t kSamplesPerAddressInfo = 1000;
+  for (uint64_t timestamp_ns = 0; timestamp_ns < kEventCount; ++timestamp_ns) {
+    buffer.AddEvent(CreateCallstackSample(1, timestamp_ns));
+    if (timestamp_ns % kSamplesPerAddressInfo == 0) {
+      CaptureEvent address_info_event;
+      address_info_event.mutable_address_info()->set_absolute_address(timestamp_ns);
+      buffer.AddEvent(std::move(address_info_event));
+    }
+  }
+  buffer.StopAndWait();
+
+  EXPECT_GT(buffer.GetDroppedEventCount(), 0);
+  absl::flat_hash_set<uint64_t> sent_addresses;
+  for (const CaptureEvent& event : sender.GetSentEvents()) {
+    if (event.event_case() == CaptureEvent::kAddressInfo) {
+      sent_addresses.insert(event.address_info().absolute_address());
+    }
+  }
+  EXPECT_EQ(sent_addresses.size(), kEventCount / kSamplesPerAddressInfo);
+}
+
+TEST(SenderThreadCaptureEventBuffer, SendsInternedValuesFirst) {
+  RecordingCaptureEventSender sender;
+  SenderThreadCaptureEventBuffer buffer{&sender};
+
+  buffer.AddEvent(CreateCallstackSample(1, 1));
+  CaptureEvent interned_callstack_event;
+  interned_callstack_event.mutable_interned_callstack()->set_key(42);
+  buffer.AddEvent(std::move(interned_callstack_event));
+  buffer.StopAndWait();
+
+  std::vector<CaptureEvent> sent_events = sender.GetSentEvents();
+  // Both events are usually sent together, in which case the interned callstack goes first.
+  ASSERT_EQ(sent_events.size(), 2);
+  if (sent_events[0].event_case() == CaptureEvent::kCallstackSample) {
+    GTEST_SKIP() << "The two events were sent separately";
+  }
+  EXPECT_EQ(sent_events[0].event_case(), CaptureEvent::kInternedCallstack);
+  EXPECT_EQ(sent_events[1].event_case(), CaptureEvent::kCallstackSample);
+}
+
+}  // namespace orbit_service
@@ -0,0 +1,45 @@
+from conans import ConanFile, CMake
+
+
+class BenchmarkConan(ConanFile):
+    name = "benchmark"
+    version = "1.5.2"
+    license = "Apache-2.0"
+    description = "A microbenchmark support library"
+    topics = ("benchmark", "performance", "timer")
+    settings = "os", "compiler", "build_type", "arch"
+    options = {"fPIC": [True, False]}
+    default_options = {"fPIC": True}
+    generators = "cmake"
+
+    def config_options(self):
+        if self.settings.os == "Windows":
+            del self.options.fPIC
+
+    def source(self):
+        self.run("git clone https://github.com/google/benchmark.git")
+        self.run("git checkout v{}".format(self.version), cwd="benchmark/")
+
+    def _get_cmake(self):
+        cmake = CMake(self)
+        cmake.definitions["BENCHMARK_ENABLE_TESTING"] = False
+        cmake.definitions["BENCHMARK_ENABLE_GTEST_TESTS"] = False
+        cmake.definitions["BENCHMARK_ENABLE_INSTALL"] = True
+        cmake.definitions["BENCHMARK_ENABLE_LTO"] = False
+        cmake.configure(source_folder="benchmark")
+        return cmake
+
+    def build(self):
+        cmake = self._get_cmake()
+        cmake.build()
+
+    def package(self):
+        cmake = self._get_cmake()
+        cmake.install()
+
+    def package_info(self):
+        self.cpp_info.libs = ["benchmark"]
+        if self.settings.os == "Linux":
+            self.cpp_info.system_libs.append("pthread")
+        elif self.settings.os == "Windows":
+            self.cpp_info.system_libs.append("shlwapi")